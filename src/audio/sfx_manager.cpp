@@ -24,6 +24,7 @@
 #include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "utils/time.hpp"
 
 #include <pthread.h>
 #include <stdexcept>
@@ -85,6 +86,9 @@ SFXManager::SFXManager()
     loadSfx();
 
     pthread_cond_init(&m_cond_request, NULL);
+    m_main_thread   = pthread_self();
+    m_overflow_used = false;
+    m_wake_up.setAtomic(false);
 
     pthread_attr_t  attr;
     pthread_attr_init(&attr);
@@ -110,9 +114,6 @@ SFXManager::SFXManager()
     pthread_attr_destroy(&attr);
 
     setMasterSFXVolume( UserConfigParams::m_sfx_volume );
-    m_sfx_commands.lock();
-    m_sfx_commands.getData().clear();
-    m_sfx_commands.unlock();
 
 }  // SoundManager
 
@@ -175,8 +176,7 @@ SFXManager::~SFXManager()
  */
 void SFXManager::queue(SFXCommands command,  SFXBase *sfx)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, sfx);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx));
 }   // queue
 
 //----------------------------------------------------------------------------
@@ -189,8 +189,7 @@ void SFXManager::queue(SFXCommands command,  SFXBase *sfx)
  */
 void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, f));
 }   // queue(float)
 
 //----------------------------------------------------------------------------
@@ -203,8 +202,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f)
  */
 void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p)
 {
-   SFXCommand *sfx_command = new SFXCommand(command, sfx, p);
-   queueCommand(sfx_command);
+   queueCommand(SFXCommand(command, sfx, p));
 }   // queue (Vec3)
 
 //----------------------------------------------------------------------------
@@ -213,8 +211,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p)
  */
 void SFXManager::queue(SFXCommands command, MusicInformation *mi)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, mi);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi));
 }   // queue(MusicInformation)
 //----------------------------------------------------------------------------
 /** Queues a command for the music manager that takes a floating point value
@@ -224,41 +221,56 @@ void SFXManager::queue(SFXCommands command, MusicInformation *mi)
  */
 void SFXManager::queue(SFXCommands command, MusicInformation *mi, float f)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, mi, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi, f));
 }   // queue(MusicInformation)
 
 //----------------------------------------------------------------------------
-/** Enqueues a command to the sfx queue threadsafe. Then signal the
- *  sfx manager to wake up.
- *  \param command Pointer to the command to queue up.
+/** Enqueues a command to the sfx queue threadsafe. Commands of the main
+ *  thread are added to a lock free queue, so the main thread never has to
+ *  wait for the audio thread and no memory is allocated. The audio thread
+ *  is only woken up once per frame (see update()).
+ *  \param command The command to queue up.
  */
-void SFXManager::queueCommand(SFXCommand *command)
+void SFXManager::queueCommand(const SFXCommand &command)
 {
-    m_sfx_commands.lock();
-    if(World::getWorld() && 
-        m_sfx_commands.getData().size() > 20*race_manager->getNumberOfKarts()+20 &&
-        race_manager->getMinorMode() != RaceManager::MINOR_MODE_CUTSCENE)
+    if (pthread_equal(pthread_self(), m_main_thread) &&
+        !m_overflow_used.load(std::memory_order_acquire) &&
+        m_sfx_commands.push(command))
+        return;
+
+    // The queue is full, or this is not the main thread. If the queue is
+    // full, commands that will be repeated anyway in the next frame are
+    // dropped.
+    if (pthread_equal(pthread_self(), m_main_thread) &&
+        (command.m_command==SFX_POSITION || command.m_command==SFX_LOOP ||
+         command.m_command==SFX_SPEED                                      ))
     {
-        if(command->m_command==SFX_POSITION || command->m_command==SFX_LOOP ||
-           command->m_command==SFX_SPEED                                       )
+        static int count_messages = 0;
+        if(count_messages < 5)
         {
-            delete command;
-            static int count_messages = 0;
-            if(count_messages < 5)
-            {
-                Log::warn("SFXManager", "Throttling sfx - queue size %d",
-                         m_sfx_commands.getData().size());
-                count_messages++;
-            }
-            m_sfx_commands.unlock();
-            return;
-        }   // if throttling
-    }
-    m_sfx_commands.getData().push_back(command);
-    m_sfx_commands.unlock();
+            Log::warn("SFXManager", "Throttling sfx - queue size %d",
+                      m_sfx_commands.size());
+            count_messages++;
+        }
+        return;
+    }   // if throttling
+
+    m_overflow_commands.lock();
+    m_overflow_commands.getData().push_back(command);
+    m_overflow_used.store(true, std::memory_order_release);
+    m_overflow_commands.unlock();
 }   // queueCommand
 
+//----------------------------------------------------------------------------
+/** Wakes up the audio thread. */
+void SFXManager::wakeUp()
+{
+    m_wake_up.lock();
+    m_wake_up.getData() = true;
+    pthread_cond_signal(&m_cond_request);
+    m_wake_up.unlock();
+}   // wakeUp
+
 //----------------------------------------------------------------------------
 /** Puts a NULL request into the queue, which will trigger the thread to
  *  exit.
@@ -267,13 +279,79 @@ void SFXManager::stopThread()
 {
     queue(SFX_EXIT);
     // Make sure the thread wakes up.
-    pthread_cond_signal(&m_cond_request);
+    wakeUp();
 }   // stopThread
 
+//----------------------------------------------------------------------------
+/** Executes one command in the audio thread.
+ *  \param command The command to execute.
+ *  \return False if the command is SFX_EXIT.
+ */
+bool SFXManager::executeCommand(const SFXCommand &command)
+{
+    switch (command.m_command)
+    {
+    case SFX_EXIT:     return false;
+    case SFX_PLAY:     command.m_sfx->reallyPlayNow();       break;
+    case SFX_STOP:     command.m_sfx->reallyStopNow();       break;
+    case SFX_PAUSE:    command.m_sfx->reallyPauseNow();      break;
+    case SFX_RESUME:   command.m_sfx->reallyResumeNow();     break;
+    case SFX_SPEED:    command.m_sfx->reallySetSpeed(
+        command.m_parameter.getX());   break;
+    case SFX_POSITION: command.m_sfx->reallySetPosition(
+        command.m_parameter);   break;
+    case SFX_VOLUME:   command.m_sfx->reallySetVolume(
+        command.m_parameter.getX());   break;
+    case SFX_MASTER_VOLUME:
+        command.m_sfx->reallySetMasterVolumeNow(
+            command.m_parameter.getX());   break;
+    case SFX_LOOP:     command.m_sfx->reallySetLoop(
+        command.m_parameter.getX() != 0);   break;
+    case SFX_DELETE:     deleteSFX(command.m_sfx);           break;
+    case SFX_PAUSE_ALL:  reallyPauseAllNow();                 break;
+    case SFX_RESUME_ALL: reallyResumeAllNow();                break;
+    case SFX_LISTENER:   reallyPositionListenerNow();         break;
+    case SFX_UPDATE:     reallyUpdateNow();                   break;
+    case SFX_MUSIC_START:
+    {
+        command.m_music_information->setDefaultVolume();
+        command.m_music_information->startMusic();           break;
+    }
+    case SFX_MUSIC_STOP:
+        command.m_music_information->stopMusic();            break;
+    case SFX_MUSIC_PAUSE:
+        command.m_music_information->pauseMusic();           break;
+    case SFX_MUSIC_RESUME:
+        command.m_music_information->resumeMusic();
+        // This might be necessasary if the volume was changed
+        // in the in-game menu
+        command.m_music_information->setDefaultVolume();     break;
+    case SFX_MUSIC_SWITCH_FAST:
+        command.m_music_information->switchToFastMusic();    break;
+    case SFX_MUSIC_SET_TMP_VOLUME:
+    {
+        MusicInformation *mi = command.m_music_information;
+        mi->setTemporaryVolume(command.m_parameter.getX());  break;
+    }
+    case SFX_MUSIC_WAITING:
+           command.m_music_information->setMusicWaiting();   break;
+    case SFX_MUSIC_DEFAULT_VOLUME:
+    {
+        command.m_music_information->setDefaultVolume();     break;
+    }
+    default: assert("Not yet supported.");
+    }
+    return true;
+}   // executeCommand
+
 //----------------------------------------------------------------------------
 /** This loops runs in a different threads, and starts sfx to be played.
  *  This can sometimes take up to 5 ms, so it needs to be handled in a thread
- *  in order to avoid rendering delays.
+ *  in order to avoid rendering delays. The thread sleeps till it is woken
+ *  up by the main thread (once per frame), then executes all queued
+ *  commands and updates the music and sfx. If the main thread does not
+ *  wake it up (e.g. while loading), it still updates the music every
+ *  10 ms to keep it playing.
  *  \param obj A pointer to the SFX singleton.
  */
 void* SFXManager::mainLoop(void *obj)
@@ -282,110 +360,64 @@ void* SFXManager::mainLoop(void *obj)
 
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
-    me->m_sfx_commands.lock();
-
-    // Wait till we have an empty sfx in the queue
-    while (me->m_sfx_commands.getData().empty() ||
-           me->m_sfx_commands.getData().front()->m_command!=SFX_EXIT)
+    // Commands taken from the overflow list
+    std::vector<SFXCommand> overflow;
+    bool exit_requested = false;
+    while (!exit_requested)
     {
-        bool empty = me->m_sfx_commands.getData().empty();
-
-        // Wait in cond_wait for a request to arrive. The 'while' is necessary
-        // since "spurious wakeups from the pthread_cond_wait ... may occur"
-        // (pthread_cond_wait man page)!
-        while (empty)
-        {
-            pthread_cond_wait(&me->m_cond_request, me->m_sfx_commands.getMutex());
-            empty = me->m_sfx_commands.getData().empty();
-        }
-        SFXCommand *current = me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
+        struct timespec timeout;
+        StkTime::getAbsoluteTimeout(10, &timeout);
 
-        if (current->m_command == SFX_EXIT)
+        me->m_wake_up.lock();
+        // The 'while' is necessary since "spurious wakeups from the
+        // pthread_cond_wait ... may occur" (pthread_cond_wait man page)!
+        while (!me->m_wake_up.getData())
         {
-            delete current;
-            break;
+            if (pthread_cond_timedwait(&me->m_cond_request,
+                                       me->m_wake_up.getMutex(),
+                                       &timeout) == ETIMEDOUT)
+                break;
         }
-        me->m_sfx_commands.unlock();
-        switch (current->m_command)
-        {
-        case SFX_PLAY:     current->m_sfx->reallyPlayNow();       break;
-        case SFX_STOP:     current->m_sfx->reallyStopNow();       break;
-        case SFX_PAUSE:    current->m_sfx->reallyPauseNow();      break;
-        case SFX_RESUME:   current->m_sfx->reallyResumeNow();     break;
-        case SFX_SPEED:    current->m_sfx->reallySetSpeed(
-            current->m_parameter.getX());   break;
-        case SFX_POSITION: current->m_sfx->reallySetPosition(
-            current->m_parameter);   break;
-        case SFX_VOLUME:   current->m_sfx->reallySetVolume(
-            current->m_parameter.getX());   break;
-        case SFX_MASTER_VOLUME:
-            current->m_sfx->reallySetMasterVolumeNow(
-                current->m_parameter.getX());   break;
-        case SFX_LOOP:     current->m_sfx->reallySetLoop(
-            current->m_parameter.getX() != 0);   break;
-        case SFX_DELETE:     me->deleteSFX(current->m_sfx);       break;
-        case SFX_PAUSE_ALL:  me->reallyPauseAllNow();             break;
-        case SFX_RESUME_ALL: me->reallyResumeAllNow();            break;
-        case SFX_LISTENER:   me->reallyPositionListenerNow();     break;
-        case SFX_UPDATE:     me->reallyUpdateNow(current);        break;
-        case SFX_MUSIC_START:
+        me->m_wake_up.getData() = false;
+        me->m_wake_up.unlock();
+
+        // Execute all commands queued so far. The overflow list is only
+        // used once the queue is empty, since the main thread only adds
+        // to the overflow list when the queue was full before.
+        SFXCommand command;
+        while (!exit_requested)
         {
-            current->m_music_information->setDefaultVolume();
-            current->m_music_information->startMusic();           break;
-        }
-        case SFX_MUSIC_STOP:
-            current->m_music_information->stopMusic();            break;
-        case SFX_MUSIC_PAUSE:
-            current->m_music_information->pauseMusic();           break;
-        case SFX_MUSIC_RESUME:
-            current->m_music_information->resumeMusic();
-            // This might be necessasary if the volume was changed
-            // in the in-game menu
-            current->m_music_information->setDefaultVolume();     break;
-        case SFX_MUSIC_SWITCH_FAST:
-            current->m_music_information->switchToFastMusic();    break;
-        case SFX_MUSIC_SET_TMP_VOLUME:
-        {
-            MusicInformation *mi = current->m_music_information;
-            mi->setTemporaryVolume(current->m_parameter.getX());  break;
-        }
-        case SFX_MUSIC_WAITING:
-               current->m_music_information->setMusicWaiting();   break;
-        case SFX_MUSIC_DEFAULT_VOLUME:
-        {
-            current->m_music_information->setDefaultVolume();
-        }
-        default: assert("Not yet supported.");
-        }
-        delete current;
-        current = NULL;
-        // We access the size without lock, doesn't matter if we
-        // should get an incorrect value because of concurrent read/writes
-        if (me->m_sfx_commands.getData().size() == 0)
-        {
-            // Wait some time to let other threads run, then queue an
-            // update event to keep music playing.
-            double t = StkTime::getRealTime();
-            StkTime::sleep(1);
-            t = StkTime::getRealTime() - t;
-            me->queue(SFX_UPDATE, (SFXBase*)NULL, float(t));
-        }
-        me->m_sfx_commands.lock();
+            if (me->m_sfx_commands.pop(&command))
+            {
+                exit_requested = !me->executeCommand(command);
+                continue;
+            }
+            if (!me->m_overflow_used.load(std::memory_order_acquire))
+                break;
+            me->m_overflow_commands.lock();
+            overflow.swap(me->m_overflow_commands.getData());
+            me->m_overflow_used.store(false, std::memory_order_release);
+            me->m_overflow_commands.unlock();
+            for (unsigned int i = 0; i < overflow.size(); i++)
+            {
+                if (!me->executeCommand(overflow[i]))
+                {
+                    exit_requested = true;
+                    break;
+                }
+            }
+            overflow.clear();
+        }   // while !exit_requested
 
-    }   // while
+        if (!exit_requested)
+            me->reallyUpdateNow();
+    }   // while !exit_requested
 
     // Signal that the sfx manager can now be deleted.
     // We signal this even before cleaning up memory, since there is no
     // need to keep the user waiting for STK to exit.
     me->setCanBeDeleted();
 
-    // Clean up memory to avoid leak detection
-    while(!me->m_sfx_commands.getData().empty())
-    {
-        delete me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
-    }
     return NULL;
 }   // mainLoop
 
@@ -667,23 +699,25 @@ void SFXManager::deleteSFXMapping(const std::string &name)
 }   // deleteSFXMapping
 
 //----------------------------------------------------------------------------
-/** Make sure that the sfx thread is started at least once per frame. It also
- *  adds an update command for the music manager.
- *  \param dt Time step size.
+/** Called once per frame by the main thread. The commands of this frame
+ *  were already added to the single-producer, single-consumer queue
+ *  m_sfx_commands (or m_overflow_commands) when they were issued, so this
+ *  only wakes up the audio thread. The audio thread then pops all queued
+ *  commands and updates all sfx and the music in reallyUpdateNow.
  */
 void SFXManager::update()
 {
-    queue(SFX_UPDATE, (SFXBase*)NULL);
-    // Wake up the sfx thread to handle all queued up audio commands.
-    pthread_cond_signal(&m_cond_request);
+    // Wake up the sfx thread to handle all queued up audio commands, it
+    // will then update all sfx and the music as well.
+    wakeUp();
 }   // update
 
 //----------------------------------------------------------------------------
 /** Updates the status of all playing sfx (to test if they are finished).
- *  This function is executed once per frame (triggered by the audio thread).
- *  \param current The sfx command - used to get timestep information.
+ *  This function is executed by the audio thread after each batch of
+ *  commands, i.e. at least once per frame.
 */
-void SFXManager::reallyUpdateNow(SFXCommand *current)
+void SFXManager::reallyUpdateNow()
 {
     if (m_last_update_time < 0.0)
     {
@@ -695,7 +729,6 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
     m_last_update_time = StkTime::getRealTime();
     float dt = float(m_last_update_time - previous_update_time);
 
-    assert(current->m_command==SFX_UPDATE);
     if (music_manager->getCurrentMusic())
         music_manager->getCurrentMusic()->update(dt);
     m_all_sfx.lock();
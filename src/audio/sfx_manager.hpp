@@ -22,9 +22,11 @@
 #include "utils/can_be_deleted.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/spsc_queue.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
@@ -110,11 +112,10 @@ public:
 private:
 
     /** Data structure for the queue, which stores a sfx and the command to 
-     *  execute for it. */
-    class SFXCommand : public NoCopy
+     *  execute for it. Commands are stored by value in the queue, so this
+     *  must stay small and copyable. */
+    class SFXCommand
     {
-    private:
-        LEAK_CHECK()
     public:
         /** The sound effect for which the command should be executed. */
         SFXBase *m_sfx;
@@ -128,16 +129,25 @@ private:
          *  floating point values are stored in the X component. */
         Vec3        m_parameter;
         // --------------------------------------------------------------------
+        SFXCommand()
+        {
+            m_command           = SFX_EXIT;
+            m_sfx               = NULL;
+            m_music_information = NULL;
+        }   // SFXCommand
+        // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base)
         {
-            m_command   = command;
-            m_sfx       = base;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
         }   // SFXCommand()
         // --------------------------------------------------------------------
         /** Constructor for music information commands. */
         SFXCommand(SFXCommands command, MusicInformation *mi)
         {
             m_command           = command;
+            m_sfx               = NULL;
             m_music_information = mi;
         }   // SFXCommnd(MusicInformation*)
         // --------------------------------------------------------------------
@@ -147,21 +157,24 @@ private:
         {
             m_command = command;
             m_parameter.setX(f);
+            m_sfx               = NULL;
             m_music_information = mi;
         }   // SFXCommnd(MusicInformation *, float)
         // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base, float parameter)
         {
-            m_command   = command;
-            m_sfx       = base;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
             m_parameter.setX(parameter);
         }   // SFXCommand(float)
         // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base, const Vec3 &parameter)
         {
-            m_command   = command;
-            m_sfx       = base;
-            m_parameter = parameter;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
+            m_parameter         = parameter;
         }   // SFXCommand(Vec3)
     };   // SFXCommand
     // ========================================================================
@@ -184,8 +197,28 @@ private:
     /** The actual instances (sound sources) */
     Synchronised<std::vector<SFXBase*> > m_all_sfx;
 
-    /** The list of sound effects to be played in the next update. */
-    Synchronised< std::vector<SFXCommand*> > m_sfx_commands;
+    /** Capacity of m_sfx_commands. */
+    static const unsigned int COMMAND_QUEUE_SIZE = 2048;
+
+    /** The commands queued by the main thread. Adding a command does not
+     *  allocate memory and does not need a lock. */
+    SPSCQueue<SFXCommand, COMMAND_QUEUE_SIZE> m_sfx_commands;
+
+    /** Commands queued by other threads, or by the main thread if
+     *  m_sfx_commands is full. The audio thread only locks this list to
+     *  swap it with its own (empty) list, so this never blocks for long. */
+    Synchronised< std::vector<SFXCommand> > m_overflow_commands;
+
+    /** True if m_overflow_commands is not empty. As long as this is set,
+     *  the main thread adds its commands to m_overflow_commands as well,
+     *  to keep all commands in order. */
+    std::atomic<bool>         m_overflow_used;
+
+    /** The thread that is allowed to add commands to m_sfx_commands. */
+    pthread_t                 m_main_thread;
+
+    /** Set to wake up the audio thread, protected by its own lock. */
+    Synchronised<bool>        m_wake_up;
 
     /** To play non-positional sounds without having to create a
      *  new object for each. */
@@ -202,7 +235,9 @@ private:
 
     double                    m_last_update_time;
 
-    /** A conditional variable to wake up the main loop. */
+    /** A conditional variable to wake up the main loop. It is signalled
+     *  once per frame, so the audio thread handles the commands of a whole
+     *  frame at once. */
     pthread_cond_t            m_cond_request;
 
     void                      loadSfx();
@@ -211,7 +246,9 @@ private:
 
     static void* mainLoop(void *obj);
     void deleteSFX(SFXBase *sfx);
-    void queueCommand(SFXCommand *command);
+    void queueCommand(const SFXCommand &command);
+    bool executeCommand(const SFXCommand &command);
+    void wakeUp();
     void reallyPositionListenerNow();
 
 public:
@@ -256,7 +293,7 @@ public:
     void                     resumeAll();
     void                     reallyResumeAllNow();
     void                     update();
-    void                     reallyUpdateNow(SFXCommand *current);
+    void                     reallyUpdateNow();
     bool                     soundExist(const std::string &name);
     void                     setMasterSFXVolume(float gain);
     float                    getMasterSFXVolume() const { return m_master_gain; }
@@ -275,7 +275,7 @@ void reportHardwareStats()
     if(UserConfigParams::m_last_hw_report_version>=report_version) return;
     while(UserConfigParams::m_random_identifier==0)
     {
-        RandomGenerator rg;
+        RandomGenerator rg(RandomGenerator::ST_LOCAL);
         UserConfigParams::m_random_identifier = rg.get(1<<30);
         user_config->saveConfig();
     }
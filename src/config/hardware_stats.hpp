@@ -82,6 +82,7 @@ namespace HardwareStats
     // ========================================================================
     void reportHardwareStats();
     const std::string& getOSVersion();
+    int getNumProcessors();
 };   // HardwareStats
 
 #endif
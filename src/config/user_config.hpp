@@ -536,6 +536,10 @@ namespace UserConfigParams
 
     PARAM_PREFIX bool m_race_now          PARAM_DEFAULT( false );
 
+    /** Length of a simulation tick in seconds if the simulation uses a
+     *  fixed time step independent of the frame rate, 0 otherwise. */
+    PARAM_PREFIX float m_fixed_timestep   PARAM_DEFAULT( 0.0f );
+
     /** True to test funky ambient/diffuse/specularity in RGB &
      *  all anisotropic */
     PARAM_PREFIX bool m_rendering_debug   PARAM_DEFAULT( false );
@@ -552,7 +556,12 @@ namespace UserConfigParams
 
     PARAM_PREFIX IntUserConfigParam         m_server_max_players
             PARAM_DEFAULT(  IntUserConfigParam(16, "server_max_players",
-                                       "Maximum number of players on the server.") );
+                                       "Maximum number of players in each lobby of the server.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_server_lobbies
+            PARAM_DEFAULT(  IntUserConfigParam(1, "server_lobbies",
+                                       "Number of lobbies hosted by the server. "
+                                       "Only one lobby can race at a time.") );
 
     PARAM_PREFIX StringListUserConfigParam         m_stun_servers
             PARAM_DEFAULT(  StringListUserConfigParam("Stun_servers", "The stun servers"
@@ -583,6 +592,12 @@ namespace UserConfigParams
                             "stun.voxgratia.org",
                             "stun.xten.com") );
 
+    PARAM_PREFIX FloatUserConfigParam       m_network_interpolation_delay
+            PARAM_DEFAULT(  FloatUserConfigParam(0.1f, "network_interpolation_delay",
+                            "Delay (in seconds) with which the karts of other "
+                            "players are shown, so that their received "
+                            "states can be interpolated.") );
+
     PARAM_PREFIX StringUserConfigParam m_packets_log_filename
             PARAM_DEFAULT( StringUserConfigParam("packets_log.txt", "packets_log_filename",
                                                  "Where to log received and sent packets.") );
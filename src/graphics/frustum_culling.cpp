@@ -0,0 +1,557 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/frustum_culling.hpp"
+
+#include "utils/log.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/time.hpp"
+
+#include <ISceneNode.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#  include <immintrin.h>
+#  define FRUSTUM_CULLING_AVX
+#elif defined(__SSE__) || defined(_M_X64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  include <xmmintrin.h>
+#  define FRUSTUM_CULLING_SSE
+#endif
+
+/** Number of boxes that are culled in one thread pool task. */
+static const unsigned int BOXES_PER_TASK     = 512;
+
+/** Minimum number of boxes for which the thread pool is used. With fewer
+ *  boxes the overhead of waking up the threads is larger than the time
+ *  saved. */
+static const unsigned int MIN_PARALLEL_BOXES = 2048;
+
+// ----------------------------------------------------------------------------
+FrustumCulling::FrustumCulling()
+{
+    m_num_boxes   = 0;
+    m_num_frusta  = 0;
+    m_num_updated = 0;
+}   // FrustumCulling
+
+// ----------------------------------------------------------------------------
+/** Starts a new frame: removes all boxes (the corners of the boxes are kept
+ *  to be reused if the same node is added again at the same index) and
+ *  all frusta.
+ */
+void FrustumCulling::reset()
+{
+    m_num_boxes   = 0;
+    m_num_frusta  = 0;
+    m_num_updated = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Sets the planes of one frustum. All frusta from 0 to index-1 must be
+ *  set, too.
+ *  \param index Index of the frustum, i.e. the bit in the result mask.
+ *  \param frustum The frustum.
+ */
+void FrustumCulling::setFrustum(unsigned int index,
+                                const scene::SViewFrustum &frustum)
+{
+    assert(index < MAX_FRUSTA);
+    for (unsigned int i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        const core::plane3df &plane = frustum.planes[i];
+        m_planes[index][i][0] = plane.Normal.X;
+        m_planes[index][i][1] = plane.Normal.Y;
+        m_planes[index][i][2] = plane.Normal.Z;
+        m_planes[index][i][3] = plane.D;
+    }
+    if (index >= m_num_frusta)
+        m_num_frusta = index + 1;
+}   // setFrustum
+
+// ----------------------------------------------------------------------------
+/** Adds the bounding box of a scene node.
+ *  \param node The scene node, its absolute transformation must be up to
+ *         date.
+ *  \return The index of the box.
+ */
+unsigned int FrustumCulling::addNode(const scene::ISceneNode *node)
+{
+    return addBox(node->getAbsoluteTransformation(), node->getBoundingBox(),
+                  node->getAutomaticCulling() != scene::EAC_OFF, node);
+}   // addNode
+
+// ----------------------------------------------------------------------------
+/** Adds a box. If the same node with the same transform and box was added
+ *  at the same index in the last frame, the corners computed then are
+ *  used.
+ *  \param transform The transform from object to world space.
+ *  \param box The bounding box in object space.
+ *  \param can_cull False if the box must never be culled.
+ *  \param node The scene node the box belongs to, or NULL.
+ *  \return The index of the box.
+ */
+unsigned int FrustumCulling::addBox(const core::matrix4 &transform,
+                                    const core::aabbox3df &box,
+                                    bool can_cull,
+                                    const scene::ISceneNode *node)
+{
+    unsigned int index = m_num_boxes++;
+    const bool is_new = index >= m_nodes.size();
+    if (is_new)
+    {
+        m_nodes.push_back(node);
+        m_transforms.resize(m_transforms.size() + 16);
+        m_boxes.resize(m_boxes.size() + 6);
+        m_corners.resize(m_corners.size() + 24);
+        m_can_cull.push_back(0);
+        m_culled.push_back(0);
+    }
+    m_can_cull[index] = can_cull ? 1 : 0;
+
+    const float box_data[6] = { box.MinEdge.X, box.MinEdge.Y, box.MinEdge.Z,
+                                box.MaxEdge.X, box.MaxEdge.Y, box.MaxEdge.Z };
+    if (is_new || m_nodes[index] != node                                ||
+        memcmp(&m_transforms[index*16], transform.pointer(),
+               16*sizeof(float)) != 0                                   ||
+        memcmp(&m_boxes[index*6], box_data, 6*sizeof(float)) != 0        )
+    {
+        m_nodes[index] = node;
+        memcpy(&m_transforms[index*16], transform.pointer(), 16*sizeof(float));
+        memcpy(&m_boxes[index*6], box_data, 6*sizeof(float));
+        setBox(index, transform, box);
+        m_num_updated++;
+    }
+    return index;
+}   // addBox
+
+// ----------------------------------------------------------------------------
+/** Computes the world space corners of a box, in the same way as Irrlicht
+ *  does (so that the results of the culling are identical).
+ */
+void FrustumCulling::setBox(unsigned int index,
+                            const core::matrix4 &transform,
+                            const core::aabbox3df &box)
+{
+    core::vector3df edges[8];
+    box.getEdges(edges);
+    float *c = &m_corners[index*24];
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        transform.transformVect(edges[i]);
+        c[i   ] = edges[i].X;
+        c[i+ 8] = edges[i].Y;
+        c[i+16] = edges[i].Z;
+    }
+}   // setBox
+
+// ----------------------------------------------------------------------------
+/** Tests a range of boxes against all frusta. A box is culled by a frustum
+ *  if all its corners are in front of one of the planes, using the same
+ *  computation and tolerance as plane3d::classifyPointRelation.
+ *  \param first Index of the first box.
+ *  \param last Index after the last box.
+ */
+void FrustumCulling::cullBoxes(unsigned int first, unsigned int last)
+{
+    const unsigned int num_planes = scene::SViewFrustum::VF_PLANE_COUNT;
+    const unsigned int num        = m_num_frusta*num_planes;
+    const float (*planes)[4]      = &m_planes[0][0];
+#if defined(FRUSTUM_CULLING_AVX)
+    __m256 nx[MAX_FRUSTA*num_planes], ny[MAX_FRUSTA*num_planes],
+           nz[MAX_FRUSTA*num_planes], d[MAX_FRUSTA*num_planes];
+    for (unsigned int p = 0; p < num; p++)
+    {
+        nx[p] = _mm256_set1_ps(planes[p][0]);
+        ny[p] = _mm256_set1_ps(planes[p][1]);
+        nz[p] = _mm256_set1_ps(planes[p][2]);
+        d[p]  = _mm256_set1_ps(planes[p][3]);
+    }
+    const __m256 eps = _mm256_set1_ps(core::ROUNDING_ERROR_f32);
+#elif defined(FRUSTUM_CULLING_SSE)
+    __m128 nx[MAX_FRUSTA*num_planes], ny[MAX_FRUSTA*num_planes],
+           nz[MAX_FRUSTA*num_planes], d[MAX_FRUSTA*num_planes];
+    for (unsigned int p = 0; p < num; p++)
+    {
+        nx[p] = _mm_set1_ps(planes[p][0]);
+        ny[p] = _mm_set1_ps(planes[p][1]);
+        nz[p] = _mm_set1_ps(planes[p][2]);
+        d[p]  = _mm_set1_ps(planes[p][3]);
+    }
+    const __m128 eps = _mm_set1_ps(core::ROUNDING_ERROR_f32);
+#endif
+
+    for (unsigned int i = first; i < last; i++)
+    {
+        unsigned char culled = 0;
+        if (!m_can_cull[i])
+        {
+            m_culled[i] = 0;
+            continue;
+        }
+        const float *c = &m_corners[i*24];
+#if defined(FRUSTUM_CULLING_AVX)
+        const __m256 x = _mm256_loadu_ps(c);
+        const __m256 y = _mm256_loadu_ps(c+8);
+        const __m256 z = _mm256_loadu_ps(c+16);
+#elif defined(FRUSTUM_CULLING_SSE)
+        const __m128 x0 = _mm_loadu_ps(c),    x1 = _mm_loadu_ps(c+4);
+        const __m128 y0 = _mm_loadu_ps(c+8),  y1 = _mm_loadu_ps(c+12);
+        const __m128 z0 = _mm_loadu_ps(c+16), z1 = _mm_loadu_ps(c+20);
+#endif
+        for (unsigned int f = 0; f < m_num_frusta; f++)
+        {
+            for (unsigned int j = 0; j < num_planes; j++)
+            {
+                const unsigned int p = f*num_planes + j;
+                // The order of the operations is the same as in
+                // plane3d::classifyPointRelation
+#if defined(FRUSTUM_CULLING_AVX)
+                __m256 dist = _mm256_mul_ps(nx[p], x);
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(ny[p], y));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(nz[p], z));
+                dist = _mm256_add_ps(dist, d[p]);
+                const bool in_front =
+                    _mm256_movemask_ps(_mm256_cmp_ps(dist, eps,
+                                                     _CMP_GT_OQ)) == 0xFF;
+#elif defined(FRUSTUM_CULLING_SSE)
+                __m128 dist0 = _mm_mul_ps(nx[p], x0);
+                __m128 dist1 = _mm_mul_ps(nx[p], x1);
+                dist0 = _mm_add_ps(dist0, _mm_mul_ps(ny[p], y0));
+                dist1 = _mm_add_ps(dist1, _mm_mul_ps(ny[p], y1));
+                dist0 = _mm_add_ps(dist0, _mm_mul_ps(nz[p], z0));
+                dist1 = _mm_add_ps(dist1, _mm_mul_ps(nz[p], z1));
+                dist0 = _mm_add_ps(dist0, d[p]);
+                dist1 = _mm_add_ps(dist1, d[p]);
+                const bool in_front =
+                    (_mm_movemask_ps(_mm_cmpgt_ps(dist0, eps)) &
+                     _mm_movemask_ps(_mm_cmpgt_ps(dist1, eps))) == 0xF;
+#else
+                bool in_front = true;
+                for (unsigned int k = 0; k < 8 && in_front; k++)
+                {
+                    const float dist = planes[p][0]*c[k]
+                                     + planes[p][1]*c[k+8]
+                                     + planes[p][2]*c[k+16]
+                                     + planes[p][3];
+                    in_front = dist > core::ROUNDING_ERROR_f32;
+                }
+#endif
+                if (in_front)
+                {
+                    culled |= 1 << f;
+                    break;
+                }
+            }   // for j < num_planes
+        }   // for f < m_num_frusta
+        m_culled[i] = culled;
+    }   // for i
+}   // cullBoxes
+
+// ----------------------------------------------------------------------------
+/** Thread pool task which culls one range of boxes.
+ *  \param index Index of the range.
+ *  \param data Pointer to the FrustumCulling object.
+ */
+void FrustumCulling::cullTask(unsigned int index, void *data)
+{
+    FrustumCulling *culling = (FrustumCulling*)data;
+    unsigned int last = (index+1)*BOXES_PER_TASK;
+    if (last > culling->m_num_boxes)
+        last = culling->m_num_boxes;
+    culling->cullBoxes(index*BOXES_PER_TASK, last);
+}   // cullTask
+
+// ----------------------------------------------------------------------------
+/** Tests all boxes against all frusta, the results can then be queried
+ *  with getCulled().
+ *  \param use_thread_pool If the boxes can be distributed to the thread
+ *         pool (if there are enough of them).
+ */
+void FrustumCulling::cull(bool use_thread_pool)
+{
+    if (use_thread_pool && thread_pool && m_num_boxes >= MIN_PARALLEL_BOXES)
+    {
+        unsigned int num_tasks = (m_num_boxes + BOXES_PER_TASK - 1)
+                               / BOXES_PER_TASK;
+        thread_pool->run(num_tasks, &cullTask, this);
+    }
+    else
+        cullBoxes(0, m_num_boxes);
+}   // cull
+
+// ============================================================================
+namespace FrustumCullingTest
+{
+    /** Returns a random float between min and max. */
+    float random(float min, float max)
+    {
+        return min + (max-min)*(rand()%10001)/10000.0f;
+    }   // random
+
+    // ------------------------------------------------------------------------
+    /** Returns a random transform with rotation, scale and translation. */
+    core::matrix4 randomTransform(float size)
+    {
+        core::matrix4 rotation, scale;
+        rotation.setRotationDegrees(core::vector3df(random(0, 360),
+                                                    random(0, 360),
+                                                    random(0, 360)));
+        rotation.setTranslation(core::vector3df(random(-size, size),
+                                                random(-10, 30),
+                                                random(-size, size)));
+        scale.setScale(core::vector3df(random(0.5f, 2.0f),
+                                       random(0.5f, 2.0f),
+                                       random(0.5f, 2.0f)));
+        return rotation*scale;
+    }   // randomTransform
+
+    // ------------------------------------------------------------------------
+    /** Returns a random box. */
+    core::aabbox3df randomBox(float max_size)
+    {
+        core::vector3df min(random(-max_size, 0), random(-max_size, 0),
+                            random(-max_size, 0));
+        return core::aabbox3df(min, min + core::vector3df(
+                                              random(0.1f, max_size),
+                                              random(0.1f, max_size),
+                                              random(0.1f, max_size)));
+    }   // randomBox
+
+    // ------------------------------------------------------------------------
+    /** Creates the frusta of a camera at a random position, of the RSM
+     *  camera and of 4 shadow cascades (similar to the ones the renderer
+     *  uses).
+     */
+    void randomFrusta(float size, scene::SViewFrustum frusta[6])
+    {
+        core::vector3df position(random(-size, size), random(2, 10),
+                                 random(-size, size));
+        core::vector3df target = position
+                               + core::vector3df(random(-1, 1), random(-0.2f, 0),
+                                                 random(-1, 1));
+        core::matrix4 view, projection;
+        view.buildCameraLookAtMatrixLH(position, target,
+                                       core::vector3df(0, 1, 0));
+        projection.buildProjectionMatrixPerspectiveFovLH(1.0f, 16.0f/9.0f,
+                                                         1.0f, 1000.0f);
+        frusta[0].setFrom(projection*view);
+
+        core::matrix4 sun_view;
+        sun_view.buildCameraLookAtMatrixLH(core::vector3df(500, 250, 250),
+                                           core::vector3df(0, 0, 0),
+                                           core::vector3df(0, 1, 0));
+        projection.buildProjectionMatrixOrthoLH(2*size, 2*size, 1, 2000);
+        frusta[1].setFrom(projection*sun_view);
+
+        const float cascade_size[4] = { 20, 50, 150, 500 };
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            core::matrix4 cascade_view;
+            cascade_view.buildCameraLookAtMatrixLH(
+                position + core::vector3df(500, 250, 250),
+                position, core::vector3df(0, 1, 0));
+            projection.buildProjectionMatrixOrthoLH(cascade_size[i],
+                                                    cascade_size[i], 1, 2000);
+            frusta[2+i].setFrom(projection*cascade_view);
+        }
+    }   // randomFrusta
+
+    // ------------------------------------------------------------------------
+    /** Tests a box against a frustum the way the renderer did before:
+     *  transforms the corners and tests them with
+     *  plane3d::classifyPointRelation.
+     */
+    bool isCulled(const scene::SViewFrustum &frustum,
+                  const core::matrix4 &transform, const core::aabbox3df &box)
+    {
+        core::vector3df edges[8];
+        box.getEdges(edges);
+        for (unsigned int i = 0; i < 8; i++)
+            transform.transformVect(edges[i]);
+        for (unsigned int i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+        {
+            bool in_front = true;
+            for (unsigned int j = 0; j < 8 && in_front; j++)
+            {
+                in_front = frustum.planes[i].classifyPointRelation(edges[j])
+                           == core::ISREL3D_FRONT;
+            }
+            if (in_front)
+                return true;
+        }
+        return false;
+    }   // isCulled
+}   // namespace FrustumCullingTest
+
+// ----------------------------------------------------------------------------
+/** Compares the results of cull() with testing each box against each
+ *  frustum, and checks that unchanged boxes are cached.
+ */
+void FrustumCulling::unitTesting()
+{
+    using namespace FrustumCullingTest;
+    const unsigned int num_boxes = 500;
+    std::vector<core::matrix4>   transforms(num_boxes);
+    std::vector<core::aabbox3df> boxes(num_boxes);
+    for (unsigned int i = 0; i < num_boxes; i++)
+    {
+        transforms[i] = randomTransform(200);
+        boxes[i]      = randomBox(20);
+    }
+    // A box with corners exactly on two planes of the first frustum in
+    // the first frame (see below), and a box that must never be culled
+    transforms[0].makeIdentity();
+    boxes[0] = core::aabbox3df(0, 0, 0, 1, 1, 1);
+
+    FrustumCulling culling;
+    for (unsigned int frame = 0; frame < 10; frame++)
+    {
+        scene::SViewFrustum frusta[6];
+        randomFrusta(200, frusta);
+        if (frame == 0)
+        {
+            frusta[0].planes[0].setPlane(core::vector3df(0,  1, 0), 0.0f);
+            frusta[0].planes[1].setPlane(core::vector3df(0, -1, 0), 1.0f);
+        }
+        // Move some boxes after the first frame
+        unsigned int num_moved = 0;
+        if (frame > 0)
+        {
+            for (unsigned int i = 1; i < num_boxes; i += 7)
+            {
+                transforms[i] = randomTransform(200);
+                num_moved++;
+            }
+        }
+
+        culling.reset();
+        for (unsigned int f = 0; f < 6; f++)
+            culling.setFrustum(f, frusta[f]);
+        for (unsigned int i = 0; i < num_boxes; i++)
+            culling.addBox(transforms[i], boxes[i], i != 1);
+        assert(culling.getNumUpdated() == (frame == 0 ? num_boxes
+                                                      : num_moved));
+        culling.cull();
+        for (unsigned int i = 0; i < num_boxes; i++)
+        {
+            unsigned int expected = 0;
+            for (unsigned int f = 0; f < 6; f++)
+            {
+                if (i != 1 && isCulled(frusta[f], transforms[i], boxes[i]))
+                    expected |= 1 << f;
+            }
+            assert(culling.getCulled(i) == expected);
+        }
+    }
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Measures the time to cull a scene with 10000 nodes against the camera,
+ *  the RSM camera and 4 shadow cascades, testing each node against each
+ *  frustum as the renderer did before, and with this class (serially and
+ *  with the thread pool). In each frame the camera moves and 2% of the
+ *  nodes move. Checks that the results are identical.
+ */
+void FrustumCulling::benchmark()
+{
+    using namespace FrustumCullingTest;
+    const unsigned int num_boxes  = 10000;
+    const unsigned int num_frames = 100;
+    const float        size       = 500.0f;
+
+    std::vector<core::matrix4>   transforms(num_boxes);
+    std::vector<core::aabbox3df> boxes(num_boxes);
+    for (unsigned int i = 0; i < num_boxes; i++)
+    {
+        transforms[i] = randomTransform(size);
+        boxes[i]      = randomBox(i%10==0 ? 40.0f : 4.0f);
+    }
+
+    FrustumCulling culling;
+    std::vector<unsigned char> expected(num_boxes);
+    double reference_time = 0, serial_time = 0, parallel_time = 0;
+    unsigned int num_culled = 0, num_updated = 0;
+    bool identical = true;
+    for (unsigned int frame = 0; frame < num_frames; frame++)
+    {
+        scene::SViewFrustum frusta[6];
+        randomFrusta(size, frusta);
+        for (unsigned int i = frame%50; i < num_boxes; i += 50)
+            transforms[i] = randomTransform(size);
+
+        double start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < num_boxes; i++)
+        {
+            unsigned char culled = 0;
+            for (unsigned int f = 0; f < 6; f++)
+            {
+                if (isCulled(frusta[f], transforms[i], boxes[i]))
+                    culled |= 1 << f;
+            }
+            expected[i] = culled;
+        }
+        reference_time += StkTime::getRealTime() - start;
+
+        for (unsigned int k = 0; k < 2; k++)
+        {
+            start = StkTime::getRealTime();
+            culling.reset();
+            for (unsigned int f = 0; f < 6; f++)
+                culling.setFrustum(f, frusta[f]);
+            for (unsigned int i = 0; i < num_boxes; i++)
+                culling.addBox(transforms[i], boxes[i]);
+            culling.cull(/*use_thread_pool*/k == 1);
+            (k == 0 ? serial_time : parallel_time) +=
+                StkTime::getRealTime() - start;
+            if (k == 0)
+                num_updated += culling.getNumUpdated();
+
+            for (unsigned int i = 0; i < num_boxes; i++)
+            {
+                if (culling.getCulled(i) != expected[i])
+                    identical = false;
+            }
+        }
+        for (unsigned int i = 0; i < num_boxes; i++)
+        {
+            if (expected[i] & 1)
+                num_culled++;
+        }
+    }
+#if defined(FRUSTUM_CULLING_AVX)
+    const char *kernel = "AVX";
+#elif defined(FRUSTUM_CULLING_SSE)
+    const char *kernel = "SSE";
+#else
+    const char *kernel = "scalar";
+#endif
+    Log::info("FrustumCulling", "%d nodes, 6 frusta: per node %.3f ms, "
+              "%s %.3f ms, %d threads %.3f ms per frame, %.0f nodes culled "
+              "for the camera, %.0f updated, results %s.", num_boxes,
+              reference_time*1000.0/num_frames, kernel,
+              serial_time*1000.0/num_frames,
+              thread_pool ? thread_pool->getNumberOfThreads() : 1,
+              parallel_time*1000.0/num_frames,
+              float(num_culled)/num_frames, float(num_updated)/num_frames,
+              identical ? "identical" : "DIFFERENT");
+}   // benchmark
+
+/* EOF */
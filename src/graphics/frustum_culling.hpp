@@ -0,0 +1,139 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_FRUSTUM_CULLING_HPP
+#define HEADER_FRUSTUM_CULLING_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <aabbox3d.h>
+#include <matrix4.h>
+#include <SViewFrustum.h>
+
+#include <assert.h>
+#include <vector>
+
+namespace irr
+{
+    namespace scene { class ISceneNode; }
+}
+using namespace irr;
+
+/** \brief Culls the bounding boxes of scene nodes against several view
+ *  frusta (e.g. the camera, the RSM camera and the shadow cascades) at
+ *  once.
+ *  The scene nodes are added once per frame with addNode(), which stores
+ *  the 8 world space corners of the bounding box of each node in a flat
+ *  array (all x, then all y, then all z coordinates of a box). The corners
+ *  are only transformed again if the transform or the bounding box of a
+ *  node changed since the last frame (the cache is indexed by the position
+ *  of a node in the list, which is stable as long as the scene does not
+ *  change). cull() then tests all boxes against all frusta using SSE/AVX
+ *  if available, distributing the boxes to the thread pool if there are
+ *  many of them.
+ *  The test is the same as the one of Irrlicht (a box is culled if all
+ *  its corners are in front of one plane of the frustum), and the corners
+ *  are computed with the same functions, so the results are identical to
+ *  testing each node against each frustum.
+ * \ingroup graphics
+ */
+class FrustumCulling : public NoCopy
+{
+public:
+    /** Maximum number of frusta that can be tested. */
+    static const unsigned int MAX_FRUSTA = 6;
+
+private:
+    /** Number of boxes added in the current frame. */
+    unsigned int                     m_num_boxes;
+
+    /** The node of each box, used to detect if a cached box can be used. */
+    std::vector<const scene::ISceneNode*> m_nodes;
+
+    /** The transform of each box (16 floats per box). */
+    std::vector<float>               m_transforms;
+
+    /** The bounding box in object space of each box (6 floats per box). */
+    std::vector<float>               m_boxes;
+
+    /** The 8 corners in world space of each box: x0..x7, y0..y7, z0..z7. */
+    std::vector<float>               m_corners;
+
+    /** If a box can be culled at all (automatic culling of the node). */
+    std::vector<unsigned char>       m_can_cull;
+
+    /** For each box a bit mask of the frusta that cull it. */
+    std::vector<unsigned char>       m_culled;
+
+    /** The planes of all frusta: normal x, y, z and d for each plane. */
+    float m_planes[MAX_FRUSTA][scene::SViewFrustum::VF_PLANE_COUNT][4];
+
+    /** Number of frusta set. */
+    unsigned int                     m_num_frusta;
+
+    /** Number of boxes whose corners were computed in the current frame. */
+    unsigned int                     m_num_updated;
+
+    void         setBox(unsigned int index, const core::matrix4 &transform,
+                        const core::aabbox3df &box);
+    void         cullBoxes(unsigned int first, unsigned int last);
+    static void  cullTask(unsigned int index, void *data);
+
+public:
+                 FrustumCulling();
+    void         reset();
+    void         setFrustum(unsigned int index,
+                            const scene::SViewFrustum &frustum);
+    unsigned int addNode(const scene::ISceneNode *node);
+    unsigned int addBox(const core::matrix4 &transform,
+                        const core::aabbox3df &box, bool can_cull=true,
+                        const scene::ISceneNode *node=NULL);
+    void         cull(bool use_thread_pool=true);
+    static void  unitTesting();
+    static void  benchmark();
+
+    // ------------------------------------------------------------------------
+    /** Returns a bit mask of the frusta (bit i for frustum i) that cull the
+     *  box with the given index. Only valid after cull() was called. */
+    unsigned int getCulled(unsigned int index) const
+    {
+        assert(index < m_num_boxes);
+        return m_culled[index];
+    }   // getCulled
+    // ------------------------------------------------------------------------
+    /** Returns the 8 world space corners of a box, in the order of
+     *  aabbox3d::getEdges. */
+    void getCorners(unsigned int index, core::vector3df corners[8]) const
+    {
+        assert(index < m_num_boxes);
+        const float *c = &m_corners[index*24];
+        for (unsigned int i = 0; i < 8; i++)
+            corners[i].set(c[i], c[i+8], c[i+16]);
+    }   // getCorners
+    // ------------------------------------------------------------------------
+    /** Returns the number of boxes added in the current frame. */
+    unsigned int getNumBoxes() const { return m_num_boxes; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of boxes whose corners were transformed in the
+     *  current frame (i.e. which were not cached). */
+    unsigned int getNumUpdated() const { return m_num_updated; }
+};   // FrustumCulling
+
+#endif
+
+/* EOF */
@@ -23,6 +23,7 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
+#include "modes/profile_world.hpp"
 #include "utils/constants.hpp"
 
 #include <ISceneNode.h>
@@ -36,13 +37,16 @@ Stars::Stars(scene::ISceneNode* parentKart, core::vector3df center)
 {
     m_parent_kart_node = parentKart;
     m_enabled = false;
+    m_center = center;
+
+    // Without graphics no billboards are needed, update then does nothing
+    if (ProfileWorld::isNoGraphics())
+        return;
 
     video::ITexture* texture = irr_driver->getTexture("starparticle.png");
     Material* star_material =
         material_manager->getMaterial("starparticle.png");
 
-    m_center = center;
-
     for (int n=0; n<STAR_AMOUNT; n++)
     {
         scene::ISceneNode* billboard =
@@ -20,6 +20,7 @@
 #include "graphics/stkmesh.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/frustum_culling.hpp"
 #include "stkanimatedmesh.hpp"
 #include "stkmeshscenenode.hpp"
 #include "utils/ptr_vector.hpp"
@@ -173,16 +174,6 @@ static std::vector <STKMeshCommon *> DeferredUpdate;
 
 static core::vector3df windDir;
 
-// From irrlicht code
-static
-bool isBoxInFrontOfPlane(const core::plane3df &plane, const core::vector3df edges[8])
-{
-    for (u32 j = 0; j<8; ++j)
-        if (plane.classifyPointRelation(edges[j]) != core::ISREL3D_FRONT)
-            return false;
-    return true;
-}
-
 std::vector<float> BoundingBoxes;
 
 static void addEdge(const core::vector3df &P0, const core::vector3df &P1)
@@ -195,38 +186,44 @@ static void addEdge(const core::vector3df &P0, const core::vector3df &P1)
     BoundingBoxes.push_back(P1.Z);
 }
 
-static
-bool isCulledPrecise(const scene::ICameraSceneNode *cam, const scene::ISceneNode *node)
+/** The type of the nodes collected by parseSceneManager. */
+enum SceneNodeType
 {
-    if (!node->getAutomaticCulling())
-        return false;
+    SNT_OTHER,
+    SNT_PARTICLES,
+    SNT_BILLBOARD,
+    SNT_MESH
+};
 
-    const core::matrix4 &trans = node->getAbsoluteTransformation();
-    const scene::SViewFrustum &frust = *cam->getViewFrustum();
+/** A visible node collected by parseSceneManager. */
+struct SceneNodeEntry
+{
+    scene::ISceneNode   *m_node;
+    ParticleSystemProxy *m_particles;
+    STKBillboard        *m_billboard;
+    STKMeshCommon       *m_mesh;
+    SceneNodeType        m_type;
+    /** Index of the parent entry, or -1. */
+    int                  m_parent;
+    /** Index of the bounding box in the frustum culling, or -1. */
+    int                  m_box;
+};
 
-    core::vector3df edges[8];
-    node->getBoundingBox().getEdges(edges);
-    for (unsigned i = 0; i < 8; i++)
-        trans.transformVect(edges[i]);
+/** Bits of the frusta in the culling results. */
+enum
+{
+    CULL_CAMERA = 1,
+    CULL_RSM    = 2,
+    CULL_SHADOW = 4   // shifted by the cascade
+};
 
-    for (s32 i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; ++i)
-        if (isBoxInFrontOfPlane(frust.planes[i], edges))
-            return true;
-    return false;
-}
+static std::vector<SceneNodeEntry> SceneNodes;
+static std::vector<unsigned char>  SceneNodeCulled;
+static FrustumCulling              Culling;
 
 static void
-handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *ImmediateDraw,
-    const scene::ICameraSceneNode *cam, scene::ICameraSceneNode *shadowcam[4], const scene::ICameraSceneNode *rsmcam,
-    bool &culledforcam, bool culledforshadowcam[4], bool &culledforrsm, bool drawRSM)
+addBoundingBoxEdges(scene::ISceneNode *Node)
 {
-    STKMeshCommon *node = dynamic_cast<STKMeshCommon*>(Node);
-    if (!node)
-        return;
-    node->updateNoGL();
-    DeferredUpdate.push_back(node);
-
-
     const core::matrix4 &trans = Node->getAbsoluteTransformation();
 
     core::vector3df edges[8];
@@ -245,33 +242,24 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
     0---------4/
     */
 
-    if (irr_driver->getBoundingBoxesViz())
-    {
-        addEdge(edges[0], edges[1]);
-        addEdge(edges[1], edges[5]);
-        addEdge(edges[5], edges[4]);
-        addEdge(edges[4], edges[0]);
-        addEdge(edges[2], edges[3]);
-        addEdge(edges[3], edges[7]);
-        addEdge(edges[7], edges[6]);
-        addEdge(edges[6], edges[2]);
-        addEdge(edges[0], edges[2]);
-        addEdge(edges[1], edges[3]);
-        addEdge(edges[5], edges[7]);
-        addEdge(edges[4], edges[6]);
-    }
-
-    if (node->isImmediateDraw())
-    {
-        ImmediateDraw->push_back(Node);
-        return;
-    }
-
-    culledforcam = culledforcam || isCulledPrecise(cam, Node);
-    culledforrsm = culledforrsm || isCulledPrecise(rsmcam, Node);
-    for (unsigned i = 0; i < 4; i++)
-        culledforshadowcam[i] = culledforshadowcam[i] || isCulledPrecise(shadowcam[i], Node);
+    addEdge(edges[0], edges[1]);
+    addEdge(edges[1], edges[5]);
+    addEdge(edges[5], edges[4]);
+    addEdge(edges[4], edges[0]);
+    addEdge(edges[2], edges[3]);
+    addEdge(edges[3], edges[7]);
+    addEdge(edges[7], edges[6]);
+    addEdge(edges[6], edges[2]);
+    addEdge(edges[0], edges[2]);
+    addEdge(edges[1], edges[3]);
+    addEdge(edges[5], edges[7]);
+    addEdge(edges[4], edges[6]);
+}
 
+static void
+handleSTKCommon(scene::ISceneNode *Node, STKMeshCommon *node,
+    bool culledforcam, const bool culledforshadowcam[4], bool culledforrsm, bool drawRSM)
+{
     // Transparent
 
     if (World::getWorld() && World::getWorld()->isFogEnabled())
@@ -501,10 +489,14 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
     }
 }
 
+/** Collects all visible nodes of the scene in SceneNodes (parents before
+ *  their children), and adds the bounding boxes of the nodes that can be
+ *  culled to the frustum culling. The STK meshes are updated here, and the
+ *  immediate draw list is filled.
+ */
 static void
 parseSceneManager(core::list<scene::ISceneNode*> &List, std::vector<scene::ISceneNode *> *ImmediateDraw,
-    const scene::ICameraSceneNode* cam, scene::ICameraSceneNode *shadow_cam[4], const scene::ICameraSceneNode *rsmcam,
-    bool culledforcam, bool culledforshadowcam[4], bool culledforrsm, bool drawRSM)
+    int parent)
 {
     core::list<scene::ISceneNode*>::Iterator I = List.begin(), E = List.end();
     for (; I != E; ++I)
@@ -515,27 +507,99 @@ parseSceneManager(core::list<scene::ISceneNode*> &List, std::vector<scene::IScen
         if (!(*I)->isVisible())
             continue;
 
+        SceneNodeEntry entry;
+        entry.m_node      = *I;
+        entry.m_particles = NULL;
+        entry.m_billboard = NULL;
+        entry.m_mesh      = NULL;
+        entry.m_type      = SNT_OTHER;
+        entry.m_parent    = parent;
+        entry.m_box       = -1;
+
         if (ParticleSystemProxy *node = dynamic_cast<ParticleSystemProxy *>(*I))
         {
-            if (!isCulledPrecise(cam, *I))
-                ParticlesList::getInstance()->push_back(node);
+            entry.m_type      = SNT_PARTICLES;
+            entry.m_particles = node;
+            entry.m_box       = Culling.addNode(*I);
+            SceneNodes.push_back(entry);
             continue;
         }
 
         if (STKBillboard *node = dynamic_cast<STKBillboard *>(*I))
         {
-            if (!isCulledPrecise(cam, *I))
-                BillBoardList::getInstance()->push_back(node);
+            entry.m_type      = SNT_BILLBOARD;
+            entry.m_billboard = node;
+            entry.m_box       = Culling.addNode(*I);
+            SceneNodes.push_back(entry);
             continue;
         }
 
-        bool newculledforcam = culledforcam;
-        bool newculledforrsm = culledforrsm;
-        bool newculledforshadowcam[4] = { culledforshadowcam[0], culledforshadowcam[1], culledforshadowcam[2], culledforshadowcam[3] };
+        if (STKMeshCommon *node = dynamic_cast<STKMeshCommon*>(*I))
+        {
+            node->updateNoGL();
+            DeferredUpdate.push_back(node);
+            if (irr_driver->getBoundingBoxesViz())
+                addBoundingBoxEdges(*I);
 
-        handleSTKCommon(*I, ImmediateDraw, cam, shadow_cam, rsmcam, newculledforcam, newculledforshadowcam, newculledforrsm, drawRSM);
+            if (node->isImmediateDraw())
+                ImmediateDraw->push_back(*I);
+            else
+            {
+                entry.m_type      = SNT_MESH;
+                entry.m_mesh      = node;
+                entry.m_box       = Culling.addNode(*I);
+            }
+        }
 
-        parseSceneManager(const_cast<core::list<scene::ISceneNode*>& >((*I)->getChildren()), ImmediateDraw, cam, shadow_cam, rsmcam, newculledforcam, newculledforshadowcam, newculledforrsm, drawRSM);
+        SceneNodes.push_back(entry);
+        parseSceneManager(const_cast<core::list<scene::ISceneNode*>& >((*I)->getChildren()),
+                          ImmediateDraw, (int)SceneNodes.size() - 1);
+    }
+}
+
+/** Culls all nodes collected by parseSceneManager against the camera, the
+ *  RSM camera and the shadow cascades at once, and fills the draw lists.
+ *  A node that is culled for a camera culls all its children, too.
+ */
+static void
+cullSceneNodes(const scene::ICameraSceneNode* cam, scene::ICameraSceneNode *shadow_cam[4],
+    const scene::ICameraSceneNode *rsmcam, bool drawRSM)
+{
+    Culling.setFrustum(0, *cam->getViewFrustum());
+    Culling.setFrustum(1, *rsmcam->getViewFrustum());
+    for (unsigned i = 0; i < 4; i++)
+        Culling.setFrustum(2 + i, *shadow_cam[i]->getViewFrustum());
+    Culling.cull();
+
+    SceneNodeCulled.resize(SceneNodes.size());
+    for (unsigned i = 0; i < SceneNodes.size(); i++)
+    {
+        const SceneNodeEntry &entry = SceneNodes[i];
+        unsigned culled = entry.m_parent >= 0 ? SceneNodeCulled[entry.m_parent] : 0;
+        switch (entry.m_type)
+        {
+        case SNT_PARTICLES:
+            if (!(Culling.getCulled(entry.m_box) & CULL_CAMERA))
+                ParticlesList::getInstance()->push_back(entry.m_particles);
+            break;
+        case SNT_BILLBOARD:
+            if (!(Culling.getCulled(entry.m_box) & CULL_CAMERA))
+                BillBoardList::getInstance()->push_back(entry.m_billboard);
+            break;
+        case SNT_MESH:
+        {
+            culled |= Culling.getCulled(entry.m_box);
+            bool culledforshadowcam[4];
+            for (unsigned cascade = 0; cascade < 4; cascade++)
+                culledforshadowcam[cascade] = (culled & (CULL_SHADOW << cascade)) != 0;
+            handleSTKCommon(entry.m_node, entry.m_mesh, (culled & CULL_CAMERA) != 0,
+                culledforshadowcam, (culled & CULL_RSM) != 0, drawRSM);
+            break;
+        }
+        case SNT_OTHER:
+            break;
+        }
+        SceneNodeCulled[i] = culled;
     }
 }
 
@@ -599,9 +663,10 @@ PROFILER_PUSH_CPU_MARKER("- culling", 0xFF, 0xFF, 0x0);
     for (scene::ISceneNode *child : List)
         FixBoundingBoxes(child);
 
-    bool cam = false, rsmcam = false;
-    bool shadowcam[4] = { false, false, false, false };
-    parseSceneManager(List, ImmediateDrawList::getInstance(), camnode, m_shadow_camnodes, m_suncam, cam, shadowcam, rsmcam, !m_rsm_map_available);
+    SceneNodes.clear();
+    Culling.reset();
+    parseSceneManager(List, ImmediateDrawList::getInstance(), -1);
+    cullSceneNodes(camnode, m_shadow_camnodes, m_suncam, !m_rsm_map_available);
 PROFILER_POP_CPU_MARKER();
 
     // Add a 1 s timeout
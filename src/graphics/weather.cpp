@@ -42,7 +42,7 @@ Weather::Weather(bool lightning, std::string sound)
         m_weather_sound = SFXManager::get()->createSoundSource(sound);
     }
 
-    RandomGenerator g;
+    RandomGenerator g(RandomGenerator::ST_LOCAL);
     m_next_lightning = (float)g.get(35);
 }   // Weather
 
@@ -79,7 +79,7 @@ void Weather::update(float dt)
                 }
             }
     
-            RandomGenerator g;
+            RandomGenerator g(RandomGenerator::ST_LOCAL);
             m_next_lightning = 35 + (float)g.get(35);
         }
     }
@@ -7,6 +7,8 @@
 #include "graphics/2dutils.hpp"
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 #include <IAttributes.h>
@@ -39,6 +41,7 @@ ScalableFont::ScalableFont(IGUIEnvironment *env, const std::string &filename)
     m_shadow                 = false;
     m_mono_space_digits      = false;
     m_rtl                    = translations->isRTLLanguage();
+    m_layout_counter         = 0;
 
     if (Environment)
     {
@@ -228,7 +231,7 @@ void ScalableFont::doReadXmlFile(io::IXMLReader* xml)
                 }
                 rectangle.LowerRightCorner.Y = val - trim_bottom;
 
-                CharacterMap[ch] = Areas.size();
+                setCharacterArea(ch, Areas.size());
 
                 //Log::info("ScalableFont", "Inserting character '%d' with area %d", (int)ch, Areas.size());
 
@@ -363,14 +366,37 @@ u32 ScalableFont::getSpriteNoFromChar(const wchar_t *c) const
 }
 
 
+/** Stores the area index of a character. */
+void ScalableFont::setCharacterArea(const wchar_t c, s32 area_id)
+{
+    if ((u32)c <= 0xffff)
+    {
+        if ((u32)c >= m_character_table.size())
+            m_character_table.resize((u32)c + 1, -1);
+        m_character_table[c] = area_id;
+    }
+    else
+        m_rare_characters[c] = area_id;
+}   // setCharacterArea
+
 s32 ScalableFont::getAreaIDFromCharacter(const wchar_t c, bool* fallback_font) const
 {
-    std::map<wchar_t, s32>::const_iterator n = CharacterMap.find(c);
-    if (n != CharacterMap.end())
+    s32 area_id = -1;
+    if ((u32)c < m_character_table.size())
+        area_id = m_character_table[c];
+    else if ((u32)c > 0xffff)
+    {
+        std::unordered_map<wchar_t, s32>::const_iterator n =
+            m_rare_characters.find(c);
+        if (n != m_rare_characters.end())
+            area_id = n->second;
+    }
+
+    if (area_id >= 0)
     {
         if (fallback_font != NULL) *fallback_font = false;
         //Log::info("ScalableFont", "Character %d found in font", (int)c);
-        return (*n).second;
+        return area_id;
     }
     else if (m_fallback_font != NULL && fallback_font != NULL)
     {
@@ -420,16 +446,57 @@ const ScalableFont::SFontArea &ScalableFont::getAreaFromCharacter(const wchar_t
 void ScalableFont::setInvisibleCharacters( const wchar_t *s )
 {
     Invisible = s;
+    clearLayoutCache();
 }
 
+/** Removes all texts from the layout cache. */
+void ScalableFont::clearLayoutCache() const
+{
+    for (unsigned int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+        m_layout_cache[i].m_text      = L"";
+        m_layout_cache[i].m_hash      = 0;
+        m_layout_cache[i].m_last_used = 0;
+        m_layout_cache[i].m_glyphs.clear();
+    }
+}   // clearLayoutCache
 
-//! returns the dimension of text
-core::dimension2d<u32> ScalableFont::getDimension(const wchar_t* text) const
+bool ScalableFont::LayoutParams::operator==(const LayoutParams &other) const
+{
+    return m_scale                  == other.m_scale                  &&
+           m_kerning_width          == other.m_kerning_width          &&
+           m_mono_space_digits      == other.m_mono_space_digits      &&
+           m_fallback_font          == other.m_fallback_font          &&
+           m_fallback_font_scale    == other.m_fallback_font_scale    &&
+           m_fallback_kerning_width == other.m_fallback_kerning_width;
+}   // LayoutParams::operator==
+
+/** Returns the current settings that influence the layout of a text. */
+ScalableFont::LayoutParams ScalableFont::getLayoutParams() const
+{
+    LayoutParams params;
+    params.m_scale                  = m_scale;
+    params.m_kerning_width          = GlobalKerningWidth;
+    params.m_mono_space_digits      = m_mono_space_digits;
+    params.m_fallback_font          = m_fallback_font;
+    params.m_fallback_font_scale    = m_fallback_font_scale;
+    params.m_fallback_kerning_width = m_fallback_kerning_width;
+    return params;
+}   // getLayoutParams
+
+/** Computes the dimension of a text and the positions of all characters.
+ *  \param text The text.
+ *  \param layout On return the layout (only dimension and glyphs are set).
+ */
+void ScalableFont::layoutText(const wchar_t* text, TextLayout* layout) const
 {
     assert(Areas.size() > 0);
 
+    layout->m_glyphs.clear();
     core::dimension2d<u32> dim(0, 0);
     core::dimension2d<u32> thisLine(0, (int)(MaxHeight*m_scale));
+    s32  y          = 0;
+    bool first_line = true;
 
     for (const wchar_t* p = text; *p; ++p)
     {
@@ -442,6 +509,8 @@ core::dimension2d<u32> ScalableFont::getDimension(const wchar_t* text) const
             if (dim.Width < thisLine.Width)
                 dim.Width = thisLine.Width;
             thisLine.Width = 0;
+            y += (int)(MaxHeight*m_scale);
+            first_line = false;
             continue;
         }
 
@@ -450,20 +519,71 @@ core::dimension2d<u32> ScalableFont::getDimension(const wchar_t* text) const
 
         thisLine.Width += area.underhang;
 
+        LayoutGlyph glyph;
+        glyph.m_offset     = core::position2di((s32)thisLine.Width, y);
+        // Invisible character. Add it anyway, so that the glyphs
+        // stay in sync with the characters.
+        glyph.m_sprite     = Invisible.findFirst(*p) < 0 ? area.spriteno : -1;
+        glyph.m_fallback   = fallback;
+        glyph.m_first_line = first_line;
+        layout->m_glyphs.push_back(glyph);
+
         thisLine.Width += getCharWidth(area, fallback);
     }
 
     dim.Height += thisLine.Height;
     if (dim.Width < thisLine.Width) dim.Width = thisLine.Width;
 
-   //Log::info("ScalableFont", "ScalableFont::getDimension returns: %d, %d", dim.Width, dim.Height);
+    layout->m_dimension = dim;
+}   // layoutText
 
-    dim.Width  = (int)(dim.Width + 0.9f); // round up
-    dim.Height = (int)(dim.Height + 0.9f);
+/** Returns the layout of a text. The layout is taken from the cache if
+ *  possible, otherwise it replaces the least recently used layout in the
+ *  cache. The returned reference is only valid till the next call.
+ */
+const ScalableFont::TextLayout &ScalableFont::getLayout(const wchar_t* text) const
+{
+    u32 hash = 2166136261u;
+    for (const wchar_t* p = text; *p; ++p)
+    {
+        hash ^= (u32)*p;
+        hash *= 16777619u;
+    }
+    const LayoutParams params = getLayoutParams();
+    if (++m_layout_counter == 0)
+    {
+        // Counter overflow, start again
+        clearLayoutCache();
+        m_layout_counter = 1;
+    }
 
-    //Log::info("ScalableFont", "After: %d, %d", dim.Width, dim.Height);
+    unsigned int oldest = 0;
+    for (unsigned int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+        TextLayout &layout = m_layout_cache[i];
+        if (layout.m_last_used > 0 && layout.m_hash == hash &&
+            layout.m_params == params && layout.m_text == text)
+        {
+            layout.m_last_used = m_layout_counter;
+            return layout;
+        }
+        if (layout.m_last_used < m_layout_cache[oldest].m_last_used)
+            oldest = i;
+    }
+
+    TextLayout &layout = m_layout_cache[oldest];
+    layoutText(text, &layout);
+    layout.m_text      = text;
+    layout.m_hash      = hash;
+    layout.m_params    = params;
+    layout.m_last_used = m_layout_counter;
+    return layout;
+}   // getLayout
 
-    return dim;
+//! returns the dimension of text
+core::dimension2d<u32> ScalableFont::getDimension(const wchar_t* text) const
+{
+    return getLayout(text).m_dimension;
 }
 
 void ScalableFont::draw(const core::stringw& text,
@@ -509,12 +629,13 @@ void ScalableFont::doDraw(const core::stringw& text,
         m_shadow = true; // set back
     }
 
+    const TextLayout &layout = getLayout(text.c_str());
     core::position2d<s32> offset = position.UpperLeftCorner;
     core::dimension2d<s32> text_dimension;
 
     if (m_rtl || hcenter || vcenter || clip)
     {
-        text_dimension = getDimension(text.c_str());
+        text_dimension = layout.m_dimension;
 
         if (hcenter)    offset.X += (position.getWidth() - text_dimension.Width) / 2;
         else if (m_rtl) offset.X += (position.getWidth() - text_dimension.Width);
@@ -528,41 +649,14 @@ void ScalableFont::doDraw(const core::stringw& text,
         }
     }
 
-    // ---- collect character locations
-    const unsigned int text_size = text.size();
-    core::array<s32>               indices(text_size);
-    core::array<core::position2di> offsets(text_size);
-    std::vector<bool>              fallback(text_size);
-
-    for (u32 i = 0; i<text_size; i++)
-    {
-        wchar_t c = text[i];
-
-        if (c == L'\r' ||          // Windows breaks
-            c == L'\n'    )        // Unix breaks
-        {
-            if(c==L'\r' && text[i+1]==L'\n') c = text[++i];
-            offset.Y += (int)(MaxHeight*m_scale);
-            offset.X  = position.UpperLeftCorner.X;
-            if (hcenter)
-                offset.X += (position.getWidth() - text_dimension.Width) >> 1;
-            continue;
-        }   // if lineBreak
-
-        bool use_fallback_font = false;
-        const SFontArea &area  = getAreaFromCharacter(c, &use_fallback_font);
-        fallback[i]            = use_fallback_font;
-        offset.X              += area.underhang;
-        offsets.push_back(offset);
-        // Invisible character. add something to the array anyway so that
-        // indices from the various arrays remain in sync
-        indices.push_back( Invisible.findFirst(c) < 0  ? area.spriteno
-                                                       : -1            );
-        offset.X += getCharWidth(area, fallback[i]);
-    }   // for i<text_size
+    // ---- start of all lines but the first one
+    core::position2d<s32> line_start(position.UpperLeftCorner.X, offset.Y);
+    if (hcenter)
+        line_start.X += (position.getWidth() - text_dimension.Width) >> 1;
 
     // ---- do the actual rendering
-    const int indiceAmount                    = indices.size();
+    const std::vector<LayoutGlyph> &glyphs    = layout.m_glyphs;
+    const int indiceAmount                    = (int)glyphs.size();
     core::array< SGUISprite >& sprites        = SpriteBank->getSprites();
     core::array< core::rect<s32> >& positions = SpriteBank->getPositions();
     core::array< SGUISprite >* fallback_sprites;
@@ -581,21 +675,23 @@ void ScalableFont::doDraw(const core::stringw& text,
     const int spriteAmount      = sprites.size();
     for (int n=0; n<indiceAmount; n++)
     {
-        const int spriteID = indices[n];
-        if (!fallback[n] && (spriteID < 0 || spriteID >= spriteAmount)) continue;
-        if (indices[n] == -1) continue;
+        const LayoutGlyph &glyph = glyphs[n];
+        const int spriteID = glyph.m_sprite;
+        const bool use_fallback = glyph.m_fallback;
+        if (!use_fallback && (spriteID < 0 || spriteID >= spriteAmount)) continue;
+        if (spriteID == -1) continue;
 
         //assert(sprites[spriteID].Frames.size() > 0);
 
-        const int texID = (fallback[n] ?
+        const int texID = (use_fallback ?
                            (*fallback_sprites)[spriteID].Frames[0].textureNumber :
                            sprites[spriteID].Frames[0].textureNumber);
 
-        core::rect<s32> source = (fallback[n] ?
+        core::rect<s32> source = (use_fallback ?
                                   (*fallback_positions)[(*fallback_sprites)[spriteID].Frames[0].rectNumber] :
                                   positions[sprites[spriteID].Frames[0].rectNumber]);
 
-        const TextureInfo& info = (fallback[n] ?
+        const TextureInfo& info = (use_fallback ?
                                    (*(m_fallback_font->m_texture_files.find(texID))).second :
                                    (*(m_texture_files.find(texID))).second
                                    );
@@ -603,25 +699,27 @@ void ScalableFont::doDraw(const core::stringw& text,
 
         core::dimension2d<s32> size = source.getSize();
 
-        float scale = (fallback[n] ? m_scale*m_fallback_font_scale : m_scale);
+        float scale = (use_fallback ? m_scale*m_fallback_font_scale : m_scale);
         size.Width  = (int)(size.Width  * scale * char_scale);
         size.Height = (int)(size.Height * scale * char_scale);
 
         // align vertically if character is smaller
         int y_shift = (size.Height < MaxHeight*m_scale ? (int)((MaxHeight*m_scale - size.Height)/2.0f) : 0);
 
-        core::rect<s32> dest(offsets[n] + core::position2di(0, y_shift), size);
+        const core::position2di char_offset =
+            (glyph.m_first_line ? offset : line_start) + glyph.m_offset;
+        core::rect<s32> dest(char_offset + core::position2di(0, y_shift), size);
 
-        video::ITexture* texture = (fallback[n] ?
+        video::ITexture* texture = (use_fallback ?
                                     m_fallback_font->SpriteBank->getTexture(texID) :
                                     SpriteBank->getTexture(texID) );
 
         /*
-        if (fallback[n])
+        if (use_fallback)
         {
             Log::info("ScalableFont", "Using fallback font %s; source area is %d, %d; size %d, %d; dest = %d, %d",
                 core::stringc(texture->getName()).c_str(), source.UpperLeftCorner.X, source.UpperLeftCorner.Y,
-                source.getWidth(), source.getHeight(), offsets[n].X, offsets[n].Y);
+                source.getWidth(), source.getHeight(), char_offset.X, char_offset.Y);
         }
         */
 
@@ -629,7 +727,7 @@ void ScalableFont::doDraw(const core::stringw& text,
         {
             // perform lazy loading
 
-            if (fallback[n])
+            if (use_fallback)
             {
                 m_fallback_font->lazyLoadTexture(texID);
                 texture = m_fallback_font->SpriteBank->getTexture(texID);
@@ -666,7 +764,7 @@ void ScalableFont::doDraw(const core::stringw& text,
             }
         }
 
-        if (fallback[n])
+        if (use_fallback)
         {
             // TODO: don't hardcode colors?
             video::SColor orange(color.getAlpha(), 255, 100, 0);
@@ -819,6 +917,54 @@ IGUISpriteBank* ScalableFont::getSpriteBank() const
     return SpriteBank;
 }
 
+/** Measures the time to lay out the texts of a typical race hud frame,
+ *  with and without the layout cache. Each text is measured and then drawn,
+ *  so it is laid out twice per frame.
+ */
+void ScalableFont::benchmark()
+{
+    const int num_frames = 10000;
+    // The kart names in the ranking list, lap and rank. The race time
+    // (added below) changes every frame.
+    const wchar_t* texts[] = { L"Lap 2/3", L"4/8", L"Tux", L"Gnu",
+                               L"Nolok", L"Sara", L"Kiki", L"Pidgin",
+                               L"Puffy", L"Wilber", NULL };
+    const int num_texts = sizeof(texts)/sizeof(texts[0]);
+
+    TextLayout layout;
+    double time[2];
+    unsigned int num_glyphs[2] = { 0, 0 };
+    for (unsigned int cached = 0; cached < 2; cached++)
+    {
+        clearLayoutCache();
+        const double start = StkTime::getRealTime();
+        for (int frame = 0; frame < num_frames; frame++)
+        {
+            const core::stringw race_time =
+                StringUtils::timeToString(frame/60.0f).c_str();
+            texts[num_texts-1] = race_time.c_str();
+            for (int i = 0; i < 2*num_texts; i++)
+            {
+                const wchar_t* text = texts[i/2];
+                if (cached)
+                    num_glyphs[cached] += getLayout(text).m_glyphs.size();
+                else
+                {
+                    layoutText(text, &layout);
+                    num_glyphs[cached] += layout.m_glyphs.size();
+                }
+            }
+        }
+        time[cached] = StkTime::getRealTime() - start;
+    }
+    assert(num_glyphs[0] == num_glyphs[1]);
+    Log::info("ScalableFont", "%d frames with %d texts: %.2f us per frame "
+              "without cache, %.2f us per frame with cache "
+              "(%.1f million glyphs/s).", num_frames, num_texts,
+              time[0]*1000000.0/num_frames, time[1]*1000000.0/num_frames,
+              num_glyphs[1]/(time[1]*1000000.0));
+}   // benchmark
+
 } // end namespace gui
 } // end namespace irr
 
@@ -18,6 +18,8 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace irr
 {
@@ -159,6 +161,8 @@ public:
 
     void updateRTL();
 
+    void benchmark();
+
 private:
 
     struct SFontArea
@@ -170,15 +174,76 @@ private:
         u32             spriteno;
     };
 
+    /** One character of a laid out text. */
+    struct LayoutGlyph
+    {
+        /** Position relative to the start of the line, the y coordinate
+         *  is relative to the first line. */
+        core::position2di m_offset;
+        /** The sprite to draw, or -1 for invisible characters. */
+        s32               m_sprite;
+        /** True if the character is taken from the fallback font. */
+        bool              m_fallback;
+        /** True if the character is in the first line of the text. */
+        bool              m_first_line;
+    };
+
+    /** The settings that influence the layout of a text. */
+    struct LayoutParams
+    {
+        float         m_scale;
+        s32           m_kerning_width;
+        bool          m_mono_space_digits;
+        ScalableFont *m_fallback_font;
+        float         m_fallback_font_scale;
+        int           m_fallback_kerning_width;
+        bool operator==(const LayoutParams &other) const;
+    };
+
+    /** A text with the dimension and positions of all its characters. */
+    struct TextLayout
+    {
+        core::stringw            m_text;
+        u32                      m_hash;
+        LayoutParams             m_params;
+        /** Value of m_layout_counter when this layout was last used. */
+        u32                      m_last_used;
+        core::dimension2d<u32>   m_dimension;
+        std::vector<LayoutGlyph> m_glyphs;
+        TextLayout() : m_hash(0), m_last_used(0) {}
+    };
+
+    /** Number of texts in the layout cache. */
+    static const unsigned int LAYOUT_CACHE_SIZE = 32;
+
+    /** The most recently used layouts. The hud draws mostly the same
+     *  texts each frame (and measures them before drawing), so they don't
+     *  need to be laid out again. */
+    mutable TextLayout          m_layout_cache[LAYOUT_CACHE_SIZE];
+
+    /** Incremented for each layout lookup, used to find the least recently
+     *  used layout. */
+    mutable u32                 m_layout_counter;
+
     int getCharWidth(const SFontArea& area, const bool fallback) const;
     s32 getAreaIDFromCharacter(const wchar_t c, bool* fallback_font) const;
     const SFontArea &getAreaFromCharacter(const wchar_t c, bool* fallback_font) const;
     void setMaxHeight();
+    void setCharacterArea(const wchar_t c, s32 area_id);
+    LayoutParams getLayoutParams() const;
+    void layoutText(const wchar_t* text, TextLayout* layout) const;
+    const TextLayout &getLayout(const wchar_t* text) const;
+    void clearLayoutCache() const;
 
     core::array<SFontArea>      Areas;
     /** The maximum values of all digits, used in monospace_digits. */
     mutable SFontArea           m_max_digit_area;
-    std::map<wchar_t, s32>      CharacterMap;
+    /** Area index of each character in the basic multilingual plane,
+     *  indexed by the character (-1 if the font has no such character). */
+    std::vector<s32>            m_character_table;
+    /** Area index of all characters outside of the basic multilingual
+     *  plane (only possible if wchar_t has 32 bits). */
+    std::unordered_map<wchar_t, s32> m_rare_characters;
     video::IVideoDriver*        Driver;
     IGUISpriteBank*         SpriteBank;
     IGUIEnvironment*        Environment;
@@ -0,0 +1,135 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/mapped_file.hpp"
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    m_data    = NULL;
+    m_size    = 0;
+#if defined(WIN32) && !defined(__CYGWIN__)
+    m_file    = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#endif
+}   // MappedFile
+
+// ----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}   // ~MappedFile
+
+// ----------------------------------------------------------------------------
+/** Maps the specified file into memory. Any previously mapped file is
+ *  closed first.
+ *  \param filename Name of the file to map.
+ *  \return True if the file could be mapped. Empty files can not be mapped.
+ */
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+#if defined(WIN32) && !defined(__CYGWIN__)
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                         NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping)
+    {
+        close();
+        return false;
+    }
+    m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+    m_size = (size_t)size.QuadPart;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file descriptor is closed.
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    m_data = (const char*)p;
+    m_size = (size_t)st.st_size;
+#endif
+    return true;
+}   // open
+
+// ----------------------------------------------------------------------------
+/** Unmaps the file. */
+void MappedFile::close()
+{
+#if defined(WIN32) && !defined(__CYGWIN__)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+    m_mapping = NULL;
+    m_file    = INVALID_HANDLE_VALUE;
+#else
+    if (m_data)
+        munmap((void*)m_data, m_size);
+#endif
+    m_data = NULL;
+    m_size = 0;
+}   // close
+
+// ----------------------------------------------------------------------------
+/** Writes an array to a file and pads it with zeros to a multiple of
+ *  ALIGNMENT bytes.
+ *  \param fd The file to write to.
+ *  \param data The data to write.
+ *  \param size Number of bytes to write.
+ *  \return True if the data was written successfully.
+ */
+bool MappedFile::writePadded(FILE *fd, const void *data, size_t size)
+{
+    static const char zeros[ALIGNMENT] = {0};
+    const size_t padding = paddedSize(size) - size;
+    return (size == 0    || fwrite(data, 1, size, fd) == size) &&
+           (padding == 0 || fwrite(zeros, 1, padding, fd) == padding);
+}   // writePadded
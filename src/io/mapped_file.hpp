@@ -0,0 +1,80 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MAPPED_FILE_HPP
+#define HEADER_MAPPED_FILE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * \brief Maps a complete file read-only into memory.
+ *  This is used to read binary files (e.g. history and replay files)
+ *  without copying or parsing them first. To allow accessing arrays in
+ *  the mapped file directly, the writer should pad all arrays to a multiple
+ *  of ALIGNMENT bytes (see writePadded).
+ * \ingroup io
+ */
+class MappedFile : public NoCopy
+{
+private:
+    /** Start of the mapped data, or NULL if no file is mapped. */
+    const char *m_data;
+
+    /** Size of the file in bytes. */
+    size_t      m_size;
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+    /** The file and mapping handles (stored as void* to avoid including
+     *  windows.h here). */
+    void       *m_file;
+    void       *m_mapping;
+#endif
+
+public:
+    /** Alignment of arrays written with writePadded. */
+    static const size_t ALIGNMENT = 16;
+
+          MappedFile();
+         ~MappedFile();
+    bool  open(const std::string &filename);
+    void  close();
+    static bool writePadded(FILE *fd, const void *data, size_t size);
+
+    // ------------------------------------------------------------------------
+    /** Returns the size of an array padded to a multiple of ALIGNMENT. */
+    static size_t paddedSize(size_t size)
+    {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }   // paddedSize
+
+    // ------------------------------------------------------------------------
+    /** Returns a pointer to the mapped data. */
+    const char *getData() const { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the mapped file. */
+    size_t getSize() const { return m_size; }
+    // ------------------------------------------------------------------------
+    /** Returns true if a file is mapped. */
+    bool isOpen() const { return m_data != NULL; }
+};   // MappedFile
+
+#endif
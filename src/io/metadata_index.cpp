@@ -0,0 +1,480 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/metadata_index.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
+#include "io/xml_node.hpp"
+#include "utils/log.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+MetadataIndex *metadata_index = NULL;
+
+namespace
+{
+    /** Magic number at the start of the index file. */
+    const char INDEX_MAGIC[4] = { 'S', 'T', 'K', 'I' };
+
+    /** Version of the file format. The index is only a local cache, so all
+     *  values are stored in native byte order. */
+    const uint32_t INDEX_VERSION = 1;
+
+    // ------------------------------------------------------------------------
+    void writeU32(std::string *out, uint32_t value)
+    {
+        out->append((const char*)&value, sizeof(value));
+    }   // writeU32
+
+    // ------------------------------------------------------------------------
+    void writeI64(std::string *out, int64_t value)
+    {
+        out->append((const char*)&value, sizeof(value));
+    }   // writeI64
+
+    // ------------------------------------------------------------------------
+    void writeString(std::string *out, const std::string &s)
+    {
+        writeU32(out, (uint32_t)s.size());
+        out->append(s);
+    }   // writeString
+
+    // ------------------------------------------------------------------------
+    bool readU32(const char **data, const char *end, uint32_t *value)
+    {
+        if (end - *data < (ptrdiff_t)sizeof(*value)) return false;
+        memcpy(value, *data, sizeof(*value));
+        *data += sizeof(*value);
+        return true;
+    }   // readU32
+
+    // ------------------------------------------------------------------------
+    bool readI64(const char **data, const char *end, int64_t *value)
+    {
+        if (end - *data < (ptrdiff_t)sizeof(*value)) return false;
+        memcpy(value, *data, sizeof(*value));
+        *data += sizeof(*value);
+        return true;
+    }   // readI64
+
+    // ------------------------------------------------------------------------
+    bool readString(const char **data, const char *end, std::string *s)
+    {
+        uint32_t length;
+        if (!readU32(data, end, &length) || (uint32_t)(end - *data) < length)
+            return false;
+        s->assign(*data, length);
+        *data += length;
+        return true;
+    }   // readString
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Creates the index and loads the index file if it exists. */
+MetadataIndex::MetadataIndex()
+{
+    m_filename   = file_manager->getUserConfigFile("metadata.idx");
+    m_changed    = false;
+    m_num_hits   = 0;
+    m_num_misses = 0;
+    pthread_mutex_init(&m_mutex, NULL);
+    load();
+}   // MetadataIndex
+
+// ----------------------------------------------------------------------------
+MetadataIndex::~MetadataIndex()
+{
+    pthread_mutex_destroy(&m_mutex);
+}   // ~MetadataIndex
+
+// ----------------------------------------------------------------------------
+/** Gets the modification time and size of a file or directory.
+ *  \return False if the file does not exist.
+ */
+bool MetadataIndex::getStamp(const std::string &path, FileStamp *stamp)
+{
+    std::string s(path);
+    // At least on windows stat returns an error if there is
+    // a '/' at the end of the path.
+    if (s.size() > 1 && s[s.size()-1] == '/')
+        s.erase(s.end()-1, s.end());
+    struct stat mystat;
+    if (stat(s.c_str(), &mystat) < 0) return false;
+    stamp->m_mtime = (int64_t)mystat.st_mtime;
+    stamp->m_size  = (int64_t)mystat.st_size;
+    return true;
+}   // getStamp
+
+// ----------------------------------------------------------------------------
+/** Appends a node and all its children to a string. Attribute values are
+ *  stored with 32 bits per character, since the size of wchar_t depends on
+ *  the platform.
+ */
+void MetadataIndex::serialiseNode(const XMLNode *node, std::string *out)
+{
+    writeString(out, node->m_name);
+    writeU32(out, (uint32_t)node->m_attributes.size());
+    std::map<std::string, core::stringw>::const_iterator i;
+    for (i = node->m_attributes.begin(); i != node->m_attributes.end(); i++)
+    {
+        writeString(out, i->first);
+        const core::stringw &value = i->second;
+        writeU32(out, value.size());
+        for (unsigned int j = 0; j < value.size(); j++)
+            writeU32(out, (uint32_t)value[j]);
+    }
+    writeU32(out, (uint32_t)node->m_nodes.size());
+    for (unsigned int j = 0; j < node->m_nodes.size(); j++)
+        serialiseNode(node->m_nodes[j], out);
+}   // serialiseNode
+
+// ----------------------------------------------------------------------------
+/** Creates a node tree from data written by serialiseNode.
+ *  \param data Pointer to the data, on return points after the node.
+ *  \param end End of the data.
+ *  \param filename Name of the XML file, used in error messages.
+ *  \return The node, or NULL if the data is invalid.
+ */
+XMLNode *MetadataIndex::deserialiseNode(const char **data, const char *end,
+                                        const std::string &filename)
+{
+    XMLNode *node     = new XMLNode();
+    node->m_file_name = filename;
+    uint32_t num_attributes;
+    if (!readString(data, end, &node->m_name) ||
+        !readU32(data, end, &num_attributes))
+    {
+        delete node;
+        return NULL;
+    }
+    for (unsigned int i = 0; i < num_attributes; i++)
+    {
+        std::string name;
+        uint32_t    length;
+        if (!readString(data, end, &name) || !readU32(data, end, &length) ||
+            (uint32_t)(end - *data) / sizeof(uint32_t) < length)
+        {
+            delete node;
+            return NULL;
+        }
+        core::stringw value;
+        value.reserve(length + 1);
+        for (unsigned int j = 0; j < length; j++)
+        {
+            uint32_t c;
+            readU32(data, end, &c);
+            value.append((wchar_t)c);
+        }
+        node->m_attributes[name] = value;
+    }
+    uint32_t num_nodes;
+    if (!readU32(data, end, &num_nodes))
+    {
+        delete node;
+        return NULL;
+    }
+    for (unsigned int i = 0; i < num_nodes; i++)
+    {
+        XMLNode *child = deserialiseNode(data, end, filename);
+        if (!child)
+        {
+            delete node;
+            return NULL;
+        }
+        node->m_nodes.push_back(child);
+    }
+    return node;
+}   // deserialiseNode
+
+// ----------------------------------------------------------------------------
+/** Loads the index file. If the file is missing or invalid, the index
+ *  starts empty.
+ */
+void MetadataIndex::load()
+{
+    MappedFile file;
+    if (!file.open(m_filename))
+        return;
+
+    const char *data = file.getData();
+    const char *end  = data + file.getSize();
+    uint32_t version, num_directories, num_files;
+    bool ok = file.getSize() >= 4 && memcmp(data, INDEX_MAGIC, 4) == 0;
+    data += 4;
+    ok = ok && readU32(&data, end, &version) && version == INDEX_VERSION;
+    ok = ok && readU32(&data, end, &num_directories);
+    for (unsigned int i = 0; ok && i < num_directories; i++)
+    {
+        std::string name;
+        DirEntry    entry;
+        uint32_t    num_entries;
+        entry.m_used = false;
+        ok = readString(&data, end, &name)                 &&
+             readI64(&data, end, &entry.m_stamp.m_mtime)   &&
+             readI64(&data, end, &entry.m_stamp.m_size)    &&
+             readU32(&data, end, &num_entries);
+        for (unsigned int j = 0; ok && j < num_entries; j++)
+        {
+            std::string file_name;
+            ok = readString(&data, end, &file_name);
+            entry.m_files.insert(file_name);
+        }
+        if (ok)
+            m_directories[name] = entry;
+    }
+    ok = ok && readU32(&data, end, &num_files);
+    for (unsigned int i = 0; ok && i < num_files; i++)
+    {
+        std::string name;
+        XMLEntry    entry;
+        entry.m_used = false;
+        ok = readString(&data, end, &name)                 &&
+             readI64(&data, end, &entry.m_stamp.m_mtime)   &&
+             readI64(&data, end, &entry.m_stamp.m_size)    &&
+             readString(&data, end, &entry.m_data);
+        if (ok)
+            m_xml_files[name] = entry;
+    }
+
+    if (!ok)
+    {
+        Log::warn("MetadataIndex", "Ignoring invalid index '%s'.",
+                  m_filename.c_str());
+        m_directories.clear();
+        m_xml_files.clear();
+    }
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Saves the index if it has changed. Only the entries that were used in
+ *  this run are saved. Failing to save is not an error, the files will
+ *  just be read again at the next start.
+ */
+void MetadataIndex::save()
+{
+    pthread_mutex_lock(&m_mutex);
+    Log::info("MetadataIndex", "%d of %d files and directories were read "
+              "from the index.", m_num_hits, m_num_hits + m_num_misses);
+
+    std::string directories, files;
+    uint32_t num_directories = 0, num_files = 0;
+    bool unused = false;
+    std::map<std::string, DirEntry>::const_iterator d;
+    for (d = m_directories.begin(); d != m_directories.end(); d++)
+    {
+        if (!d->second.m_used)
+        {
+            unused = true;
+            continue;
+        }
+        num_directories++;
+        writeString(&directories, d->first);
+        writeI64(&directories, d->second.m_stamp.m_mtime);
+        writeI64(&directories, d->second.m_stamp.m_size);
+        writeU32(&directories, (uint32_t)d->second.m_files.size());
+        std::set<std::string>::const_iterator f;
+        for (f = d->second.m_files.begin(); f != d->second.m_files.end(); f++)
+            writeString(&directories, *f);
+    }
+    std::map<std::string, XMLEntry>::const_iterator x;
+    for (x = m_xml_files.begin(); x != m_xml_files.end(); x++)
+    {
+        if (!x->second.m_used)
+        {
+            unused = true;
+            continue;
+        }
+        num_files++;
+        writeString(&files, x->first);
+        writeI64(&files, x->second.m_stamp.m_mtime);
+        writeI64(&files, x->second.m_stamp.m_size);
+        writeString(&files, x->second.m_data);
+    }
+    if (!m_changed && !unused)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+    m_changed = false;
+    pthread_mutex_unlock(&m_mutex);
+
+    std::string header(INDEX_MAGIC, 4);
+    writeU32(&header, INDEX_VERSION);
+    writeU32(&header, num_directories);
+    std::string num_files_data;
+    writeU32(&num_files_data, num_files);
+
+    FILE *fd = fopen(m_filename.c_str(), "wb");
+    if (!fd)
+    {
+        Log::debug("MetadataIndex", "Can't write index '%s'.",
+                   m_filename.c_str());
+        return;
+    }
+    bool ok = fwrite(header.data(), header.size(), 1, fd) == 1;
+    ok = ok && (directories.empty() ||
+                fwrite(directories.data(), directories.size(), 1, fd) == 1);
+    ok = ok && fwrite(num_files_data.data(), num_files_data.size(), 1, fd)==1;
+    ok = ok && (files.empty() ||
+                fwrite(files.data(), files.size(), 1, fd) == 1);
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+    {
+        Log::warn("MetadataIndex", "Could not write index '%s'.",
+                  m_filename.c_str());
+        remove(m_filename.c_str());
+    }
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Returns the XML tree of a file. If the file is unchanged since it was
+ *  added to the index, the tree is created from the index, otherwise the
+ *  file is parsed and added to the index.
+ *  \param filename Name of the XML file.
+ *  \return The tree (which must be freed by the caller), or NULL if the
+ *          file could not be read.
+ */
+XMLNode *MetadataIndex::createXMLTree(const std::string &filename)
+{
+    FileStamp stamp;
+    if (!getStamp(filename, &stamp))
+        return file_manager->createXMLTree(filename);
+
+    std::string data;
+    pthread_mutex_lock(&m_mutex);
+    std::map<std::string, XMLEntry>::iterator i = m_xml_files.find(filename);
+    bool found = i != m_xml_files.end() && i->second.m_stamp == stamp;
+    if (found)
+    {
+        i->second.m_used = true;
+        data = i->second.m_data;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    if (found)
+    {
+        const char *p    = data.data();
+        XMLNode    *node = deserialiseNode(&p, p + data.size(), filename);
+        if (node)
+        {
+            pthread_mutex_lock(&m_mutex);
+            m_num_hits++;
+            pthread_mutex_unlock(&m_mutex);
+            return node;
+        }
+        Log::warn("MetadataIndex", "Invalid index entry for '%s'.",
+                  filename.c_str());
+    }
+
+    XMLNode *node = file_manager->createXMLTree(filename);
+    if (!node)
+        return NULL;
+    XMLEntry entry;
+    entry.m_stamp = stamp;
+    entry.m_used  = true;
+    serialiseNode(node, &entry.m_data);
+    pthread_mutex_lock(&m_mutex);
+    m_xml_files[filename] = entry;
+    m_changed = true;
+    m_num_misses++;
+    pthread_mutex_unlock(&m_mutex);
+    return node;
+}   // createXMLTree
+
+// ----------------------------------------------------------------------------
+/** Returns the names of all files in a directory (see
+ *  FileManager::listFiles). If the directory is unchanged since it was
+ *  added to the index, the cached list is returned.
+ *  \param result On return the names of all files.
+ *  \param dir The directory.
+ */
+void MetadataIndex::listFiles(std::set<std::string> &result,
+                              const std::string &dir)
+{
+    FileStamp stamp;
+    if (!getStamp(dir, &stamp))
+    {
+        file_manager->listFiles(result, dir);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    std::map<std::string, DirEntry>::iterator i = m_directories.find(dir);
+    if (i != m_directories.end() && i->second.m_stamp == stamp)
+    {
+        i->second.m_used = true;
+        result = i->second.m_files;
+        m_num_hits++;
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    file_manager->listFiles(result, dir);
+    DirEntry entry;
+    entry.m_stamp = stamp;
+    entry.m_files = result;
+    entry.m_used  = true;
+    pthread_mutex_lock(&m_mutex);
+    m_directories[dir] = entry;
+    m_changed = true;
+    m_num_misses++;
+    pthread_mutex_unlock(&m_mutex);
+}   // listFiles
+
+// ----------------------------------------------------------------------------
+/** Tests that a serialised tree is restored correctly, and that truncated
+ *  data is detected.
+ */
+void MetadataIndex::unitTesting()
+{
+    XMLNode *root = file_manager->createXMLTreeFromString(
+        "<kart name=\"Tux\" version=\"2\">"
+        "  <engine power=\"450 475 500 510\"/>"
+        "  <sounds><sound file=\"a.ogg\"/><sound file=\"b.ogg\"/></sounds>"
+        "</kart>");
+    assert(root);
+    std::string data;
+    serialiseNode(root, &data);
+
+    const char *p = data.data();
+    XMLNode *copy = deserialiseNode(&p, p + data.size(), "test");
+    assert(copy && p == data.data() + data.size());
+    std::string name, power;
+    copy->get("name", &name);
+    assert(name == "Tux");
+    assert(copy->getNumNodes() == 2);
+    copy->getNode("engine")->get("power", &power);
+    assert(power == "450 475 500 510");
+    assert(copy->getNode("sounds")->getNumNodes() == 2);
+    std::string copy_data;
+    serialiseNode(copy, &copy_data);
+    assert(copy_data == data);
+    delete copy;
+
+    for (unsigned int size = 0; size < data.size(); size++)
+    {
+        p = data.data();
+        assert(deserialiseNode(&p, p + size, "test") == NULL);
+    }
+    delete root;
+}   // unitTesting
@@ -0,0 +1,115 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_METADATA_INDEX_HPP
+#define HEADER_METADATA_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <map>
+#include <pthread.h>
+#include <set>
+#include <string>
+
+class XMLNode;
+
+/**
+ * \brief A persistent cache of the data that is read at every startup.
+ *  At startup all kart and track directories are listed, and all kart.xml,
+ *  track.xml (and easter egg) files are parsed. The index stores the
+ *  directory listings and the parsed XML trees in a binary file in the user
+ *  config directory. Each entry is keyed by its path and is only used if the
+ *  modification time and size of the file or directory are unchanged, so
+ *  on a warm start only new or modified files are read again. Entries that
+ *  were not used during a run (e.g. of uninstalled addons) are dropped when
+ *  the index is saved.
+ *  All functions are thread safe, since the karts and tracks are parsed by
+ *  the thread pool.
+ * \ingroup io
+ */
+class MetadataIndex : public NoCopy
+{
+private:
+    /** Modification time and size of a file or directory. */
+    struct FileStamp
+    {
+        int64_t m_mtime;
+        int64_t m_size;
+        bool operator==(const FileStamp &other) const
+        {
+            return m_mtime==other.m_mtime && m_size==other.m_size;
+        }
+    };   // FileStamp
+
+    /** A cached XML file. */
+    struct XMLEntry
+    {
+        FileStamp   m_stamp;
+        /** The serialised XMLNode tree. */
+        std::string m_data;
+        /** True if this entry was used or added in this run. */
+        bool        m_used;
+    };   // XMLEntry
+
+    /** A cached directory listing. */
+    struct DirEntry
+    {
+        FileStamp             m_stamp;
+        std::set<std::string> m_files;
+        bool                  m_used;
+    };   // DirEntry
+
+    /** The cached XML files, indexed by file name. */
+    std::map<std::string, XMLEntry> m_xml_files;
+
+    /** The cached directory listings, indexed by directory name. */
+    std::map<std::string, DirEntry> m_directories;
+
+    /** Name of the index file. */
+    std::string     m_filename;
+
+    /** True if an entry was added or replaced since the index was loaded. */
+    bool            m_changed;
+
+    /** Number of files and directories read from the index, and number of
+     *  files and directories that had to be read again. */
+    unsigned int    m_num_hits, m_num_misses;
+
+    /** Protects all data above. */
+    pthread_mutex_t m_mutex;
+
+    static bool     getStamp(const std::string &path, FileStamp *stamp);
+    static void     serialiseNode(const XMLNode *node, std::string *out);
+    static XMLNode *deserialiseNode(const char **data, const char *end,
+                                    const std::string &filename);
+    void            load();
+
+public:
+             MetadataIndex();
+            ~MetadataIndex();
+    XMLNode *createXMLTree(const std::string &filename);
+    void     listFiles(std::set<std::string> &result, const std::string &dir);
+    void     save();
+    static void unitTesting();
+};   // MetadataIndex
+
+extern MetadataIndex *metadata_index;
+
+#endif
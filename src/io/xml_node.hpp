@@ -57,6 +57,10 @@ private:
 
     std::string                          m_file_name;
 
+    /** Used by the MetadataIndex to create a tree from cached data. */
+    XMLNode() {}
+    friend class MetadataIndex;
+
 public:
          LEAK_CHECK();
          XMLNode(io::IXMLReader *xml);
@@ -23,6 +23,7 @@
 #include "graphics/hit_sfx.hpp"
 #include "graphics/material.hpp"
 #include "io/xml_node.hpp"
+#include "items/projectile_manager.hpp"
 #include "karts/abstract_kart.hpp"
 #include "utils/random_generator.hpp"
 
@@ -56,7 +57,7 @@ Bowling::Bowling(AbstractKart *kart)
     }
 
     createPhysics(y_offset, btVector3(0.0f, 0.0f, m_speed*2),
-                  new btSphereShape(0.5f*m_extend.getY()),
+                  m_st_shape[PowerupManager::POWERUP_BOWLING],
                   1.0f /*restitution*/,
                   -70.0f /*gravity*/,
                   true /*rotates*/);
@@ -77,6 +78,7 @@ Bowling::Bowling(AbstractKart *kart)
     m_max_lifespan = 20;
 
     m_roll_sfx = SFXManager::get()->createSoundSource("bowling_roll");
+    projectile_manager->addPerShotAllocation();
     m_roll_sfx->play();
     m_roll_sfx->setLoop(true);
 
@@ -100,6 +102,9 @@ Bowling::~Bowling()
 void Bowling::init(const XMLNode &node, scene::IMesh *bowling)
 {
     Flyable::init(node, bowling, PowerupManager::POWERUP_BOWLING);
+    setShape(PowerupManager::POWERUP_BOWLING,
+             new btSphereShape(0.5f*m_st_extend[PowerupManager::POWERUP_BOWLING]
+                                   .getY()));
     m_st_max_distance         = 20.0f;
     m_st_max_distance_squared = 20.0f * 20.0f;
     m_st_force_to_target      = 10.0f;
@@ -198,7 +203,7 @@ bool Bowling::hit(AbstractKart* kart, PhysicalObject* obj)
         else
         {
             m_has_hit_kart = kart != NULL;
-            explode(kart, obj, /*hit_secondary*/false);
+            explode(kart, /*hit_secondary*/false);
         }
     }
     return was_real_hit;
@@ -90,7 +90,7 @@ Cake::Cake (AbstractKart *kart) : Flyable(kart, PowerupManager::POWERUP_CAKE)
         m_initial_velocity = Vec3(0.0f, up_velocity, m_speed);
 
         createPhysics(forward_offset, m_initial_velocity,
-                      new btCylinderShape(0.5f*m_extend),
+                      m_st_shape[PowerupManager::POWERUP_CAKE],
                       0.5f /* restitution */, -m_gravity,
                       true /* rotation */, false /* backwards */, &trans);
     }
@@ -104,7 +104,7 @@ Cake::Cake (AbstractKart *kart) : Flyable(kart, PowerupManager::POWERUP_CAKE)
         m_initial_velocity = Vec3(0.0f, up_velocity, m_speed);
 
         createPhysics(forward_offset, m_initial_velocity,
-                      new btCylinderShape(0.5f*m_extend),
+                      m_st_shape[PowerupManager::POWERUP_CAKE],
                       0.5f /* restitution */, -m_gravity,
                       true /* rotation */, backwards, &trans);
     }
@@ -127,6 +127,8 @@ Cake::Cake (AbstractKart *kart) : Flyable(kart, PowerupManager::POWERUP_CAKE)
 void Cake::init(const XMLNode &node, scene::IMesh *cake_model)
 {
     Flyable::init(node, cake_model, PowerupManager::POWERUP_CAKE);
+    setShape(PowerupManager::POWERUP_CAKE,
+             new btCylinderShape(0.5f*m_st_extend[PowerupManager::POWERUP_CAKE]));
     float max_distance        = 80.0f;
     m_gravity                 = 9.8f;
 
@@ -154,7 +156,7 @@ bool Cake::hit(AbstractKart* kart, PhysicalObject* obj)
             kart->decreaseShieldTime();
             return false; //Not sure if a shield hit is a real hit.
         }
-        explode(kart, obj);
+        explode(kart);
     }
 
     return was_real_hit;
@@ -34,6 +34,7 @@
 #include "items/projectile_manager.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/explosion_animation.hpp"
+#include "karts/kart_proximity.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "tracks/track.hpp"
@@ -48,6 +49,7 @@ float         Flyable::m_st_min_height  [PowerupManager::POWERUP_MAX];
 float         Flyable::m_st_max_height  [PowerupManager::POWERUP_MAX];
 float         Flyable::m_st_force_updown[PowerupManager::POWERUP_MAX];
 Vec3          Flyable::m_st_extend      [PowerupManager::POWERUP_MAX];
+btCollisionShape* Flyable::m_st_shape   [PowerupManager::POWERUP_MAX];
 // ----------------------------------------------------------------------------
 
 Flyable::Flyable(AbstractKart *kart, PowerupManager::PowerupType type,
@@ -73,7 +75,15 @@ Flyable::Flyable(AbstractKart *kart, PowerupManager::PowerupType type,
     m_do_terrain_info              = true;
     m_max_lifespan = -1;
 
-    // Add the graphical model
+    // Add the graphical model, reusing the node of a removed flyable
+    // if possible.
+    scene::ISceneNode *node = projectile_manager->getRecycledNode(type);
+    if(node)
+    {
+        setNode(node);
+        return;
+    }
+    projectile_manager->addAllocation();
     setNode(irr_driver->addMesh(m_st_model[type], StringUtils::insertValues("flyable_%i", (int)type)));
     irr_driver->applyObjectPassShader(getNode());
 #ifdef DEBUG
@@ -84,6 +94,40 @@ Flyable::Flyable(AbstractKart *kart, PowerupManager::PowerupType type,
 
 }   // Flyable
 
+// ----------------------------------------------------------------------------
+/** Flyables are allocated by the projectile manager, which reuses the
+ *  memory of deleted flyables.
+ *  \param size Size of the object.
+ */
+void* Flyable::operator new(size_t size)
+{
+    return projectile_manager->allocateFlyable(size);
+}   // operator new
+
+// ----------------------------------------------------------------------------
+/** Returns the memory of a deleted flyable to the projectile manager.
+ *  \param p The memory of the object.
+ *  \param size Size of the object.
+ */
+void Flyable::operator delete(void *p, size_t size)
+{
+    projectile_manager->freeFlyable(p, size);
+}   // operator delete
+
+// ----------------------------------------------------------------------------
+/** Sets the collision shape that is used by all flyables of a type. This is
+ *  called when the flyable type is initialised, and deletes the previous
+ *  shape.
+ *  \param type The type of flyable.
+ *  \param shape The collision shape.
+ */
+void Flyable::setShape(PowerupManager::PowerupType type,
+                       btCollisionShape *shape)
+{
+    delete m_st_shape[type];
+    m_st_shape[type] = shape;
+}   // setShape
+
 // ----------------------------------------------------------------------------
 /** Creates a bullet physics body for the flyable item.
  *  \param forw_offset How far ahead of the kart the flyable should be
@@ -128,6 +172,10 @@ void Flyable::createPhysics(float forw_offset, const Vec3 &velocity,
     trans  *= offset_transform;
 
     m_shape = shape;
+    // Reuse the body of a removed flyable if possible, createBody will then
+    // reinitialise it.
+    if(!projectile_manager->getRecycledBody(m_type, &m_body, &m_motion_state))
+        projectile_manager->addAllocation();
     createBody(m_mass, trans, m_shape, restitution);
     m_user_pointer.set(this);
     World::getWorld()->getPhysics()->addBody(getBody());
@@ -193,10 +241,23 @@ void Flyable::init(const XMLNode &node, scene::IMesh *model,
 }   // init
 
 //-----------------------------------------------------------------------------
+/** Removes the body from the physics world, and gives the body and the
+ *  scene node to the projectile manager so that they can be reused.
+ */
 Flyable::~Flyable()
 {
-    if(m_shape) delete m_shape;
-    World::getWorld()->getPhysics()->removeBody(getBody());
+    if(m_body)
+    {
+        World::getWorld()->getPhysics()->removeBody(getBody());
+        projectile_manager->recycleBody(m_type, m_body, m_motion_state);
+        m_body         = NULL;
+        m_motion_state = NULL;
+    }
+    if(m_node)
+    {
+        projectile_manager->recycleNode(m_type, m_node);
+        m_node = NULL;
+    }
 }   // ~Flyable
 
 //-----------------------------------------------------------------------------
@@ -218,9 +279,22 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
     *minKart = NULL;
 
     World *world = World::getWorld();
-    for(unsigned int i=0 ; i<world->getNumKarts(); i++ )
+    // Only karts within 50 units of inFrontOf are aimed at, so only these
+    // karts need to be tested (some margin is added since the position of
+    // a kart is stored after its update).
+    std::vector<unsigned int> karts;
+    if(inFrontOf != NULL)
     {
-        AbstractKart *kart = world->getKart(i);
+        world->getKartProximity().findKarts(inFrontOf->getXYZ(), 51.0f,
+                                            &karts);
+    }
+    const unsigned int num_karts = inFrontOf != NULL
+                                 ? (unsigned int)karts.size()
+                                 : world->getNumKarts();
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        AbstractKart *kart = world->getKart(inFrontOf != NULL ? karts[k] : k);
         // If a kart has star effect shown, the kart is immune, so
         // it is not considered a target anymore.
         if(kart->isEliminated() || kart == m_owner ||
@@ -262,7 +336,7 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
             *minKart  = kart;
             *minDelta = delta;
         }
-    }  // for i<getNumKarts
+    }  // for k<num_karts
 
 }   // getClosestKart
 
@@ -444,15 +518,14 @@ bool Flyable::hit(AbstractKart *kart_hit, PhysicalObject* object)
 }   // hit
 
 // ----------------------------------------------------------------------------
-/** Creates the explosion physical effect, i.e. pushes the karts and ph
+/** Creates the explosion physical effect, i.e. pushes the karts
  *  appropriately. The corresponding visual/sfx needs to be added manually!
+ *  Track objects are not affected by explosions.
  *  \param kart_hit If non-NULL a kart that was directly hit.
- *  \param object If non-NULL a physical item that was hit directly.
- *  \param secondary_hits True if items that are not directly hit should
+ *  \param secondary_hits True if karts that are not directly hit should
  *         also be affected.
  */
-void Flyable::explode(AbstractKart *kart_hit, PhysicalObject *object,
-                      bool secondary_hits)
+void Flyable::explode(AbstractKart *kart_hit, bool secondary_hits)
 {
     // Apply explosion effect
     // ----------------------
@@ -480,7 +553,6 @@ void Flyable::explode(AbstractKart *kart_hit, PhysicalObject *object,
             }
         }
     }
-    world->getTrack()->handleExplosion(getXYZ(), object, secondary_hits);
 }   // explode
 
 // ----------------------------------------------------------------------------
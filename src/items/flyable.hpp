@@ -72,7 +72,8 @@ protected:
     PowerupManager::PowerupType
                       m_type;
 
-    /** Collision shape of this Flyable. */
+    /** Collision shape of this Flyable (shared by all flyables of this
+     *  type, see m_st_shape). */
     btCollisionShape *m_shape;
 
     /** Maximum height above terrain. */
@@ -119,6 +120,9 @@ protected:
     /** Size of the model. */
     static Vec3       m_st_extend[PowerupManager::POWERUP_MAX];
 
+    /** The collision shape, which is shared by all flyables of a type. */
+    static btCollisionShape *m_st_shape[PowerupManager::POWERUP_MAX];
+
     /** Time since thrown. used so a kart can't hit himself when trying
      *  something, and also to put some time limit to some collectibles */
     float             m_time_since_thrown;
@@ -153,6 +157,8 @@ protected:
                                     const bool rotates=false,
                                     const bool turn_around=false,
                                     const btTransform* customDirection=NULL);
+    static void       setShape(PowerupManager::PowerupType type,
+                               btCollisionShape *shape);
 public:
 
                  Flyable     (AbstractKart* kart,
@@ -161,11 +167,13 @@ public:
     virtual     ~Flyable     ();
     static void  init        (const XMLNode &node, scene::IMesh *model,
                               PowerupManager::PowerupType type);
+    static void* operator new   (size_t size);
+    static void  operator delete(void *p, size_t size);
     virtual bool              updateAndDelete(float);
     virtual HitEffect*        getHitEffect() const;
     bool                      isOwnerImmunity(const AbstractKart *kart_hit) const;
     virtual bool              hit(AbstractKart* kart, PhysicalObject* obj=NULL);
-    void                      explode(AbstractKart* kart, PhysicalObject* obj=NULL,
+    void                      explode(AbstractKart* kart,
                                       bool secondary_hits=true);
     // ------------------------------------------------------------------------
     /** If true the up velocity of the flyable will be adjust so that the
@@ -0,0 +1,225 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "items/item_grid.hpp"
+
+#include "items/item.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+    /** Sort order of items in a cell, identical to the order in which
+     *  ItemManager stores all items. */
+    bool compareItemId(const Item *a, const Item *b)
+    {
+        return a->getItemId() < b->getItemId();
+    }   // compareItemId
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Creates an empty grid.
+ *  \param cell_size Size of a cell in the XZ plane.
+ */
+ItemGrid::ItemGrid(float cell_size)
+{
+    assert(cell_size>0);
+    m_inv_cell_size = 1.0f/cell_size;
+}   // ItemGrid
+
+// ----------------------------------------------------------------------------
+/** Returns the index of the cell a coordinate is in. */
+int ItemGrid::getCellIndex(float f) const
+{
+    return (int)floorf(f*m_inv_cell_size);
+}   // getCellIndex
+
+// ----------------------------------------------------------------------------
+/** Determines the range of cells that an item must be stored in, which
+ *  are all cells touched by the square around the item's hit radius.
+ */
+void ItemGrid::getCellRange(const Item *item, int *min_x, int *max_x,
+                            int *min_z, int *max_z) const
+{
+    const Vec3 &xyz = item->getXYZ();
+    const float r   = sqrtf(item->getDistance2());
+    *min_x = getCellIndex(xyz.getX()-r);
+    *max_x = getCellIndex(xyz.getX()+r);
+    *min_z = getCellIndex(xyz.getZ()-r);
+    *max_z = getCellIndex(xyz.getZ()+r);
+}   // getCellRange
+
+// ----------------------------------------------------------------------------
+/** Adds an item to the grid. The item id must be set before calling this,
+ *  since it is used to keep the items in a cell sorted.
+ *  \param item The item to add.
+ */
+void ItemGrid::insert(Item *item)
+{
+    int min_x, max_x, min_z, max_z;
+    getCellRange(item, &min_x, &max_x, &min_z, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            ItemList &items = m_cells[getKey(x, z)];
+            items.insert(std::upper_bound(items.begin(), items.end(), item,
+                                          compareItemId),
+                         item);
+        }   // for z
+    }   // for x
+}   // insert
+
+// ----------------------------------------------------------------------------
+/** Removes an item from all cells it is stored in.
+ *  \param item The item to remove.
+ */
+void ItemGrid::remove(Item *item)
+{
+    int min_x, max_x, min_z, max_z;
+    getCellRange(item, &min_x, &max_x, &min_z, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            std::unordered_map<uint64_t, ItemList>::iterator cell =
+                m_cells.find(getKey(x, z));
+            assert(cell!=m_cells.end());
+            ItemList &items = cell->second;
+            ItemList::iterator it = std::find(items.begin(), items.end(),
+                                              item);
+            assert(it!=items.end());
+            items.erase(it);
+            // Keep the (now empty) cell: items are frequently dropped at
+            // the same places, so this avoids re-allocating it.
+        }   // for z
+    }   // for x
+}   // remove
+
+// ----------------------------------------------------------------------------
+/** Returns all items that could be hit by a kart at the given position,
+ *  sorted by item id, or NULL if there are none.
+ *  \param xyz Position of the kart.
+ */
+const ItemGrid::ItemList* ItemGrid::getItemsNear(const Vec3 &xyz) const
+{
+    std::unordered_map<uint64_t, ItemList>::const_iterator cell =
+        m_cells.find(getKey(getCellIndex(xyz.getX()),
+                            getCellIndex(xyz.getZ())));
+    if(cell==m_cells.end() || cell->second.empty())
+        return NULL;
+    return &cell->second;
+}   // getItemsNear
+
+// ----------------------------------------------------------------------------
+/** Checks that the grid finds exactly the same items as a linear scan over
+ *  all items, and prints the time per kart for both approaches with 10, 100
+ *  and 1000 items.
+ */
+void ItemGrid::unitTesting()
+{
+    const int num_karts      = 20;
+    const int num_iterations = 500;
+    const int all_num_items[] = {10, 100, 1000};
+
+    for(unsigned int n=0; n<sizeof(all_num_items)/sizeof(int); n++)
+    {
+        const int num_items = all_num_items[n];
+        ItemGrid grid(5.0f);
+        std::vector<Item*> all_items;
+        for(int i=0; i<num_items; i++)
+        {
+            // Use trigger items, since they don't need any graphics. Use
+            // the default item radius for most, and a few larger ones.
+            Vec3 xyz(rand()%3000*0.1f-150.0f, rand()%50*0.1f,
+                     rand()%3000*0.1f-150.0f);
+            float distance = i%10==0 ? 3.0f+(rand()%100)*0.1f : 0.9f;
+            Item *item = new Item(xyz, distance, NULL);
+            item->setItemId(i);
+            all_items.push_back(item);
+            grid.insert(item);
+        }
+        // Remove and re-insert some items, as happens with bubble gums
+        for(int i=0; i<num_items; i+=7)
+            grid.remove(all_items[i]);
+        for(int i=0; i<num_items; i+=7)
+            grid.insert(all_items[i]);
+
+        // Place the karts close to items, so that there are hits
+        std::vector<Vec3> karts;
+        for(int i=0; i<num_karts; i++)
+        {
+            const Vec3 &xyz = all_items[rand()%num_items]->getXYZ();
+            karts.push_back(xyz + Vec3(rand()%20*0.1f-1.0f, 0,
+                                       rand()%20*0.1f-1.0f));
+        }
+
+        // First check that both approaches find the same items
+        for(int k=0; k<num_karts; k++)
+        {
+            std::vector<Item*> hit_linear, hit_grid;
+            for(unsigned int i=0; i<all_items.size(); i++)
+                if(all_items[i]->hitKart(karts[k]))
+                    hit_linear.push_back(all_items[i]);
+            const ItemList *close_items = grid.getItemsNear(karts[k]);
+            for(unsigned int i=0; close_items && i<close_items->size(); i++)
+                if((*close_items)[i]->hitKart(karts[k]))
+                    hit_grid.push_back((*close_items)[i]);
+            assert(hit_linear==hit_grid);
+        }
+
+        int hits = 0;
+        double start = StkTime::getRealTime();
+        for(int it=0; it<num_iterations; it++)
+        {
+            for(int k=0; k<num_karts; k++)
+            {
+                for(unsigned int i=0; i<all_items.size(); i++)
+                    if(all_items[i]->hitKart(karts[k])) hits++;
+            }
+        }
+        double linear_time = StkTime::getRealTime() - start;
+
+        start = StkTime::getRealTime();
+        for(int it=0; it<num_iterations; it++)
+        {
+            for(int k=0; k<num_karts; k++)
+            {
+                const ItemList *close_items = grid.getItemsNear(karts[k]);
+                for(unsigned int i=0; close_items && i<close_items->size(); i++)
+                    if((*close_items)[i]->hitKart(karts[k])) hits--;
+            }
+        }
+        double grid_time = StkTime::getRealTime() - start;
+        assert(hits==0);
+
+        const double queries = double(num_iterations)*num_karts;
+        Log::info("ItemGrid", "%4d items: linear %f us/kart, grid %f us/kart.",
+                  num_items, linear_time/queries*1.0e6,
+                  grid_time/queries*1.0e6);
+
+        for(unsigned int i=0; i<all_items.size(); i++)
+            delete all_items[i];
+    }   // for n
+}   // unitTesting
@@ -0,0 +1,76 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ITEM_GRID_HPP
+#define HEADER_ITEM_GRID_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+class Item;
+class Vec3;
+
+/**
+  * \brief A uniform grid in the XZ plane to quickly find items close to a
+  *  kart.
+  * An item is stored in all cells that are touched by the square around
+  * the item with its hit radius, so a kart only has to test the items in
+  * the cell it is in. Since an item hit is tested with the 3d distance,
+  * which is never smaller than the distance in the XZ plane, this finds
+  * exactly the same items as testing all items. The items in each cell
+  * are sorted by item id, so they are tested in the same order as in
+  * ItemManager's list of all items. Cells are stored in a hash map, so
+  * the grid does not need to know the size of the track (items can be
+  * created before the track bounding box is known).
+  * \ingroup items
+  */
+class ItemGrid : public NoCopy
+{
+public:
+    typedef std::vector<Item*> ItemList;
+
+private:
+    /** 1/size of a cell. */
+    float m_inv_cell_size;
+
+    /** All non-empty cells. */
+    std::unordered_map<uint64_t, ItemList> m_cells;
+
+    void getCellRange(const Item *item, int *min_x, int *max_x,
+                      int *min_z, int *max_z) const;
+    int  getCellIndex(float f) const;
+    // ------------------------------------------------------------------------
+    /** Returns the key of the cell with the given indices. */
+    static uint64_t getKey(int x, int z)
+    {
+        return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(z));
+    }   // getKey
+
+public:
+         ItemGrid(float cell_size);
+    void insert(Item *item);
+    void remove(Item *item);
+    const ItemList* getItemsNear(const Vec3 &xyz) const;
+
+    static void unitTesting();
+};   // ItemGrid
+
+#endif
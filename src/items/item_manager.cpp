@@ -142,7 +142,7 @@ void ItemManager::removeTextures()
 // ============================================================================
 /** Creates a new instance of the item manager. This is done at startup
  *  of each race. */
-ItemManager::ItemManager()
+ItemManager::ItemManager() : m_item_grid(5.0f)
 {
     m_switch_time = -1.0f;
     // The actual loading is done in loadDefaultItems
@@ -216,6 +216,7 @@ void ItemManager::insertItem(Item *item)
     else
         m_all_items.push_back(item);
     item->setItemId(index);
+    m_item_grid.insert(item);
 
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
@@ -300,33 +301,34 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+    // Only test the items in the grid cell the kart is in (which are sorted
+    // by item id, so items are collected in the same order as when testing
+    // all items). m_items_in_quads is not used, since an item close to the
+    // border of a quad can be hit from adjacent quads, and items can be
+    // outside of the track.
+    const ItemGrid::ItemList *items = m_item_grid.getItemsNear(kart->getXYZ());
+    if(!items) return;
+
+    // Use an index, since a collected item might (e.g. through a script
+    // called by a trigger) add new items to the grid.
+    for(unsigned int n=0; n<items->size(); n++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        Item *item = (*items)[n];
+        if(item->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if(item->hitKart(kart->getXYZ(), kart))
         {
             // if we're not playing online, pick the item.
             if (!NetworkWorld::getInstance()->isRunning())
-                collectedItem(*i, kart);
+                collectedItem(item, kart);
             else if (NetworkManager::getInstance()->isServer())
             {
-                collectedItem(*i, kart);
-                NetworkWorld::getInstance()->collectedItem(*i, kart);
+                collectedItem(item, kart);
+                NetworkWorld::getInstance()->collectedItem(item, kart);
             }
         }   // if hit
-    }   // for m_all_items
+    }   // for n<items->size()
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -430,6 +432,7 @@ void ItemManager::deleteItem(Item *item)
         items.erase(it);
     }   // if m_items_in_quads
 
+    m_item_grid.remove(item);
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
@@ -20,6 +20,7 @@
 #define HEADER_ITEMMANAGER_HPP
 
 #include "items/item.hpp"
+#include "items/item_grid.hpp"
 #include "utils/no_copy.hpp"
 
 #include <SColor.h>
@@ -82,6 +83,10 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** A spatial index of all items, used to quickly find the items
+     *  a kart can hit. */
+    ItemGrid m_item_grid;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -78,14 +78,14 @@ Plunger::Plunger(AbstractKart *kart)
         m_initial_velocity = btVector3(0.0f, up_velocity, plunger_speed);
 
         createPhysics(forward_offset, m_initial_velocity,
-                      new btCylinderShape(0.5f*m_extend),
+                      m_st_shape[PowerupManager::POWERUP_PLUNGER],
                       0.5f /* restitution */ , gravity,
                       /* rotates */false , /*turn around*/false, &trans);
     }
     else
     {
         createPhysics(forward_offset, btVector3(pitch, 0.0f, plunger_speed),
-                      new btCylinderShape(0.5f*m_extend),
+                      m_st_shape[PowerupManager::POWERUP_PLUNGER],
                       0.5f /* restitution */, gravity,
                       false /* rotates */, m_reverse_mode, &kart_transform);
     }
@@ -100,6 +100,7 @@ Plunger::Plunger(AbstractKart *kart)
     else
     {
         m_rubber_band = new RubberBand(this, kart);
+        projectile_manager->addPerShotAllocation();
     }
     m_keep_alive = -1;
 }   // Plunger
@@ -115,6 +116,8 @@ Plunger::~Plunger()
 void Plunger::init(const XMLNode &node, scene::IMesh *plunger_model)
 {
     Flyable::init(node, plunger_model, PowerupManager::POWERUP_PLUNGER);
+    setShape(PowerupManager::POWERUP_PLUNGER,
+             new btCylinderShape(0.5f*m_st_extend[PowerupManager::POWERUP_PLUNGER]));
 }   // init
 
 // ----------------------------------------------------------------------------
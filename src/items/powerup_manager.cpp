@@ -357,7 +357,8 @@ PowerupManager::PowerupType PowerupManager::getRandomPowerup(unsigned int pos,
          (race_manager->isTutorialMode() ? POSITION_TUTORIAL_MODE :
                                      m_position_to_class[pos-1]));
 
-    int random = rand()%m_powerups_for_position[pos_class].size();
+    int random = World::getWorld()->getRandomGenerator()
+                 .get((int)m_powerups_for_position[pos_class].size());
     int i=m_powerups_for_position[pos_class][random];
     if(i>=POWERUP_MAX)
     {
@@ -20,6 +20,7 @@
 
 #include "graphics/explosion.hpp"
 #include "graphics/hit_effect.hpp"
+#include "graphics/irr_driver.hpp"
 #include "items/bowling.hpp"
 #include "items/cake.hpp"
 #include "items/plunger.hpp"
@@ -27,9 +28,33 @@
 #include "items/powerup.hpp"
 #include "items/rubber_ball.hpp"
 #include "karts/abstract_kart.hpp"
+#include "physics/kart_motion_state.hpp"
+#include "utils/log.hpp"
+
+#include "btBulletDynamicsCommon.h"
+
+#include <ISceneNode.h>
 
 ProjectileManager *projectile_manager=0;
 
+ProjectileManager::ProjectileManager()
+{
+    m_num_allocations          = 0;
+    m_num_per_shot_allocations = 0;
+    m_num_projectiles          = 0;
+}   // ProjectileManager
+
+//-----------------------------------------------------------------------------
+ProjectileManager::~ProjectileManager()
+{
+    for(unsigned int i=0; i<m_free_memory.size(); i++)
+    {
+        std::vector<void*> &list = m_free_memory[i].second;
+        for(unsigned int j=0; j<list.size(); j++)
+            ::operator delete(list[j]);
+    }
+}   // ~ProjectileManager
+
 void ProjectileManager::loadData()
 {
 }   // loadData
@@ -59,8 +84,151 @@ void ProjectileManager::cleanup()
     }
 
     m_active_hit_effects.clear();
+
+    freeRecycled();
+    if(m_num_projectiles>0)
+        Log::debug("ProjectileManager", "%d projectiles, %d allocations not "
+                   "avoided by recycling (flyables, bodies, nodes), %d "
+                   "per-shot allocations (sound sources, rubber bands and "
+                   "hit effects).", m_num_projectiles, m_num_allocations,
+                   m_num_per_shot_allocations);
+    m_num_projectiles          = 0;
+    m_num_allocations          = 0;
+    m_num_per_shot_allocations = 0;
 }   // cleanup
 
+//-----------------------------------------------------------------------------
+/** Frees all recycled bodies and scene nodes. This must be done at the end
+ *  of a race, since the scene nodes belong to the scene of the race.
+ */
+void ProjectileManager::freeRecycled()
+{
+    for(unsigned int type=0; type<PowerupManager::POWERUP_MAX; type++)
+    {
+        std::vector<RecycledBody> &bodies = m_recycled_bodies[type];
+        for(unsigned int i=0; i<bodies.size(); i++)
+        {
+            delete bodies[i].m_body;
+            delete bodies[i].m_motion_state;
+        }
+        bodies.clear();
+
+        std::vector<scene::ISceneNode*> &nodes = m_recycled_nodes[type];
+        for(unsigned int i=0; i<nodes.size(); i++)
+            irr_driver->removeNode(nodes[i]);
+        nodes.clear();
+    }
+}   // freeRecycled
+
+//-----------------------------------------------------------------------------
+/** Returns memory for a new flyable object, reusing the memory of a deleted
+ *  flyable of the same size if possible.
+ *  \param size Size of the object.
+ */
+void* ProjectileManager::allocateFlyable(size_t size)
+{
+    for(unsigned int i=0; i<m_free_memory.size(); i++)
+    {
+        if(m_free_memory[i].first!=size) continue;
+        std::vector<void*> &list = m_free_memory[i].second;
+        if(list.empty()) break;
+        void *p = list.back();
+        list.pop_back();
+        return p;
+    }
+    m_num_allocations++;
+    return ::operator new(size);
+}   // allocateFlyable
+
+//-----------------------------------------------------------------------------
+/** Keeps the memory of a deleted flyable object for the next flyable of
+ *  the same size.
+ *  \param p The memory.
+ *  \param size Size of the object.
+ */
+void ProjectileManager::freeFlyable(void *p, size_t size)
+{
+    for(unsigned int i=0; i<m_free_memory.size(); i++)
+    {
+        if(m_free_memory[i].first==size)
+        {
+            m_free_memory[i].second.push_back(p);
+            return;
+        }
+    }
+    m_free_memory.push_back(std::make_pair(size, std::vector<void*>()));
+    m_free_memory.back().second.push_back(p);
+}   // freeFlyable
+
+//-----------------------------------------------------------------------------
+/** Keeps the rigid body and motion state of a removed flyable, so that they
+ *  can be reused by a new flyable of the same type. The body must not be
+ *  part of the physics world anymore.
+ *  \param type Type of the flyable.
+ *  \param body The rigid body.
+ *  \param motion_state The motion state of the body.
+ */
+void ProjectileManager::recycleBody(PowerupManager::PowerupType type,
+                                    btRigidBody *body,
+                                    KartMotionState *motion_state)
+{
+    RecycledBody b;
+    b.m_body         = body;
+    b.m_motion_state = motion_state;
+    m_recycled_bodies[type].push_back(b);
+}   // recycleBody
+
+//-----------------------------------------------------------------------------
+/** Returns a recycled rigid body and motion state for a flyable.
+ *  \param type Type of the flyable.
+ *  \param body On return the body.
+ *  \param motion_state On return the motion state.
+ *  \return False if there is no recycled body for this type.
+ */
+bool ProjectileManager::getRecycledBody(PowerupManager::PowerupType type,
+                                        btRigidBody **body,
+                                        KartMotionState **motion_state)
+{
+    std::vector<RecycledBody> &bodies = m_recycled_bodies[type];
+    if(bodies.empty())
+        return false;
+    *body         = bodies.back().m_body;
+    *motion_state = bodies.back().m_motion_state;
+    bodies.pop_back();
+    return true;
+}   // getRecycledBody
+
+//-----------------------------------------------------------------------------
+/** Hides the scene node of a removed flyable and keeps it for the next
+ *  flyable of the same type.
+ *  \param type Type of the flyable.
+ *  \param node The scene node.
+ */
+void ProjectileManager::recycleNode(PowerupManager::PowerupType type,
+                                    scene::ISceneNode *node)
+{
+    node->setVisible(false);
+    m_recycled_nodes[type].push_back(node);
+}   // recycleNode
+
+//-----------------------------------------------------------------------------
+/** Returns a recycled scene node for a flyable (which is visible again),
+ *  or NULL if there is none.
+ *  \param type Type of the flyable.
+ */
+scene::ISceneNode* ProjectileManager::getRecycledNode(
+                                           PowerupManager::PowerupType type)
+{
+    std::vector<scene::ISceneNode*> &nodes = m_recycled_nodes[type];
+    if(nodes.empty())
+        return NULL;
+    scene::ISceneNode *node = nodes.back();
+    nodes.pop_back();
+    node->setVisible(true);
+    node->setScale(core::vector3df(1.0f, 1.0f, 1.0f));
+    return node;
+}   // getRecycledNode
+
 // -----------------------------------------------------------------------------
 /** General projectile update call. */
 void ProjectileManager::update(float dt)
@@ -89,27 +257,32 @@ void ProjectileManager::update(float dt)
 }   // update
 
 // -----------------------------------------------------------------------------
-/** Updates all rockets on the server (or no networking). */
+/** Updates all rockets on the server (or no networking). Removed projectiles
+ *  are deleted, and the remaining ones are moved to the front of the list
+ *  (keeping their order) in the same pass.
+ */
 void ProjectileManager::updateServer(float dt)
 {
-    Projectiles::iterator p = m_active_projectiles.begin();
-    while(p!=m_active_projectiles.end())
+    unsigned int num_active = 0;
+    for(unsigned int i=0; i<m_active_projectiles.size(); i++)
     {
-        bool can_be_deleted = (*p)->updateAndDelete(dt);
+        Flyable *f = m_active_projectiles[i];
+        bool can_be_deleted = f->updateAndDelete(dt);
         if(can_be_deleted)
         {
-            HitEffect *he = (*p)->getHitEffect();
+            HitEffect *he = f->getHitEffect();
             if(he)
+            {
+                // Hit effects are not recycled.
+                m_num_per_shot_allocations++;
                 addHitEffect(he);
-            Flyable *f=*p;
-            Projectiles::iterator p_next=m_active_projectiles.erase(p);
+            }
             delete f;
-            p=p_next;
         }
         else
-            p++;
-    }   // while p!=m_active_projectiles.end()
-    
+            m_active_projectiles[num_active++] = f;
+    }   // for i<m_active_projectiles.size()
+    m_active_projectiles.resize(num_active);
 }   // updateServer
 
 // -----------------------------------------------------------------------------
@@ -131,6 +304,7 @@ Flyable *ProjectileManager::newProjectile(AbstractKart *kart,
         default:              return NULL;
     }
     m_active_projectiles.push_back(f);
+    m_num_projectiles++;
     return f;
 }   // newProjectile
 
@@ -23,15 +23,17 @@
 
 namespace irr
 {
-    namespace scene { class IMesh; }
+    namespace scene { class IMesh; class ISceneNode; }
 }
 
 #include "items/powerup_manager.hpp"
 #include "utils/no_copy.hpp"
 
 class AbstractKart;
+class btRigidBody;
 class Flyable;
 class HitEffect;
+class KartMotionState;
 class Track;
 class Vec3;
 
@@ -52,10 +54,43 @@ private:
      *  being shown or have a sfx playing. */
     HitEffects       m_active_hit_effects;
 
+    /** A rigid body and its motion state of a removed flyable. */
+    struct RecycledBody
+    {
+        btRigidBody     *m_body;
+        KartMotionState *m_motion_state;
+    };   // RecycledBody
+
+    /** The bodies of removed flyables for each type. They are not part of
+     *  the physics world, and are reused by new flyables of the same type. */
+    std::vector<RecycledBody>        m_recycled_bodies[PowerupManager::POWERUP_MAX];
+
+    /** The (hidden) scene nodes of removed flyables for each type. */
+    std::vector<irr::scene::ISceneNode*> m_recycled_nodes[PowerupManager::POWERUP_MAX];
+
+    /** The memory of deleted flyable objects, for each object size. */
+    std::vector<std::pair<size_t, std::vector<void*> > > m_free_memory;
+
+    /** Number of flyable objects, rigid bodies, motion states and scene
+     *  nodes that had to be allocated because nothing could be recycled.
+     *  Once each type was fired a few times this stays at 0. */
+    unsigned int     m_num_allocations;
+
+    /** Number of objects that are allocated for each shot and are not
+     *  recycled: sound sources of bowling and rubber balls, rubber bands of
+     *  plungers and hit effects. So this is not 0 in steady state. Memory
+     *  allocated internally by bullet, irrlicht or the sound system is not
+     *  counted in either counter. */
+    unsigned int     m_num_per_shot_allocations;
+
+    /** Number of projectiles fired since the last cleanup. */
+    unsigned int     m_num_projectiles;
+
     void             updateServer(float dt);
+    void             freeRecycled();
 public:
-                     ProjectileManager() {}
-                    ~ProjectileManager() {}
+                     ProjectileManager();
+                    ~ProjectileManager();
     void             loadData         ();
     void             cleanup          ();
     void             update           (float dt);
@@ -65,6 +100,33 @@ public:
     void             removeTextures   ();
     bool             projectileIsClose(const AbstractKart * const kart,
                                        float radius);
+    void*            allocateFlyable  (size_t size);
+    void             freeFlyable      (void *p, size_t size);
+    void             recycleBody      (PowerupManager::PowerupType type,
+                                       btRigidBody *body,
+                                       KartMotionState *motion_state);
+    bool             getRecycledBody  (PowerupManager::PowerupType type,
+                                       btRigidBody **body,
+                                       KartMotionState **motion_state);
+    void             recycleNode      (PowerupManager::PowerupType type,
+                                       irr::scene::ISceneNode *node);
+    irr::scene::ISceneNode* getRecycledNode(PowerupManager::PowerupType type);
+    // ------------------------------------------------------------------------
+    /** Counts an allocation that recycling could not avoid (see
+     *  m_num_allocations). */
+    void             addAllocation() { m_num_allocations++; }
+    // ------------------------------------------------------------------------
+    /** Counts an allocation that is done for each shot (see
+     *  m_num_per_shot_allocations). */
+    void             addPerShotAllocation() { m_num_per_shot_allocations++; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of allocations for flyables that could not be
+     *  avoided by recycling. */
+    unsigned int     getNumAllocations() const { return m_num_allocations; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of allocations that are done for each shot. */
+    unsigned int     getNumPerShotAllocations() const
+                                        { return m_num_per_shot_allocations; }
     // ------------------------------------------------------------------------
     /** Adds a special hit effect to be shown.
      *  \param hit_effect The hit effect to be added. */
@@ -66,7 +66,7 @@ RubberBall::RubberBall(AbstractKart *kart)
     float forw_offset = 0.5f*kart->getKartLength() + m_extend.getZ()*0.5f+5.0f;
 
     createPhysics(forw_offset, btVector3(0.0f, 0.0f, m_speed*2),
-                  new btSphereShape(0.5f*m_extend.getY()),
+                  m_st_shape[PowerupManager::POWERUP_RUBBERBALL],
                   -70.0f /*gravity*/,
                   true /*rotates*/);
 
@@ -82,6 +82,7 @@ RubberBall::RubberBall(AbstractKart *kart)
     m_interval           = m_st_interval;
     m_current_max_height = m_max_height;
     m_ping_sfx           = SFXManager::get()->createSoundSource("ball_bounce");
+    projectile_manager->addPerShotAllocation();
     // Just init the previoux coordinates with some value that's not getXYZ()
     m_previous_xyz       = m_owner->getXYZ();
     m_previous_height    = 2.0f;  //
@@ -293,6 +294,9 @@ void RubberBall::init(const XMLNode &node, scene::IMesh *rubberball)
         Log::warn("powerup",
                   "No time-between-balls specified for rubber ball.");
     Flyable::init(node, rubberball, PowerupManager::POWERUP_RUBBERBALL);
+    setShape(PowerupManager::POWERUP_RUBBERBALL,
+             new btSphereShape(0.5f*m_st_extend[PowerupManager::POWERUP_RUBBERBALL]
+                                   .getY()));
 }   // init
 
 // ----------------------------------------------------------------------------
@@ -713,7 +717,7 @@ bool RubberBall::hit(AbstractKart* kart, PhysicalObject* object)
             kart->decreaseShieldTime();
         }
         else
-            explode(kart, object);
+            explode(kart);
     }
     return was_real_hit;
 }   // hit
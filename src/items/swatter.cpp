@@ -37,6 +37,7 @@
 #include "karts/controller/controller.hpp"
 #include "karts/explosion_animation.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_proximity.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 
@@ -278,10 +279,14 @@ void Swatter::squashThingsAround()
     m_swat_sound->setPosition(swatter_pos);
     m_swat_sound->play();
 
-    // Squash karts around
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    // Squash karts around. Some margin is added to the search radius,
+    // since the position of a kart is stored after its update.
+    std::vector<unsigned int> karts;
+    world->getKartProximity().findKarts(swatter_pos, sqrt(min_dist2)+1.0f,
+                                        &karts);
+    for(unsigned int i=0; i<karts.size(); i++)
     {
-        AbstractKart *kart = world->getKart(i);
+        AbstractKart *kart = world->getKart(karts[i]);
         // TODO: isSwatterReady()
         if(kart->isEliminated() || kart==m_kart)
             continue;
@@ -23,6 +23,7 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/skidding_properties.hpp"
+#include "karts/controller/ai_path.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "modes/linear_world.hpp"
 #include "tracks/track.hpp"
@@ -48,16 +49,17 @@ At race start and every time a new lap is started, the AI will compute the
 path the kart is taking this lap (computePath). At this stage the decision
 which road in case of shortcut to take is purely random. It stores the
 information in two arrays:
-  m_successor_index[i] stores which successor to take from node i.
+  m_path->getSuccessorIndex(i) stores which successor to take from node i.
        The successor is a number between 0 and number_of_successors - 1.
-  m_next_node_index[i] stores the actual index of the graph node that
+  m_path->getNextNode(i) stores the actual index of the graph node that
        follows after node i.
-Depending on operation one of the other data is more useful, so this
-class stores both information to avoid looking it up over and over.
-Once this is done (still in computePath), the array m_all_look_aheads is
-computed. This array stores for each quad a list of the next (atm) 10 quads.
+Depending on operation one of the other data is more useful, so the path
+stores both information to avoid looking it up over and over. The path also
+stores for each quad a list of the next (atm) 10 quads (getLookAheads).
 This is used when the AI is selecting where to drive next, and it will just
-pass the list of next quads to findRoadSector.
+pass the list of next quads to findRoadSector. These tables are the same
+for all AIs that selected the same branches, so they are computed once and
+shared (see AIPath).
 
 Note that the quad graph information is stored for every quad in the quad
 graph, even if the quad is not on the path chosen. This is necessary since
@@ -66,9 +68,9 @@ pushed on that part, or couldn't get a sharp corner).
 
 In update(), which gets called one per frame per AI, this object will
 determine the quad the kart is currently on (which is then used to determine
-where the kart will be driving to). This uses the m_all_look_aheads to
+where the kart will be driving to). This uses the look-ahead lists to
 speed up this process (since the kart is likely to be either on the same
-quad as it was before, or the next quad in the m_all_look_aheads list).
+quad as it was before, or the next quad in the look-ahead list).
 
 It will also check if the kart is stuck:
 this is done by maintaining a list of times when the kart hits the track. If
@@ -108,9 +110,7 @@ AIBaseController::AIBaseController(AbstractKart *kart,
         // a linear world, since it assumes the existance of drivelines)
         m_world           = NULL;
         m_track           = NULL;
-        m_next_node_index.clear();
-        m_all_look_aheads.clear();
-        m_successor_index.clear();
+        m_path            = NULL;
     }   // if battle mode
     // Don't call our own setControllerName, since this will add a
     // billboard showing 'aibasecontroller' to the kar.
@@ -162,8 +162,8 @@ void  AIBaseController::newLap(int lap)
  */
 void AIBaseController::computePath()
 {
-    m_next_node_index.resize(QuadGraph::get()->getNumNodes());
-    m_successor_index.resize(QuadGraph::get()->getNumNodes());
+    std::vector<int> next_node_index(QuadGraph::get()->getNumNodes());
+    std::vector<int> successor_index(QuadGraph::get()->getNumNodes());
     std::vector<unsigned int> next;
     for(unsigned int i=0; i<QuadGraph::get()->getNumNodes(); i++)
     {
@@ -181,36 +181,14 @@ void AIBaseController::computePath()
         // For now pick one part on random, which is not adjusted during the
         // race. Long term statistics might be gathered to determine the
         // best way, potentially depending on race position etc.
-        int r = rand();
-        int indx = (int)( r / ((float)(RAND_MAX)+1.0f) * next.size() );
-        // In case of rounding errors0
-        if(indx>=(int)next.size()) indx--;
-        m_successor_index[i] = indx;
+        int indx = World::getWorld()->getRandomGenerator()
+                                     .get((int)next.size());
+        successor_index[i] = indx;
         assert(indx <(int)next.size() && indx>=0);
-        m_next_node_index[i] = next[indx];
+        next_node_index[i] = next[indx];
     }
 
-    const unsigned int look_ahead=10;
-    // Now compute for each node in the graph the list of the next 'look_ahead'
-    // graph nodes. This is the list of node that is tested in checkCrashes.
-    // If the look_ahead is too big, the AI can skip loops (see
-    // QuadGraph::findRoadSector for details), if it's too short the AI won't
-    // find too good a driveline. Note that in general this list should
-    // be computed recursively, but since the AI for now is using only
-    // (randomly picked) path this is fine
-    m_all_look_aheads.resize(QuadGraph::get()->getNumNodes());
-    for(unsigned int i=0; i<QuadGraph::get()->getNumNodes(); i++)
-    {
-        std::vector<int> l;
-        int current = i;
-        for(unsigned int j=0; j<look_ahead; j++)
-        {
-            assert(current < (int)m_next_node_index.size());
-            l.push_back(m_next_node_index[current]);
-            current = m_next_node_index[current];
-        }   // for j<look_ahead
-        m_all_look_aheads[i] = l;
-    }
+    m_path = AIPath::get(successor_index, next_node_index);
 }   // computePath
 
 //-----------------------------------------------------------------------------
@@ -230,7 +208,7 @@ void AIBaseController::update(float dt)
         if(m_track_node!=QuadGraph::UNKNOWN_SECTOR)
         {
             QuadGraph::get()->findRoadSector(m_kart->getXYZ(), &m_track_node,
-                &m_all_look_aheads[m_track_node]);
+                &m_path->getLookAheads(m_track_node));
         }
         // If we can't find a proper place on the track, to a broader search
         // on off-track locations.
@@ -241,7 +219,7 @@ void AIBaseController::update(float dt)
         // IF the AI is off track (or on a branch of the track it did not
         // select to be on), keep the old position.
         if(m_track_node==QuadGraph::UNKNOWN_SECTOR ||
-            m_next_node_index[m_track_node]==-1)
+            m_path->getNextNode(m_track_node)==-1)
             m_track_node = old_node;
     }
 }   // update
@@ -22,6 +22,7 @@
 #include "karts/controller/controller.hpp"
 #include "states_screens/state_manager.hpp"
 
+class AIPath;
 class AIProperties;
 class LinearWorld;
 class QuadGraph;
@@ -66,17 +67,13 @@ protected:
      *  chosen by the AI). */
     int   m_track_node;
 
-    /** Which of the successors of a node was selected by the AI. */
-    std::vector<int> m_successor_index;
-    /** For each node in the graph this list contains the chosen next node.
-     *  For normal lap track without branches we always have
-     *  m_next_node_index[i] = (i+1) % size;
+    /** The path the AI follows, i.e. which successor is selected at each
+     *  graph node. For normal lap track without branches we always have
+     *  m_path->getNextNode(i) = (i+1) % size;
      *  but if a branch is possible, the AI will select one option here.
-     *  If the node is not used, m_next_node_index will be -1. */
-    std::vector<int> m_next_node_index;
-    /** For each graph node this list contains a list of the next X
-     *  graph nodes. */
-    std::vector<std::vector<int> > m_all_look_aheads;
+     *  The path is shared with all AIs that selected the same branches.
+     *  NULL in battle mode. */
+    const AIPath *m_path;
 
     virtual void update      (float delta) ;
     virtual unsigned int getNextSector(unsigned int index);
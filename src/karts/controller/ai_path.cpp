@@ -0,0 +1,97 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/controller/ai_path.hpp"
+
+#include "tracks/quad_graph.hpp"
+#include "utils/log.hpp"
+
+std::vector<AIPath*> AIPath::m_all_paths;
+
+/** Creates the tables of a path.
+ *  \param successor_index Which successor is taken at each node.
+ *  \param next_node_index The next node for each node.
+ */
+AIPath::AIPath(const std::vector<int> &successor_index,
+               const std::vector<int> &next_node_index)
+      : m_successor_index(successor_index),
+        m_next_node_index(next_node_index)
+{
+    const unsigned int num_nodes = (unsigned int)m_next_node_index.size();
+
+    // Compute for each node in the graph the list of the next LOOK_AHEAD
+    // graph nodes. This is the list of node that is tested in checkCrashes.
+    // If the look_ahead is too big, the AI can skip loops (see
+    // QuadGraph::findRoadSector for details), if it's too short the AI won't
+    // find too good a driveline. Note that in general this list should
+    // be computed recursively, but since the AI for now is using only
+    // (randomly picked) path this is fine
+    m_all_look_aheads.resize(num_nodes);
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        std::vector<int> &l = m_all_look_aheads[i];
+        l.reserve(LOOK_AHEAD);
+        int current = i;
+        for(unsigned int j=0; j<LOOK_AHEAD; j++)
+        {
+            assert(current < (int)num_nodes);
+            l.push_back(m_next_node_index[current]);
+            current = m_next_node_index[current];
+        }   // for j<LOOK_AHEAD
+    }
+
+    m_angle_to_next.resize(num_nodes);
+    m_distance_to_next.resize(num_nodes);
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        m_angle_to_next[i] =
+            QuadGraph::get()->getAngleToNext(i, m_successor_index[i]);
+        m_distance_to_next[i] =
+            QuadGraph::get()->getDistanceToNext(i, m_successor_index[i]);
+    }
+}   // AIPath
+
+// ----------------------------------------------------------------------------
+/** Returns the path with the given successors. If no AI used this path
+ *  on the current track so far, it is created.
+ *  \param successor_index Which successor is taken at each node.
+ *  \param next_node_index The next node for each node.
+ */
+const AIPath *AIPath::get(const std::vector<int> &successor_index,
+                          const std::vector<int> &next_node_index)
+{
+    for(unsigned int i=0; i<m_all_paths.size(); i++)
+    {
+        if(m_all_paths[i]->m_next_node_index == next_node_index &&
+           m_all_paths[i]->m_successor_index == successor_index   )
+            return m_all_paths[i];
+    }
+    AIPath *path = new AIPath(successor_index, next_node_index);
+    m_all_paths.push_back(path);
+    Log::debug("AIPath", "Created AI path %d.", (int)m_all_paths.size());
+    return path;
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Deletes all paths. Called when the track is removed. */
+void AIPath::destroyAll()
+{
+    for(unsigned int i=0; i<m_all_paths.size(); i++)
+        delete m_all_paths[i];
+    m_all_paths.clear();
+}   // destroyAll
@@ -0,0 +1,114 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_AI_PATH_HPP
+#define HEADER_AI_PATH_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <vector>
+
+/** \brief The path an AI follows through the quad graph, i.e. which
+ *  successor is taken at each graph node, together with the tables derived
+ *  from it (the next nodes to test in findRoadSector, and the angle and
+ *  distance to the selected successor).
+ *  Paths are immutable and shared: all AIs that selected the same branches
+ *  use the same object (on tracks without branches all AIs share a single
+ *  path). They are created on demand with get() and deleted with
+ *  destroyAll() when the track is removed.
+ * \ingroup controller
+ */
+class AIPath : public NoCopy
+{
+private:
+    /** Number of graph nodes stored in the look-ahead list of each node. */
+    static const unsigned int LOOK_AHEAD = 10;
+
+    /** Which of the successors of a node was selected. */
+    std::vector<int>                m_successor_index;
+
+    /** For each node in the graph the chosen next node. */
+    std::vector<int>                m_next_node_index;
+
+    /** For each graph node the list of the next LOOK_AHEAD graph nodes. */
+    std::vector<std::vector<int> >  m_all_look_aheads;
+
+    /** For each graph node the angle to the chosen successor. */
+    std::vector<float>              m_angle_to_next;
+
+    /** For each graph node the distance to the chosen successor. */
+    std::vector<float>              m_distance_to_next;
+
+    /** All paths created for the current track. */
+    static std::vector<AIPath*>     m_all_paths;
+
+    AIPath(const std::vector<int> &successor_index,
+           const std::vector<int> &next_node_index);
+
+public:
+    static const AIPath *get(const std::vector<int> &successor_index,
+                             const std::vector<int> &next_node_index);
+    static void destroyAll();
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of different paths used on the current track. */
+    static unsigned int getNumPaths()
+    {
+        return (unsigned int)m_all_paths.size();
+    }   // getNumPaths
+    // ------------------------------------------------------------------------
+    /** Returns which of the successors of a node is taken. */
+    int getSuccessorIndex(unsigned int n) const
+    {
+        assert(n < m_successor_index.size());
+        return m_successor_index[n];
+    }   // getSuccessorIndex
+    // ------------------------------------------------------------------------
+    /** Returns the graph node following node n on this path. */
+    int getNextNode(unsigned int n) const
+    {
+        assert(n < m_next_node_index.size());
+        return m_next_node_index[n];
+    }   // getNextNode
+    // ------------------------------------------------------------------------
+    /** Returns the list of the graph nodes following node n. */
+    const std::vector<int> &getLookAheads(unsigned int n) const
+    {
+        assert(n < m_all_look_aheads.size());
+        return m_all_look_aheads[n];
+    }   // getLookAheads
+    // ------------------------------------------------------------------------
+    /** Returns the angle from node n to the next node on this path. */
+    float getAngleToNext(unsigned int n) const
+    {
+        assert(n < m_angle_to_next.size());
+        return m_angle_to_next[n];
+    }   // getAngleToNext
+    // ------------------------------------------------------------------------
+    /** Returns the distance from node n to the next node on this path. */
+    float getDistanceToNext(unsigned int n) const
+    {
+        assert(n < m_distance_to_next.size());
+        return m_distance_to_next[n];
+    }   // getDistanceToNext
+};   // AIPath
+
+#endif
+
+/* EOF */
@@ -104,6 +104,13 @@ public:
     /** Get a pointer on the kart controls. */
     virtual KartControl* getControls() { return m_controls; }
     // ------------------------------------------------------------------------
+    /** Called for all karts before any kart is updated, for different
+     *  karts at the same time from different threads. A controller can
+     *  compute its decisions here, which are then applied in update().
+     *  It must only change the state of the controller and its kart
+     *  controls, and only read the state of the world and the karts. */
+    virtual void  computeDecisions(float dt) {}
+    // ------------------------------------------------------------------------
 };   // Controller
 
 #endif
@@ -40,6 +40,7 @@
 #endif
 
 #include "karts/abstract_kart.hpp"
+#include "karts/controller/ai_path.hpp"
 #include "karts/max_speed.hpp"
 #include "karts/rescue_animation.hpp"
 #include "modes/linear_world.hpp"
@@ -61,37 +62,20 @@ EndController::EndController(AbstractKart *kart, StateManager::ActivePlayer *pla
         // Overwrite the random selected default path from AIBaseController
         // with a path that always picks the first branch (i.e. it follows
         // the main driveline).
+        std::vector<int> successor_index(QuadGraph::get()->getNumNodes());
+        std::vector<int> next_node_index(QuadGraph::get()->getNumNodes());
         std::vector<unsigned int> next;
         for(unsigned int i=0; i<QuadGraph::get()->getNumNodes(); i++)
         {
             // 0 is always a valid successor - so even if the kart should end
             // up by accident on a non-selected path, it will keep on working.
-            m_successor_index[i] = 0;
+            successor_index[i] = 0;
 
             next.clear();
             QuadGraph::get()->getSuccessors(i, next);
-            m_next_node_index[i] = next[0];
-        }
-
-        const unsigned int look_ahead=10;
-        // Now compute for each node in the graph the list of the next 'look_ahead'
-        // graph nodes. This is the list of node that is tested in checkCrashes.
-        // If the look_ahead is too big, the AI can skip loops (see
-        // QuadGraph::findRoadSector for details), if it's too short the AI won't
-        // find too good a driveline. Note that in general this list should
-        // be computed recursively, but since the AI for now is using only
-        // (randomly picked) path this is fine
-        for(unsigned int i=0; i<QuadGraph::get()->getNumNodes(); i++)
-        {
-            std::vector<int> l;
-            int current = i;
-            for(unsigned int j=0; j<look_ahead; j++)
-            {
-                l.push_back(m_next_node_index[current]);
-                current = m_next_node_index[current];
-            }   // for j<look_ahead
-            m_all_look_aheads[i] = l;
+            next_node_index[i] = next[0];
         }
+        m_path = AIPath::get(successor_index, next_node_index);
     }   // if not battle mode
 
     // Reset must be called after QuadGraph::get() etc. is set up
@@ -213,7 +197,7 @@ void EndController::handleSteering(float dt)
     if( fabsf(m_world->getDistanceToCenterForKart( m_kart->getWorldKartId() ))  >
        0.5f* QuadGraph::get()->getNode(m_track_node).getPathWidth()+0.5f )
     {
-        const int next = m_next_node_index[m_track_node];
+        const int next = m_path->getNextNode(m_track_node);
         target_point = QuadGraph::get()->getQuadOfNode(next).getCenter();
 #ifdef AI_DEBUG
         Log::debug("end_controller.cpp", "- Outside of road: steer to center point.");
@@ -258,7 +242,7 @@ void EndController::handleRescue(const float DELTA)
  */
 void EndController::findNonCrashingPoint(Vec3 *result)
 {
-    unsigned int sector = m_next_node_index[m_track_node];
+    unsigned int sector = m_path->getNextNode(m_track_node);
     int target_sector;
 
     Vec3 direction;
@@ -271,7 +255,7 @@ void EndController::findNonCrashingPoint(Vec3 *result)
     {
         //target_sector is the sector at the longest distance that we can drive
         //to without crashing with the track.
-        target_sector = m_next_node_index[sector];
+        target_sector = m_path->getNextNode(sector);
 
         //direction is a vector from our kart to the sectors we are testing
         direction = QuadGraph::get()->getQuadOfNode(target_sector).getCenter()
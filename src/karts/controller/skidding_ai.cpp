@@ -46,9 +46,11 @@
 #include "items/powerup.hpp"
 #include "items/projectile_manager.hpp"
 #include "karts/abstract_kart.hpp"
+#include "karts/controller/ai_path.hpp"
 #include "karts/controller/kart_control.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_proximity.hpp"
 #include "karts/max_speed.hpp"
 #include "karts/rescue_animation.hpp"
 #include "karts/skidding.hpp"
@@ -190,6 +192,9 @@ void SkiddingAI::reset()
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
+    m_decisions_computed         = false;
+    m_needs_rescue               = false;
+    m_speed_cap                  = -1.0f;
 
     AIBaseController::reset();
     m_track_node               = QuadGraph::UNKNOWN_SECTOR;
@@ -225,19 +230,20 @@ const irr::core::stringw& SkiddingAI::getNamePostfix() const
  */
 unsigned int SkiddingAI::getNextSector(unsigned int index)
 {
-    return m_successor_index[index];
+    return m_path->getSuccessorIndex(index);
 }   // getNextSector
 
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
- *  It is called once per frame for each AI and determines the behaviour of
- *  the AI, e.g. steering, accelerating/braking, firing.
+ *  It is called once per frame for each AI and applies the decisions made
+ *  in computeDecisions (which is called here if the world did not call it
+ *  before all karts were updated).
  */
 void SkiddingAI::update(float dt)
 {
-    // This is used to enable firing an item backwards.
-    m_controls->m_look_back = false;
-    m_controls->m_nitro     = false;
+    if(!m_decisions_computed)
+        makeDecisions(dt);
+    m_decisions_computed = false;
 
     // Don't do anything if there is currently a kart animations shown.
     if(m_kart->getKartAnimation())
@@ -249,7 +255,7 @@ void SkiddingAI::update(float dt)
         {
             if (m_kart->getPosition() > 1)
             {
-                int r = rand() % 5;
+                int r = m_random.get(5);
                 if (r == 0 || r == 1)
                     m_kart->setPowerup(PowerupManager::POWERUP_ZIPPER, 1);
                 else if (r == 2 || r == 3)
@@ -259,7 +265,7 @@ void SkiddingAI::update(float dt)
             }
             else if (m_kart->getAttachment()->getType() == Attachment::ATTACH_SWATTER)
             {
-                int r = rand() % 4;
+                int r = m_random.get(4);
                 if (r < 3)
                     m_kart->setPowerup(PowerupManager::POWERUP_BUBBLEGUM, 1);
                 else
@@ -267,7 +273,7 @@ void SkiddingAI::update(float dt)
             }
             else
             {
-                int r = rand() % 5;
+                int r = m_random.get(5);
                 if (r == 0 || r == 1)
                     m_kart->setPowerup(PowerupManager::POWERUP_BUBBLEGUM, 1);
                 else if (r == 2 || r == 3)
@@ -295,6 +301,48 @@ void SkiddingAI::update(float dt)
         }
     }
 
+    if(m_speed_cap>=0)
+        m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI, m_speed_cap,
+                            /*fade_in_time*/0.0f);
+
+    if(m_needs_rescue)
+        new RescueAnimation(m_kart);
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Called by the world for all karts (in parallel) before any kart is
+ *  updated.
+ */
+void SkiddingAI::computeDecisions(float dt)
+{
+    // The debug graphics can only be changed in the main thread, so with
+    // AI_DEBUG all decisions are made in update().
+#ifndef AI_DEBUG
+    makeDecisions(dt);
+#endif
+}   // computeDecisions
+
+//-----------------------------------------------------------------------------
+/** Determines the behaviour of the AI, e.g. steering, accelerating/braking,
+ *  firing. This must only change the state of this AI and its kart
+ *  controls, since it can be called for all AI karts at the same time.
+ *  Everything else (rescuing the kart, setting the speed cap) is only
+ *  recorded and done in update().
+ */
+void SkiddingAI::makeDecisions(float dt)
+{
+    m_decisions_computed = true;
+    m_needs_rescue       = false;
+    m_speed_cap          = -1.0f;
+
+    // This is used to enable firing an item backwards.
+    m_controls->m_look_back = false;
+    m_controls->m_nitro     = false;
+
+    // Don't do anything if there is currently a kart animations shown.
+    if(m_kart->getKartAnimation())
+        return;
+
     // Having a non-moving AI can be useful for debugging, e.g. aiming
     // or slipstreaming.
 #undef AI_DOES_NOT_MOVE_FOR_DEBUGGING
@@ -307,7 +355,7 @@ void SkiddingAI::update(float dt)
     // If the kart needs to be rescued, do it now (and nothing else)
     if(isStuck() && !m_kart->getKartAnimation())
     {
-        new RescueAnimation(m_kart);
+        m_needs_rescue = true;
         AIBaseController::update(dt);
         return;
     }
@@ -322,9 +370,7 @@ void SkiddingAI::update(float dt)
     // Get information that is needed by more than 1 of the handling funcs
     computeNearestKarts();
 
-    m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
-                        m_ai_properties->getSpeedCap(m_distance_to_player),
-                        /*fade_in_time*/0.0f);
+    m_speed_cap = m_ai_properties->getSpeedCap(m_distance_to_player);
     //Detect if we are going to crash with the track and/or kart
     checkCrashes(m_kart->getXYZ());
     determineTrackDirection();
@@ -382,7 +428,7 @@ void SkiddingAI::update(float dt)
         // time in time trial at start up, so during the first 5 seconds
         // this is done at random only.
         if(race_manager->getMinorMode()!=RaceManager::MINOR_MODE_TIME_TRIAL ||
-            (m_world->getTime()<3.0f && rand()%50==1) )
+            (m_world->getTime()<3.0f && m_random.get(50)==1) )
         {
             m_controls->m_nitro = false;
             m_controls->m_fire  = true;
@@ -391,7 +437,7 @@ void SkiddingAI::update(float dt)
 
     /*And obviously general kart stuff*/
     AIBaseController::update(dt);
-}   // update
+}   // makeDecisions
 
 //-----------------------------------------------------------------------------
 /** This function decides if the AI should brake.
@@ -477,7 +523,7 @@ void SkiddingAI::handleBraking()
  */
 void SkiddingAI::handleSteering(float dt)
 {
-    const int next = m_next_node_index[m_track_node];
+    const int next = m_path->getNextNode(m_track_node);
 
     float steer_angle = 0.0f;
 
@@ -636,7 +682,7 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
 
     // Make sure we have a valid last_node
     if(last_node==QuadGraph::UNKNOWN_SECTOR)
-        last_node = m_next_node_index[m_track_node];
+        last_node = m_path->getNextNode(m_track_node);
 
     int node = m_track_node;
     float distance = 0;
@@ -656,9 +702,8 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
             evaluateItems(items_ahead[i],  kart_aim_angle,
                           &items_to_avoid, &items_to_collect);
         }   // for i<items_ahead;
-        distance += QuadGraph::get()->getDistanceToNext(node,
-                                                      m_successor_index[node]);
-        node = m_next_node_index[node];
+        distance += m_path->getDistanceToNext(node);
+        node = m_path->getNextNode(node);
         // Stop when we have reached the last quad
         if(node==last_node) break;
     }   // while (distance < max_item_lookahead_distance)
@@ -1175,7 +1220,7 @@ void SkiddingAI::handleItems(const float dt)
             else
             {
                 // to make things less predictable :)
-                m_time_since_last_shot = (rand() % 1000) / 1000.0f * 3.0f - 2.0f;
+                m_time_since_last_shot = m_random.get(1000) / 1000.0f * 3.0f - 2.0f;
             }
         }
         else
@@ -1529,7 +1574,7 @@ void SkiddingAI::handleRaceStart()
         // Each kart starts at a different, random time, and the time is
         // smaller depending on the difficulty.
         m_start_delay = m_ai_properties->m_min_start_delay
-                      + (float) rand() / RAND_MAX
+                      + m_random.getFloat()
                       * (m_ai_properties->m_max_start_delay -
                          m_ai_properties->m_min_start_delay);
 
@@ -1538,7 +1583,7 @@ void SkiddingAI::handleRaceStart()
                ? 0.0f  : m_ai_properties->m_false_start_probability;
 
         // Now check for a false start. If so, add 1 second penalty time.
-        if(rand() < RAND_MAX * false_start_probability)
+        if(m_random.getFloat() < false_start_probability)
         {
             m_start_delay+=stk_config->m_penalty_time;
             return;
@@ -1559,7 +1604,7 @@ void SkiddingAI::handleRescue(const float dt)
         m_time_since_stuck += dt;
         if(m_time_since_stuck > 2.0f)
         {
-            new RescueAnimation(m_kart);
+            m_needs_rescue = true;
             m_time_since_stuck=0.0f;
         }   // m_time_since_stuck > 2.0f
     }
@@ -1676,7 +1721,8 @@ void SkiddingAI::handleNitroAndZipper()
         GraphNode::DirectionType dir;
         unsigned int last;
         const GraphNode &gn = QuadGraph::get()->getNode(m_track_node);
-        gn.getDirectionData(m_successor_index[m_track_node], &dir, &last);
+        gn.getDirectionData(m_path->getSuccessorIndex(m_track_node),
+                            &dir, &last);
         if(dir==GraphNode::DIR_STRAIGHT)
         {
             float diff = QuadGraph::get()->getDistanceFromStart(last)
@@ -1722,8 +1768,6 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
         m_crashes.m_kart = slip->getSlipstreamTarget()->getWorldKartId();
     }
 
-    const size_t NUM_KARTS = m_world->getNumKarts();
-
     //Protection against having vel_normal with nan values
     const Vec3 &VEL = m_kart->getVelocity();
     Vec3 vel_normal(VEL.getX(), 0.0, VEL.getZ());
@@ -1743,6 +1787,14 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
             steps, m_kart_length, m_kart->getVelocityLC().getZ());
         steps=1000;
     }
+
+    // Only karts that can come within m_kart_length of one of the tested
+    // positions need to be tested.
+    const KartProximity &proximity = m_world->getKartProximity();
+    proximity.findKarts(pos,
+                        proximity.getCrashTestRadius(steps, m_kart_length, dt),
+                        &m_close_karts);
+
     for(int i = 1; steps > i; ++i)
     {
         Vec3 step_coord = pos + vel_normal* m_kart_length * float(i);
@@ -1752,8 +1804,9 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
          */
         if( m_crashes.m_kart == -1 )
         {
-            for( unsigned int j = 0; j < NUM_KARTS; ++j )
+            for( unsigned int k = 0; k < m_close_karts.size(); ++k )
             {
+                const unsigned int j = m_close_karts[k];
                 const AbstractKart* kart = m_world->getKart(j);
                 // Ignore eliminated karts
                 if(kart==m_kart||kart->isEliminated()) continue;
@@ -1772,9 +1825,9 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
 
         /*Find if we crash with the drivelines*/
         if(current_node!=QuadGraph::UNKNOWN_SECTOR &&
-            m_next_node_index[current_node]!=-1)
+            m_path->getNextNode(current_node)!=-1)
             QuadGraph::get()->findRoadSector(step_coord, &current_node,
-                        /* sectors to test*/ &m_all_look_aheads[current_node]);
+                /* sectors to test*/ &m_path->getLookAheads(current_node));
 
         if( current_node == QuadGraph::UNKNOWN_SECTOR)
         {
@@ -1821,7 +1874,7 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
 */
 void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
 {
-    *last_node = m_next_node_index[m_track_node];
+    *last_node = m_path->getNextNode(m_track_node);
     const core::vector2df xz = m_kart->getXYZ().toIrrVector2d();
 
     const Quad &q = QuadGraph::get()->getQuadOfNode(*last_node);
@@ -1852,7 +1905,7 @@ void SkiddingAI::findNonCrashingPointNew(Vec3 *result, int *last_node)
 #endif
     while(1)
     {
-        unsigned int next_sector = m_next_node_index[*last_node];
+        unsigned int next_sector = m_path->getNextNode(*last_node);
         const Quad &q_next = QuadGraph::get()->getQuadOfNode(next_sector);
         // Test if the next left point is to the right of the left
         // line. If so, a new left line is defined.
@@ -1921,7 +1974,7 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
-    *last_node = m_next_node_index[m_track_node];
+    *last_node = m_path->getNextNode(m_track_node);
     int target_sector;
 
     Vec3 direction;
@@ -1934,7 +1987,7 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     {
         // target_sector is the sector at the longest distance that we can
         // drive to without crashing with the track.
-        target_sector = m_next_node_index[*last_node];
+        target_sector = m_path->getNextNode(*last_node);
 
         //direction is a vector from our kart to the sectors we are testing
         direction = QuadGraph::get()->getQuadOfNode(target_sector).getCenter()
@@ -2015,9 +2068,8 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
-    *last_node = m_next_node_index[m_track_node];
-    float angle = QuadGraph::get()->getAngleToNext(m_track_node,
-                                              m_successor_index[m_track_node]);
+    *last_node = m_path->getNextNode(m_track_node);
+    float angle = m_path->getAngleToNext(m_track_node);
     int target_sector;
 
     Vec3 direction;
@@ -2031,9 +2083,8 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     {
         // target_sector is the sector at the longest distance that we can
         // drive to without crashing with the track.
-        target_sector = m_next_node_index[*last_node];
-        angle1 = QuadGraph::get()->getAngleToNext(target_sector,
-                                                m_successor_index[target_sector]);
+        target_sector = m_path->getNextNode(*last_node);
+        angle1 = m_path->getAngleToNext(target_sector);
         // In very sharp turns this algorithm tends to aim at off track points,
         // resulting in hitting a corner. So test for this special case and
         // prevent a too-far look-ahead in this case
@@ -2096,8 +2147,8 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
 void SkiddingAI::determineTrackDirection()
 {
     const QuadGraph *qg = QuadGraph::get();
-    unsigned int succ   = m_successor_index[m_track_node];
-    float angle_to_track = qg->getNode(m_track_node).getAngleToSuccessor(succ)
+    unsigned int succ   = m_path->getSuccessorIndex(m_track_node);
+    float angle_to_track = m_path->getAngleToNext(m_track_node)
                          - m_kart->getHeading();
     angle_to_track = normalizeAngle(angle_to_track);
 
@@ -2120,7 +2171,7 @@ void SkiddingAI::determineTrackDirection()
 
     unsigned int next   = qg->getNode(m_track_node).getSuccessor(succ);
 
-    qg->getNode(next).getDirectionData(m_successor_index[next],
+    qg->getNode(next).getDirectionData(m_path->getSuccessorIndex(next),
                                        &m_current_track_direction,
                                        &m_last_direction_node);
 
@@ -2176,7 +2227,7 @@ void SkiddingAI::handleCurve()
     unsigned int i= m_track_node;
     while(1)
     {
-        i = m_next_node_index[i];
+        i = m_path->getNextNode(i);
         // Pick either the lower left or right point:
         int index = m_current_track_direction==GraphNode::DIR_LEFT
                   ? 0 : 1;
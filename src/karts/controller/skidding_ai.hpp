@@ -104,8 +104,22 @@ private:
         void clear() {m_road = false; m_kart = -1;}
     } m_crashes;
 
+    /** The karts close enough to be tested in checkCrashes. Kept as member
+     *  to avoid allocating the vector each frame. */
+    std::vector<unsigned int> m_close_karts;
+
     RaceManager::AISuperPower m_superpower;
 
+    /** True if computeDecisions was called since the last update. */
+    bool m_decisions_computed;
+
+    /** Set in computeDecisions if the kart should be rescued. */
+    bool m_needs_rescue;
+
+    /** The speed cap determined in computeDecisions, or a negative value
+     *  if no slowdown needs to be set. */
+    float m_speed_cap;
+
     /*General purpose variables*/
 
     /** Pointer to the closest kart ahead of this kart. NULL if this
@@ -183,6 +197,10 @@ private:
     /** A random number generator for collecting items. */
     RandomGenerator m_random_collect_item;
 
+    /** A random number generator for all other random decisions (start
+     *  delay, false starts, use of powerups). */
+    RandomGenerator m_random;
+
     /** \brief Determines the algorithm to use to select the point-to-aim-for
      *  There are three different Point Selection Algorithms:
      *  1. findNonCrashingPoint() is the default (which is actually slightly
@@ -223,6 +241,7 @@ private:
     void  handleSteering(float dt);
     void  handleItems(const float dt);
     void  handleRescue(const float dt);
+    void  makeDecisions(float dt);
     void  handleBraking();
     void  handleNitroAndZipper();
     void  computeNearestKarts();
@@ -260,6 +279,7 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (float delta) ;
+    virtual void computeDecisions(float delta);
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
 };
@@ -101,9 +101,10 @@ ExplosionAnimation::ExplosionAnimation(AbstractKart *kart,
     // To get rotations in both directions for each axis we determine a random
     // number between -(max_rotation-1) and +(max_rotation-1)
     float f=2.0f*M_PI/m_timer;
-    m_add_rotation.setHeading( (rand()%(2*max_rotation+1)-max_rotation)*f );
-    m_add_rotation.setPitch(   (rand()%(2*max_rotation+1)-max_rotation)*f );
-    m_add_rotation.setRoll(    (rand()%(2*max_rotation+1)-max_rotation)*f );
+    RandomGenerator &random = World::getWorld()->getRandomGenerator();
+    m_add_rotation.setHeading( (random.get(2*max_rotation+1)-max_rotation)*f );
+    m_add_rotation.setPitch(   (random.get(2*max_rotation+1)-max_rotation)*f );
+    m_add_rotation.setRoll(    (random.get(2*max_rotation+1)-max_rotation)*f );
 
     // Set invulnerable time, and graphical effects
     float t = m_kart->getKartProperties()->getExplosionInvulnerabilityTime() *
@@ -41,6 +41,7 @@
 #include "karts/kart_gfx.hpp"
 #include "karts/rescue_animation.hpp"
 #include "modes/overworld.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/world.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment.hpp"
@@ -925,7 +926,7 @@ void Kart::collectedItem(Item *item, int add_info)
 
         // slow down
         m_bubblegum_time = m_kart_properties->getBubblegumTime() * m_difficulty->getBubblegumTime();
-        m_bubblegum_torque = ((rand()%2)
+        m_bubblegum_torque = (World::getWorld()->getRandomGenerator().get(2)
                            ?  m_kart_properties->getBubblegumTorque()
                            : -m_kart_properties->getBubblegumTorque()) *
                            m_difficulty->getBubblegumTorque();
@@ -1330,7 +1331,7 @@ void Kart::update(float dt)
     static video::SColor green(255, 61, 87, 23);
 
     // draw skidmarks if relevant (we force pink skidmarks on when hitting a bubblegum)
-    if(m_kart_properties->getSkiddingProperties()->hasSkidmarks())
+    if(m_skidmarks)
     {
         m_skidmarks->update(dt,
                             m_bubblegum_time > 0,
@@ -2406,23 +2407,30 @@ void Kart::loadData(RaceManager::KartType type, bool is_animated_model)
     bool always_animated = (type == RaceManager::KT_PLAYER && race_manager->getNumPlayers() == 1);
     m_node = m_kart_model->attachModel(is_animated_model, always_animated);
 
-    // Create nitro light
-    m_nitro_light = irr_driver->addLight(core::vector3df(0.0f, 0.5f, m_kart_model->getLength()*-0.5f - 0.05f),
-        0.4f /* force */, 5.0f /* radius */, 0.0f, 0.4f, 1.0f, false, m_node);
-    m_nitro_light->setVisible(false);
-    m_nitro_light->setName( ("nitro emitter (" + getIdent() + ")").c_str() );
-
-    // Create skidding lights
-    // For the first skidding level
-    m_skidding_light_1 = irr_driver->addLight(core::vector3df(0.0f, 0.1f, m_kart_model->getLength()*-0.5f - 0.05f),
-        0.3f /* force */, 3.0f /* radius */, 1.0f, 0.6f, 0.0f, false, m_node);
-    m_skidding_light_1->setVisible(false);
-    m_skidding_light_1->setName( ("skidding emitter 1 (" + getIdent() + ")").c_str() );
-    // For the second skidding level
-    m_skidding_light_2 = irr_driver->addLight(core::vector3df(0.0f, 0.1f, m_kart_model->getLength()*-0.5f - 0.05f),
-        0.4f /* force */, 4.0f /* radius */, 1.0f, 0.0f, 0.0f, false, m_node);
-    m_skidding_light_2->setVisible(false);
-    m_skidding_light_2->setName( ("skidding emitter 2 (" + getIdent() + ")").c_str() );
+    // Without graphics the lights, weather particles and skidmarks are
+    // not needed (Kart::updateGraphics only positions the node in this case).
+    const bool no_graphics = ProfileWorld::isNoGraphics();
+
+    if (!no_graphics)
+    {
+        // Create nitro light
+        m_nitro_light = irr_driver->addLight(core::vector3df(0.0f, 0.5f, m_kart_model->getLength()*-0.5f - 0.05f),
+            0.4f /* force */, 5.0f /* radius */, 0.0f, 0.4f, 1.0f, false, m_node);
+        m_nitro_light->setVisible(false);
+        m_nitro_light->setName( ("nitro emitter (" + getIdent() + ")").c_str() );
+
+        // Create skidding lights
+        // For the first skidding level
+        m_skidding_light_1 = irr_driver->addLight(core::vector3df(0.0f, 0.1f, m_kart_model->getLength()*-0.5f - 0.05f),
+            0.3f /* force */, 3.0f /* radius */, 1.0f, 0.6f, 0.0f, false, m_node);
+        m_skidding_light_1->setVisible(false);
+        m_skidding_light_1->setName( ("skidding emitter 1 (" + getIdent() + ")").c_str() );
+        // For the second skidding level
+        m_skidding_light_2 = irr_driver->addLight(core::vector3df(0.0f, 0.1f, m_kart_model->getLength()*-0.5f - 0.05f),
+            0.4f /* force */, 4.0f /* radius */, 1.0f, 0.0f, 0.0f, false, m_node);
+        m_skidding_light_2->setVisible(false);
+        m_skidding_light_2->setName( ("skidding emitter 2 (" + getIdent() + ")").c_str() );
+    }
 
 #ifdef DEBUG
     m_node->setName( (getIdent()+"(lod-node)").c_str() );
@@ -2440,7 +2448,8 @@ void Kart::loadData(RaceManager::KartType type, bool is_animated_model)
     Track *track = World::getWorld()->getTrack();
     if (type == RaceManager::KT_PLAYER      &&
         UserConfigParams::m_weather_effects &&
-        track->getSkyParticles() != NULL)
+        track->getSkyParticles() != NULL    &&
+        !no_graphics)
     {
         track->getSkyParticles()->setBoxSizeXZ(150.0f, 150.0f);
 
@@ -2459,7 +2468,8 @@ void Kart::loadData(RaceManager::KartType type, bool is_animated_model)
 
     m_slipstream = new SlipStream(this);
 
-    if(m_kart_properties->getSkiddingProperties()->hasSkidmarks())
+    if(m_kart_properties->getSkiddingProperties()->hasSkidmarks() &&
+       !no_graphics)
     {
         m_skidmarks = new SkidMarks(*this);
         m_skidmarks->adjustFog(
@@ -2533,39 +2543,48 @@ void Kart::kartIsInRestNow()
 void Kart::updateGraphics(float dt, const Vec3& offset_xyz,
                           const btQuaternion& rotation)
 {
-    // Upate particle effects (creation rate, and emitter size
-    // depending on speed)
-    // --------------------------------------------------------
-    if ( (m_controls.m_nitro || m_min_nitro_time > 0.0f) &&
-         isOnGround() &&  m_collected_energy > 0            )
-    {
-        // fabs(speed) is important, otherwise the negative number will
-        // become a huge unsigned number in the particle scene node!
-        float f = fabsf(getSpeed())/(m_kart_properties->getMaxSpeed() *
-                  m_difficulty->getMaxSpeed());
-        // The speed of the kart can be higher (due to powerups) than
-        // the normal maximum speed of the kart.
-        if(f>1.0f) f = 1.0f;
-        m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITRO1, f);
-        m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITRO2, f);
-        m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITROSMOKE1, f);
-        m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITROSMOKE2, f);
-        m_nitro_light->setVisible(true);
-    }
-    else
+    // Without graphics there are no particle emitters, lights or kart
+    // model to update, but the position and rotation of the node (which
+    // depend on leaning, jumping and the suspension) are still computed,
+    // since the node is used by gameplay code, e.g. attachments.
+    const bool no_graphics = ProfileWorld::isNoGraphics();
+
+    if (!no_graphics)
     {
-        m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITRO1, 0);
-        m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITRO2, 0);
-        m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITROSMOKE1, 0);
-        m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITROSMOKE2, 0);
-        m_nitro_light->setVisible(false);
-    }
-    m_kart_gfx->resizeBox(KartGFX::KGFX_NITRO1, getSpeed(), dt);
-    m_kart_gfx->resizeBox(KartGFX::KGFX_NITRO2, getSpeed(), dt);
-    m_kart_gfx->resizeBox(KartGFX::KGFX_NITROSMOKE1, getSpeed(), dt);
-    m_kart_gfx->resizeBox(KartGFX::KGFX_NITROSMOKE2, getSpeed(), dt);
+        // Upate particle effects (creation rate, and emitter size
+        // depending on speed)
+        // --------------------------------------------------------
+        if ( (m_controls.m_nitro || m_min_nitro_time > 0.0f) &&
+             isOnGround() &&  m_collected_energy > 0            )
+        {
+            // fabs(speed) is important, otherwise the negative number will
+            // become a huge unsigned number in the particle scene node!
+            float f = fabsf(getSpeed())/(m_kart_properties->getMaxSpeed() *
+                      m_difficulty->getMaxSpeed());
+            // The speed of the kart can be higher (due to powerups) than
+            // the normal maximum speed of the kart.
+            if(f>1.0f) f = 1.0f;
+            m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITRO1, f);
+            m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITRO2, f);
+            m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITROSMOKE1, f);
+            m_kart_gfx->setCreationRateRelative(KartGFX::KGFX_NITROSMOKE2, f);
+            m_nitro_light->setVisible(true);
+        }
+        else
+        {
+            m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITRO1, 0);
+            m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITRO2, 0);
+            m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITROSMOKE1, 0);
+            m_kart_gfx->setCreationRateAbsolute(KartGFX::KGFX_NITROSMOKE2, 0);
+            m_nitro_light->setVisible(false);
+        }
+        m_kart_gfx->resizeBox(KartGFX::KGFX_NITRO1, getSpeed(), dt);
+        m_kart_gfx->resizeBox(KartGFX::KGFX_NITRO2, getSpeed(), dt);
+        m_kart_gfx->resizeBox(KartGFX::KGFX_NITROSMOKE1, getSpeed(), dt);
+        m_kart_gfx->resizeBox(KartGFX::KGFX_NITROSMOKE2, getSpeed(), dt);
 
-    m_kart_gfx->resizeBox(KartGFX::KGFX_ZIPPER, getSpeed(), dt);
+        m_kart_gfx->resizeBox(KartGFX::KGFX_ZIPPER, getSpeed(), dt);
+    }
 
     // Handle leaning of karts
     // -----------------------
@@ -2624,7 +2643,9 @@ void Kart::updateGraphics(float dt, const Vec3& offset_xyz,
         }
     }
 
-    m_kart_model->update(dt, m_wheel_rotation_dt, getSteerPercent(), m_speed);
+    if (!no_graphics)
+        m_kart_model->update(dt, m_wheel_rotation_dt, getSteerPercent(),
+                             m_speed);
 
     // If the kart is leaning, part of the kart might end up 'in' the track.
     // To avoid this, raise the kart enough to offset the leaning.
@@ -2761,6 +2782,8 @@ void Kart::setOnScreenText(const wchar_t *text)
 // ----------------------------------------------------------------------------
 void Kart::activateSkidLight(unsigned int level)
 {
+    if (!m_skidding_light_1)
+        return;
     m_skidding_light_1->setVisible(level == 1);
     m_skidding_light_2->setVisible(level > 1);
 }   // activateSkidLight
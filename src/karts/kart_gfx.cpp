@@ -28,6 +28,7 @@
 #include "karts/kart.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/skidding.hpp"
+#include "modes/profile_world.hpp"
 #include "physics/btKart.hpp"
 #include "utils/log.hpp"
 
@@ -101,8 +102,9 @@ KartGFX::~KartGFX()
 void KartGFX::addEffect(KartGFXType type, const std::string &file_name,
                         const Vec3 &position, bool important)
 {
-    if (!UserConfigParams::m_graphical_effects &&
-        (!important || m_kart->getType() == RaceManager::KT_AI))
+    if ((!UserConfigParams::m_graphical_effects &&
+         (!important || m_kart->getType() == RaceManager::KT_AI)) ||
+        ProfileWorld::isNoGraphics())
     {
         m_all_emitters.push_back(NULL);
         return;
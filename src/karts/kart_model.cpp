@@ -32,6 +32,7 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/ghost_kart.hpp"
 #include "karts/kart_properties.hpp"
+#include "modes/profile_world.hpp"
 #include "physics/btKart.hpp"
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
@@ -333,6 +334,21 @@ scene::ISceneNode* KartModel::attachModel(bool animated_models, bool always_anim
 {
     assert(!m_is_master);
 
+    // Without graphics only an empty node is created, to which attachments
+    // etc. can be added. The radius of the wheels is still needed for the
+    // tires in the three strikes battle.
+    if (ProfileWorld::isNoGraphics())
+    {
+        for(unsigned int i=0; i<4; i++)
+        {
+            if(!m_wheel_model[i]) continue;
+            Vec3 wheel_min, wheel_max;
+            MeshTools::minMax3D(m_wheel_model[i], &wheel_min, &wheel_max);
+            m_wheel_graphics_radius[i] = 0.5f*(wheel_max.getY() - wheel_min.getY());
+        }
+        return irr_driver->getSceneManager()->addEmptySceneNode();
+    }
+
     scene::ISceneNode* node;
 
     if (animated_models)
@@ -25,6 +25,7 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "karts/kart_model.hpp"
 #include "karts/skidding_properties.hpp"
@@ -167,7 +168,9 @@ void KartProperties::copyFrom(const KartProperties *source)
 }   // copyFrom
 
 //-----------------------------------------------------------------------------
-/** Loads the kart properties from a file.
+/** Loads the kart properties from a file. This only reads the xml file and
+ *  does not use any graphics, so it can be called from a worker thread.
+ *  loadGraphics() must be called afterwards.
  *  \param filename Filename to load.
  *  \param node Name of the xml node to load the data from
  */
@@ -176,7 +179,11 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     // Get the default values from STKConfig. This will also allocate any
     // pointers used in KartProperties
 
-    const XMLNode* root = new XMLNode(filename);
+    const XMLNode* root = metadata_index
+                        ? metadata_index->createXMLTree(filename)
+                        : file_manager->createXMLTree(filename);
+    if(!root)
+        throw std::runtime_error("Cannot find file "+filename);
     std::string kart_type;
 
     if (root->get("type", &kart_type))
@@ -230,8 +237,15 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     // Set a default group (that has to happen after init_default and load)
     if(m_groups.size()==0)
         m_groups.push_back(DEFAULT_GROUP_NAME);
+}   // load
 
-
+//-----------------------------------------------------------------------------
+/** Loads the materials, icons and models of the kart. This uses the
+ *  irrlicht driver and the material manager, so unlike load() it can only
+ *  be called from the main thread.
+ */
+void KartProperties::loadGraphics()
+{
     // Load material
     std::string materials_file = m_root+"materials.xml";
     file_manager->pushModelSearchPath  (m_root);
@@ -271,6 +285,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         if (!success)
         {
             delete m_kart_model;
+            m_kart_model = NULL;
             file_manager->popTextureSearchPath();
             file_manager->popModelSearchPath();
             throw std::runtime_error("Cannot load kart models");
@@ -307,7 +322,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     file_manager->popTextureSearchPath();
     file_manager->popModelSearchPath();
 
-}   // load
+}   // loadGraphics
 
 //-----------------------------------------------------------------------------
 /** Actually reads in the data from the xml file.
@@ -407,6 +407,7 @@ public:
           KartProperties    (const std::string &filename="");
          ~KartProperties    ();
     void  copyFrom          (const KartProperties *source);
+    void  loadGraphics      ();
     void  getAllData        (const XMLNode * root);
     void  checkAllSet       (const std::string &filename);
     float getStartupBoost   () const;
@@ -27,9 +27,12 @@
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "karts/kart_properties.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/time.hpp"
 
 #include <algorithm>
 #include <ctime>
@@ -142,36 +145,88 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 }   // removeKart
 
 //-----------------------------------------------------------------------------
-/** Loads all kart properties and models.
+/** Data for the tasks that parse the kart.xml files in parallel. */
+struct ParseKartsData
+{
+    /** The directories of all karts. */
+    const std::vector<std::string> *m_dirs;
+    /** On return the parsed kart properties (NULL if an error occurred). */
+    std::vector<KartProperties*>    m_karts;
+};   // ParseKartsData
+
+//-----------------------------------------------------------------------------
+/** Loads all kart properties and models. The directories are scanned first
+ *  (listing a directory changes the current directory of the file system,
+ *  so this can not be done in parallel). Then all kart.xml files are parsed
+ *  in parallel by the thread pool. Finally the models are loaded and the
+ *  karts are added in the order of the directories, so that the kart ids
+ *  and groups do not depend on the order in which the tasks finished.
  */
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
     m_all_kart_dirs.clear();
+    const double start_time = StkTime::getPreciseTime();
+
+    std::vector<std::string> kart_dirs;
     std::vector<std::string>::const_iterator dir;
     for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
     {
         // First check if there is a kart in the current directory
         // -------------------------------------------------------
-        if(loadKart(*dir)) continue;
+        if(file_manager->fileExists(*dir+"/kart.xml"))
+        {
+            kart_dirs.push_back(*dir);
+            continue;
+        }
 
         // If not, check each subdir of this directory.
         // --------------------------------------------
         std::set<std::string> result;
-        file_manager->listFiles(result, *dir);
+        if(metadata_index)
+            metadata_index->listFiles(result, *dir);
+        else
+            file_manager->listFiles(result, *dir);
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
-            const bool loaded = loadKart(*dir+*subdir);
-
-            if (loaded && loading_icon)
-            {
-                GUIEngine::addLoadingIcon(irr_driver->getTexture(
-                    m_karts_properties[m_karts_properties.size()-1]
-                            .getAbsoluteIconFile()              )
-                                          );
-            }
+            if(file_manager->fileExists(*dir+*subdir+"/kart.xml"))
+                kart_dirs.push_back(*dir+*subdir);
         }   // for all files in the currently handled directory
     }   // for i
+    const double scan_time = StkTime::getPreciseTime();
+
+    ParseKartsData data;
+    data.m_dirs = &kart_dirs;
+    data.m_karts.resize(kart_dirs.size(), NULL);
+    if(thread_pool)
+        thread_pool->run((unsigned int)kart_dirs.size(), &parseKartTask,
+                         &data);
+    else
+    {
+        for(unsigned int i=0; i<kart_dirs.size(); i++)
+            parseKartTask(i, &data);
+    }
+    const double parse_time = StkTime::getPreciseTime();
+
+    for(unsigned int i=0; i<kart_dirs.size(); i++)
+    {
+        if(!data.m_karts[i] || !addKart(kart_dirs[i], data.m_karts[i]))
+            continue;
+        if (loading_icon)
+        {
+            GUIEngine::addLoadingIcon(irr_driver->getTexture(
+                m_karts_properties[m_karts_properties.size()-1]
+                        .getAbsoluteIconFile()              )
+                                      );
+        }
+    }   // for i<kart_dirs.size()
+    const double end_time = StkTime::getPreciseTime();
+
+    Log::info("KartPropertiesManager", "Loaded %d karts in %.1f ms (scan "
+              "%.1f ms, parsing %.1f ms, models %.1f ms).",
+              m_karts_properties.size(), (end_time-start_time)*1000,
+              (scan_time-start_time)*1000, (parse_time-scan_time)*1000,
+              (end_time-parse_time)*1000);
 }   // loadAllKarts
 
 //-----------------------------------------------------------------------------
@@ -179,10 +234,25 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
  *  \param filename Full path to the kart config file.
  */
 bool KartPropertiesManager::loadKart(const std::string &dir)
+{
+    KartProperties *kart_properties = parseKart(dir);
+    if(!kart_properties)
+        return false;
+    return addKart(dir, kart_properties);
+}   // loadKart
+
+//-----------------------------------------------------------------------------
+/** Reads the kart.xml file of a kart. This does not load any graphics and
+ *  does not change the kart properties manager, so it can be executed by
+ *  a worker thread.
+ *  \param dir Directory of the kart.
+ *  \return The kart properties, or NULL if the kart can not be loaded.
+ */
+KartProperties* KartPropertiesManager::parseKart(const std::string &dir)
 {
     std::string config_filename=dir+"/kart.xml";
     if(!file_manager->fileExists(config_filename))
-        return false;
+        return NULL;
 
     KartProperties* kart_properties;
     try
@@ -193,9 +263,34 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
     {
         Log::error("[Kart_Properties_Manager]","Giving up loading '%s': %s",
                     config_filename.c_str(), err.what());
-        return false;
+        return NULL;
     }
+    return kart_properties;
+}   // parseKart
 
+//-----------------------------------------------------------------------------
+/** The task executed by the thread pool for each kart.xml file.
+ *  \param index Index of the kart directory.
+ *  \param data Pointer to the ParseKartsData.
+ */
+void KartPropertiesManager::parseKartTask(unsigned int index, void *data)
+{
+    ParseKartsData *karts = (ParseKartsData*)data;
+    karts->m_karts[index] = parseKart((*karts->m_dirs)[index]);
+}   // parseKartTask
+
+//-----------------------------------------------------------------------------
+/** Checks the version of a parsed kart, loads its models and adds it to
+ *  the list of karts and to its groups. Must be called from the main
+ *  thread.
+ *  \param dir Directory of the kart.
+ *  \param kart_properties The parsed kart properties. They are deleted if
+ *         the kart can not be added.
+ *  \return True if the kart was added.
+ */
+bool KartPropertiesManager::addKart(const std::string &dir,
+                                    KartProperties *kart_properties)
+{
     // If the version of the kart file is not supported,
     // ignore this .kart file
     if (kart_properties->getVersion() < stk_config->m_min_kart_version ||
@@ -208,6 +303,18 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
         return false;
     }
 
+    try
+    {
+        kart_properties->loadGraphics();
+    }
+    catch (std::runtime_error& err)
+    {
+        Log::error("[Kart_Properties_Manager]","Giving up loading '%s': %s",
+                    dir.c_str(), err.what());
+        delete kart_properties;
+        return false;
+    }
+
     m_karts_properties.push_back(kart_properties);
     m_kart_available.push_back(true);
     const std::vector<std::string>& groups=kart_properties->getGroups();
@@ -221,7 +328,7 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
     }
     m_all_kart_dirs.push_back(dir);
     return true;
-}   // loadKartData
+}   // addKart
 
 //-----------------------------------------------------------------------------
 /** Sets the name of a mesh to use as a hat for all karts.
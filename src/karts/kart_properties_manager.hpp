@@ -58,6 +58,11 @@ private:
      *  all clients or not. */
     std::vector<bool>        m_kart_available;
 
+    static KartProperties*   parseKart(const std::string &dir);
+    static void              parseKartTask(unsigned int index, void *data);
+    bool                     addKart(const std::string &dir,
+                                     KartProperties *kart_properties);
+
 protected:
 
     typedef PtrVector<KartProperties> KartPropertiesVector;
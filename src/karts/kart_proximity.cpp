@@ -0,0 +1,322 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/kart_proximity.hpp"
+
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+KartProximity::KartProximity(float cell_size)
+{
+    m_cell_size = cell_size;
+    m_max_speed = 0;
+}   // KartProximity
+
+// ----------------------------------------------------------------------------
+/** Returns the grid cell of a coordinate. */
+int KartProximity::getCell(float x) const
+{
+    return (int)floorf(x/m_cell_size);
+}   // getCell
+
+// ----------------------------------------------------------------------------
+/** Returns the bucket in which the karts of a grid cell are stored. */
+unsigned int KartProximity::getBucket(int cell_x, int cell_z) const
+{
+    unsigned int h = (unsigned int)cell_x*73856093u
+                   ^ (unsigned int)cell_z*19349663u;
+    return h & (NUM_BUCKETS-1);
+}   // getBucket
+
+// ----------------------------------------------------------------------------
+/** Removes all karts and prepares the grid for a number of karts. The
+ *  positions of all karts must then be set with setKart.
+ *  \param num_karts Number of karts.
+ */
+void KartProximity::reset(unsigned int num_karts)
+{
+    for(unsigned int i=0; i<NUM_BUCKETS; i++)
+        m_buckets[i].clear();
+    KartEntry empty;
+    empty.m_x      = empty.m_z = 0;
+    empty.m_speed  = 0;
+    empty.m_bucket = NUM_BUCKETS;
+    m_karts.assign(num_karts, empty);
+    m_max_speed = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Sets the position and speed of a kart.
+ *  \param index Index of the kart (world kart id).
+ *  \param xyz The position of the kart.
+ *  \param speed The speed of the kart.
+ */
+void KartProximity::setKart(unsigned int index, const Vec3 &xyz, float speed)
+{
+    assert(index < m_karts.size());
+    KartEntry &kart = m_karts[index];
+    kart.m_x     = xyz.getX();
+    kart.m_z     = xyz.getZ();
+    kart.m_speed = fabsf(speed);
+    if(kart.m_speed > m_max_speed)
+        m_max_speed = kart.m_speed;
+
+    unsigned int bucket = getBucket(getCell(kart.m_x), getCell(kart.m_z));
+    if(bucket == kart.m_bucket)
+        return;
+    if(kart.m_bucket < NUM_BUCKETS)
+    {
+        std::vector<unsigned int> &old_bucket = m_buckets[kart.m_bucket];
+        old_bucket.erase(std::find(old_bucket.begin(), old_bucket.end(),
+                                   index));
+    }
+    m_buckets[bucket].push_back(index);
+    kart.m_bucket = bucket;
+}   // setKart
+
+// ----------------------------------------------------------------------------
+/** Returns the radius around a kart in which karts must be searched for the
+ *  crash test of the AI (see SkiddingAI::checkCrashes): the tested positions
+ *  are at most steps*step_length away from the kart, and a kart must come
+ *  within step_length of one of them at the time the kart gets there. No
+ *  kart moves faster than the maximum speed; a margin of 10% (and 1m) is
+ *  added for karts whose speed changed since their position was stored.
+ *  \param steps Number of positions tested.
+ *  \param step_length Distance between two tested positions (which is
+ *         also the distance that counts as a crash).
+ *  \param dt Time it takes the kart to drive step_length.
+ */
+float KartProximity::getCrashTestRadius(int steps, float step_length,
+                                        float dt) const
+{
+    return (steps+1)*step_length + m_max_speed*1.1f*steps*dt + 1.0f;
+}   // getCrashTestRadius
+
+// ----------------------------------------------------------------------------
+/** Finds all karts whose distance in the x/z plane to a position is at most
+ *  radius. The karts are returned sorted by their index, so callers can
+ *  process them in the same order as when testing all karts.
+ *  \param center The position to test.
+ *  \param radius The maximum distance.
+ *  \param karts On return the indices of the karts.
+ */
+void KartProximity::findKarts(const Vec3 &center, float radius,
+                              std::vector<unsigned int> *karts) const
+{
+    karts->clear();
+    const float x = center.getX(), z = center.getZ();
+    const float r2 = radius*radius;
+
+    // If more cells than karts would be tested, testing all karts is
+    // faster (and avoids an overflow of the cell index for a huge radius).
+    const float num_cells = (2*radius/m_cell_size + 2)
+                          * (2*radius/m_cell_size + 2);
+    if(num_cells >= m_karts.size() || num_cells >= NUM_BUCKETS)
+    {
+        for(unsigned int i=0; i<m_karts.size(); i++)
+        {
+            const float dx = m_karts[i].m_x - x, dz = m_karts[i].m_z - z;
+            if(dx*dx + dz*dz <= r2)
+                karts->push_back(i);
+        }
+        return;
+    }
+
+    const int min_x = getCell(x-radius), max_x = getCell(x+radius);
+    const int min_z = getCell(z-radius), max_z = getCell(z+radius);
+    for(int cell_x=min_x; cell_x<=max_x; cell_x++)
+    {
+        for(int cell_z=min_z; cell_z<=max_z; cell_z++)
+        {
+            const std::vector<unsigned int> &bucket =
+                m_buckets[getBucket(cell_x, cell_z)];
+            for(unsigned int i=0; i<bucket.size(); i++)
+            {
+                const KartEntry &kart = m_karts[bucket[i]];
+                const float dx = kart.m_x - x, dz = kart.m_z - z;
+                if(dx*dx + dz*dz <= r2)
+                    karts->push_back(bucket[i]);
+            }
+        }
+    }
+    // Different cells can share a bucket, so a kart can be found twice
+    std::sort(karts->begin(), karts->end());
+    karts->erase(std::unique(karts->begin(), karts->end()), karts->end());
+}   // findKarts
+
+// ----------------------------------------------------------------------------
+/** Compares the results of findKarts with testing all karts, for random
+ *  positions and moving karts.
+ */
+void KartProximity::unitTesting()
+{
+    const unsigned int num_karts = 40;
+    KartProximity proximity(10.0f);
+    proximity.reset(num_karts);
+    std::vector<Vec3> xyz(num_karts);
+    for(unsigned int frame=0; frame<20; frame++)
+    {
+        for(unsigned int i=0; i<num_karts; i++)
+        {
+            if(frame>0 && rand()%2) continue;
+            xyz[i] = Vec3(rand()%4001*0.1f-200.0f, 0,
+                          rand()%4001*0.1f-200.0f);
+            proximity.setKart(i, xyz[i], float(rand()%30));
+        }
+        for(unsigned int q=0; q<50; q++)
+        {
+            Vec3 center(rand()%4001*0.1f-200.0f, 0, rand()%4001*0.1f-200.0f);
+            float radius = rand()%1000*0.1f;
+            std::vector<unsigned int> found;
+            proximity.findKarts(center, radius, &found);
+            std::vector<unsigned int> expected;
+            for(unsigned int i=0; i<num_karts; i++)
+            {
+                if((xyz[i]-center).length_2d() <= radius)
+                    expected.push_back(i);
+            }
+            assert(found == expected);
+        }
+    }
+    assert(proximity.getMaxSpeed() <= 29.0f);
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+namespace BenchmarkProximity
+{
+    /** The kart length used in the benchmark. */
+    const float KART_LENGTH = 1.5f;
+
+    /** Simulates the kart crash test of the AI (see
+     *  SkiddingAI::checkCrashes, which needs a world with karts and a
+     *  track): returns the index of the first kart that the kart 'index'
+     *  would crash into in the next steps, or -1. As in the AI, karts
+     *  that are faster than this kart are ignored.
+     *  \param candidates The karts to test, sorted by index.
+     */
+    int checkCrashes(unsigned int index, const std::vector<Vec3> &xyz,
+                     const std::vector<Vec3> &velocity,
+                     const std::vector<unsigned int> &candidates)
+    {
+        const float speed = velocity[index].length_2d();
+        const int steps   = int(speed/KART_LENGTH) + 7;
+        const float dt    = KART_LENGTH / speed;
+        Vec3 vel_normal(velocity[index].getX(), 0, velocity[index].getZ());
+        vel_normal /= speed;
+        int crash = -1;
+        for(int i=1; steps>i && crash==-1; ++i)
+        {
+            Vec3 step_coord = xyz[index] + vel_normal*KART_LENGTH*float(i);
+            for(unsigned int c=0; c<candidates.size(); c++)
+            {
+                unsigned int j = candidates[c];
+                if(j==index) continue;
+                if(speed < velocity[j].length_2d()) continue;
+                Vec3 other = xyz[j] + velocity[j]*(i*dt);
+                if((step_coord - other).length_2d() < KART_LENGTH)
+                    crash = j;
+            }
+        }
+        return crash;
+    }   // checkCrashes
+}   // namespace BenchmarkProximity
+
+// ----------------------------------------------------------------------------
+/** Measures the time of the AI crash test for 8, 32 and 64 karts on a
+ *  track with a length of 2km, testing all karts and using the proximity
+ *  grid (including setting the kart positions), and checks that both give
+ *  the same results.
+ */
+void KartProximity::benchmark()
+{
+    using namespace BenchmarkProximity;
+    const unsigned int num_karts[] = { 8, 32, 64 };
+    const unsigned int num_frames  = 600;
+    for(unsigned int n=0; n<sizeof(num_karts)/sizeof(num_karts[0]); n++)
+    {
+        const unsigned int count = num_karts[n];
+        // Karts drive on a circle with a radius of 320m, spread over the
+        // track as in the middle of a race
+        std::vector<float> angle(count), lane(count), speed(count);
+        for(unsigned int i=0; i<count; i++)
+        {
+            angle[i] = (rand()%1000)*0.001f*2*3.1415926f;
+            lane[i]  = 316.0f + (i%2)*4.0f + (rand()%100)*0.02f;
+            speed[i] = 20.0f + (rand()%100)*0.1f;
+        }
+
+        std::vector<Vec3> xyz(count), velocity(count);
+        std::vector<unsigned int> all(count), candidates;
+        for(unsigned int i=0; i<count; i++)
+            all[i] = i;
+
+        KartProximity proximity;
+        double all_time = 0, grid_time = 0;
+        unsigned int num_crashes = 0, num_candidates = 0;
+        bool identical = true;
+        for(unsigned int frame=0; frame<num_frames; frame++)
+        {
+            for(unsigned int i=0; i<count; i++)
+            {
+                angle[i] += speed[i]/lane[i]/60.0f;
+                xyz[i]      = Vec3(lane[i]*cosf(angle[i]), 0,
+                                   lane[i]*sinf(angle[i]));
+                velocity[i] = Vec3(-speed[i]*sinf(angle[i]), 0,
+                                    speed[i]*cosf(angle[i]));
+            }
+            double start = StkTime::getRealTime();
+            proximity.reset(count);
+            for(unsigned int i=0; i<count; i++)
+                proximity.setKart(i, xyz[i], speed[i]);
+            grid_time += StkTime::getRealTime() - start;
+
+            for(unsigned int i=0; i<count; i++)
+            {
+                start = StkTime::getRealTime();
+                int crash_all = checkCrashes(i, xyz, velocity, all);
+                all_time += StkTime::getRealTime() - start;
+
+                start = StkTime::getRealTime();
+                const int steps = int(speed[i]/KART_LENGTH) + 7;
+                const float dt  = KART_LENGTH/speed[i];
+                proximity.findKarts(xyz[i],
+                             proximity.getCrashTestRadius(steps, KART_LENGTH,
+                                                          dt),
+                             &candidates);
+                int crash_grid = checkCrashes(i, xyz, velocity, candidates);
+                grid_time += StkTime::getRealTime() - start;
+
+                num_candidates += (unsigned int)candidates.size();
+                if(crash_all!=-1) num_crashes++;
+                if(crash_all!=crash_grid) identical = false;
+            }
+        }
+        Log::info("KartProximity", "%2d karts: all karts %.3f ms, grid %.3f "
+                  "ms per frame, %.1f karts tested, %d crashes, results %s.",
+                  count, all_time*1000.0/num_frames,
+                  grid_time*1000.0/num_frames,
+                  float(num_candidates)/(num_frames*count), num_crashes,
+                  identical ? "identical" : "DIFFERENT");
+    }   // for n
+}   // benchmark
@@ -0,0 +1,85 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_KART_PROXIMITY_HPP
+#define HEADER_KART_PROXIMITY_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+class Vec3;
+
+/** \brief A uniform grid (in the x/z plane) of the positions of all karts.
+ *  It is used to find the karts close to a position without testing all
+ *  karts, e.g. by the AI to find karts it might crash into, or by items
+ *  to find karts to hit. The world sets the position of each kart after
+ *  it was updated, so the grid always contains the current positions.
+ *  The grid cells are hashed into a fixed number of buckets, so the size
+ *  of the track does not matter.
+ * \ingroup karts
+ */
+class KartProximity : public NoCopy
+{
+private:
+    /** Number of buckets, must be a power of 2. */
+    static const unsigned int NUM_BUCKETS = 256;
+
+    /** The data stored for each kart. */
+    struct KartEntry
+    {
+        float        m_x, m_z;
+        float        m_speed;
+        unsigned int m_bucket;
+    };   // KartEntry
+
+    /** Size of a grid cell. */
+    float                     m_cell_size;
+
+    /** The position and bucket of each kart. */
+    std::vector<KartEntry>    m_karts;
+
+    /** The indices of the karts in each bucket. */
+    std::vector<unsigned int> m_buckets[NUM_BUCKETS];
+
+    /** The maximum speed of all karts since the last reset. */
+    float                     m_max_speed;
+
+    int          getCell(float x) const;
+    unsigned int getBucket(int cell_x, int cell_z) const;
+
+public:
+         KartProximity(float cell_size=20.0f);
+    void reset(unsigned int num_karts);
+    void setKart(unsigned int index, const Vec3 &xyz, float speed);
+    void findKarts(const Vec3 &center, float radius,
+                   std::vector<unsigned int> *karts) const;
+    float getCrashTestRadius(int steps, float step_length, float dt) const;
+    static void unitTesting();
+    static void benchmark();
+
+    // ------------------------------------------------------------------------
+    /** Returns the maximum speed of all karts, which can be used to find
+     *  karts that might come close to a position in the future. */
+    float getMaxSpeed() const { return m_max_speed; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts. */
+    unsigned int getNumKarts() const { return (unsigned int)m_karts.size(); }
+};   // KartProximity
+
+#endif
@@ -125,6 +125,18 @@ void Moveable::stopFlying()
  *  \param float dt Time step size.
  */
 void Moveable::update(float dt)
+{
+    updatePosition();
+    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Updates the position and the data derived from it (velocity in local
+ *  coordinates, heading, pitch and roll) from the physics body. This does
+ *  not update the graphics, so it can be used to make the new positions of
+ *  all moveables available before any of them is updated.
+ */
+void Moveable::updatePosition()
 {
     if(m_body->getInvMass()!=0)
         m_motion_state->getWorldTransform(m_transform);
@@ -138,12 +150,12 @@ void Moveable::update(float dt)
     Vec3 up       = getTrans().getBasis().getColumn(1);
     m_pitch       = atan2(up.getZ(), fabsf(up.getY()));
     m_roll        = atan2(up.getX(), up.getY());
-
-    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
-}   // update
+}   // updatePosition
 
 //-----------------------------------------------------------------------------
-/** Creates the bullet rigid body for this moveable.
+/** Creates the bullet rigid body for this moveable. If this moveable already
+ *  has a body and motion state (e.g. recycled from a removed flyable), their
+ *  memory is reused and they are initialised as if they were new.
  *  \param mass Mass of this object.
  *  \param trans Transform (=position and orientation) for this object).
  *  \param shape Bullet collision shape for this object.
@@ -155,7 +167,10 @@ void Moveable::createBody(float mass, btTransform& trans,
     btVector3 inertia;
     shape->calculateLocalInertia(mass, inertia);
     m_transform = trans;
-    m_motion_state = new KartMotionState(trans);
+    if(m_motion_state)
+        m_motion_state->setWorldTransform(trans);
+    else
+        m_motion_state = new KartMotionState(trans);
 
     btRigidBody::btRigidBodyConstructionInfo info(mass, m_motion_state,
                                                   shape, inertia);
@@ -163,7 +178,13 @@ void Moveable::createBody(float mass, btTransform& trans,
 
     // Then create a rigid body
     // ------------------------
-    m_body = new btRigidBody(info);
+    if(m_body)
+    {
+        m_body->~btRigidBody();
+        new (m_body) btRigidBody(info);
+    }
+    else
+        m_body = new btRigidBody(info);
     if(mass==0)
     {
         // Create a kinematic object
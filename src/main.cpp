@@ -153,6 +153,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/frustum_culling.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
@@ -161,22 +162,29 @@
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
+#include "guiengine/scalable_font.hpp"
 #include "input/device_manager.hpp"
 #include "input/input_manager.hpp"
 #include "input/keyboard_device.hpp"
 #include "input/wiimote_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "items/attachment_manager.hpp"
+#include "items/item_grid.hpp"
 #include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
 #include "karts/controller/ai_base_controller.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
+#include "karts/kart_proximity.hpp"
 #include "modes/demo_world.hpp"
 #include "modes/profile_world.hpp"
 #include "network/client_network_manager.hpp"
+#include "network/interpolation_buffer.hpp"
+#include "network/kart_snapshot.hpp"
 #include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
+#include "network/protocols/kart_update_protocol.hpp"
 #include "network/protocols/server_lobby_room_protocol.hpp"
 #include "network/client_network_manager.hpp"
 #include "network/server_network_manager.hpp"
@@ -185,17 +193,20 @@
 #include "online/profile_manager.hpp"
 #include "online/request_manager.hpp"
 #include "online/servers_manager.hpp"
+#include "physics/stk_dynamics_world.hpp"
 #include "race/grand_prix_manager.hpp"
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
+#include "scriptengine/script_engine.hpp"
 #include "states_screens/main_menu_screen.hpp"
 #include "states_screens/register_screen.hpp"
 #include "states_screens/state_manager.hpp"
 #include "states_screens/user_screen.hpp"
 #include "states_screens/dialogs/message_dialog.hpp"
+#include "tracks/quad_graph.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
@@ -203,6 +214,9 @@
 #include "utils/crash_reporting.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/random_generator.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -525,6 +539,12 @@ void cmdLineHelp()
                               "laps.\n"
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
+    "       --profile-races=n  Run n profile races in one process (track and "
+                              "karts are only loaded once).\n"
+    "       --profile-seed=n   Seed for the first profile race, race i uses "
+                              "n+i.\n"
+    "       --profile-results=FILE Write per-race profile results as CSV "
+                              "to FILE.\n"
     "       --no-graphics      Do not display the actual race.\n"
     "       --with-profile     Enables the profile mode.\n"
     "       --demo-mode=t      Enables demo mode after t seconds idle time in "
@@ -538,11 +558,40 @@ void cmdLineHelp()
     // "       --history=n        Replay history file 'history.dat' using:\n"
     // "                            n=1: recorded positions\n"
     // "                            n=2: recorded key strokes\n"
+    "       --verify-history   Replay history file 'history.dat' with physics\n"
+    "                          and report the first tick at which a kart\n"
+    "                          diverges from the recorded positions.\n"
+    "       --fixed-timestep[=n] Simulate with n (default 60) fixed time steps\n"
+    "                          per second, independent of the frame rate.\n"
+    "       --seed=n           Seed for all random numbers (e.g. to reproduce\n"
+    "                          AI races with --fixed-timestep).\n"
+    "       --convert-history=IN,OUT Convert the history file IN from binary to\n"
+    "                          text format or vice versa, and save it as OUT.\n"
+    "       --convert-replay=IN,OUT Convert the replay file IN from binary to\n"
+    "                          text format or vice versa, and save it as OUT.\n"
+    "       --history-benchmark Measure size and load time of a 20 kart, 10\n"
+    "                          minute history in text and binary format.\n"
+    "       --script-benchmark Measure the time of 10000 script collision\n"
+    "                          callbacks and of loading script bytecode.\n"
+    "       --network-benchmark Measure the time from receiving a packet on a\n"
+    "                          loopback connection till a protocol gets it.\n"
+    "       --font-benchmark   Measure the time to lay out the texts of a\n"
+    "                          race hud frame.\n"
+    "       --raycast-benchmark Measure the time to cast the wheel rays of\n"
+    "                          4 to 64 karts with and without the thread pool.\n"
+    "       --proximity-benchmark Measure the time of the AI crash test for\n"
+    "                          8 to 64 karts with and without the kart grid.\n"
+    "       --culling-benchmark Measure the time to cull 10000 nodes against\n"
+    "                          the camera, RSM and shadow frusta.\n"
     "       --server           Start a server (not a playing client).\n"
     "       --login=s          Automatically log in (set the login).\n"
     "       --password=s       Automatically log in (set the password).\n"
     "       --port=n           Port number to use.\n"
-    "       --max-players=n    Maximum number of clients (server only).\n"
+    "       --max-players=n    Maximum number of clients in each lobby\n"
+    "                          (server only).\n"
+    "       --server-lobbies=n Number of lobbies (server only). The lobbies\n"
+    "                          share the server's race, so while one lobby\n"
+    "                          is racing the others have to wait.\n"
     "       --no-console       Does not write messages in the console but to\n"
     "                          stdout.log.\n"
     "       --console          Write messages in the console and files\n"
@@ -722,6 +771,27 @@ int handleCmdLinePreliminary()
     return 0;
 }   // handleCmdLinePreliminary
 
+// ============================================================================
+/** Converts a history or replay file from the binary into the text format
+ *  or vice versa.
+ *  \param files The input and output file name, separated by a comma.
+ *  \param is_history True if a history file is converted, false for a
+ *         replay file.
+ *  \return True if the conversion was successful.
+ */
+bool convertFile(const std::string &files, bool is_history)
+{
+    std::vector<std::string> names = StringUtils::split(files, ',');
+    if(names.size()!=2)
+    {
+        Log::error("main", "Expected two file names separated by a comma: "
+                   "'%s'.", files.c_str());
+        return false;
+    }
+    return is_history ? History::convert(names[0], names[1])
+                      : ReplayBase::convert(names[0], names[1]);
+}   // convertFile
+
 // ============================================================================
 /** Handles command line options.
  *  \param argc Number of command line options
@@ -737,6 +807,12 @@ int handleCmdLine()
 
     if (CommandLine::has("--unit-testing"))
         UserConfigParams::m_unit_testing = true;
+    if (CommandLine::has("--font-benchmark"))
+    {
+        // Needs the fonts, so it can only be done after initRest
+        GUIEngine::getFont()->benchmark();
+        exit(0);
+    }   // --font-benchmark
     if (CommandLine::has("--gamepad-debug"))
         UserConfigParams::m_gamepad_debug=true;
     if (CommandLine::has("--keyboard-debug"))
@@ -782,6 +858,9 @@ int handleCmdLine()
     if(CommandLine::has("--max-players", &n))
         UserConfigParams::m_server_max_players=n;
 
+    if(CommandLine::has("--server-lobbies", &n))
+        UserConfigParams::m_server_lobbies=n;
+
     if(CommandLine::has("--login", &s) )
     {
         login = s.c_str();
@@ -984,6 +1063,22 @@ int handleCmdLine()
         }
     }   // --with-profile
 
+    if(CommandLine::has("--profile-races", &n))
+    {
+        if (n < 1)
+        {
+            Log::error("main", "Invalid number of profile-races: %i.", n);
+            return 0;
+        }
+        ProfileWorld::setNumRaces(n);
+    }   // --profile-races
+
+    if(CommandLine::has("--profile-seed", &n))
+        ProfileWorld::setSeed(n);
+
+    if(CommandLine::has("--profile-results", &s))
+        ProfileWorld::setResultsFile(s);
+
     if(CommandLine::has("--ghost"))
         ReplayPlay::create();
 
@@ -1003,6 +1098,71 @@ int handleCmdLine()
         UserConfigParams::m_no_start_screen = true;
     }   // --history
 
+    if(CommandLine::has("--fixed-timestep", &n))
+    {
+        if(n>0)
+            UserConfigParams::m_fixed_timestep = 1.0f/n;
+        else
+            Log::warn("main", "Invalid number of steps '%d' - ignored.", n);
+    }   // --fixed-timestep=n
+
+    if(CommandLine::has("--fixed-timestep"))
+        UserConfigParams::m_fixed_timestep = 1.0f/60.0f;
+
+    if(CommandLine::has("--seed", &n))
+        srand(n);
+
+    if(CommandLine::has("--verify-history"))
+    {
+        history->doVerifyHistory();
+        // The physics must be stepped exactly as during recording.
+        if(UserConfigParams::m_fixed_timestep<=0)
+            UserConfigParams::m_fixed_timestep = 1.0f/60.0f;
+        UserConfigParams::m_no_start_screen = true;
+    }   // --verify-history
+
+    if(CommandLine::has("--convert-history", &s))
+        exit(convertFile(s, /*is_history*/true) ? 0 : 1);
+
+    if(CommandLine::has("--convert-replay", &s))
+        exit(convertFile(s, /*is_history*/false) ? 0 : 1);
+
+    if(CommandLine::has("--history-benchmark"))
+    {
+        History::benchmark();
+        exit(0);
+    }   // --history-benchmark
+
+    if(CommandLine::has("--script-benchmark"))
+    {
+        Scripting::ScriptEngine::benchmark();
+        exit(0);
+    }   // --script-benchmark
+
+    if(CommandLine::has("--network-benchmark"))
+    {
+        ProtocolManager::benchmark();
+        exit(0);
+    }   // --network-benchmark
+
+    if(CommandLine::has("--raycast-benchmark"))
+    {
+        STKDynamicsWorld::benchmark();
+        exit(0);
+    }   // --raycast-benchmark
+
+    if(CommandLine::has("--proximity-benchmark"))
+    {
+        KartProximity::benchmark();
+        exit(0);
+    }   // --proximity-benchmark
+
+    if(CommandLine::has("--culling-benchmark"))
+    {
+        FrustumCulling::benchmark();
+        exit(0);
+    }   // --culling-benchmark
+
     // Demo mode
     if(CommandLine::has("--demo-mode", &s))
     {
@@ -1095,6 +1255,21 @@ void initUserConfig()
                                                     // command line parameters
 }   // initUserConfig
 
+//=============================================================================
+/** Prints how long a phase of the startup took, and the time since STK was
+ *  started.
+ *  \param phase Name of the phase that just finished.
+ */
+void logStartupTime(const char *phase)
+{
+    static double start_time    = StkTime::getPreciseTime();
+    static double previous_time = start_time;
+    const double now = StkTime::getPreciseTime();
+    Log::info("Startup", "%-20s %8.1f ms, total %8.1f ms.", phase,
+              (now-previous_time)*1000, (now-start_time)*1000);
+    previous_time = now;
+}   // logStartupTime
+
 //=============================================================================
 void initRest()
 {
@@ -1105,6 +1280,7 @@ void initRest()
 
     // Now create the actual non-null device in the irrlicht driver
     irr_driver->initDevice();
+    logStartupTime("Graphics device");
 
     // Init GUI
     IrrlichtDevice* device = irr_driver->getDevice();
@@ -1138,6 +1314,10 @@ void initRest()
     // defaultKartProperties, which are defined in stk_config.
     history                 = new History              ();
     ReplayRecorder::create();
+    // Used to load the karts and tracks in parallel
+    thread_pool             = new ThreadPool           ();
+    // Caches the directory listings and xml files of karts and tracks
+    metadata_index          = new MetadataIndex        ();
     material_manager        = new MaterialManager      ();
     track_manager           = new TrackManager         ();
     kart_properties_manager = new KartPropertiesManager();
@@ -1154,8 +1334,10 @@ void initRest()
     track_manager->addTrackSearchDir(
                  file_manager->getAddonsFile("tracks/"));
 
+    logStartupTime("Managers");
     track_manager->loadTrackList();
     music_manager->addMusicToTracks();
+    logStartupTime("Tracks");
 
     GUIEngine::addLoadingIcon(irr_driver->getTexture(FileManager::GUI,
                                                      "notes.png"      ) );
@@ -1180,7 +1362,7 @@ void initRest()
         UserConfigParams::m_last_track.revertToDefaults();
 
     race_manager->setTrack(UserConfigParams::m_last_track);
-
+    logStartupTime("Grand prix and race");
 }   // initRest
 
 //=============================================================================
@@ -1245,6 +1427,7 @@ void askForInternetPermission()
 // ----------------------------------------------------------------------------
 int main(int argc, char *argv[] )
 {
+    logStartupTime("Start");
     CommandLine::init(argc, argv);
 
     CrashReporting::installHandlers();
@@ -1266,6 +1449,7 @@ int main(int argc, char *argv[] )
         // handle all command line options that do not need (or must
         // not have) other managers initialised:
         initUserConfig();
+        logStartupTime("User config");
 
         handleCmdLinePreliminary();
 
@@ -1292,7 +1476,10 @@ int main(int argc, char *argv[] )
 
         GUIEngine::addLoadingIcon( irr_driver->getTexture(FileManager::GUI,
                                                           "options_video.png"));
+        logStartupTime("Materials and fonts");
         kart_properties_manager -> loadAllKarts    ();
+        metadata_index->save();
+        logStartupTime("Karts");
         handleXmasMode();
         handleEasterEarMode();
 
@@ -1336,6 +1523,7 @@ int main(int argc, char *argv[] )
         file_manager->popTextureSearchPath();
 
         attachment_manager->loadModels();
+        logStartupTime("Items and powerups");
 
         GUIEngine::addLoadingIcon( irr_driver->getTexture(FileManager::GUI,
                                                           "banana.png")    );
@@ -1350,11 +1538,13 @@ int main(int argc, char *argv[] )
         {
             ServerNetworkManager::getInstance()->setMaxPlayers(
                     UserConfigParams::m_server_max_players);
+            ServerNetworkManager::getInstance()->setNumRooms(
+                    std::max(1, std::min(254, (int)UserConfigParams::m_server_lobbies)));
         }
         NetworkManager::getInstance()->run();
         if (NetworkManager::getInstance()->isServer())
         {
-            ProtocolManager::getInstance()->requestStart(new ServerLobbyRoomProtocol());
+            ServerNetworkManager::getInstance()->startRooms();
         }
 
         addons_manager->checkInstalledAddons();
@@ -1449,6 +1639,7 @@ int main(int argc, char *argv[] )
             }
 #endif
             askForInternetPermission();
+            logStartupTime("Menu");
         }
         else
         {
@@ -1477,9 +1668,13 @@ int main(int argc, char *argv[] )
             race_manager->setupPlayerKartInfo();
             race_manager->startNew(false);
             main_loop->run();
-            // well, actually run() will never return, since
-            // it exits after replaying history (see history::GetNextDT()).
-            // So the next line is just to make this obvious here!
+            // When verifying, the main loop is aborted at the end of the
+            // replay or at the first divergence.
+            if(history->isVerifying())
+                exit(history->verificationFailed() ? 1 : 0);
+            // Otherwise run() will never return, since the history replay
+            // is restarted when it is finished. So the next line is just
+            // to make this obvious here!
             exit(-3);
         }
 
@@ -1586,6 +1781,8 @@ static void cleanSuperTuxKart()
     if(projectile_manager)      delete projectile_manager;
     if(kart_properties_manager) delete kart_properties_manager;
     if(track_manager)           delete track_manager;
+    if(thread_pool)             delete thread_pool;
+    if(metadata_index)          delete metadata_index;
     if(material_manager)        delete material_manager;
     if(history)                 delete history;
     ReplayRecorder::destroy();
@@ -1664,6 +1861,18 @@ static void cleanUserConfig()
 void runUnitTests()
 {
     GraphicsRestrictions::unitTesting();
+    FrustumCulling::unitTesting();
+    ItemGrid::unitTesting();
+    KartProximity::unitTesting();
+    QuadGraph::unitTesting();
+    RandomGenerator::unitTesting();
+    KartSnapshot::unitTesting();
+    KartUpdateProtocol::unitTesting();
+    InterpolationBuffer::unitTesting();
+    History::unitTesting();
+    ReplayBase::unitTesting();
+    ThreadPool::unitTesting();
+    MetadataIndex::unitTesting();
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
     // before and after
     int saved_easter_mode = UserConfigParams::m_easter_ear_mode;
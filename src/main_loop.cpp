@@ -45,6 +45,7 @@ m_frame_count(0)
 {
     m_curr_time = 0;
     m_prev_time = 0;
+    m_time_accumulator = 0;
     m_throttle_fps = true;
 }  // MainLoop
 
@@ -95,18 +96,55 @@ float MainLoop::getLimitedDt()
 }   // getLimitedDt
 
 //-----------------------------------------------------------------------------
-/** Updates all race related objects.
+/** Updates all race related objects. If a fixed time step is used, the
+ *  frame time is accumulated, and the race is updated with as many fixed
+ *  steps as fit into the accumulated time. This makes the simulation
+ *  independent of the frame rate.
  *  \param dt Time step size.
  */
 void MainLoop::updateRace(float dt)
 {
-    if(ProfileWorld::isProfileMode()) dt=1.0f/60.0f;
+    if(ProfileWorld::isProfileMode())
+    {
+        updateRaceStep(1.0f/60.0f);
+        return;
+    }
+
+    const float fixed_dt = UserConfigParams::m_fixed_timestep;
+    if(fixed_dt<=0)
+    {
+        updateRaceStep(dt);
+        return;
+    }
+
+    // getLimitedDt() limits dt, so the number of steps per frame is
+    // bounded as well.
+    m_time_accumulator += dt;
+    World *world = World::getWorld();
+    while(m_time_accumulator >= fixed_dt && !m_abort)
+    {
+        updateRaceStep(fixed_dt);
+        m_time_accumulator -= fixed_dt;
+        // A finished race can delete the world (or start a new one)
+        if(World::getWorld()!=world)
+        {
+            m_time_accumulator = 0;
+            break;
+        }
+    }
+}   // updateRace
 
+//-----------------------------------------------------------------------------
+/** Does one update of the race.
+ *  \param dt Time step size.
+ */
+void MainLoop::updateRaceStep(float dt)
+{
     if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
         NetworkWorld::getInstance<NetworkWorld>()->update(dt);
     else
         World::getWorld()->updateWorld(dt);
-}   // updateRace
+}   // updateRaceStep
 
 //-----------------------------------------------------------------------------
 /** Run the actual main loop.
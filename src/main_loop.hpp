@@ -34,8 +34,14 @@ private:
     int      m_frame_count;
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+
+    /** With a fixed time step: the frame time that has not been
+     *  simulated yet. */
+    float    m_time_accumulator;
+
     float    getLimitedDt();
     void     updateRace(float dt);
+    void     updateRaceStep(float dt);
 public:
          MainLoop();
         ~MainLoop();
@@ -27,6 +27,8 @@
 
 #include <ISceneManager.h>
 
+#include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 
@@ -34,6 +36,11 @@ ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+int   ProfileWorld::m_num_races   = 1;
+int   ProfileWorld::m_current_race = 0;
+int   ProfileWorld::m_seed        = -1;
+std::string  ProfileWorld::m_results_file;
+unsigned int ProfileWorld::m_batch_start_time = 0;
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -56,6 +63,8 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    m_current_race     = 0;
+    m_batch_start_time = m_start_time;
 }   // ProfileWorld
 
 //-----------------------------------------------------------------------------
@@ -128,6 +137,57 @@ AbstractKart *ProfileWorld::createKart(const std::string &kart_ident, int index,
     return new_kart;
 }   // createKart
 
+//-----------------------------------------------------------------------------
+/** Resets the statistics for a new race. This is called at the start of
+ *  each race of a batch, so that the track and all karts are only loaded
+ *  once. Each race is seeded with its own seed to make a batch reproducible.
+ */
+void ProfileWorld::reset()
+{
+    if(m_seed<0)
+        m_seed = (int)time(NULL);
+    srand(m_seed+m_current_race);
+
+    // In time based profiling the number of laps is modified at the end
+    // of each race, so restore it.
+    if(m_profile_mode==PROFILE_TIME)
+        race_manager->setNumLaps(m_num_laps);
+
+    StandardRace::reset();
+
+    m_frame_count      = 0;
+    m_start_time       = irr_driver->getRealTime();
+    m_num_triangles    = 0;
+    m_num_culls        = 0;
+    m_num_solid        = 0;
+    m_num_transparent  = 0;
+    m_num_trans_effect = 0;
+    m_num_calls        = 0;
+    m_lap_times.clear();
+    m_lap_times.resize(getNumKarts());
+}   // reset
+
+//-----------------------------------------------------------------------------
+/** Records the lap times of all karts.
+ *  \param kart_index Index of the kart that crossed the start line.
+ */
+void ProfileWorld::newLap(unsigned int kart_index)
+{
+    const int   old_lap      = getKartLaps(kart_index);
+    const float old_lap_time = m_kart_info[kart_index].m_time_at_last_lap;
+
+    StandardRace::newLap(kart_index);
+
+    const int new_lap = getKartLaps(kart_index);
+    if(new_lap > old_lap && new_lap > 0)
+    {
+        // The first lap is counted from the start of the race, since the
+        // karts start behind the start line.
+        m_lap_times[kart_index].push_back(old_lap<=0 ? getTime()
+                                                     : getTime()-old_lap_time);
+    }
+}   // newLap
+
 //-----------------------------------------------------------------------------
 /** The race is over if either the requested number of laps have been done
  *  or the requested time is over.
@@ -344,6 +404,77 @@ void ProfileWorld::enterRaceOverState()
                off_track_count);
         Log::verbose("profile", "");
     }   // for it !=all_groups.end
+
+    writeRaceResults();
+
+    // Start the next race of a batch without reloading track and karts.
+    m_current_race++;
+    if(m_current_race < m_num_races)
+    {
+        race_manager->rerunRace();
+        return;
+    }
+
+    if(m_num_races>1)
+    {
+        float batch_time = (irr_driver->getRealTime()-m_batch_start_time)
+                         * 0.001f;
+        Log::verbose("profile", "Batch of %d races took %f s, %f races/s",
+                     m_num_races, batch_time, m_num_races/batch_time);
+    }
     delete this;
     main_loop->abort();
 }   // enterRaceOverState
+
+//-----------------------------------------------------------------------------
+/** Appends the results of the current race to the results file (if one was
+ *  specified). One line is written for each kart, the lap times of a kart
+ *  are separated by ';'. The header is written before the first race.
+ */
+void ProfileWorld::writeRaceResults()
+{
+    if(m_results_file.empty())
+        return;
+
+    std::ofstream out(m_results_file.c_str(),
+                      m_current_race==0 ? std::ios::out
+                                        : std::ios::out | std::ios::app);
+    if(!out.is_open())
+    {
+        Log::error("profile", "Can't open results file '%s'.",
+                   m_results_file.c_str());
+        return;
+    }
+
+    if(m_current_race==0)
+    {
+        out << "race,seed,track,kart,controller,start_position,end_position,"
+            << "finish_time,lap_times,average_speed,top_speed,rescue_count,"
+            << "rescue_time,"
+            << "explosion_count,skidding_time,brake_count,off_track_count\n";
+    }
+
+    float distance = (float)(m_profile_mode==PROFILE_LAPS
+                             ? race_manager->getNumLaps() : 1);
+    distance *= m_track->getTrackLength();
+
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        KartWithStats* kart = dynamic_cast<KartWithStats*>(m_karts[i]);
+        out << m_current_race << "," << m_seed+m_current_race << ","
+            << m_track->getIdent() << "," << kart->getIdent() << ","
+            << kart->getController()->getControllerName() << ","
+            << i+1 << "," << kart->getPosition() << ","
+            << kart->getFinishTime() << ",";
+        for(unsigned int j=0; j<m_lap_times[i].size(); j++)
+        {
+            if(j>0) out << ";";
+            out << m_lap_times[i][j];
+        }
+        out << "," << distance/kart->getFinishTime()
+            << "," << kart->getTopSpeed()     << "," << kart->getRescueCount()
+            << "," << kart->getRescueTime()   << "," << kart->getExplosionCount()
+            << "," << kart->getSkiddingTime() << "," << kart->getBrakeCount()
+            << "," << kart->getOffTrackCount() << "\n";
+    }
+}   // writeRaceResults
@@ -21,6 +21,9 @@
 
 #include "modes/standard_race.hpp"
 
+#include <string>
+#include <vector>
+
 class Kart;
 
 /**
@@ -43,6 +46,28 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** Number of races to run back to back in this process. The track
+     *  and karts are only loaded once, each further race is started
+     *  with a reset of the world. */
+    static int   m_num_races;
+
+    /** Index of the race currently being run in a batch. */
+    static int   m_current_race;
+
+    /** Seed used for the first race of a batch, race i is seeded with
+     *  m_seed+i. A negative value means a seed is picked at startup. */
+    static int   m_seed;
+
+    /** If not empty, the per-race results are written to this file
+     *  as comma separated values. */
+    static std::string m_results_file;
+
+    /** Real time at which the first race of a batch was started. */
+    static unsigned int m_batch_start_time;
+
+    /** For each kart the times of all finished laps. */
+    std::vector<std::vector<float> > m_lap_times;
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -76,6 +101,7 @@ protected:
                                      int local_player_id, int global_player_id,
                                      RaceManager::KartType type,
                                      const PlayerDifficulty *difficulty);
+    void                  writeRaceResults();
 
 public:
                           ProfileWorld();
@@ -85,10 +111,21 @@ public:
     virtual  void        update(float dt);
     virtual  bool        isRaceOver();
     virtual  void        enterRaceOverState();
+    virtual  void        reset();
+    virtual  void        newLap(unsigned int kart_index);
 
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
     // ------------------------------------------------------------------------
+    /** Sets the number of races to run in one batch. */
+    static   void setNumRaces(int n) { m_num_races = n; }
+    // ------------------------------------------------------------------------
+    /** Sets the seed for the first race of a batch. */
+    static   void setSeed(int seed) { m_seed = seed; }
+    // ------------------------------------------------------------------------
+    /** Sets the name of the file to which per-race results are written. */
+    static   void setResultsFile(const std::string &f) { m_results_file = f; }
+    // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
     // ------------------------------------------------------------------------
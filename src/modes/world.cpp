@@ -60,6 +60,7 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
 
 #include <algorithm>
 #include <assert.h>
@@ -70,6 +71,10 @@
 
 World* World::m_world = NULL;
 
+/** Minimum number of karts for which the controller decisions are computed
+ *  in parallel. */
+static const unsigned int MIN_PARALLEL_KARTS = 4;
+
 /** The main world class is used to handle the track and the karts.
  *  The end of the race is detected in two phases: first the (abstract)
  *  function isRaceOver, which must be implemented by all game modes,
@@ -229,6 +234,13 @@ void World::reset()
     m_schedule_pause = false;
     m_schedule_unpause = false;
 
+    // Seed all random generators, so that a race can be reproduced (e.g.
+    // when replaying a history with physics) from the seed and the time
+    // steps. In profile mode rand() is seeded for each race.
+    RandomGenerator::seedRace(history->replayHistory()
+                              ? history->getRandomSeed()
+                              : (unsigned int)rand());
+
     WorldStatus::reset();
     m_faster_music_active = false;
     m_eliminated_karts    = 0;
@@ -359,6 +371,7 @@ Controller* World::loadAIController(AbstractKart *kart)
 World::~World()
 {
     irr_driver->onUnloadWorld();
+    RandomGenerator::endRace();
 
     if(ReplayPlay::get())
     {
@@ -937,10 +950,30 @@ void World::update(float dt)
 
     PROFILER_PUSH_CPU_MARKER("World::update (AI)", 0x40, 0x7F, 0x00);
     const int kart_amount = (int)m_karts.size();
+    // Make the new positions of all karts available before any kart is
+    // updated, so that all controllers see the same state.
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        if(!m_karts[i]->isEliminated()) m_karts[i]->updatePosition();
+    }
+    m_kart_proximity.reset(kart_amount);
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        m_kart_proximity.setKart(i, m_karts[i]->getXYZ(),
+                                 m_karts[i]->getVelocity().length());
+    }
+    if(!history->replayHistory())
+        computeKartDecisions(dt);
     for (int i = 0 ; i < kart_amount; ++i)
     {
         // Update all karts that are not eliminated
-        if(!m_karts[i]->isEliminated()) m_karts[i]->update(dt) ;
+        if(!m_karts[i]->isEliminated())
+        {
+            m_karts[i]->update(dt);
+            // Keep the position up to date for the karts updated later
+            m_kart_proximity.setKart(i, m_karts[i]->getXYZ(),
+                                     m_karts[i]->getVelocity().length());
+        }
     }
     PROFILER_POP_CPU_MARKER();
 
@@ -969,6 +1002,50 @@ void World::update(float dt)
 #endif
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Lets the controllers of all karts compute their decisions, before any
+ *  kart is updated. Since the controllers only read the state of the world
+ *  and karts at this stage, this is done in parallel using the thread pool.
+ *  Each controller only changes its own state, so the result does not
+ *  depend on the number of threads. The decisions are applied when each
+ *  kart is updated.
+ *  \param dt Time step size.
+ */
+void World::computeKartDecisions(float dt)
+{
+    m_decision_data.m_karts.clear();
+    m_decision_data.m_dt = dt;
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if(!m_karts[i]->isEliminated())
+            m_decision_data.m_karts.push_back(m_karts[i]);
+    }
+
+    if(thread_pool && m_decision_data.m_karts.size() >= MIN_PARALLEL_KARTS)
+    {
+        thread_pool->run((unsigned int)m_decision_data.m_karts.size(),
+                         &computeDecisionsTask, &m_decision_data);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_decision_data.m_karts.size(); i++)
+            computeDecisionsTask(i, &m_decision_data);
+    }
+}   // computeKartDecisions
+
+// ----------------------------------------------------------------------------
+/** Thread pool task which computes the decisions of the controller of one
+ *  kart.
+ *  \param index Index of the kart.
+ *  \param data Pointer to the DecisionData of the world.
+ */
+void World::computeDecisionsTask(unsigned int index, void *data)
+{
+    DecisionData *decision_data = (DecisionData*)data;
+    decision_data->m_karts[index]->getController()
+                                  ->computeDecisions(decision_data->m_dt);
+}   // computeDecisionsTask
+
 // ----------------------------------------------------------------------------
 /** Only updates the track. The order in which the various parts of STK are
  *  updated is quite important (i.e. the track can't be updated as part of
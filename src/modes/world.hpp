@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include "graphics/weather.hpp"
+#include "karts/kart_proximity.hpp"
 #include "modes/world_status.hpp"
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
@@ -94,8 +95,23 @@ protected:
 
     /** The list of all karts. */
     KartList                  m_karts;
+
+    /** Used for all random decisions of the simulation that do not belong
+     *  to an object with its own generator. */
     RandomGenerator           m_random;
 
+    /** The positions of all karts, to find the karts close to a position. */
+    KartProximity             m_kart_proximity;
+
+    /** The data for the thread pool task that computes the decisions of
+     *  the controllers (see computeKartDecisions). */
+    struct DecisionData
+    {
+        std::vector<AbstractKart*> m_karts;
+        float                      m_dt;
+    };   // DecisionData
+    DecisionData              m_decision_data;
+
     Physics*      m_physics;
     bool          m_force_disable_fog;
     AbstractKart* m_fastest_kart;
@@ -115,6 +131,8 @@ protected:
     */
     bool        m_use_highscores;
 
+    void  computeKartDecisions(float dt);
+    static void computeDecisionsTask(unsigned int index, void *data);
     void  updateHighscores  (int* best_highscore_rank, int* best_finish_time,
                              std::string* highscore_who,
                              StateManager::ActivePlayer** best_player);
@@ -320,6 +338,14 @@ public:
     /** Returns a pointer to the physics. */
     Physics        *getPhysics() const { return m_physics; }
     // ------------------------------------------------------------------------
+    /** Returns the random generator of the world, which is seeded for each
+     *  race (see RandomGenerator::seedRace). */
+    RandomGenerator &getRandomGenerator() { return m_random; }
+    // ------------------------------------------------------------------------
+    /** Returns the positions of all karts, which are updated after each kart
+     *  was updated. */
+    const KartProximity &getKartProximity() const { return m_kart_proximity; }
+    // ------------------------------------------------------------------------
     /** Returns a pointer to the track. */
     Track          *getTrack() const { return m_track; }
     // ------------------------------------------------------------------------
@@ -20,11 +20,15 @@
 #include "network/network_manager.hpp"
 
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <string.h>
 
 Event::Event(ENetEvent* event)
 {
+    m_packet       = NULL;
+    peer           = NULL;
+    m_receive_time = StkTime::getPreciseTime();
     switch (event->type)
     {
     case ENET_EVENT_TYPE_CONNECT:
@@ -40,20 +44,17 @@ Event::Event(ENetEvent* event)
         return;
         break;
     }
-    if (type == EVENT_TYPE_MESSAGE)
+    // Keep the packet, so that its data can be accessed without copying
+    // it. The packet is destroyed when the event is deleted.
+    m_packet = event->packet;
+    if (type == EVENT_TYPE_MESSAGE && m_packet && m_packet->dataLength > 0)
     {
-        m_data = NetworkString(std::string((char*)(event->packet->data), event->packet->dataLength-1));
+        // The last byte is the string terminator added by the sender.
+        m_data = NetworkStringView(m_packet->data,
+                                   (int)m_packet->dataLength-1);
     }
 
-    m_packet = NULL;
-    if (event->packet)
-        m_packet = event->packet;
-
-    if (m_packet)
-        enet_packet_destroy(m_packet); // we got all we need, just remove the data.
-    m_packet = NULL;
-
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    const std::vector<STKPeer*> &peers = NetworkManager::getInstance()->getPeers();
     peer = new STKPeer*;
     *peer = NULL;
     for (unsigned int i = 0; i < peers.size(); i++)
@@ -74,24 +75,11 @@ Event::Event(ENetEvent* event)
     }
 }
 
-Event::Event(const Event& event)
-{
-    m_packet = NULL;
-    m_data = event.m_data;
-    // copy the peer
-    peer = event.peer;
-    type = event.type;
-}
-
 Event::~Event()
 {
     delete peer;
     peer = NULL;
+    if (m_packet)
+        enet_packet_destroy(m_packet);
     m_packet = NULL;
 }
-
-void Event::removeFront(int size)
-{
-    m_data.removeFront(size);
-}
-
@@ -26,6 +26,7 @@
 
 #include "network/stk_peer.hpp"
 #include "network/network_string.hpp"
+#include "utils/no_copy.hpp"
 #include "utils/types.hpp"
 
 /*!
@@ -48,40 +49,45 @@ enum EVENT_TYPE
  * Indeed, when packets are logged, the state of the peer cannot be stored at
  * all times, and then the user of this class can rely only on the address/port
  * of the peer, and not on values that might change over time.
+ * The event keeps the ENetPacket and only gives a view on its data, so
+ * no copy of the data is made. Therefore events can not be copied.
  */
-class Event
+class Event : public NoCopy
 {
     public:
         /*! \brief Constructor
          *  \param event : The event that needs to be translated.
          */
         Event(ENetEvent* event);
-        /*! \brief Constructor
-         *  \param event : The event to copy.
-         */
-        Event(const Event& event);
         /*! \brief Destructor
          *  frees the memory of the ENetPacket.
          */
         ~Event();
 
         /*! \brief Remove bytes at the beginning of data.
+         *  This only moves the read cursor, the data is not copied.
          *  \param size : The number of bytes to remove.
          */
-        void removeFront(int size);
+        void removeFront(int size) { m_data.skip(size); }
 
-        /*! \brief Get a copy of the data.
-         *  \return A copy of the message data. This is empty for events like
-         *  connection or disconnections.
+        /*! \brief Get a view on the data.
+         *  \return A view on the message data, which is only valid as long
+         *  as the event exists. This is empty for events like connection or
+         *  disconnections.
+         */
+        const NetworkStringView& data() const { return m_data; }
+        /*! \brief Get the time when the event was received.
+         *  \return The time as returned by StkTime::getPreciseTime().
          */
-        NetworkString data() const { return m_data; }
+        double getReceiveTime() const { return m_receive_time; }
 
         EVENT_TYPE type;    //!< Type of the event.
         STKPeer** peer;     //!< Pointer to the peer that triggered that event.
 
     private:
-        NetworkString m_data; //!< Copy of the data passed by the event.
+        NetworkStringView m_data; //!< View on the data of the packet.
         ENetPacket* m_packet; //!< A pointer on the ENetPacket to be deleted.
+        double m_receive_time; //!< Time when the event was received.
 };
 
 #endif // EVENT_HPP
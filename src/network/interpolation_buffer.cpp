@@ -0,0 +1,235 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/interpolation_buffer.hpp"
+
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+/** Maximum time a position is extrapolated beyond the newest state. */
+static const float MAX_EXTRAPOLATION_TIME = 0.25f;
+
+InterpolationBuffer::InterpolationBuffer()
+{
+    clear();
+}   // InterpolationBuffer
+
+// ----------------------------------------------------------------------------
+/** Removes all states. */
+void InterpolationBuffer::clear()
+{
+    m_first       = 0;
+    m_count       = 0;
+    m_time_offset = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds a received state. States that are not newer than the newest stored
+ *  state are ignored.
+ *  \param time Time of the sender when the state was taken.
+ *  \param local_time Local time when the state was received.
+ *  \param xyz Position of the kart.
+ *  \param rotation Rotation of the kart.
+ */
+void InterpolationBuffer::add(float time, double local_time, const Vec3 &xyz,
+                              const btQuaternion &rotation)
+{
+    if (m_count > 0 && time <= getState(m_count-1).m_time)
+        return;
+
+    // The offset is smoothed, since the arrival times jitter. If a packet
+    // arrives earlier than expected the offset is increased immediately,
+    // so that this packet can be interpolated.
+    const double offset = time - local_time;
+    if (m_count == 0 || offset > m_time_offset)
+        m_time_offset = offset;
+    else
+        m_time_offset += (offset - m_time_offset)*0.05;
+
+    if (m_count == BUFFER_SIZE)
+    {
+        m_first = (m_first + 1) % BUFFER_SIZE;
+        m_count--;
+    }
+    State &s     = m_states[(m_first + m_count) % BUFFER_SIZE];
+    s.m_time     = time;
+    s.m_xyz      = xyz;
+    s.m_rotation = rotation;
+    m_count++;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Computes the state of the kart to show.
+ *  \param local_time The current local time.
+ *  \param delay The delay with which the kart is shown.
+ *  \param xyz On return the position.
+ *  \param rotation On return the rotation.
+ *  \param latency On return how far the shown state is behind the newest
+ *         received state (negative if extrapolated).
+ *  \param extrapolated On return true if the newest state was too old, so
+ *         the position had to be extrapolated.
+ *  \return False if no state is available.
+ */
+bool InterpolationBuffer::get(double local_time, float delay, Vec3 *xyz,
+                              btQuaternion *rotation, float *latency,
+                              bool *extrapolated) const
+{
+    if (m_count == 0)
+        return false;
+
+    const float time = float(local_time + m_time_offset - delay);
+    const State &newest = getState(m_count-1);
+    *latency      = newest.m_time - time;
+    *extrapolated = false;
+
+    if (time <= getState(0).m_time)
+    {
+        *xyz      = getState(0).m_xyz;
+        *rotation = getState(0).m_rotation;
+        return true;
+    }
+
+    if (time >= newest.m_time)
+    {
+        *rotation = newest.m_rotation;
+        *xyz      = newest.m_xyz;
+        if (m_count > 1)
+        {
+            const State &prev = getState(m_count-2);
+            const float dt    = std::min(time - newest.m_time,
+                                         MAX_EXTRAPOLATION_TIME);
+            const Vec3 velocity = (newest.m_xyz - prev.m_xyz)
+                                / (newest.m_time - prev.m_time);
+            *xyz          = newest.m_xyz + velocity*dt;
+            *extrapolated = true;
+        }
+        return true;
+    }
+
+    // Find the two states to interpolate between
+    int i = 0;
+    while (getState(i+1).m_time < time)
+        i++;
+    const State &s1 = getState(i);
+    const State &s2 = getState(i+1);
+    const float h   = s2.m_time - s1.m_time;
+
+    // Tangents from the neighbouring states (one-sided at the ends),
+    // scaled to the interval [s1, s2].
+    const State &s0 = getState(std::max(i-1, 0));
+    const State &s3 = getState(std::min(i+2, m_count-1));
+    const Vec3 m1   = (s2.m_xyz - s0.m_xyz) * (h / (s2.m_time - s0.m_time));
+    const Vec3 m2   = (s3.m_xyz - s1.m_xyz) * (h / (s3.m_time - s1.m_time));
+
+    const float t   = (time - s1.m_time) / h;
+    const float t2  = t*t, t3 = t2*t;
+    *xyz = s1.m_xyz * ( 2*t3 - 3*t2 + 1) + m1 * (t3 - 2*t2 + t)
+         + s2.m_xyz * (-2*t3 + 3*t2    ) + m2 * (t3 - t2);
+    // q and -q are the same rotation, and the decoded rotations can have
+    // either sign. btQuaternion::slerp negates q2 for the long arc, but
+    // keeps the angle of the long arc, so make sure to use the short arc.
+    btQuaternion q2 = s2.m_rotation;
+    if (s1.m_rotation.dot(q2) < 0)
+        q2 = -q2;
+    *rotation = s1.m_rotation.slerp(q2, t);
+    return true;
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Tests the buffer with a kart driving on a circle, received with random
+ *  delays and some lost states.
+ */
+void InterpolationBuffer::unitTesting()
+{
+    InterpolationBuffer buffer;
+    const float radius = 50.0f, speed = 0.4f;   // speed in radians/s
+    const float delay  = 0.1f;
+    // The clock of the sender is 100 s ahead of the local one.
+    const double offset = 100.0;
+    float max_error     = 0;
+    int   num_extrapolated = 0, num_frames = 0;
+    // Sent states (sender time) and their arrival (local) time
+    std::vector<std::pair<float, double> > in_flight;
+    float next_send = float(offset);
+    for (double local_time = 0; local_time < 20.0; local_time += 1/60.0)
+    {
+        // Send states at 20 Hz, with 30 to 80 ms latency and 5% loss.
+        while (next_send <= local_time + offset)
+        {
+            if (rand() % 20 != 0)
+            {
+                double arrival = next_send - offset + 0.03 + (rand()%50)*0.001;
+                in_flight.push_back(std::make_pair(next_send, arrival));
+            }
+            next_send += 0.05f;
+        }
+        for (unsigned int i = 0; i < in_flight.size(); )
+        {
+            if (in_flight[i].second > local_time)
+            {
+                i++;
+                continue;
+            }
+            const float a = float(in_flight[i].first - offset)*speed;
+            buffer.add(in_flight[i].first, in_flight[i].second,
+                       Vec3(radius*cosf(a), 0, radius*sinf(a)),
+                       btQuaternion(btVector3(0, 1, 0), -a));
+            in_flight.erase(in_flight.begin()+i);
+        }
+
+        Vec3 xyz;
+        btQuaternion q;
+        float latency;
+        bool extrapolated;
+        if (!buffer.get(local_time, delay, &xyz, &q, &latency, &extrapolated)
+            || local_time < 1.0)
+            continue;
+        num_frames++;
+        if (extrapolated)
+            num_extrapolated++;
+        // All shown positions must be close to the circle
+        max_error = std::max(max_error, fabsf(xyz.length() - radius));
+    }
+    assert(max_error < 0.1f);
+    assert(num_extrapolated < num_frames/4);
+    Log::info("InterpolationBuffer", "Max. error %f, %d of %d frames "
+              "extrapolated.", max_error, num_extrapolated, num_frames);
+
+    // Two states whose rotations have a different sign (which is the same
+    // rotation): the rotation must still turn at a constant speed.
+    buffer.clear();
+    const btVector3 up(0, 1, 0);
+    buffer.add(10.0f, 0.0, Vec3(0, 0, 0), btQuaternion(up, 0.0f));
+    buffer.add(10.1f, 0.1, Vec3(0, 0, 0), -btQuaternion(up, 0.2f));
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        Vec3 xyz;
+        btQuaternion q;
+        float latency;
+        bool extrapolated;
+        buffer.get(0.1 + 0.025*i, 0.1f, &xyz, &q, &latency, &extrapolated);
+        const float angle = 2.0f*acosf(std::min(fabsf(q.getW()), 1.0f));
+        assert(fabsf(angle - 0.05f*i) < 0.001f);
+        (void)angle;
+    }
+}   // unitTesting
@@ -0,0 +1,89 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file interpolation_buffer.hpp
+ *  \brief Buffers received states of a remote kart to smoothly interpolate
+ *  between them.
+ */
+
+#ifndef INTERPOLATION_BUFFER_HPP
+#define INTERPOLATION_BUFFER_HPP
+
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+/** \class InterpolationBuffer
+ *  \brief A jitter buffer for the received states of one remote kart.
+ *  The states are stored with the time of the sender. The offset between
+ *  the sender's time and the local time is estimated from the arrival
+ *  times, and the kart is shown with a fixed delay: positions are
+ *  interpolated with cubic Hermite splines (the tangents are computed from
+ *  the neighbouring states), rotations with slerp. If no new state has
+ *  arrived in time, the position is extrapolated using the last velocity.
+ */
+class InterpolationBuffer
+{
+private:
+    /** One received state. */
+    struct State
+    {
+        float        m_time;
+        Vec3         m_xyz;
+        btQuaternion m_rotation;
+    };   // State
+
+    /** Number of states kept. */
+    static const int BUFFER_SIZE = 16;
+
+    /** The states as ring buffer, the oldest one at m_first. */
+    State m_states[BUFFER_SIZE];
+
+    /** Index of the oldest state. */
+    int m_first;
+
+    /** Number of states stored. */
+    int m_count;
+
+    /** Estimated difference between the time of the sender and the local
+     *  time. */
+    double m_time_offset;
+
+    // ------------------------------------------------------------------------
+    /** Returns the i-th oldest state. */
+    const State& getState(int i) const
+    {
+        return m_states[(m_first + i) % BUFFER_SIZE];
+    }   // getState
+
+public:
+          InterpolationBuffer();
+    void  clear();
+    void  add(float time, double local_time, const Vec3 &xyz,
+              const btQuaternion &rotation);
+    bool  get(double local_time, float delay, Vec3 *xyz,
+              btQuaternion *rotation, float *latency,
+              bool *extrapolated) const;
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns true if no state is stored. */
+    bool isEmpty() const { return m_count == 0; }
+};   // InterpolationBuffer
+
+#endif // INTERPOLATION_BUFFER_HPP
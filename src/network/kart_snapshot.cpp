@@ -0,0 +1,344 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_snapshot.hpp"
+
+#include "network/network_string.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/** Flags used for each kart in an encoded snapshot. If neither position
+ *  flag is set, the position is the same as in the baseline; if the
+ *  rotation flag is not set, the rotation is the same as in the baseline. */
+enum
+{
+    KS_POSITION_FULL  = 0x01,   //!< 3 x 16 bit quantized position
+    KS_POSITION_DELTA = 0x02,   //!< 3 x varint difference to baseline
+    KS_ROTATION       = 0x04    //!< 32 bit compressed quaternion
+};
+
+// ----------------------------------------------------------------------------
+/** Writes a signed integer using zigzag encoding and 7 bits per byte. */
+static void addVarInt(NetworkString *ns, int32_t value)
+{
+    uint32_t u = (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+    while (u >= 0x80)
+    {
+        ns->addUInt8(uint8_t(u | 0x80));
+        u >>= 7;
+    }
+    ns->addUInt8(uint8_t(u));
+}   // addVarInt
+
+// ----------------------------------------------------------------------------
+/** Returns the number of bytes addVarInt would write. */
+static int getVarIntSize(int32_t value)
+{
+    uint32_t u = (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+    int size = 1;
+    while (u >= 0x80)
+    {
+        u >>= 7;
+        size++;
+    }
+    return size;
+}   // getVarIntSize
+
+// ----------------------------------------------------------------------------
+/** Reads a value written by addVarInt. Returns false if the data is
+ *  incomplete. */
+static bool getVarInt(NetworkStringView *ns, int32_t *value)
+{
+    uint32_t u = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (ns->size() < 1)
+            return false;
+        uint8_t b = ns->getUInt8();
+        u |= uint32_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+        {
+            *value = int32_t(u >> 1) ^ -int32_t(u & 1);
+            return true;
+        }
+    }
+    return false;
+}   // getVarInt
+
+// ============================================================================
+/** Creates a snapshot for the given number of karts.
+ *  \param min, max The box in which positions are quantized. Positions
+ *         slightly outside of it can still be stored, further away ones
+ *         are clamped.
+ *  \param num_karts Number of karts.
+ */
+KartSnapshot::KartSnapshot(const Vec3 &min, const Vec3 &max,
+                           unsigned int num_karts)
+{
+    m_tick = 0;
+    // Leave some space for karts that fly or fall off the track.
+    const float margin = 10.0f;
+    m_min  = min - Vec3(margin, margin, margin);
+    m_step = (max - min + Vec3(2*margin, 2*margin, 2*margin)) * (1.0f/65535.0f);
+    KartState zero;
+    zero.m_xyz[0] = zero.m_xyz[1] = zero.m_xyz[2] = 0;
+    zero.m_rotation = compressQuaternion(btQuaternion(0, 0, 0, 1));
+    m_karts.resize(num_karts, zero);
+}   // KartSnapshot
+
+// ----------------------------------------------------------------------------
+/** Quantizes and stores the position and rotation of a kart.
+ *  \param i Index of the kart.
+ *  \param xyz Position of the kart.
+ *  \param q Rotation of the kart.
+ */
+void KartSnapshot::setKart(unsigned int i, const Vec3 &xyz,
+                           const btQuaternion &q)
+{
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        float f = (xyz[axis] - m_min[axis]) / m_step[axis] + 0.5f;
+        m_karts[i].m_xyz[axis] = (uint16_t)std::max(0.0f,
+                                                    std::min(f, 65535.0f));
+    }
+    m_karts[i].m_rotation = compressQuaternion(q);
+}   // setKart
+
+// ----------------------------------------------------------------------------
+/** Returns the (dequantized) position of a kart. */
+Vec3 KartSnapshot::getXYZ(unsigned int i) const
+{
+    const KartState &s = m_karts[i];
+    return Vec3(m_min.getX() + s.m_xyz[0] * m_step.getX(),
+                m_min.getY() + s.m_xyz[1] * m_step.getY(),
+                m_min.getZ() + s.m_xyz[2] * m_step.getZ() );
+}   // getXYZ
+
+// ----------------------------------------------------------------------------
+/** Returns the (decompressed) rotation of a kart. */
+btQuaternion KartSnapshot::getRotation(unsigned int i) const
+{
+    return decompressQuaternion(m_karts[i].m_rotation);
+}   // getRotation
+
+// ----------------------------------------------------------------------------
+/** Compresses a quaternion into 32 bits: the index of the largest
+ *  component (2 bits), and the other three components (10 bits each).
+ *  Since q and -q are the same rotation, the largest component can always
+ *  be made positive, and then be recomputed from the other three.
+ */
+uint32_t KartSnapshot::compressQuaternion(const btQuaternion &q_in)
+{
+    btQuaternion q = q_in.normalized();
+    const float c[4] = { q.x(), q.y(), q.z(), q.w() };
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    }
+    const float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    uint32_t result = largest;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        // The other components are in [-1/sqrt(2), 1/sqrt(2)]
+        float f = (sign*c[i]*float(M_SQRT2) + 1.0f)*0.5f*1023.0f + 0.5f;
+        uint32_t v = (uint32_t)std::max(0.0f, std::min(f, 1023.0f));
+        result = (result << 10) | v;
+    }
+    return result;
+}   // compressQuaternion
+
+// ----------------------------------------------------------------------------
+/** Decompresses a quaternion compressed with compressQuaternion. */
+btQuaternion KartSnapshot::decompressQuaternion(uint32_t compressed)
+{
+    const unsigned int largest = compressed >> 30;
+    float c[4];
+    float sum = 0;
+    for (int i = 3; i >= 0; i--)
+    {
+        if (i == (int)largest) continue;
+        float v = (compressed & 1023) / 1023.0f;
+        compressed >>= 10;
+        c[i] = (v*2.0f - 1.0f) / float(M_SQRT2);
+        sum += c[i]*c[i];
+    }
+    c[largest] = sqrtf(std::max(0.0f, 1.0f - sum));
+    return btQuaternion(c[0], c[1], c[2], c[3]).normalized();
+}   // decompressQuaternion
+
+// ----------------------------------------------------------------------------
+/** Writes the state of one kart. If a baseline is given, only the data
+ *  that changed compared with the baseline is written.
+ *  \param ns The network string to add the data to.
+ *  \param i Index of the kart.
+ *  \param baseline The snapshot the receiver already has, or NULL.
+ */
+void KartSnapshot::encodeKart(NetworkString *ns, unsigned int i,
+                              const KartSnapshot *baseline) const
+{
+    const KartState &s = m_karts[i];
+    if (!baseline)
+    {
+        ns->addUInt8(KS_POSITION_FULL | KS_ROTATION);
+        ns->addUInt16(s.m_xyz[0]).addUInt16(s.m_xyz[1]).addUInt16(s.m_xyz[2]);
+        ns->addUInt32(s.m_rotation);
+        return;
+    }
+    assert(baseline->getNumberOfKarts() == getNumberOfKarts());
+    const KartState &b = baseline->m_karts[i];
+    int32_t delta[3];
+    int delta_size = 0;
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        delta[axis] = int32_t(s.m_xyz[axis]) - int32_t(b.m_xyz[axis]);
+        delta_size += getVarIntSize(delta[axis]);
+    }
+    uint8_t flags = 0;
+    if (delta[0] != 0 || delta[1] != 0 || delta[2] != 0)
+        flags |= delta_size < 6 ? KS_POSITION_DELTA : KS_POSITION_FULL;
+    if (s.m_rotation != b.m_rotation)
+        flags |= KS_ROTATION;
+
+    ns->addUInt8(flags);
+    if (flags & KS_POSITION_FULL)
+        ns->addUInt16(s.m_xyz[0]).addUInt16(s.m_xyz[1]).addUInt16(s.m_xyz[2]);
+    else if (flags & KS_POSITION_DELTA)
+    {
+        for (unsigned int axis = 0; axis < 3; axis++)
+            addVarInt(ns, delta[axis]);
+    }
+    if (flags & KS_ROTATION)
+        ns->addUInt32(s.m_rotation);
+}   // encodeKart
+
+// ----------------------------------------------------------------------------
+/** Reads the state of one kart written by encodeKart.
+ *  \param ns The network data to read from.
+ *  \param i Index of the kart.
+ *  \param baseline The snapshot used as baseline by the sender, or NULL.
+ *  \return False if the data is incomplete or invalid.
+ */
+bool KartSnapshot::decodeKart(NetworkStringView *ns, unsigned int i,
+                              const KartSnapshot *baseline)
+{
+    if (ns->size() < 1)
+        return false;
+    const uint8_t flags = ns->getUInt8();
+    KartState &s = m_karts[i];
+    const bool need_baseline = (flags & KS_POSITION_FULL) == 0 ||
+                               (flags & KS_ROTATION) == 0;
+    if (need_baseline && !baseline)
+        return false;
+    if (baseline)
+        s = baseline->m_karts[i];
+
+    if (flags & KS_POSITION_FULL)
+    {
+        if (ns->size() < 6)
+            return false;
+        for (unsigned int axis = 0; axis < 3; axis++)
+            s.m_xyz[axis] = ns->getUInt16();
+    }
+    else if (flags & KS_POSITION_DELTA)
+    {
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            int32_t delta;
+            if (!getVarInt(ns, &delta))
+                return false;
+            s.m_xyz[axis] = uint16_t(int32_t(s.m_xyz[axis]) + delta);
+        }
+    }
+    if (flags & KS_ROTATION)
+    {
+        if (ns->size() < 4)
+            return false;
+        s.m_rotation = ns->getUInt32();
+    }
+    return true;
+}   // decodeKart
+
+// ----------------------------------------------------------------------------
+/** Writes the state of all karts.
+ *  \param ns The network string to add the data to.
+ *  \param baseline The snapshot the receiver already has, or NULL.
+ */
+void KartSnapshot::encode(NetworkString *ns,
+                          const KartSnapshot *baseline) const
+{
+    ns->addUInt8(getNumberOfKarts());
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+        encodeKart(ns, i, baseline);
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Reads the state of all karts written by encode.
+ *  \param ns The network data to read from.
+ *  \param baseline The snapshot used as baseline by the sender, or NULL.
+ *  \return False if the data is incomplete or invalid. In this case the
+ *          content of this snapshot is undefined.
+ */
+bool KartSnapshot::decode(NetworkStringView *ns, const KartSnapshot *baseline)
+{
+    if (ns->size() < 1 || ns->getUInt8() != getNumberOfKarts())
+        return false;
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (!decodeKart(ns, i, baseline))
+            return false;
+    }
+    return true;
+}   // decode
+
+// ----------------------------------------------------------------------------
+/** Tests the quaternion compression and the quantization of positions.
+ *  The bandwidth is measured in KartUpdateProtocol::unitTesting.
+ */
+void KartSnapshot::unitTesting()
+{
+    // Quaternion compression
+    for (int i = 0; i < 1000; i++)
+    {
+        btQuaternion q(rand()%2001-1000.0f, rand()%2001-1000.0f,
+                       rand()%2001-1000.0f, rand()%2001-1000.0f);
+        if (q.length2() < 1.0f) continue;
+        q.normalize();
+        btQuaternion r = decompressQuaternion(compressQuaternion(q));
+        // q and -q are the same rotation
+        assert(fabsf(q.dot(r)) > 0.9999f);
+    }
+
+    const Vec3 min(-200, -10, -300), max(300, 40, 200);
+    const float max_error = (max-min+Vec3(20,20,20)).length() / 65535.0f;
+
+    // Check the quantization error
+    KartSnapshot s(min, max, 1);
+    for (int i = 0; i < 1000; i++)
+    {
+        Vec3 xyz(min.getX() + rand()%500, min.getY() + rand()%50,
+                 min.getZ() + rand()%500);
+        s.setKart(0, xyz, btQuaternion(0, 0, 0, 1));
+        assert((s.getXYZ(0) - xyz).length() <= max_error);
+    }
+}   // unitTesting
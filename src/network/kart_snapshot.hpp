@@ -0,0 +1,100 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_snapshot.hpp
+ *  \brief Quantized positions and rotations of all karts at one tick.
+ */
+
+#ifndef KART_SNAPSHOT_HPP
+#define KART_SNAPSHOT_HPP
+
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+class NetworkString;
+class NetworkStringView;
+
+/** \class KartSnapshot
+ *  \brief Stores the quantized state of all karts at one tick.
+ *  Positions are stored with 16 bits per axis relative to a bounding box
+ *  (usually the one of the track), rotations use the 'smallest three'
+ *  encoding in 32 bits (the largest component is dropped and recomputed,
+ *  the other three are stored with 10 bits each).
+ *  A snapshot can be encoded relative to an older snapshot (the baseline):
+ *  then only the state of karts that changed is sent, and positions are
+ *  sent as variable length differences.
+ */
+class KartSnapshot
+{
+public:
+    /** Quantized state of one kart. */
+    struct KartState
+    {
+        uint16_t m_xyz[3];
+        uint32_t m_rotation;
+    };   // KartState
+
+private:
+    /** The tick this snapshot belongs to. */
+    uint32_t m_tick;
+
+    /** Minimum point of the quantization box. */
+    Vec3 m_min;
+
+    /** Size of one quantization step on each axis. */
+    Vec3 m_step;
+
+    /** The quantized states of all karts. */
+    std::vector<KartState> m_karts;
+
+public:
+         KartSnapshot(const Vec3 &min, const Vec3 &max,
+                      unsigned int num_karts);
+    void setKart(unsigned int i, const Vec3 &xyz, const btQuaternion &q);
+    Vec3 getXYZ(unsigned int i) const;
+    btQuaternion getRotation(unsigned int i) const;
+    void encode(NetworkString *ns, const KartSnapshot *baseline) const;
+    bool decode(NetworkStringView *ns, const KartSnapshot *baseline);
+    void encodeKart(NetworkString *ns, unsigned int i,
+                    const KartSnapshot *baseline) const;
+    bool decodeKart(NetworkStringView *ns, unsigned int i,
+                    const KartSnapshot *baseline);
+
+    static uint32_t     compressQuaternion(const btQuaternion &q);
+    static btQuaternion decompressQuaternion(uint32_t c);
+    static void         unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts in this snapshot. */
+    unsigned int getNumberOfKarts() const { return (unsigned int)m_karts.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the tick of this snapshot. */
+    uint32_t getTick() const { return m_tick; }
+    // ------------------------------------------------------------------------
+    /** Sets the tick of this snapshot. */
+    void setTick(uint32_t tick) { m_tick = tick; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of one quantization step on each axis. */
+    const Vec3& getStepSize() const { return m_step; }
+};   // KartSnapshot
+
+#endif // KART_SNAPSHOT_HPP
@@ -121,11 +121,11 @@ void NetworkManager::notifyEvent(Event* event)
     if (event->type == EVENT_TYPE_MESSAGE)
     {
         uint32_t addr = peer->getAddress();
-        Log::verbose("NetworkManager", "Message, Sender : %i.%i.%i.%i, message = \"%s\"",
+        Log::verbose("NetworkManager", "Message, Sender : %i.%i.%i.%i, size = %d",
                   ((addr>>24)&0xff),
                   ((addr>>16)&0xff),
                   ((addr>>8)&0xff),
-                  (addr & 0xff), event->data().std_string().c_str());
+                  (addr & 0xff), event->data().size());
 
     }
 
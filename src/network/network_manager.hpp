@@ -74,6 +74,7 @@ class NetworkManager : public AbstractSingleton<NetworkManager>
         virtual void setManualSocketsMode(bool manual);
 
         // message/packets related functions
+        /** Takes ownership of the event. */
         virtual void notifyEvent(Event* event);
         virtual void sendPacket(const NetworkString& data,
                                 bool reliable = true) = 0;
@@ -101,7 +102,9 @@ class NetworkManager : public AbstractSingleton<NetworkManager>
         inline bool isClient()              { return !isServer();         }
         bool isPlayingOnline()              { return m_playing_online;    }
         STKHost* getHost()                  { return m_localhost;         }
-        std::vector<STKPeer*> getPeers()    { return m_peers;             }
+        const std::vector<STKPeer*>& getPeers() const { return m_peers; }
+        /** Returns the peers that take part in the current race. */
+        virtual std::vector<STKPeer*> getRacePeers() const { return m_peers; }
         unsigned int getPeerCount()         { return (int)m_peers.size(); }
         TransportAddress getPublicAddress() { return m_public_address;    }
         GameSetup* getGameSetup()           { return m_game_setup;        }
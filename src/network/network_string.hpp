@@ -29,9 +29,126 @@
 #include <vector>
 #include <stdarg.h>
 #include <assert.h>
+#include <string.h>
 
 typedef unsigned char uchar;
 
+class NetworkString;
+
+/** \class NetworkStringView
+ *  \brief A read-only view on received network data with a read cursor.
+ *  The view does not own or copy the data (usually the buffer of an ENet
+ *  packet), so it must not be used after the data is freed. The get
+ *  functions read at the cursor position and advance it; all reads are
+ *  bounds-checked: reading past the end returns 0 and empties the view.
+ */
+class NetworkStringView
+{
+    private:
+        /** Pointer to the first byte of the data. */
+        const uint8_t *m_data;
+        /** Total size of the data. */
+        int m_size;
+        /** Offset of the next byte to read. */
+        int m_current_offset;
+
+        // --------------------------------------------------------------------
+        /** Returns true if n more bytes can be read, otherwise moves the
+         *  cursor to the end and returns false. */
+        bool canRead(int n)
+        {
+            if (m_current_offset + n <= m_size)
+                return true;
+            m_current_offset = m_size;
+            return false;
+        }   // canRead
+
+    public:
+        NetworkStringView() : m_data(NULL), m_size(0), m_current_offset(0) {}
+        NetworkStringView(const uint8_t *data, int size)
+                  : m_data(data), m_size(size), m_current_offset(0) {}
+        NetworkStringView(const NetworkString &ns);
+
+        // --------------------------------------------------------------------
+        /** Returns the number of bytes that remain to be read. */
+        int size() const { return m_size - m_current_offset; }
+        // --------------------------------------------------------------------
+        /** Returns a pointer to the remaining bytes. */
+        const uint8_t* getBytes() const { return m_data + m_current_offset; }
+        // --------------------------------------------------------------------
+        /** Returns the byte at position pos (relative to the cursor) without
+         *  moving the cursor, or 0 if pos is out of range. */
+        uint8_t operator[](int pos) const
+        {
+            if (pos < 0 || pos >= size())
+                return 0;
+            return m_data[m_current_offset + pos];
+        }   // operator[]
+        // --------------------------------------------------------------------
+        /** Skips n bytes. */
+        NetworkStringView& skip(int n)
+        {
+            if (canRead(n))
+                m_current_offset += n;
+            return *this;
+        }   // skip
+        // --------------------------------------------------------------------
+        uint8_t getUInt8()
+        {
+            if (!canRead(1))
+                return 0;
+            return m_data[m_current_offset++];
+        }   // getUInt8
+        // --------------------------------------------------------------------
+        uint16_t getUInt16()
+        {
+            if (!canRead(2))
+                return 0;
+            const uint8_t *p = m_data + m_current_offset;
+            m_current_offset += 2;
+            return (uint16_t)((p[0] << 8) | p[1]);
+        }   // getUInt16
+        // --------------------------------------------------------------------
+        uint32_t getUInt32()
+        {
+            if (!canRead(4))
+                return 0;
+            const uint8_t *p = m_data + m_current_offset;
+            m_current_offset += 4;
+            return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                   ((uint32_t)p[2] <<  8) |  (uint32_t)p[3];
+        }   // getUInt32
+        // --------------------------------------------------------------------
+        /** Reads a float in the (native) format used by
+         *  NetworkString::addFloat. */
+        float getFloat()
+        {
+            if (!canRead(4))
+                return 0.0f;
+            float f;
+            memcpy(&f, m_data + m_current_offset, 4);
+            m_current_offset += 4;
+            return f;
+        }   // getFloat
+        // --------------------------------------------------------------------
+        /** Reads a string of the given length. This is the only function
+         *  that allocates memory. */
+        std::string getString(int len)
+        {
+            if (len < 0 || !canRead(len))
+                return "";
+            std::string s((const char*)m_data + m_current_offset, len);
+            m_current_offset += len;
+            return s;
+        }   // getString
+        // --------------------------------------------------------------------
+        /** Returns a copy of the remaining bytes as string (for debugging). */
+        const std::string std_string() const
+        {
+            return std::string((const char*)getBytes(), size());
+        }   // std_string
+};   // NetworkStringView
+
 /** \class NetworkString
  *  \brief Describes a chain of 8-bit unsigned integers.
  *  This class allows you to easily create and parse 8-bit strings.
@@ -145,6 +262,11 @@ class NetworkString
             m_string.insert( m_string.end(), value.m_string.begin(), value.m_string.end() );
             return *this;
         }
+        NetworkString& operator+=(NetworkStringView const& value)
+        {
+            m_string.insert( m_string.end(), value.getBytes(), value.getBytes()+value.size() );
+            return *this;
+        }
 
         const std::string std_string() const
         {
@@ -157,8 +279,8 @@ class NetworkString
             return (int)m_string.size();
         }
 
-        uint8_t* getBytes() { return &m_string[0]; };
-        const uint8_t* getBytes() const { return &m_string[0]; };
+        uint8_t* getBytes() { return m_string.empty() ? NULL : &m_string[0]; };
+        const uint8_t* getBytes() const { return m_string.empty() ? NULL : &m_string[0]; };
 
         template<typename T, size_t n>
         T get(int pos) const
@@ -257,4 +379,11 @@ class NetworkString
 
 NetworkString operator+(NetworkString const& a, NetworkString const& b);
 
+// ----------------------------------------------------------------------------
+/** Creates a view on the content of a NetworkString. */
+inline NetworkStringView::NetworkStringView(const NetworkString &ns)
+    : m_data(ns.getBytes()), m_size(ns.size()), m_current_offset(0)
+{
+}   // NetworkStringView(NetworkString)
+
 #endif // NETWORK_STRING_HPP
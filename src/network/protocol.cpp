@@ -56,7 +56,7 @@ PROTOCOL_TYPE Protocol::getProtocolType()
 
 bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < minimum_size || data[0] != 4)
     {
         Log::warn("Protocol", "Receiving a badly "
@@ -65,7 +65,7 @@ bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
         return false;
     }
     STKPeer* peer = *(event->peer);
-    uint32_t token = data.gui32(1);
+    uint32_t token = data.skip(1).getUInt32();
     if (token != peer->getClientServerToken())
     {
         Log::warn("Protocol", "Peer sending bad token. Request "
@@ -77,7 +77,7 @@ bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 
 bool Protocol::isByteCorrect(Event* event, int byte_nb, int value)
 {
-    NetworkString data = event->data();
+    const NetworkStringView &data = event->data();
     if (data[byte_nb] != value)
     {
         Log::info("Protocol", "Bad byte at pos %d. %d "
@@ -87,9 +87,10 @@ bool Protocol::isByteCorrect(Event* event, int byte_nb, int value)
     return true;
 }
 
-void Protocol::sendMessageToPeersChangingToken(NetworkString prefix, NetworkString message)
+void Protocol::sendMessageToPeersChangingToken(const std::vector<STKPeer*>& peers,
+                                               NetworkString prefix,
+                                               NetworkString message)
 {
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         prefix.ai8(4).ai32(peers[i]->getClientServerToken());
@@ -43,6 +43,7 @@ enum PROTOCOL_TYPE
     PROTOCOL_KART_UPDATE = 5,   //!< Protocol to update karts position, rotation etc...
     PROTOCOL_GAME_EVENTS = 6,   //!< Protocol to communicate the game events.
     PROTOCOL_CONTROLLER_EVENTS = 7,//!< Protocol to transfer controller modifications
+    PROTOCOL_MAX,               //!< Number of protocol types that receive events.
     PROTOCOL_SILENT = 0xffff    //!< Used for protocols that do not subscribe to any network event.
 };
 
@@ -116,7 +117,9 @@ class Protocol
         /// functions to check incoming data easily
         bool checkDataSizeAndToken(Event* event, int minimum_size);
         bool isByteCorrect(Event* event, int byte_nb, int value);
-        void sendMessageToPeersChangingToken(NetworkString prefix, NetworkString message);
+        void sendMessageToPeersChangingToken(const std::vector<STKPeer*>& peers,
+                                             NetworkString prefix,
+                                             NetworkString message);
 
 
     protected:
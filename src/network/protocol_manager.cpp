@@ -19,15 +19,22 @@
 #include "network/protocol_manager.hpp"
 
 #include "network/protocol.hpp"
+#include "network/client_network_manager.hpp"
 #include "network/network_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <cstdlib>
 #include <errno.h>
 #include <typeinfo>
 
+/** Maximum time in ms the asynchronous thread waits for events before it
+ *  updates the protocols anyway. */
+#define MAX_ASYNCHRONOUS_WAIT_TIME 20
+
 void* protocolManagerUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
@@ -45,7 +52,8 @@ void* protocolManagerAsynchronousUpdate(void* data)
     while(manager && !manager->exit())
     {
         manager->asynchronousUpdate();
-        StkTime::sleep(2);
+        // Sleep till an event or request arrives
+        manager->waitForWakeUp();
     }
     manager->m_asynchronous_thread_running = false;
     return NULL;
@@ -59,6 +67,9 @@ ProtocolManager::ProtocolManager()
     pthread_mutex_init(&m_requests_mutex, NULL);
     pthread_mutex_init(&m_id_mutex, NULL);
     pthread_mutex_init(&m_exit_mutex, NULL);
+    pthread_mutex_init(&m_wake_up_mutex, NULL);
+    pthread_cond_init(&m_wake_up_cond, NULL);
+    m_wake_up          = false;
     m_next_protocol_id = 0;
 
 
@@ -82,6 +93,7 @@ ProtocolManager::~ProtocolManager()
 void ProtocolManager::abort()
 {
     pthread_mutex_unlock(&m_exit_mutex); // will stop the update function
+    wakeUp();
     pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
     pthread_mutex_lock(&m_events_mutex);
     pthread_mutex_lock(&m_protocols_mutex);
@@ -93,6 +105,8 @@ void ProtocolManager::abort()
     for (unsigned int i = 0; i < m_events_to_process.size() ; i++)
         delete m_events_to_process[i].event;
     m_protocols.clear();
+    for (unsigned int i = 0; i < PROTOCOL_MAX; i++)
+        m_protocols_by_type[i].clear();
     m_requests.clear();
     m_events_to_process.clear();
     pthread_mutex_unlock(&m_events_mutex);
@@ -107,57 +121,71 @@ void ProtocolManager::abort()
     pthread_mutex_destroy(&m_requests_mutex);
     pthread_mutex_destroy(&m_id_mutex);
     pthread_mutex_destroy(&m_exit_mutex);
+    pthread_mutex_destroy(&m_wake_up_mutex);
+    pthread_cond_destroy(&m_wake_up_cond);
 }
 
 void ProtocolManager::notifyEvent(Event* event)
 {
     pthread_mutex_lock(&m_events_mutex);
-    Event* event2 = new Event(*event);
-    // register protocols that will receive this event
-    std::vector<unsigned int> protocols_ids;
     PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
-    if (event2->type == EVENT_TYPE_MESSAGE)
+    if (event->type == EVENT_TYPE_MESSAGE)
     {
-        if (event2->data().size() > 0)
+        if (event->data().size() > 0)
         {
-            searchedProtocol = (PROTOCOL_TYPE)(event2->data()[0]);
-            event2->removeFront(1);
+            searchedProtocol = (PROTOCOL_TYPE)(event->data()[0]);
+            event->removeFront(1);
         }
         else
         {
             Log::warn("ProtocolManager", "Not enough data.");
         }
     }
-    if (event2->type == EVENT_TYPE_CONNECTED)
+    if (event->type == EVENT_TYPE_CONNECTED)
     {
         searchedProtocol = PROTOCOL_CONNECTION;
     }
     Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
+
+    // register protocols that will receive this event
+    m_events_to_process.push_back(EventProcessingInfo());
+    EventProcessingInfo &epi = m_events_to_process.back();
+    std::vector<unsigned int> &protocols_ids = epi.protocols_ids;
     pthread_mutex_lock(&m_protocols_mutex);
-    for (unsigned int i = 0; i < m_protocols.size() ; i++)
+    if (event->type == EVENT_TYPE_DISCONNECTED)
     {
-        if (m_protocols[i].protocol->getProtocolType() == searchedProtocol || event2->type == EVENT_TYPE_DISCONNECTED) // pass data to protocols even when paused
-        {
+        // pass data to all protocols (even when paused)
+        epi.type = PROTOCOL_MAX;
+        for (unsigned int i = 0; i < m_protocols.size() ; i++)
             protocols_ids.push_back(m_protocols[i].id);
-        }
+    }
+    else if (searchedProtocol < PROTOCOL_MAX)
+    {
+        epi.type = searchedProtocol;
+        const std::vector<ProtocolInfo> &protocols =
+                                         m_protocols_by_type[searchedProtocol];
+        for (unsigned int i = 0; i < protocols.size() ; i++)
+            protocols_ids.push_back(protocols[i].id);
     }
     pthread_mutex_unlock(&m_protocols_mutex);
     if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
     {
-        Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event2->data().std_string().c_str());
+        Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event->data().std_string().c_str());
     }
 
     if (protocols_ids.size() != 0)
     {
-        EventProcessingInfo epi;
         epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
-        epi.event = event2;
-        epi.protocols_ids = protocols_ids;
-        m_events_to_process.push_back(epi); // add the event to the queue
+        epi.event = event;
     }
     else
+    {
         Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
+        m_events_to_process.pop_back();
+        delete event;
+    }
     pthread_mutex_unlock(&m_events_mutex);
+    wakeUp();
 }
 
 void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message, bool reliable)
@@ -197,6 +225,7 @@ uint32_t ProtocolManager::requestStart(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    wakeUp();
 
     return info.id;
 }
@@ -213,6 +242,7 @@ void ProtocolManager::requestStop(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    wakeUp();
 }
 
 void ProtocolManager::requestPause(Protocol* protocol)
@@ -227,6 +257,7 @@ void ProtocolManager::requestPause(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    wakeUp();
 }
 
 void ProtocolManager::requestUnpause(Protocol* protocol)
@@ -241,6 +272,7 @@ void ProtocolManager::requestUnpause(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    wakeUp();
 }
 
 void ProtocolManager::requestTerminate(Protocol* protocol)
@@ -264,6 +296,7 @@ void ProtocolManager::requestTerminate(Protocol* protocol)
     }
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    wakeUp();
 }
 
 void ProtocolManager::startProtocol(ProtocolInfo protocol)
@@ -273,6 +306,7 @@ void ProtocolManager::startProtocol(ProtocolInfo protocol)
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
     Log::info("ProtocolManager", "A %s protocol with id=%u has been started. There are %ld protocols running.", typeid(*protocol.protocol).name(), protocol.id, m_protocols.size()+1);
     m_protocols.push_back(protocol);
+    updateProtocolTable();
     // setup the protocol and notify it that it's started
     protocol.protocol->setListener(this);
     protocol.protocol->setup();
@@ -320,43 +354,95 @@ void ProtocolManager::protocolTerminated(ProtocolInfo protocol)
             offset++;
         }
     }
+    updateProtocolTable();
     Log::info("ProtocolManager", "A %s protocol has been terminated. There are %ld protocols running.", protocol_type.c_str(), m_protocols.size());
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
     pthread_mutex_unlock(&m_protocols_mutex);
 }
 
-bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronous)
+void ProtocolManager::updateProtocolTable()
 {
-    int index = 0;
+    for (unsigned int i = 0; i < PROTOCOL_MAX; i++)
+        m_protocols_by_type[i].clear();
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
-        if (event->protocols_ids[index] == m_protocols[i].id)
+        PROTOCOL_TYPE type = m_protocols[i].protocol->getProtocolType();
+        if (type < PROTOCOL_MAX)
+            m_protocols_by_type[type].push_back(m_protocols[i]);
+    }
+}
+
+bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronous)
+{
+    const std::vector<ProtocolInfo> &protocols =
+        event->type < PROTOCOL_MAX ? m_protocols_by_type[event->type]
+                                   : m_protocols;
+    std::vector<unsigned int> &ids = event->protocols_ids;
+    for (unsigned int i = 0; i < ids.size(); )
+    {
+        Protocol *protocol = NULL;
+        for (unsigned int j = 0; j < protocols.size(); j++)
+        {
+            if (protocols[j].id == ids[i])
+            {
+                protocol = protocols[j].protocol;
+                break;
+            }
+        }
+        bool result = false;
+        if (protocol && synchronous)
+            result = protocol->notifyEvent(event->event);
+        else if (protocol)
+            result = protocol->notifyEventAsynchronous(event->event);
+        if (result)
         {
-            bool result = false;
-            if (synchronous)
-                result = m_protocols[i].protocol->notifyEvent(event->event);
-            else
-                result = m_protocols[i].protocol->notifyEventAsynchronous(event->event);
-            if (result)
-                event->protocols_ids.pop_back();
-            else
-                index++;
+            // The order of the remaining protocols does not matter
+            ids[i] = ids.back();
+            ids.pop_back();
         }
+        else
+            i++;
     }
-    if (event->protocols_ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
+    if (ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
     {
-        // because we made a copy of the event
-        delete event->event->peer; // no more need of that
+        // the event is owned by the protocol manager (this also frees
+        // the peer and the packet)
         delete event->event;
         return true;
     }
     return false;
 }
 
+void ProtocolManager::wakeUp()
+{
+    pthread_mutex_lock(&m_wake_up_mutex);
+    m_wake_up = true;
+    pthread_cond_signal(&m_wake_up_cond);
+    pthread_mutex_unlock(&m_wake_up_mutex);
+}
+
+void ProtocolManager::waitForWakeUp()
+{
+    struct timespec timeout;
+    StkTime::getAbsoluteTimeout(MAX_ASYNCHRONOUS_WAIT_TIME, &timeout);
+    pthread_mutex_lock(&m_wake_up_mutex);
+    // The loop is necessary because of spurious wakeups
+    while (!m_wake_up)
+    {
+        if (pthread_cond_timedwait(&m_wake_up_cond, &m_wake_up_mutex,
+                                   &timeout) == ETIMEDOUT)
+            break;
+    }
+    m_wake_up = false;
+    pthread_mutex_unlock(&m_wake_up_mutex);
+}
+
 void ProtocolManager::update()
 {
     // before updating, notice protocols that they have received events
     pthread_mutex_lock(&m_events_mutex); // secure threads
+    // The protocols can be started or terminated by the asynchronous thread
+    pthread_mutex_lock(&m_protocols_mutex);
     int size = (int)m_events_to_process.size();
     int offset = 0;
     for (int i = 0; i < size; i++)
@@ -368,6 +454,7 @@ void ProtocolManager::update()
             offset --;
         }
     }
+    pthread_mutex_unlock(&m_protocols_mutex);
     pthread_mutex_unlock(&m_events_mutex); // release the mutex
     // now update all protocols
     pthread_mutex_lock(&m_protocols_mutex);
@@ -525,3 +612,135 @@ void ProtocolManager::assignProtocolId(ProtocolInfo* protocol_info)
 }
 
 
+
+/** A protocol used in the benchmark, which measures the time between
+ *  receiving a packet and getting it from the protocol manager. */
+class LatencyBenchmarkProtocol : public Protocol
+{
+public:
+    std::atomic<int> m_count;
+    double           m_total_latency;
+    double           m_max_latency;
+
+    LatencyBenchmarkProtocol() : Protocol(NULL, PROTOCOL_SYNCHRONIZATION)
+    {
+        m_count         = 0;
+        m_total_latency = 0;
+        m_max_latency   = 0;
+    }
+    virtual bool notifyEventAsynchronous(Event* event)
+    {
+        double latency = StkTime::getPreciseTime() - event->getReceiveTime();
+        m_total_latency += latency;
+        m_max_latency    = std::max(m_max_latency, latency);
+        m_count.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+    virtual void setup() {}
+    virtual void update() {}
+    virtual void asynchronousUpdate() {}
+};
+
+/** The host and stop flag for the receiving thread of the benchmark. */
+struct BenchmarkReceiver
+{
+    ENetHost         *m_host;
+    std::atomic<bool> m_stop;
+};
+
+/** Receives packets like STKHost::receive_data does. */
+void* benchmarkReceive(void* data)
+{
+    BenchmarkReceiver *receiver = static_cast<BenchmarkReceiver*>(data);
+    ENetEvent event;
+    while (!receiver->m_stop)
+    {
+        while (enet_host_service(receiver->m_host, &event, 20) > 0)
+        {
+            if (event.type == ENET_EVENT_TYPE_NONE)
+                continue;
+            // The network manager takes ownership of the event
+            NetworkManager::getInstance()->notifyEvent(new Event(&event));
+        }
+    }
+    return NULL;
+}
+
+void ProtocolManager::benchmark()
+{
+    const int num_packets = 500;
+    if (enet_initialize() != 0)
+    {
+        Log::error("ProtocolManager", "Could not initialize enet.");
+        return;
+    }
+    ENetAddress address;
+    enet_address_set_host(&address, "127.0.0.1");
+    address.port = 2761;
+    ENetHost *server = enet_host_create(&address, 1, 2, 0, 0);
+    ENetHost *client = enet_host_create(NULL, 1, 2, 0, 0);
+    if (!server || !client)
+    {
+        Log::error("ProtocolManager", "Could not create the loopback hosts.");
+        if (server) enet_host_destroy(server);
+        if (client) enet_host_destroy(client);
+        enet_deinitialize();
+        return;
+    }
+
+    NetworkManager::getInstance<ClientNetworkManager>();
+    ProtocolManager *manager = ProtocolManager::getInstance<ProtocolManager>();
+    LatencyBenchmarkProtocol *protocol = new LatencyBenchmarkProtocol();
+    manager->requestStart(protocol);
+
+    BenchmarkReceiver receiver;
+    receiver.m_host = server;
+    receiver.m_stop = false;
+    pthread_t thread;
+    pthread_create(&thread, NULL, benchmarkReceive, &receiver);
+
+    ENetEvent event;
+    ENetPeer *peer = enet_host_connect(client, &address, 2, 0);
+    if (enet_host_service(client, &event, 1000) > 0 &&
+        event.type == ENET_EVENT_TYPE_CONNECT)
+    {
+        for (int i = 0; i < num_packets; i++)
+        {
+            // The last byte is the string terminator expected by Event
+            uint8_t data[2] = { PROTOCOL_SYNCHRONIZATION, 0 };
+            ENetPacket *packet = enet_packet_create(data, 2,
+                                                   ENET_PACKET_FLAG_RELIABLE);
+            enet_peer_send(peer, 0, packet);
+            enet_host_flush(client);
+            // Give the protocol thread time to become idle again, so that
+            // the latency of waking it up is measured
+            StkTime::sleep(5);
+            while (enet_host_service(client, &event, 0) > 0) {}
+        }
+        double start = StkTime::getPreciseTime();
+        while (protocol->m_count.load(std::memory_order_acquire) < num_packets
+               && StkTime::getPreciseTime() - start < 2.0)
+            StkTime::sleep(10);
+    }
+    else
+        Log::error("ProtocolManager", "Could not connect to the loopback host.");
+
+    receiver.m_stop = true;
+    pthread_join(thread, NULL);
+
+    int count = protocol->m_count.load(std::memory_order_acquire);
+    if (count > 0)
+    {
+        Log::info("ProtocolManager", "%d of %d packets passed to the protocol, "
+                  "latency: average %.3f ms, maximum %.3f ms.", count,
+                  num_packets, protocol->m_total_latency/count*1000.0,
+                  protocol->m_max_latency*1000.0);
+    }
+
+    // This also deletes the protocol
+    manager->abort();
+    NetworkManager::kill();
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    enet_deinitialize();
+}
@@ -87,6 +87,10 @@ typedef struct EventProcessingInfo
 {
     Event* event;
     double arrival_time;
+    /*! Type of the protocols that receive the event, PROTOCOL_MAX if it is
+     *  passed to all protocols (e.g. disconnections). */
+    PROTOCOL_TYPE type;
+    /*! Ids of the protocols that did not process the event yet. */
     std::vector<unsigned int> protocols_ids;
 } EventProcessingInfo;
 
@@ -113,7 +117,7 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         /*!
          * \brief Function that processes incoming events.
          * This function is called by the network manager each time there is an
-         * incoming packet.
+         * incoming packet. The protocol manager takes ownership of the event.
          */
         virtual void            notifyEvent(Event* event);
         /*!
@@ -234,6 +238,10 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         /*! \brief Tells if we need to stop the update thread. */
         int                     exit();
 
+        /*! \brief Measures the time from receiving a packet on a loopback
+         *  connection till it is passed to a protocol. */
+        static void             benchmark();
+
     protected:
         // protected functions
         /*!
@@ -285,6 +293,13 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         virtual void            protocolTerminated(ProtocolInfo protocol);
 
         bool                    propagateEvent(EventProcessingInfo* event, bool synchronous);
+        /*! \brief Rebuilds m_protocols_by_type after a protocol was started
+         *  or terminated. m_protocols_mutex must be locked. */
+        void                    updateProtocolTable();
+        /*! \brief Wakes up the asynchronous update thread. */
+        void                    wakeUp();
+        /*! \brief Waits till the thread is woken up, or a timeout. */
+        void                    waitForWakeUp();
 
         // protected members
         /*!
@@ -293,6 +308,11 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          * state and their unique id.
          */
         std::vector<ProtocolInfo>       m_protocols;
+        /*!
+         * \brief The protocols of each type, so that events can be passed to
+         * their protocols without searching all protocols.
+         */
+        std::vector<ProtocolInfo>       m_protocols_by_type[PROTOCOL_MAX];
         /*!
          * \brief Contains the network events to pass to protocols.
          */
@@ -321,6 +341,12 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         pthread_mutex_t                 m_id_mutex;
         /*! Used when need to quit.*/
         pthread_mutex_t                 m_exit_mutex;
+        /*! Protects m_wake_up. */
+        pthread_mutex_t                 m_wake_up_mutex;
+        /*! Signalled when an event or request arrives. */
+        pthread_cond_t                  m_wake_up_cond;
+        /*! Set if the asynchronous thread has to handle events or requests.*/
+        bool                            m_wake_up;
 
         /*! Update thread.*/
         pthread_t* m_update_thread;
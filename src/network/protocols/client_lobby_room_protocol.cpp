@@ -136,7 +136,7 @@ bool ClientLobbyRoomProtocol::notifyEvent(Event* event)
     assert(m_setup); // assert that the setup exists
     if (event->type == EVENT_TYPE_MESSAGE)
     {
-        NetworkString data = event->data();
+        const NetworkStringView &data = event->data();
         assert(data.size()); // assert that data isn't empty
         uint8_t message_type = data[0];
         if (message_type != 0x03 &&
@@ -162,7 +162,7 @@ bool ClientLobbyRoomProtocol::notifyEventAsynchronous(Event* event)
     assert(m_setup); // assert that the setup exists
     if (event->type == EVENT_TYPE_MESSAGE)
     {
-        NetworkString data = event->data();
+        const NetworkStringView &data = event->data();
         assert(data.size()); // assert that data isn't empty
         uint8_t message_type = data[0];
         if (message_type == 0x03 ||
@@ -285,15 +285,15 @@ void ClientLobbyRoomProtocol::update()
  */
 void ClientLobbyRoomProtocol::newPlayer(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() != 7 || data[0] != 4 || data[5] != 1) // 7 bytes remains now
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a new player wasn't formated as expected.");
         return;
     }
 
-    uint32_t global_id = data.gui32(1);
-    uint8_t race_id = data.gui8(6);
+    uint32_t global_id = data.skip(1).getUInt32();
+    uint8_t race_id = data.skip(1).getUInt8();
 
     if (global_id == PlayerManager::getCurrentOnlineId())
     {
@@ -328,7 +328,7 @@ void ClientLobbyRoomProtocol::newPlayer(Event* event)
  */
 void ClientLobbyRoomProtocol::disconnectedPlayer(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() != 2 || data[0] != 1)
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a new player wasn't formated as expected.");
@@ -359,7 +359,7 @@ void ClientLobbyRoomProtocol::disconnectedPlayer(Event* event)
  */
 void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 12 || data[0] != 1 || data[2] != 4 || data[7] != 4) // 12 bytes remains now
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying an accepted connection wasn't formated as expected.");
@@ -367,7 +367,9 @@ void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
     }
     STKPeer* peer = *(event->peer);
 
-    uint32_t global_id = data.gui32(8);
+    uint8_t my_race_id = data.skip(1).getUInt8();
+    uint32_t token     = data.skip(1).getUInt32();
+    uint32_t global_id = data.skip(1).getUInt32(); // 12 bytes read now
     if (global_id == PlayerManager::getCurrentOnlineId())
     {
         Log::info("ClientLobbyRoomProtocol", "The server accepted the connection.");
@@ -375,14 +377,12 @@ void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
         // self profile
         NetworkPlayerProfile* profile = new NetworkPlayerProfile();
         profile->kart_name = "";
-        profile->race_id = data.gui8(1);
+        profile->race_id = my_race_id;
         profile->user_profile = PlayerManager::getCurrentOnlineProfile();
         m_setup->addPlayer(profile);
         // connection token
-        uint32_t token = data.gui32(3);
         peer->setClientServerToken(token);
         // add all players
-        data.removeFront(12); // remove the 12 first bytes
         int remaining = data.size();
         if (remaining%7 != 0)
         {
@@ -395,7 +395,7 @@ void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
                 Log::error("ClientLobbyRoomProtocol", "Bad format in players list.");
 
             uint8_t race_id = data[1];
-            uint32_t global_id = data.gui32(3);
+            uint32_t global_id = data.skip(3).getUInt32();
             Online::OnlineProfile* new_user = new Online::OnlineProfile(global_id, "");
 
             NetworkPlayerProfile* profile2 = new NetworkPlayerProfile();
@@ -403,7 +403,6 @@ void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
             profile2->user_profile = new_user;
             profile2->kart_name = "";
             m_setup->addPlayer(profile2);
-            data.removeFront(7);
         }
 
         // add self
@@ -428,7 +427,7 @@ void ClientLobbyRoomProtocol::connectionAccepted(Event* event)
  */
 void ClientLobbyRoomProtocol::connectionRefused(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() != 2 || data[0] != 1) // 2 bytes remains now
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a refused connection wasn't formated as expected.");
@@ -463,7 +462,7 @@ void ClientLobbyRoomProtocol::connectionRefused(Event* event)
  */
 void ClientLobbyRoomProtocol::kartSelectionRefused(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() != 2 || data[0] != 1)
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a refused kart selection wasn't formated as expected.");
@@ -498,7 +497,7 @@ void ClientLobbyRoomProtocol::kartSelectionRefused(Event* event)
  */
 void ClientLobbyRoomProtocol::kartSelectionUpdate(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 3 || data[0] != 1)
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a kart selection update wasn't formated as expected.");
@@ -506,7 +505,7 @@ void ClientLobbyRoomProtocol::kartSelectionUpdate(Event* event)
     }
     uint8_t player_id = data[1];
     uint8_t kart_name_length = data[2];
-    std::string kart_name = data.getString(3, kart_name_length);
+    std::string kart_name = data.skip(3).getString(kart_name_length);
     if (kart_name.size() != kart_name_length)
     {
         Log::error("ClientLobbyRoomProtocol", "Kart names sizes differ: told: %d, real: %d.", kart_name_length, kart_name.size());
@@ -534,14 +533,14 @@ void ClientLobbyRoomProtocol::kartSelectionUpdate(Event* event)
  */
 void ClientLobbyRoomProtocol::startGame(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 5 || data[0] != 4)
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a kart "
                    "selection update wasn't formated as expected.");
         return;
     }
-    uint8_t token = data.gui32(1);
+    uint8_t token = data.skip(1).getUInt32();
     if (token == NetworkManager::getInstance()->getPeers()[0]->getClientServerToken())
     {
         m_state = PLAYING;
@@ -567,14 +566,14 @@ void ClientLobbyRoomProtocol::startGame(Event* event)
  */
 void ClientLobbyRoomProtocol::startSelection(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 5 || data[0] != 4)
     {
         Log::error("ClientLobbyRoomProtocol", "A message notifying a kart "
                    "selection update wasn't formated as expected.");
         return;
     }
-    uint8_t token = data.gui32(1);
+    uint8_t token = data.skip(1).getUInt32();
     if (token == NetworkManager::getInstance()->getPeers()[0]->getClientServerToken())
     {
         m_state = KART_SELECTION;
@@ -604,13 +603,12 @@ void ClientLobbyRoomProtocol::raceFinished(Event* event)
         Log::error("ClientLobbyRoomProtocol", "Not enough data provided.");
         return;
     }
-    NetworkString data = event->data();
-    if ((*event->peer)->getClientServerToken() != data.gui32(1))
+    NetworkStringView data = event->data();
+    if ((*event->peer)->getClientServerToken() != data.skip(1).getUInt32())
     {
         Log::error("ClientLobbyRoomProtocol", "Bad token");
         return;
     }
-    data.removeFront(5);
     Log::error("ClientLobbyRoomProtocol", "Server notified that the race is finished.");
 
     // stop race protocols
@@ -653,7 +651,7 @@ void ClientLobbyRoomProtocol::raceFinished(Event* event)
         uint8_t kart_id = data[1];
         ranked_world->setKartPosition(kart_id,position);
         Log::info("ClientLobbyRoomProtocol", "Kart %d has finished #%d", kart_id, position);
-        data.removeFront(2);
+        data.skip(2);
         position++;
     }
     ranked_world->endSetKartPositions();
@@ -675,7 +673,7 @@ void ClientLobbyRoomProtocol::raceFinished(Event* event)
  */
 void ClientLobbyRoomProtocol::playerMajorVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -698,7 +696,7 @@ void ClientLobbyRoomProtocol::playerMajorVote(Event* event)
  */
 void ClientLobbyRoomProtocol::playerRaceCountVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -721,7 +719,7 @@ void ClientLobbyRoomProtocol::playerRaceCountVote(Event* event)
  */
 void ClientLobbyRoomProtocol::playerMinorVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -744,16 +742,18 @@ void ClientLobbyRoomProtocol::playerMinorVote(Event* event)
  */
 void ClientLobbyRoomProtocol::playerTrackVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 10))
         return;
     if (!isByteCorrect(event, 5, 1))
         return;
+    uint8_t player_id = data[6];
     int N = data[7];
-    std::string track_name = data.gs(8, N);
+    std::string track_name = data.skip(8).getString(N);
     if (!isByteCorrect(event, N+8, 1))
         return;
-    m_setup->getRaceConfig()->setPlayerTrackVote(data[6], track_name, data[N+9]);
+    // data[1] is the byte after the track name and the separator
+    m_setup->getRaceConfig()->setPlayerTrackVote(player_id, track_name, data[1]);
 }
 //-----------------------------------------------------------------------------
 
@@ -769,7 +769,7 @@ void ClientLobbyRoomProtocol::playerTrackVote(Event* event)
  */
 void ClientLobbyRoomProtocol::playerReversedVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 11))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -794,7 +794,7 @@ void ClientLobbyRoomProtocol::playerReversedVote(Event* event)
  */
 void ClientLobbyRoomProtocol::playerLapsVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -25,7 +25,7 @@ void ControllerEventsProtocol::setup()
 {
     m_self_controller_index = 0;
     std::vector<AbstractKart*> karts = World::getWorld()->getKarts();
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getRacePeers();
     for (unsigned int i = 0; i < karts.size(); i++)
     {
         if (karts[i]->getIdent() == NetworkWorld::getInstance()->m_self_kart)
@@ -63,31 +63,31 @@ void ControllerEventsProtocol::setup()
 
 bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 17)
     {
         Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", data.size());
         return true;
     }
-    uint32_t token = data.gui32();
-    NetworkString pure_message = data;
-    pure_message.removeFront(4);
+    uint32_t token = data.getUInt32();
+    const NetworkStringView pure_message = data;
     if (token != (*event->peer)->getClientServerToken())
     {
         Log::error("ControllerEventsProtocol", "Bad token from peer.");
         return true;
     }
-    NetworkString ns = pure_message;
+    NetworkStringView ns = pure_message;
 
-    ns.removeFront(4);
+    ns.skip(4);
     uint8_t client_index = -1;
     while (ns.size() >= 9)
     {
-        uint8_t controller_index = ns.gui8();
+        uint8_t controller_index = ns.getUInt8();
         client_index = controller_index;
-        uint8_t serialized_1 = ns.gui8(1);
-        PlayerAction action  = (PlayerAction)(ns.gui8(4));
-        int action_value = ns.gui32(5);
+        uint8_t serialized_1 = ns.getUInt8();
+        ns.skip(2);
+        PlayerAction action  = (PlayerAction)(ns.getUInt8());
+        int action_value = ns.getUInt32();
 
         KartControl* controls   = m_controllers[controller_index].first->getControls();
         controls->m_brake       = (serialized_1 & 0x40)!=0;
@@ -98,7 +98,6 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
         controls->m_skid        = KartControl::SkidControl(serialized_1 & 0x03);
 
         m_controllers[controller_index].first->action(action, action_value);
-        ns.removeFront(9);
         //Log::info("ControllerEventProtocol", "Registered one action.");
     }
     if (ns.size() > 0 && ns.size() != 9)
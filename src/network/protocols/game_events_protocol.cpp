@@ -21,19 +21,18 @@ bool GameEventsProtocol::notifyEvent(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 5) // for token and type
     {
         Log::warn("GameEventsProtocol", "Too short message.");
         return true;
     }
-    if ( (*event->peer)->getClientServerToken() != data.gui32())
+    if ( (*event->peer)->getClientServerToken() != data.getUInt32())
     {
         Log::warn("GameEventsProtocol", "Bad token.");
         return true;
     }
-    int8_t type = data.gui8(4);
-    data.removeFront(5);
+    int8_t type = data.getUInt8();
     switch (type)
     {
         case 0x01: // item picked
@@ -43,9 +42,9 @@ bool GameEventsProtocol::notifyEvent(Event* event)
                 Log::warn("GameEventsProtocol", "Too short message.");
                 return true;
             }
-            uint32_t item_id = data.gui32();
-            uint8_t powerup_type = data.gui8(4);
-            uint8_t kart_race_id = data.gui8(5);
+            uint32_t item_id = data.getUInt32();
+            uint8_t powerup_type = data.getUInt8();
+            uint8_t kart_race_id = data.getUInt8();
             // now set the kart powerup
             AbstractKart* kart = World::getWorld()->getKart(
                 NetworkManager::getInstance()->getGameSetup()->getProfile(kart_race_id)->world_kart_id);
@@ -76,7 +75,7 @@ void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
     assert(setup);
     const NetworkPlayerProfile* player_profile = setup->getProfile(kart->getIdent()); // use kart name
 
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getRacePeers();
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         NetworkString ns;
@@ -112,7 +112,7 @@ void GetPublicAddress::asynchronousUpdate()
         // time to pick a random stun server
         std::vector<std::string> stun_servers = UserConfigParams::m_stun_servers;
 
-        RandomGenerator random_gen;
+        RandomGenerator random_gen(RandomGenerator::ST_LOCAL);
         int rand_result = random_gen.get((int)stun_servers.size());
         Log::verbose("GetPublicAddress", "Using STUN server %s",
                      stun_servers[rand_result].c_str());
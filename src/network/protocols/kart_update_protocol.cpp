@@ -1,11 +1,20 @@
 #include "network/protocols/kart_update_protocol.hpp"
 
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/event.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "tracks/track.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
 KartUpdateProtocol::KartUpdateProtocol()
     : Protocol(NULL, PROTOCOL_KART_UPDATE)
 {
@@ -22,45 +31,211 @@ KartUpdateProtocol::KartUpdateProtocol()
             m_self_kart_index = i;
         }
     }
+    // Positions are quantized relative to the bounding box of the track
+    const Vec3 *min, *max;
+    World::getWorld()->getTrack()->getAABB(&min, &max);
+    init(*min, *max, m_karts.size());
+}
+
+/** Creates a protocol that is not connected to a world or to the network,
+ *  used by unitTesting. The karts are NULL, and update must not be called.
+ *  \param min, max The bounding box used for quantizing positions.
+ *  \param num_karts Number of karts.
+ */
+KartUpdateProtocol::KartUpdateProtocol(const Vec3 &min, const Vec3 &max,
+                                       unsigned int num_karts)
+    : Protocol(NULL, PROTOCOL_KART_UPDATE)
+{
+    m_karts.resize(num_karts, NULL);
+    m_self_kart_index = 0;
+    init(min, max, num_karts);
+}
+
+/** Initialises the snapshot history and the per kart data. */
+void KartUpdateProtocol::init(const Vec3 &min, const Vec3 &max,
+                              unsigned int num_karts)
+{
+    m_history.resize(HISTORY_SIZE, KartSnapshot(min, max, num_karts));
+    m_kart_state = new KartSnapshot(min, max, num_karts);
+    m_tick               = 0;
+    m_last_received_tick = 0;
+    m_last_kart_tick.resize(num_karts, 0);
+    m_buffers.resize(num_karts);
+    m_num_interpolated = 0;
+    m_num_extrapolated = 0;
+    m_total_latency    = 0;
     pthread_mutex_init(&m_positions_updates_mutex, NULL);
 }
 
 KartUpdateProtocol::~KartUpdateProtocol()
 {
+    if (m_num_interpolated > 0)
+    {
+        Log::info("KartUpdateProtocol", "Average latency of remote karts "
+                  "%f s, %d of %d states extrapolated.",
+                  m_total_latency/m_num_interpolated, m_num_extrapolated,
+                  m_num_interpolated);
+    }
+    delete m_kart_state;
 }
 
+/** Message formats:
+ *  Server to client:
+ *       ------------------------------------------------------
+ *  Size |   4  |       4       |      4     |       N        |
+ *  Data | tick | baseline tick | world time | kart snapshot  |
+ *       ------------------------------------------------------
+ *  The snapshot is delta compressed against the snapshot with the baseline
+ *  tick (which the client has acknowledged), or not compressed if the
+ *  baseline tick is 0.
+ *  Client to server:
+ *       -----------------------------------------------------------------
+ *  Size |      4     |      4      |      4     |    1    |      N     |
+ *  Data | acked tick | client tick | world time | kart id | kart state |
+ *       -----------------------------------------------------------------
+ *  The received states are not applied immediately, they are stored in
+ *  an InterpolationBuffer for each kart and shown with a small delay.
+ */
 bool KartUpdateProtocol::notifyEventAsynchronous(Event* event)
 {
+    if (event->type == EVENT_TYPE_DISCONNECTED && m_listener->isServer())
+    {
+        // Forget the acknowledged snapshot, a new peer could get the same
+        // address and must not be sent deltas against an unknown baseline.
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        m_acked_ticks.erase(*event->peer);
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        return true;
+    }
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString ns = event->data();
-    if (ns.size() < 36)
+    NetworkStringView ns = event->data();
+    if (m_listener->isServer())
+        decodeKartUpdate(&ns, *event->peer);
+    else
+        decodeSnapshot(&ns);
+    return true;
+}
+
+/** Server only: writes the current snapshot for one client, compressed
+ *  against the last snapshot this client has acknowledged.
+ *  \param ns The message to write to.
+ *  \param peer The client the message is sent to.
+ *  \param time The world time.
+ */
+void KartUpdateProtocol::encodeSnapshot(NetworkString *ns, STKPeer *peer,
+                                        float time)
+{
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    uint32_t acked_tick = m_acked_ticks[peer];
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+    const KartSnapshot *baseline = NULL;
+    if (acked_tick > 0 && m_tick - acked_tick < HISTORY_SIZE)
+        baseline = &m_history[acked_tick % HISTORY_SIZE];
+    ns->ai32(m_tick).ai32(baseline ? acked_tick : 0);
+    ns->af(time);
+    m_history[m_tick % HISTORY_SIZE].encode(ns, baseline);
+}
+
+/** Client only: reads a snapshot sent by the server, and adds the states of
+ *  all remote karts to their interpolation buffers.
+ *  \param ns The received message.
+ */
+void KartUpdateProtocol::decodeSnapshot(NetworkStringView *ns)
+{
+    if (ns->size() < 12)
     {
         Log::info("KartUpdateProtocol", "Message too short.");
-        return true;
+        return;
     }
-    ns.removeFront(4);
-    while(ns.size() >= 16)
+    uint32_t tick          = ns->getUInt32();
+    uint32_t baseline_tick = ns->getUInt32();
+    float server_time      = ns->getFloat();
+    // Drop snapshots that are older than the newest one received
+    if (tick <= m_last_received_tick)
+        return;
+    const KartSnapshot *baseline = NULL;
+    if (baseline_tick > 0)
     {
-        uint32_t kart_id = ns.getUInt32(0);
-
-        float a,b,c;
-        a = ns.getFloat(4);
-        b = ns.getFloat(8);
-        c = ns.getFloat(12);
-        float d,e,f,g;
-        d = ns.getFloat(16);
-        e = ns.getFloat(20);
-        f = ns.getFloat(24);
-        g = ns.getFloat(28);
-        pthread_mutex_trylock(&m_positions_updates_mutex);
-        m_next_positions.push_back(Vec3(a,b,c));
-        m_next_quaternions.push_back(btQuaternion(d,e,f,g));
-        m_karts_ids.push_back(kart_id);
-        pthread_mutex_unlock(&m_positions_updates_mutex);
-        ns.removeFront(32);
+        baseline = &m_history[baseline_tick % HISTORY_SIZE];
+        if (baseline->getTick() != baseline_tick)
+        {
+            Log::warn("KartUpdateProtocol", "Unknown baseline %u.", baseline_tick);
+            return;
+        }
     }
-    return true;
+    KartSnapshot &snapshot = m_history[tick % HISTORY_SIZE];
+    if (!snapshot.decode(ns, baseline))
+    {
+        Log::warn("KartUpdateProtocol", "Invalid snapshot %u.", tick);
+        snapshot.setTick(0);
+        return;
+    }
+    snapshot.setTick(tick);
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    m_last_received_tick = tick;
+    const double now = StkTime::getRealTime();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (i == m_self_kart_index)
+            continue;
+        m_buffers[i].add(server_time, now, snapshot.getXYZ(i),
+                         snapshot.getRotation(i));
+    }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+}
+
+/** Client only: writes the state of the local kart (which must be set in
+ *  m_kart_state), together with the tick of the newest snapshot received.
+ *  \param ns The message to write to.
+ *  \param time The world time.
+ */
+void KartUpdateProtocol::encodeKartUpdate(NetworkString *ns, float time)
+{
+    m_tick++;
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    ns->ai32(m_last_received_tick);
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+    ns->ai32(m_tick).af(time);
+    ns->ai8(m_self_kart_index);
+    m_kart_state->encodeKart(ns, m_self_kart_index, NULL);
+}
+
+/** Server only: reads the state of a kart sent by a client, and the
+ *  snapshot this client has acknowledged with it.
+ *  \param ns The received message.
+ *  \param peer The client that sent the message.
+ */
+void KartUpdateProtocol::decodeKartUpdate(NetworkStringView *ns,
+                                          STKPeer *peer)
+{
+    if (ns->size() < 13)
+    {
+        Log::info("KartUpdateProtocol", "Message too short.");
+        return;
+    }
+    uint32_t acked_tick  = ns->getUInt32();
+    uint32_t client_tick = ns->getUInt32();
+    float    client_time = ns->getFloat();
+    uint8_t  kart_id     = ns->getUInt8();
+    if (kart_id >= m_karts.size())
+        return;
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    uint32_t &last_ack = m_acked_ticks[peer];
+    if (acked_tick > last_ack)
+        last_ack = acked_tick;
+    // Ignore updates that are older than one already received
+    if (client_tick > m_last_kart_tick[kart_id])
+    {
+        if (m_kart_state->decodeKart(ns, kart_id, NULL))
+        {
+            m_last_kart_tick[kart_id] = client_tick;
+            m_buffers[kart_id].add(client_time, StkTime::getRealTime(),
+                                   m_kart_state->getXYZ(kart_id),
+                                   m_kart_state->getRotation(kart_id));
+        }
+    }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
 }
 
 void KartUpdateProtocol::setup()
@@ -73,66 +248,251 @@ void KartUpdateProtocol::update()
         return;
     static double time = 0;
     double current_time = StkTime::getRealTime();
-    if (current_time > time + 0.1) // 10 updates per second
+    if (current_time > time + 0.05) // 20 updates per second
     {
         time = current_time;
         if (m_listener->isServer())
         {
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
+            m_tick++;
+            KartSnapshot &snapshot = m_history[m_tick % HISTORY_SIZE];
+            snapshot.setTick(m_tick);
             for (unsigned int i = 0; i < m_karts.size(); i++)
             {
                 AbstractKart* kart = m_karts[i];
-                Vec3 v = kart->getXYZ();
-                btQuaternion quat = kart->getRotation();
-                ns.ai32( kart->getWorldKartId());
-                ns.af(v[0]).af(v[1]).af(v[2]); // add position
-                ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-                Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+                snapshot.setKart(i, kart->getXYZ(), kart->getRotation());
             }
-            m_listener->sendMessage(this, ns, false);
+            // Each client gets the snapshot compressed against the last
+            // snapshot it has acknowledged.
+            const std::vector<STKPeer*> &peers = NetworkManager::getInstance()->getRacePeers();
+            for (unsigned int i = 0; i < peers.size(); i++)
+            {
+                NetworkString ns;
+                encodeSnapshot(&ns, peers[i], World::getWorld()->getTime());
+                m_listener->sendMessage(this, peers[i], ns, false);
+            }
+            Log::verbose("KartUpdateProtocol", "Sending snapshot %u", m_tick);
         }
         else
         {
             AbstractKart* kart = m_karts[m_self_kart_index];
-            Vec3 v = kart->getXYZ();
-            btQuaternion quat = kart->getRotation();
+            m_kart_state->setKart(m_self_kart_index, kart->getXYZ(),
+                                  kart->getRotation());
             NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            ns.ai32( kart->getWorldKartId());
-            ns.af(v[0]).af(v[1]).af(v[2]); // add position
-            ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-            Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+            encodeKartUpdate(&ns, World::getWorld()->getTime());
+            Log::verbose("KartUpdateProtocol", "Sending %d's positions", m_self_kart_index);
             m_listener->sendMessage(this, ns, false);
         }
     }
-    switch(pthread_mutex_trylock(&m_positions_updates_mutex))
+    // Show the remote karts with the configured delay
+    PROFILER_PUSH_CPU_MARKER("KartUpdate interpolation", 0x40, 0x80, 0xFF);
+    const double now   = StkTime::getRealTime();
+    const float  delay = UserConfigParams::m_network_interpolation_delay;
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    for (unsigned int id = 0; id < m_buffers.size(); id++)
     {
-        case 0: /* if we got the lock */
-            while (!m_next_positions.empty())
-            {
-                uint32_t id = m_karts_ids.back();
-                if (id != m_self_kart_index || m_listener->isServer()) // server takes all updates
-                {
-                    Vec3 pos = m_next_positions.back();
-                    btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
-                    transform.setOrigin(pos);
-                    transform.setRotation(m_next_quaternions.back());
-                    m_karts[id]->getBody()->setCenterOfMassTransform(transform);
-                    //m_karts[id]->getBody()->setLinearVelocity(Vec3(0,0,0));
-                    Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f", id, pos[0], pos[1], pos[2]);
-                }
-                m_next_positions.pop_back();
-                m_next_quaternions.pop_back();
-                m_karts_ids.pop_back();
-            }
-            pthread_mutex_unlock(&m_positions_updates_mutex);
-            break;
-        default:
-            break;
+        // The server takes all updates, a client ignores its own kart
+        if (id == m_self_kart_index && !m_listener->isServer())
+            continue;
+        Vec3 xyz;
+        btQuaternion rotation;
+        float latency;
+        bool extrapolated;
+        if (!m_buffers[id].get(now, delay, &xyz, &rotation, &latency,
+                               &extrapolated))
+            continue;
+        m_num_interpolated++;
+        if (extrapolated)
+            m_num_extrapolated++;
+        m_total_latency += latency;
+        btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
+        transform.setOrigin(xyz);
+        transform.setRotation(rotation);
+        m_karts[id]->getBody()->setCenterOfMassTransform(transform);
     }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+    PROFILER_POP_CPU_MARKER();
 }
 
+// ----------------------------------------------------------------------------
+/** Wraps a message of this protocol into a packet the same way
+ *  ProtocolManager::sendMessage and STKPeer::sendPacket do.
+ *  \param message The message to send.
+ *  \return The packet, which must be freed with enet_packet_destroy.
+ */
+static ENetPacket* createPacket(const NetworkString &message)
+{
+    NetworkString packet;
+    packet.ai8(PROTOCOL_KART_UPDATE);
+    packet += message;
+    return enet_packet_create(packet.getBytes(), packet.size() + 1,
+                              ENET_PACKET_FLAG_UNSEQUENCED);
+}   // createPacket
+
+// ----------------------------------------------------------------------------
+/** Returns the message in a received packet the same way Event and
+ *  ProtocolManager::notifyEvent extract it.
+ *  \param packet The received packet.
+ */
+static NetworkStringView receivePacket(const ENetPacket *packet)
+{
+    // The last byte is the string terminator added by the sender.
+    NetworkStringView data(packet->data, (int)packet->dataLength-1);
+    assert(data[0] == PROTOCOL_KART_UPDATE);
+    data.skip(1);
+    return data;
+}   // receivePacket
 
+// ----------------------------------------------------------------------------
+/** A packet on its way through the simulated connection. */
+struct PacketInFlight
+{
+    /** The tick at which the packet arrives. */
+    uint32_t    m_arrival_tick;
+    ENetPacket *m_packet;
+};   // PacketInFlight
 
+// ----------------------------------------------------------------------------
+/** Connects a server and a client protocol over a lossy loopback connection
+ *  (5% packet loss and 75 ms latency in each direction) for one minute.
+ *  Each tick the server sends a snapshot of moving karts, and the client
+ *  sends the state of its kart together with the newest tick received.
+ *  All messages are created and read by the same functions the protocol
+ *  uses, and wrapped into ENet packets the same way. For comparison the
+ *  server also creates the packet of the previous format (time, and for
+ *  each kart its id, position and rotation as floats) every tick.
+ *  \param num_karts Number of karts.
+ *  \param min, max The bounding box of the track.
+ *  \param rate Number of updates per second.
+ *  \param old_bytes On return the number of bytes per second the previous
+ *         format sends to each client.
+ *  \param lost_percent On return the percentage of lost snapshots.
+ *  \return The number of bytes per second sent to each client.
+ */
+float KartUpdateProtocol::simulateConnection(unsigned int num_karts,
+                                             const Vec3 &min, const Vec3 &max,
+                                             int rate, float *old_bytes,
+                                             int *lost_percent)
+{
+    const int seconds = 60;
+    const uint32_t latency = uint32_t(ceilf(0.075f*rate));
+    KartUpdateProtocol server(min, max, num_karts);
+    KartUpdateProtocol client(min, max, num_karts);
+    STKPeer peer;
+    std::vector<PacketInFlight> to_client, to_server;
+    int total_bytes = 0, total_old_bytes = 0, lost = 0;
+
+    for (uint32_t tick = 1; tick <= uint32_t(rate*seconds); tick++)
+    {
+        const float time = tick/float(rate);
 
+        // Simulate karts: most drive around a circle, the last two don't
+        // move (e.g. finished karts).
+        server.m_tick = tick;
+        KartSnapshot &snapshot = server.m_history[tick % HISTORY_SIZE];
+        snapshot.setTick(tick);
+        NetworkString old_message;
+        old_message.af(time);
+        for (unsigned int k = 0; k < num_karts; k++)
+        {
+            float t = k < num_karts-2 ? time : 0;
+            float angle = t*(0.1f + 0.01f*k) + k;
+            Vec3 xyz(50 + 150*cosf(angle), 2 + sinf(3*angle),
+                     -50 + 150*sinf(angle));
+            btQuaternion q(btVector3(0, 1, 0), -angle);
+            snapshot.setKart(k, xyz, q);
+            old_message.ai32(k);
+            old_message.af(xyz[0]).af(xyz[1]).af(xyz[2]);
+            old_message.af(q.x()).af(q.y()).af(q.z()).af(q.w());
+        }
+        ENetPacket *old_packet = createPacket(old_message);
+        total_old_bytes += (int)old_packet->dataLength;
+        enet_packet_destroy(old_packet);
+
+        NetworkString message;
+        server.encodeSnapshot(&message, &peer, time);
+        PacketInFlight p;
+        p.m_arrival_tick = tick + latency;
+        p.m_packet       = createPacket(message);
+        total_bytes += (int)p.m_packet->dataLength;
+        if (rand() % 20 == 0)
+        {
+            enet_packet_destroy(p.m_packet);
+            lost++;
+        }
+        else
+            to_client.push_back(p);
+
+        // The client receives the snapshots that have arrived, and sends
+        // the state of its kart.
+        while (!to_client.empty() && to_client[0].m_arrival_tick <= tick)
+        {
+            NetworkStringView data = receivePacket(to_client[0].m_packet);
+            client.decodeSnapshot(&data);
+            assert(data.size() == 0);
+            const uint32_t received = client.m_last_received_tick;
+            const KartSnapshot &sent =
+                server.m_history[received % HISTORY_SIZE];
+            const KartSnapshot &decoded =
+                client.m_history[received % HISTORY_SIZE];
+            assert(sent.getTick() == received && decoded.getTick() == received);
+            for (unsigned int k = 0; k < num_karts; k++)
+            {
+                assert((decoded.getXYZ(k) - sent.getXYZ(k)).length() < 0.001f);
+                assert(decoded.getRotation(k) == sent.getRotation(k));
+            }
+            enet_packet_destroy(to_client[0].m_packet);
+            to_client.erase(to_client.begin());
+        }
+        client.m_kart_state->setKart(client.m_self_kart_index,
+                                     snapshot.getXYZ(client.m_self_kart_index),
+                                     snapshot.getRotation(client.m_self_kart_index));
+        NetworkString update;
+        client.encodeKartUpdate(&update, time);
+        p.m_arrival_tick = tick + latency;
+        p.m_packet       = createPacket(update);
+        if (rand() % 20 == 0)
+            enet_packet_destroy(p.m_packet);
+        else
+            to_server.push_back(p);
+
+        // The server receives the acknowledgements that have arrived
+        while (!to_server.empty() && to_server[0].m_arrival_tick <= tick)
+        {
+            NetworkStringView data = receivePacket(to_server[0].m_packet);
+            server.decodeKartUpdate(&data, &peer);
+            assert(data.size() == 0);
+            enet_packet_destroy(to_server[0].m_packet);
+            to_server.erase(to_server.begin());
+        }
+    }   // for tick
+
+    for (unsigned int i = 0; i < to_client.size(); i++)
+        enet_packet_destroy(to_client[i].m_packet);
+    for (unsigned int i = 0; i < to_server.size(); i++)
+        enet_packet_destroy(to_server[i].m_packet);
+    *old_bytes    = total_old_bytes / float(seconds);
+    *lost_percent = lost*100/(rate*seconds);
+    return total_bytes / float(seconds);
+}   // simulateConnection
+
+// ----------------------------------------------------------------------------
+/** Compares the bandwidth of the previous full precision kart updates with
+ *  the delta compressed snapshots, both at 10 Hz (the rate of the previous
+ *  format) and at the current rate of 20 Hz.
+ */
+void KartUpdateProtocol::unitTesting()
+{
+    const unsigned int num_karts = 8;
+    const Vec3 min(-200, -10, -300), max(300, 40, 200);
+    const int rates[] = { 10, 20 };
+    for (unsigned int i = 0; i < sizeof(rates)/sizeof(rates[0]); i++)
+    {
+        float old_bytes;
+        int lost_percent;
+        const float bytes = simulateConnection(num_karts, min, max, rates[i],
+                                               &old_bytes, &lost_percent);
+        Log::info("KartUpdateProtocol", "%d Hz: old format %.1f, snapshots "
+                  "%.1f bytes/kart/s (%d%% lost packets).", rates[i],
+                  old_bytes/num_karts, bytes/num_karts, lost_percent);
+    }
+}   // unitTesting
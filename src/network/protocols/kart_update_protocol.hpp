@@ -1,12 +1,16 @@
 #ifndef KART_UPDATE_PROTOCOL_HPP
 #define KART_UPDATE_PROTOCOL_HPP
 
+#include "network/interpolation_buffer.hpp"
+#include "network/kart_snapshot.hpp"
 #include "network/protocol.hpp"
 #include "utils/vec3.hpp"
 #include "LinearMath/btQuaternion.h"
-#include <list>
+#include <map>
+#include <vector>
 
 class AbstractKart;
+class STKPeer;
 
 class KartUpdateProtocol : public Protocol
 {
@@ -19,15 +23,62 @@ class KartUpdateProtocol : public Protocol
         virtual void update();
         virtual void asynchronousUpdate() {};
 
+        static void unitTesting();
+
     protected:
+        /** Number of snapshots that are kept to be used as baseline for
+         *  the delta compression. */
+        static const unsigned int HISTORY_SIZE = 32;
+
         std::vector<AbstractKart*> m_karts;
         uint32_t m_self_kart_index;
 
-        std::list<Vec3> m_next_positions;
-        std::list<btQuaternion> m_next_quaternions;
-        std::list<uint32_t> m_karts_ids;
+        /** On the server the last sent snapshots, on a client the last
+         *  received snapshots, indexed by tick % HISTORY_SIZE. */
+        std::vector<KartSnapshot> m_history;
+
+        /** Used to encode (client) or decode (server) the state of a single
+         *  kart. */
+        KartSnapshot *m_kart_state;
+
+        /** On the server the tick of the last sent snapshot, on a client
+         *  the tick of the last update sent to the server. */
+        uint32_t m_tick;
+
+        /** Client only: tick of the newest snapshot received. Older
+         *  snapshots are dropped. */
+        uint32_t m_last_received_tick;
+
+        /** Server only: the newest snapshot each client has acknowledged. */
+        std::map<STKPeer*, uint32_t> m_acked_ticks;
+
+        /** Server only: tick of the newest update received for each kart. */
+        std::vector<uint32_t> m_last_kart_tick;
+
+        /** The received states of each kart, from which the shown state
+         *  is interpolated. */
+        std::vector<InterpolationBuffer> m_buffers;
+
+        /** Statistics: number of interpolated kart states, how many of
+         *  them had to be extrapolated, and the sum of their latencies. */
+        int    m_num_interpolated;
+        int    m_num_extrapolated;
+        double m_total_latency;
 
         pthread_mutex_t m_positions_updates_mutex;
+
+    private:
+        KartUpdateProtocol(const Vec3 &min, const Vec3 &max,
+                           unsigned int num_karts);
+        void init(const Vec3 &min, const Vec3 &max, unsigned int num_karts);
+        void encodeSnapshot(NetworkString *ns, STKPeer *peer, float time);
+        void decodeSnapshot(NetworkStringView *ns);
+        void encodeKartUpdate(NetworkString *ns, float time);
+        void decodeKartUpdate(NetworkStringView *ns, STKPeer *peer);
+        static float simulateConnection(unsigned int num_karts,
+                                        const Vec3 &min, const Vec3 &max,
+                                        int rate, float *old_bytes,
+                                        int *lost_percent);
 };
 
 #endif // KART_UPDATE_PROTOCOL_HPP
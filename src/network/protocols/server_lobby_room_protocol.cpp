@@ -35,29 +35,47 @@
 #include "utils/time.hpp"
 
 
-ServerLobbyRoomProtocol::ServerLobbyRoomProtocol() : LobbyRoomProtocol(NULL)
+/** Creates the lobby of one room of the server.
+ *  \param room_id The id of the room. Room 0 also publishes the address of
+ *         the server and polls the connection requests.
+ */
+ServerLobbyRoomProtocol::ServerLobbyRoomProtocol(uint8_t room_id)
+                       : LobbyRoomProtocol(NULL)
 {
+    m_room_id = room_id;
 }
 
 //-----------------------------------------------------------------------------
 
 ServerLobbyRoomProtocol::~ServerLobbyRoomProtocol()
 {
+    // Make sure that the room does not block the races of the other rooms
+    // (the network manager can already be deleted when the server exits).
+    if (NetworkManager::getInstance())
+        ServerNetworkManager::getInstance()->removeRoom(m_room_id);
+    if (m_setup)
+        delete m_setup;
 }
 
 //-----------------------------------------------------------------------------
 
 void ServerLobbyRoomProtocol::setup()
 {
-    m_setup = NetworkManager::getInstance()->setupNewGame(); // create a new setup
+    // each room has its own setup, the network manager only knows the
+    // setup of the room that is racing
+    m_setup = new GameSetup();
     m_setup->getRaceConfig()->setPlayerCount(16); //FIXME : this has to be moved to when logging into the server
     m_next_id = 0;
-    m_state = NONE;
+    // the server only needs to be started once
+    m_state = m_room_id == 0 ? NONE : WORKING;
     m_public_address.ip = 0;
     m_public_address.port = 0;
     m_selection_enabled = false;
     m_in_race = false;
-    Log::info("ServerLobbyRoomProtocol", "Starting the protocol.");
+    m_start_requested = false;
+    m_stop_race = false;
+    Log::info("ServerLobbyRoomProtocol", "Starting the protocol for room %d.",
+              m_room_id);
 }
 
 //-----------------------------------------------------------------------------
@@ -65,9 +83,17 @@ void ServerLobbyRoomProtocol::setup()
 bool ServerLobbyRoomProtocol::notifyEventAsynchronous(Event* event)
 {
     assert(m_setup); // assert that the setup exists
+    // a peer joins a room with its connection request
+    if (event->type == EVENT_TYPE_MESSAGE && event->data().size() > 0 &&
+        event->data()[0] == 0x01)
+    {
+        ServerNetworkManager::getInstance()->joinRoom(*(event->peer));
+    }
+    if (!isInRoom(*(event->peer)))
+        return true; // the event belongs to another room
     if (event->type == EVENT_TYPE_MESSAGE)
     {
-        NetworkString data = event->data();
+        const NetworkStringView &data = event->data();
         assert(data.size()); // message not empty
         uint8_t message_type;
         message_type = data[0];
@@ -128,13 +154,20 @@ void ServerLobbyRoomProtocol::update()
         break;
     case WORKING:
     {
-        checkIncomingConnectionRequests();
+        if (m_room_id == 0)
+            checkIncomingConnectionRequests();
+        if (m_stop_race)
+            stopRace();
+        else if (m_start_requested)
+            startGame();
         if (m_in_race && World::getWorld() && NetworkWorld::getInstance<NetworkWorld>()->isRunning())
             checkRaceFinished();
 
         break;
     }
     case DONE:
+        if (m_in_race)
+            stopRace();
         m_state = EXITING;
         m_listener->requestTerminate(this);
         break;
@@ -145,9 +178,24 @@ void ServerLobbyRoomProtocol::update()
 
 //-----------------------------------------------------------------------------
 
+/** Starts the race of this room. If another room is racing, the start is
+ *  queued, and it is tried again in each update until the room can race.
+ */
 void ServerLobbyRoomProtocol::startGame()
 {
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    if (m_in_race)
+        return;
+    if (!ServerNetworkManager::getInstance()->startRace(m_room_id, m_setup))
+    {
+        if (!m_start_requested)
+            Log::info("ServerLobbyRoomProtocol", "Room %d waits until the "
+                      "race of another room is finished.", m_room_id);
+        m_start_requested = true;
+        return;
+    }
+    m_start_requested = false;
+    std::vector<STKPeer*> peers =
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id);
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         NetworkString ns;
@@ -162,7 +210,8 @@ void ServerLobbyRoomProtocol::startGame()
 
 void ServerLobbyRoomProtocol::startSelection()
 {
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    std::vector<STKPeer*> peers =
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id);
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         NetworkString ns;
@@ -254,7 +303,8 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
             }
         }
 
-        std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+        std::vector<STKPeer*> peers =
+            ServerNetworkManager::getInstance()->getRoomPeers(m_room_id);
 
         NetworkString queue;
         for (unsigned int i = 0; i < karts_results.size(); i++)
@@ -270,39 +320,47 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
             m_listener->sendMessage(this, peers[i], total, true);
         }
         Log::info("ServerLobbyRoomProtocol", "End of game message sent");
-        m_in_race = false;
-
-        // stop race protocols
-        Protocol* protocol = NULL;
-        protocol = m_listener->getProtocol(PROTOCOL_CONTROLLER_EVENTS);
-        if (protocol)
-            m_listener->requestTerminate(protocol);
-        else
-            Log::error("ClientLobbyRoomProtocol", "No controller events protocol registered.");
+        stopRace();
+    }
+    else
+    {
+        //Log::info("ServerLobbyRoomProtocol", "Phase is %d", World::getWorld()->getPhase());
+    }
+}
 
-        protocol = m_listener->getProtocol(PROTOCOL_KART_UPDATE);
-        if (protocol)
-            m_listener->requestTerminate(protocol);
-        else
-            Log::error("ClientLobbyRoomProtocol", "No kart update protocol registered.");
+//-----------------------------------------------------------------------------
+/** Stops the race protocols and exits the race of this room (if it has
+ *  started already), so that another room can race. Must be called from the
+ *  main thread.
+ */
+void ServerLobbyRoomProtocol::stopRace()
+{
+    m_in_race   = false;
+    m_stop_race = false;
 
-        protocol = m_listener->getProtocol(PROTOCOL_GAME_EVENTS);
+    // stop race protocols
+    const PROTOCOL_TYPE race_protocols[] =
+    {
+        PROTOCOL_START_GAME, PROTOCOL_SYNCHRONIZATION,
+        PROTOCOL_CONTROLLER_EVENTS, PROTOCOL_KART_UPDATE, PROTOCOL_GAME_EVENTS
+    };
+    for (unsigned int i = 0; i < sizeof(race_protocols)/sizeof(PROTOCOL_TYPE);
+         i++)
+    {
+        Protocol* protocol = m_listener->getProtocol(race_protocols[i]);
         if (protocol)
             m_listener->requestTerminate(protocol);
-        else
-            Log::error("ClientLobbyRoomProtocol", "No game events protocol registered.");
+    }
 
-        // notify the network world that it is stopped
+    // notify the network world that it is stopped
+    if (NetworkWorld::getInstance()->isRunning())
         NetworkWorld::getInstance()->stop();
-        // exit the race now
+    // exit the race now
+    if (World::getWorld())
         race_manager->exitRace();
-        race_manager->setAIKartOverride("");
-    }
-    else
-    {
-        //Log::info("ServerLobbyRoomProtocol", "Phase is %d", World::getWorld()->getPhase());
-    }
-}
+    race_manager->setAIKartOverride("");
+    ServerNetworkManager::getInstance()->raceFinished(m_room_id);
+}   // stopRace
 
 //-----------------------------------------------------------------------------
 
@@ -313,14 +371,32 @@ void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
     {
         NetworkString msg;
         msg.ai8(0x02).ai8(1).ai8(peer->getPlayerProfile()->race_id);
-        m_listener->sendMessage(this, msg);
+        sendMessageToRoom(msg, peer);
         Log::info("ServerLobbyRoomProtocol", "Player disconnected : id %d",
                   peer->getPlayerProfile()->race_id);
         m_setup->removePlayer(peer->getPlayerProfile()->race_id);
+        ServerNetworkManager::getInstance()->leaveRoom(peer);
         NetworkManager::getInstance()->removePeer(peer);
     }
     else
+    {
         Log::info("ServerLobbyRoomProtocol", "The DC peer wasn't registered.");
+        ServerNetworkManager::getInstance()->leaveRoom(peer);
+    }
+
+    // If the room is empty now, it must not block the races of other rooms.
+    // The queued start is cancelled here, a running race is stopped in the
+    // next update on the main thread.
+    if (ServerNetworkManager::getInstance()->getNumRoomPlayers(m_room_id) == 0)
+    {
+        if (m_start_requested)
+        {
+            m_start_requested = false;
+            ServerNetworkManager::getInstance()->raceFinished(m_room_id);
+        }
+        if (m_in_race)
+            m_stop_race = true;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -338,17 +414,16 @@ void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
 void ServerLobbyRoomProtocol::connectionRequested(Event* event)
 {
     STKPeer* peer = *(event->peer);
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() != 5 || data[0] != 4)
     {
         Log::warn("ServerLobbyRoomProtocol", "Receiving badly formated message. Size is %d and first byte %d", data.size(), data[0]);
         return;
     }
     uint32_t player_id = 0;
-    player_id = data.getUInt32(1);
-    // can we add the player ?
-    if (m_setup->getPlayerCount() <
-        ServerNetworkManager::getInstance()->getMaxPlayers()) //accept
+    player_id = data.skip(1).getUInt32();
+    // can we add the player ? (it only joins a room with a free place)
+    if (peer->getRoomId() == m_room_id) //accept
     {
         // add the player to the game setup
         m_next_id = m_setup->getPlayerCount();
@@ -356,10 +431,10 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
         NetworkString message;
         // new player (1) -- size of id -- id -- size of local id -- local id;
         message.ai8(1).ai8(4).ai32(player_id).ai8(1).ai8(m_next_id);
-        m_listener->sendMessageExcept(this, peer, message);
+        sendMessageToRoom(message, peer);
 
         /// now answer to the peer that just connected
-        RandomGenerator token_generator;
+        RandomGenerator token_generator(RandomGenerator::ST_LOCAL);
         // use 4 random numbers because rand_max is probably 2^15-1.
         uint32_t token = (uint32_t)(((token_generator.get(RAND_MAX)<<24) & 0xff) +
                                     ((token_generator.get(RAND_MAX)<<16) & 0xff) +
@@ -416,13 +491,13 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
  */
 void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 6))
         return;
 
-    uint8_t kart_name_size = data.gui8(5);
-    std::string kart_name = data.gs(6, kart_name_size);
+    uint8_t kart_name_size = data.skip(5).getUInt8();
+    std::string kart_name = data.getString(kart_name_size);
     if (kart_name.size() != kart_name_size)
     {
         Log::error("ServerLobbyRoomProtocol", "Kart names sizes differ: told:"
@@ -459,7 +534,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
     answer.ai8(0x03).ai8(1).ai8(peer->getPlayerProfile()->race_id);
     //  kart name size, kart name
     answer.ai8(kart_name.size()).as(kart_name);
-    m_listener->sendMessage(this, answer);
+    sendMessageToRoom(answer);
     m_setup->setPlayerKart(peer->getPlayerProfile()->race_id, kart_name);
 }
 
@@ -477,7 +552,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
  */
 void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 7))
         return;
@@ -488,11 +563,13 @@ void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc0); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -508,7 +585,7 @@ void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
  */
 void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 7))
         return;
@@ -519,11 +596,13 @@ void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc1); // prefix the token with the type
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -539,7 +618,7 @@ void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
  */
 void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 7))
         return;
@@ -550,11 +629,13 @@ void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc2); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -570,12 +651,12 @@ void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
  */
 void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 8))
         return;
     int N = data[5];
-    std::string track_name = data.gs(5, N);
+    std::string track_name = NetworkStringView(data).skip(5).getString(N);
     if (!isByteCorrect(event, N+6, 1))
         return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
@@ -583,11 +664,13 @@ void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc3); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -603,7 +686,7 @@ void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
  */
 void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 9))
         return;
@@ -616,11 +699,13 @@ void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc4); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -636,7 +721,7 @@ void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
  */
 void ServerLobbyRoomProtocol::playerLapsVote(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 9))
         return;
@@ -649,10 +734,43 @@ void ServerLobbyRoomProtocol::playerLapsVote(Event* event)
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
-    data.removeFront(5); // remove the token
+    data.skip(5); // remove the token
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc5); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToPeersChangingToken(
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id),
+        prefix, other);
 }
 //-----------------------------------------------------------------------------
+
+/** Returns if a peer belongs to this room. Peers that could not join any
+ *  room are handled by the first room, which refuses their connection.
+ *  \param peer The peer to check.
+ */
+bool ServerLobbyRoomProtocol::isInRoom(STKPeer* peer)
+{
+    if (peer->getRoomId() == STKPeer::NO_ROOM)
+        return m_room_id == 0;
+    return peer->getRoomId() == m_room_id;
+}   // isInRoom
+
+//-----------------------------------------------------------------------------
+
+/** Sends a message to all peers of this room.
+ *  \param message The message to send.
+ *  \param except A peer which does not get the message, or NULL.
+ */
+void ServerLobbyRoomProtocol::sendMessageToRoom(const NetworkString& message,
+                                                STKPeer* except)
+{
+    std::vector<STKPeer*> peers =
+        ServerNetworkManager::getInstance()->getRoomPeers(m_room_id);
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        if (!except || !peers[i]->isSamePeer(except))
+            m_listener->sendMessage(this, peers[i], message);
+    }
+}   // sendMessageToRoom
+
+//-----------------------------------------------------------------------------
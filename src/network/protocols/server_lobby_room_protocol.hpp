@@ -6,7 +6,7 @@
 class ServerLobbyRoomProtocol : public LobbyRoomProtocol
 {
     public:
-        ServerLobbyRoomProtocol();
+        ServerLobbyRoomProtocol(uint8_t room_id = 0);
         virtual ~ServerLobbyRoomProtocol();
 
         virtual bool notifyEventAsynchronous(Event* event);
@@ -18,6 +18,12 @@ class ServerLobbyRoomProtocol : public LobbyRoomProtocol
         void startSelection();
         void checkIncomingConnectionRequests();
         void checkRaceFinished();
+        void stopRace();
+
+        /** Returns the id of the room of this lobby. */
+        uint8_t getRoomId() const { return m_room_id; }
+        /** Returns the game setup of this room. */
+        GameSetup* getGameSetup() { return m_setup; }
 
     protected:
         // connection management
@@ -32,7 +38,12 @@ class ServerLobbyRoomProtocol : public LobbyRoomProtocol
         void playerTrackVote(Event* event);
         void playerReversedVote(Event* event);
         void playerLapsVote(Event* event);
+        // room management
+        bool isInRoom(STKPeer* peer);
+        void sendMessageToRoom(const NetworkString& message,
+                               STKPeer* except = NULL);
 
+        uint8_t m_room_id; //!< Id of the room this lobby belongs to.
         uint8_t m_next_id; //!< Next id to assign to a peer.
         std::vector<TransportAddress> m_peers;
         std::vector<uint32_t> m_incoming_peers_ids;
@@ -40,6 +51,12 @@ class ServerLobbyRoomProtocol : public LobbyRoomProtocol
         TransportAddress m_public_address;
         bool m_selection_enabled;
         bool m_in_race;
+        /** True if the room wants to start a race, but has to wait until
+         *  the race of another room is finished. */
+        bool m_start_requested;
+        /** Set if all peers left the room during the race. The race is
+         *  then stopped in the next update. */
+        bool m_stop_race;
 
         enum STATE
         {
@@ -36,14 +36,14 @@ StartGameProtocol::~StartGameProtocol()
 
 bool StartGameProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
+    NetworkStringView data = event->data();
     if (data.size() < 5)
     {
         Log::error("StartGameProtocol", "Too short message.");
         return true;
     }
-    uint32_t token = data.gui32();
-    uint8_t ready = data.gui8(4);
+    uint32_t token = data.getUInt32();
+    uint8_t ready = data.getUInt8();
     STKPeer* peer = (*(event->peer));
     if (peer->getClientServerToken() != token)
     {
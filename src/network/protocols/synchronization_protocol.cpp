@@ -35,18 +35,19 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString data = event->data();
+    const NetworkStringView &data = event->data();
     if (data.size() < 10)
     {
         Log::warn("SynchronizationProtocol", "Received a message too short.");
         return true;
     }
-    uint8_t talk_id = data.gui8();
-    uint32_t token = data.gui32(1);
-    uint32_t request = data.gui8(5);
-    uint32_t sequence = data.gui32(6);
+    NetworkStringView ns = data;
+    uint8_t talk_id = ns.getUInt8();
+    uint32_t token = ns.getUInt32();
+    uint32_t request = ns.getUInt8();
+    uint32_t sequence = ns.getUInt32();
 
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    const std::vector<STKPeer*> &peers = NetworkManager::getInstance()->getRacePeers();
 
     if (m_listener->isServer())
     {
@@ -74,12 +75,12 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
     if (request)
     {
         NetworkString response;
-        response.ai8(data.gui8(talk_id)).ai32(token).ai8(0).ai32(sequence);
+        response.ai8(data[talk_id]).ai32(token).ai8(0).ai32(sequence);
         m_listener->sendMessage(this, peers[peer_id], response, false);
         Log::verbose("SynchronizationProtocol", "Answering sequence %u", sequence);
         if (data.size() == 14 && !m_listener->isServer()) // countdown time in the message
         {
-            uint32_t time_to_start = data.gui32(10);
+            uint32_t time_to_start = ns.getUInt32();
             Log::debug("SynchronizationProtocol", "Request to start game in %d.", time_to_start);
             if (!m_countdown_activated)
                 startCountdown(time_to_start);
@@ -151,7 +152,7 @@ void SynchronizationProtocol::asynchronousUpdate()
     }
     if (current_time > timer+0.1)
     {
-        std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+        std::vector<STKPeer*> peers = NetworkManager::getInstance()->getRacePeers();
         for (unsigned int i = 0; i < peers.size(); i++)
         {
             NetworkString ns;
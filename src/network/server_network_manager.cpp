@@ -30,6 +30,7 @@
 #include "utils/time.hpp"
 
 #include <enet/enet.h>
+#include <algorithm>
 #include <pthread.h>
 #include <iostream>
 #include <string>
@@ -42,6 +43,16 @@ void* waitInput2(void* data)
     while(!stop)
     {
         getline(std::cin, str);
+        // Room commands can be followed by the number of the room
+        uint8_t room_id = 0;
+        std::string::size_type space = str.find(' ');
+        if (space != std::string::npos)
+        {
+            room_id = (uint8_t)atoi(str.substr(space+1).c_str());
+            str = str.substr(0, space);
+        }
+        ServerLobbyRoomProtocol* room =
+            ServerNetworkManager::getInstance()->getRoom(room_id);
         if (str == "quit")
         {
             stop = true;
@@ -50,27 +61,25 @@ void* waitInput2(void* data)
         {
             ServerNetworkManager::getInstance()->kickAllPlayers();
         }
+        else if (!room)
+        {
+            Log::warn("ServerNetworkManager", "There is no room %d.", room_id);
+        }
         else if (str == "start")
         {
-            ServerLobbyRoomProtocol* protocol = static_cast<ServerLobbyRoomProtocol*>(ProtocolManager::getInstance()->getProtocol(PROTOCOL_LOBBY_ROOM));
-            assert(protocol);
-            protocol->startGame();
+            room->startGame();
         }
         else if (str == "selection")
         {
-            ServerLobbyRoomProtocol* protocol = static_cast<ServerLobbyRoomProtocol*>(ProtocolManager::getInstance()->getProtocol(PROTOCOL_LOBBY_ROOM));
-            assert(protocol);
-            protocol->startSelection();
+            room->startSelection();
         }
         else if (str == "compute_race")
         {
-            GameSetup* setup = NetworkManager::getInstance()->getGameSetup();
-            setup->getRaceConfig()->computeRaceMode();
+            room->getGameSetup()->getRaceConfig()->computeRaceMode();
         }
         else if (str == "compute_track")
         {
-            GameSetup* setup = NetworkManager::getInstance()->getGameSetup();
-            setup->getRaceConfig()->computeNextTrack();
+            room->getGameSetup()->getRaceConfig()->computeNextTrack();
         }
     }
 
@@ -89,12 +98,19 @@ ServerNetworkManager::ServerNetworkManager()
 {
     m_localhost = NULL;
     m_thread_keyboard = NULL;
+    m_max_players = 16;
+    m_num_rooms = 1;
+    m_race_room = STKPeer::NO_ROOM;
+    pthread_mutex_init(&m_rooms_mutex, NULL);
 }
 
 ServerNetworkManager::~ServerNetworkManager()
 {
     if (m_thread_keyboard)
         pthread_cancel(*m_thread_keyboard);//, SIGKILL);
+    // The game setups are owned by the rooms
+    m_game_setup = NULL;
+    pthread_mutex_destroy(&m_rooms_mutex);
 }
 
 void ServerNetworkManager::run()
@@ -105,7 +121,10 @@ void ServerNetworkManager::run()
         return;
     }
     m_localhost = new STKHost();
-    m_localhost->setupServer(STKHost::HOST_ANY, 7321, 16, 2, 0, 0);
+    // Each room takes up to m_max_players peers
+    int peer_count = std::min(std::max(1, m_num_rooms*m_max_players),
+                              (int)ENET_PROTOCOL_MAXIMUM_PEER_ID);
+    m_localhost->setupServer(STKHost::HOST_ANY, 7321, peer_count, 2, 0, 0);
     m_localhost->startListening();
 
     Log::info("ServerNetworkManager", "Host initialized.");
@@ -126,7 +145,201 @@ void ServerNetworkManager::kickAllPlayers()
     }
 }
 
+//-----------------------------------------------------------------------------
+/** Starts the lobby protocols of all rooms. All rooms share the host, the
+ *  peers list and the loaded karts and tracks.
+ */
+void ServerNetworkManager::startRooms()
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    for (uint8_t i = 0; i < m_num_rooms; i++)
+    {
+        ServerLobbyRoomProtocol* room = new ServerLobbyRoomProtocol(i);
+        m_rooms.push_back(room);
+        m_room_players.push_back(0);
+    }
+    pthread_mutex_unlock(&m_rooms_mutex);
+    for (unsigned int i = 0; i < m_rooms.size(); i++)
+        ProtocolManager::getInstance()->requestStart(m_rooms[i]);
+    Log::info("ServerNetworkManager", "Hosting %d lobbies, their races are "
+              "run one at a time.", m_num_rooms);
+}   // startRooms
+
+//-----------------------------------------------------------------------------
+/** Returns the lobby protocol of a room, or NULL if the room does not
+ *  exist. */
+ServerLobbyRoomProtocol* ServerNetworkManager::getRoom(uint8_t room_id)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    ServerLobbyRoomProtocol* room = room_id < m_rooms.size() ? m_rooms[room_id]
+                                                             : NULL;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room;
+}   // getRoom
+
+//-----------------------------------------------------------------------------
+/** Called when the lobby protocol of a room is deleted. Releases the race
+ *  if this room was racing or waiting to race, so that other rooms can race.
+ *  \param room_id The room whose lobby is deleted.
+ */
+void ServerNetworkManager::removeRoom(uint8_t room_id)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    if (room_id < m_rooms.size())
+        m_rooms[room_id] = NULL;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    raceFinished(room_id);
+}   // removeRoom
+
+//-----------------------------------------------------------------------------
+/** Puts a peer into the first room that has a free place and is not racing.
+ *  Nothing is done if the peer is already in a room.
+ *  \return False if no room can take the peer.
+ */
+bool ServerNetworkManager::joinRoom(STKPeer* peer)
+{
+    if (peer->getRoomId() != STKPeer::NO_ROOM)
+        return true;
+    pthread_mutex_lock(&m_rooms_mutex);
+    for (uint8_t i = 0; i < m_room_players.size(); i++)
+    {
+        if (m_rooms[i] && i != m_race_room &&
+            m_room_players[i] < m_max_players)
+        {
+            m_room_players[i]++;
+            peer->setRoomId(i);
+            pthread_mutex_unlock(&m_rooms_mutex);
+            Log::info("ServerNetworkManager", "Peer joined room %d.", i);
+            return true;
+        }
+    }
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return false;
+}   // joinRoom
+
+//-----------------------------------------------------------------------------
+/** Removes a peer from its room. */
+void ServerNetworkManager::leaveRoom(STKPeer* peer)
+{
+    uint8_t room_id = peer->getRoomId();
+    if (room_id == STKPeer::NO_ROOM)
+        return;
+    pthread_mutex_lock(&m_rooms_mutex);
+    if (room_id < m_room_players.size() && m_room_players[room_id] > 0)
+        m_room_players[room_id]--;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    peer->setRoomId(STKPeer::NO_ROOM);
+}   // leaveRoom
+
+//-----------------------------------------------------------------------------
+/** Returns the number of peers in a room. */
+uint8_t ServerNetworkManager::getNumRoomPlayers(uint8_t room_id)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    uint8_t count = room_id < m_room_players.size() ? m_room_players[room_id]
+                                                    : 0;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return count;
+}   // getNumRoomPlayers
+
+//-----------------------------------------------------------------------------
+/** Called when a room wants to start a race. Since all race related
+ *  protocols use the World and the game setup of the network manager,
+ *  only one room can race at a time. If the race can not be started, the
+ *  room is added to a queue, and the queued rooms get to race in the order
+ *  of their requests.
+ *  \param room_id The room that starts the race.
+ *  \param setup The game setup of this room.
+ *  \return False if another room is racing or is ahead in the queue. The
+ *          room must try again later.
+ */
+bool ServerNetworkManager::startRace(uint8_t room_id, GameSetup* setup)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    if (m_race_room != room_id &&
+        (m_race_room != STKPeer::NO_ROOM ||
+         (!m_race_queue.empty() && m_race_queue[0] != room_id)))
+    {
+        if (std::find(m_race_queue.begin(), m_race_queue.end(), room_id)
+                                                         == m_race_queue.end())
+            m_race_queue.push_back(room_id);
+        pthread_mutex_unlock(&m_rooms_mutex);
+        return false;
+    }
+    if (!m_race_queue.empty() && m_race_queue[0] == room_id)
+        m_race_queue.erase(m_race_queue.begin());
+    m_race_room  = room_id;
+    m_game_setup = setup;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return true;
+}   // startRace
+
+//-----------------------------------------------------------------------------
+/** Called when the race of a room is over or was cancelled, so that another
+ *  room can race. This also removes the room from the queue of rooms that
+ *  wait to race. */
+void ServerNetworkManager::raceFinished(uint8_t room_id)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    if (m_race_room == room_id)
+    {
+        m_race_room  = STKPeer::NO_ROOM;
+        m_game_setup = NULL;
+    }
+    m_race_queue.erase(std::remove(m_race_queue.begin(), m_race_queue.end(),
+                                   room_id),
+                       m_race_queue.end());
+    pthread_mutex_unlock(&m_rooms_mutex);
+}   // raceFinished
+
+//-----------------------------------------------------------------------------
+/** Returns the room that is racing, or STKPeer::NO_ROOM. */
+uint8_t ServerNetworkManager::getRaceRoom()
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    uint8_t room_id = m_race_room;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room_id;
+}   // getRaceRoom
+
+//-----------------------------------------------------------------------------
+/** Returns all peers in a room. */
+std::vector<STKPeer*> ServerNetworkManager::getRoomPeers(uint8_t room_id) const
+{
+    std::vector<STKPeer*> peers;
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+    {
+        if (m_peers[i]->getRoomId() == room_id)
+            peers.push_back(m_peers[i]);
+    }
+    return peers;
+}   // getRoomPeers
+
+//-----------------------------------------------------------------------------
+/** Returns the peers of the room that is racing. */
+std::vector<STKPeer*> ServerNetworkManager::getRacePeers() const
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    uint8_t room_id = m_race_room;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    if (room_id == STKPeer::NO_ROOM)
+        return m_peers;
+    return getRoomPeers(room_id);
+}   // getRacePeers
+
+//-----------------------------------------------------------------------------
+/** Sends a packet to all peers, or only to the peers of the racing room
+ *  while a race is running. Lobby messages are sent per room by the lobby
+ *  protocols themselves.
+ */
 void ServerNetworkManager::sendPacket(const NetworkString& data, bool reliable)
 {
-    m_localhost->broadcastPacket(data, reliable);
+    if (getRaceRoom() == STKPeer::NO_ROOM)
+    {
+        m_localhost->broadcastPacket(data, reliable);
+        return;
+    }
+    std::vector<STKPeer*> peers = getRacePeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+        peers[i]->sendPacket(data, reliable);
 }
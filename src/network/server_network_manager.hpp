@@ -24,6 +24,10 @@
 
 #include "network/network_manager.hpp"
 
+#include <pthread.h>
+#include <vector>
+
+class ServerLobbyRoomProtocol;
 
 class ServerNetworkManager : public NetworkManager
 {
@@ -39,8 +43,22 @@ class ServerNetworkManager : public NetworkManager
         void setMaxPlayers(uint8_t count) { m_max_players = count; }
         uint8_t getMaxPlayers() {return m_max_players;}
 
+        void setNumRooms(uint8_t count) { m_num_rooms = count; }
+        uint8_t getNumRooms() { return m_num_rooms; }
+
         void kickAllPlayers();
+        void startRooms();
+        ServerLobbyRoomProtocol* getRoom(uint8_t room_id);
+        bool joinRoom(STKPeer* peer);
+        void leaveRoom(STKPeer* peer);
+        void removeRoom(uint8_t room_id);
+        uint8_t getNumRoomPlayers(uint8_t room_id);
+        bool startRace(uint8_t room_id, GameSetup* setup);
+        void raceFinished(uint8_t room_id);
+        uint8_t getRaceRoom();
+        std::vector<STKPeer*> getRoomPeers(uint8_t room_id) const;
 
+        virtual std::vector<STKPeer*> getRacePeers() const;
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
 
         virtual bool isServer()         { return true; }
@@ -50,8 +68,34 @@ class ServerNetworkManager : public NetworkManager
         virtual ~ServerNetworkManager();
 
         pthread_t* m_thread_keyboard;
+
+        /** Maximum number of players in each room. */
         uint8_t m_max_players;
 
+        /** Number of rooms hosted by this server. Each room has its own
+         *  lobby, game setup and players, but all rooms share the World,
+         *  so only one room can race at a time (see m_race_room). */
+        uint8_t m_num_rooms;
+
+        /** The lobby protocol of each room. They are owned by the protocol
+         *  manager. */
+        std::vector<ServerLobbyRoomProtocol*> m_rooms;
+
+        /** Number of players in each room. */
+        std::vector<uint8_t> m_room_players;
+
+        /** The room that is racing, or STKPeer::NO_ROOM. Only one room can
+         *  race at a time, since there is only one World. */
+        uint8_t m_race_room;
+
+        /** The rooms that want to start a race while another room is
+         *  racing, in the order of their requests. */
+        std::vector<uint8_t> m_race_queue;
+
+        /** Protects the room data, which is used by the protocol threads
+         *  and the console thread. */
+        mutable pthread_mutex_t m_rooms_mutex;
+
 };
 
 #endif // SERVER_NETWORK_MANAGER_HPP
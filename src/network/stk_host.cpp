@@ -58,7 +58,7 @@ const char* inet_ntop(int af, const void* src, char* dst, int cnt)
 FILE* STKHost::m_log_file = NULL;
 pthread_mutex_t STKHost::m_log_mutex;
 
-void STKHost::logPacket(const NetworkString &ns, bool incoming)
+void STKHost::logPacket(const NetworkStringView &ns, bool incoming)
 {
     if (m_log_file == NULL)
         return;
@@ -85,12 +85,13 @@ void* STKHost::receive_data(void* self)
     while (!myself->mustStopListening())
     {
         while (enet_host_service(host, &event, 20) != 0) {
+            if (event.type == ENET_EVENT_TYPE_NONE)
+                continue;
             Event* evt = new Event(&event);
             if (evt->type == EVENT_TYPE_MESSAGE)
                 logPacket(evt->data(), true);
-            if (event.type != ENET_EVENT_TYPE_NONE)
-                NetworkManager::getInstance()->notifyEvent(evt);
-            delete evt;
+            // The network manager takes ownership of the event
+            NetworkManager::getInstance()->notifyEvent(evt);
         }
     }
     myself->m_listening = false;
@@ -31,6 +31,8 @@ STKPeer::STKPeer()
     *m_client_server_token = 0;
     m_token_set = new bool;
     *m_token_set = false;
+    m_room_id = new uint8_t;
+    *m_room_id = NO_ROOM;
 }
 
 //-----------------------------------------------------------------------------
@@ -41,6 +43,7 @@ STKPeer::STKPeer(const STKPeer& peer)
     m_player_profile = peer.m_player_profile;
     m_client_server_token = peer.m_client_server_token;
     m_token_set = peer.m_token_set;
+    m_room_id = peer.m_room_id;
 }
 
 //-----------------------------------------------------------------------------
@@ -58,6 +61,9 @@ STKPeer::~STKPeer()
     if (m_token_set)
         delete m_token_set;
     m_token_set = NULL;
+    if (m_room_id)
+        delete m_room_id;
+    m_room_id = NULL;
 }
 
 //-----------------------------------------------------------------------------
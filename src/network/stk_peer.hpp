@@ -36,6 +36,9 @@ class STKPeer
 {
     friend class Event;
     public:
+        /** Room id of a peer that did not join a room (yet). */
+        static const uint8_t NO_ROOM = 0xff;
+
         STKPeer();
         STKPeer(const STKPeer& peer);
         virtual ~STKPeer();
@@ -48,6 +51,7 @@ class STKPeer
         void unsetClientServerToken() { *m_token_set = false; }
         void setPlayerProfile(NetworkPlayerProfile* profile) { *m_player_profile = profile; }
         void setPlayerProfilePtr(NetworkPlayerProfile** profile) { m_player_profile = profile; }
+        void setRoomId(uint8_t room_id) { *m_room_id = room_id; }
 
         bool isConnected() const;
         bool exists() const;
@@ -56,6 +60,8 @@ class STKPeer
         NetworkPlayerProfile* getPlayerProfile() { return (m_player_profile)?(*m_player_profile):NULL; }
         uint32_t getClientServerToken() const   { return *m_client_server_token; }
         bool     isClientServerTokenSet() const { return *m_token_set; }
+        /** Returns the room of a server this peer is in, or NO_ROOM. */
+        uint8_t  getRoomId() const              { return *m_room_id; }
 
         bool isSamePeer(const STKPeer* peer) const;
 
@@ -64,6 +70,7 @@ class STKPeer
         NetworkPlayerProfile** m_player_profile;
         uint32_t *m_client_server_token;
         bool *m_token_set;
+        uint8_t *m_room_id;
 };
 
 #endif // STK_PEER_HPP
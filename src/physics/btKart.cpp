@@ -39,7 +39,7 @@ btRigidBody& btKart::getFixedBody()
 }
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster)
 {
@@ -127,6 +127,7 @@ void btKart::reset()
     m_additional_rotation        = btVector3(0,0,0);
     m_time_additional_rotation   = 0;
     m_visual_rotation            = 0;
+    m_wheel_rays_cast            = false;
 
     // Set the brakes so that karts don't slide downhill
     setAllBrakes(5.0f);
@@ -223,16 +224,9 @@ btScalar btKart::rayCast(unsigned int index)
 
     // Work around a bullet problem: when using a convex hull the raycast
     // would sometimes hit the chassis (which does not happen when using a
-    // box shape). Therefore set the collision mask in the chassis body so
-    // that it is not hit anymore.
-    short int old_group=0;
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        old_group = m_chassisBody->getBroadphaseHandle()
-                                 ->m_collisionFilterGroup;
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
-    }
-
+    // box shape). Therefore the chassis is ignored by the raycasts. This
+    // is not done by changing the collision filter group of the chassis,
+    // since the rays of all karts can be cast in parallel.
     updateWheelTransformsWS( wheel,false);
 
     btScalar max_susp_len = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
@@ -252,7 +246,8 @@ btScalar btKart::rayCast(unsigned int index)
 
     btAssert(m_vehicleRaycaster);
 
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    void* object = m_vehicleRaycaster->castRay(source, target, rayResults,
+                                               m_chassisBody);
 
     wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -340,20 +335,14 @@ btScalar btKart::rayCast(unsigned int index)
         btVector3 target = source + rayvector;
         btVehicleRaycaster::btVehicleRaycasterResult rayResults;
 
-        void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+        void* object = m_vehicleRaycaster->castRay(source, target,
+                                                   rayResults, m_chassisBody);
         m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
         m_visual_contact_point[index-2] = source;
         m_visual_wheels_touch_ground &= (object!=NULL);
     }
 #endif
 
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
-    }
-
-
     return depth;
 
 }   // rayCast
@@ -365,19 +354,18 @@ const btTransform& btKart::getChassisWorldTransform() const
 }   // getChassisWorldTransform
 
 // ----------------------------------------------------------------------------
-void btKart::updateVehicle( btScalar step )
+/** Updates the wheel transforms and casts the rays of all wheels. This
+ *  only changes data of this kart, so it can be called for all karts in
+ *  parallel before they are updated (see STKDynamicsWorld::castWheelRays).
+ *  Otherwise it is called from updateVehicle.
+ */
+void btKart::castWheelRays()
 {
     for (int i=0;i<getNumWheels();i++)
     {
         updateWheelTransform(i,false);
     }
 
-    const btTransform& chassisTrans = getChassisWorldTransform();
-
-    btVector3 forwardW(chassisTrans.getBasis()[0][m_indexForwardAxis],
-                       chassisTrans.getBasis()[1][m_indexForwardAxis],
-                       chassisTrans.getBasis()[2][m_indexForwardAxis]);
-
     // Simulate suspension
     // -------------------
 
@@ -389,6 +377,21 @@ void btKart::updateVehicle( btScalar step )
         if(m_wheelInfo[i].m_raycastInfo.m_isInContact)
             m_num_wheels_on_ground++;
     }
+    m_wheel_rays_cast = true;
+}   // castWheelRays
+
+// ----------------------------------------------------------------------------
+void btKart::updateVehicle( btScalar step )
+{
+    if(!m_wheel_rays_cast)
+        castWheelRays();
+    m_wheel_rays_cast = false;
+
+    const btTransform& chassisTrans = getChassisWorldTransform();
+
+    btVector3 forwardW(chassisTrans.getBasis()[0][m_indexForwardAxis],
+                       chassisTrans.getBasis()[1][m_indexForwardAxis],
+                       chassisTrans.getBasis()[2][m_indexForwardAxis]);
 
     // Test if the kart is falling so fast 
     // that the chassis might hit the track
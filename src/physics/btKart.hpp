@@ -67,7 +67,10 @@ private:
     btScalar calcRollingFriction(btWheelContactPoint& contactPoint);
 
     btScalar            m_damping;
-    btVehicleRaycaster *m_vehicleRaycaster;
+    btKartRaycaster    *m_vehicleRaycaster;
+
+    /** True if castWheelRays was called for the next updateVehicle. */
+    bool                m_wheel_rays_cast;
 
     /** True if a zipper is active for that kart. */
     bool                m_zipper_active;
@@ -147,13 +150,14 @@ public:
      *         (this is used to get access to the kart properties).
      */
                        btKart(btRigidBody* chassis,
-                              btVehicleRaycaster* raycaster,
+                              btKartRaycaster* raycaster,
                               Kart *kart);
      virtual          ~btKart();
     void               reset();
     void               debugDraw(btIDebugDraw* debugDrawer);
     const btTransform& getChassisWorldTransform() const;
     btScalar           rayCast(unsigned int index);
+    void               castWheelRays();
     virtual void       updateVehicle(btScalar step);
     void               resetSuspension();
     btScalar           getSteeringValue(int wheel) const;
@@ -208,6 +212,14 @@ public:
     /** Returns the number of wheels of this vehicle. */
     inline int getNumWheels() const { return int(m_wheelInfo.size());}
     // ------------------------------------------------------------------------
+    /** Returns true if updateVehicle will change the position or rotation
+     *  of the chassis, which can change the result of raycasts of other
+     *  karts that are updated later. */
+    bool changesChassisTransform() const
+    {
+        return m_time_additional_rotation > 0;
+    }   // changesChassisTransform
+    // ------------------------------------------------------------------------
     /** Returns the chassis (rigid) body. */
     inline btRigidBody* getRigidBody() { return m_chassisBody; }
     // ------------------------------------------------------------------------
@@ -21,21 +21,47 @@
 
 void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
                                btVehicleRaycasterResult& result)
+{
+    return castRay(from, to, result, NULL);
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts a ray, ignoring one collision object. This is used to avoid that
+ *  the wheel rays of a kart hit its own chassis. It only reads the physics
+ *  world, so the rays of different karts can be cast in parallel.
+ *  \param ignore The object to ignore (can be NULL).
+ */
+void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
+                               btVehicleRaycasterResult& result,
+                               const btCollisionObject *ignore)
 {
     // ========================================================================
     class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
     {
     private:
         int m_triangle_index;
+        /** An object that is not tested. */
+        const btCollisionObject *m_ignore;
     public:
         /** Constructor, initialises the triangle index. */
         ClosestWithNormal(const btVector3 &from,
-                          const btVector3 &to)
+                          const btVector3 &to,
+                          const btCollisionObject *ignore)
                           : btCollisionWorld::ClosestRayResultCallback(from,to)
         {
             m_triangle_index = -1;
+            m_ignore         = ignore;
         }   // CloestWithNormal
         // --------------------------------------------------------------------
+        /** Skips the ignored object, otherwise uses the collision filter. */
+        virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+        {
+            if(m_ignore && proxy0->m_clientObject == m_ignore)
+                return false;
+            return btCollisionWorld::ClosestRayResultCallback
+                                   ::needsCollision(proxy0);
+        }   // needsCollision
+        // --------------------------------------------------------------------
         /** Stores the index of the triangle hit. */
         virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
                                          bool normalInWorldSpace)
@@ -57,7 +83,7 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
     };   // CloestWithNormal
     // ========================================================================
 
-    ClosestWithNormal rayCallback(from,to);
+    ClosestWithNormal rayCallback(from, to, ignore);
 
     m_dynamicsWorld->rayTest(from, to, rayCallback);
 
@@ -71,11 +97,11 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
             result.m_hitNormalInWorld.normalize();
             result.m_distFraction = rayCallback.m_closestHitFraction;
             result.m_triangle_index = -1;
-            const TriangleMesh &tm =
-                World::getWorld()->getTrack()->getTriangleMesh();
             if(m_smooth_normals &&
                 rayCallback.getTriangleIndex()>-1)
             {
+                const TriangleMesh &tm =
+                    World::getWorld()->getTrack()->getTriangleMesh();
 #undef DEBUG_NORMALS
 #ifdef DEBUG_NORMALS
                 btVector3 n=result.m_hitNormalInWorld;
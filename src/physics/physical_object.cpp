@@ -144,6 +144,12 @@ PhysicalObject::PhysicalObject(bool is_dynamic,
     m_reset_height       = settings.m_reset_height;
     m_on_kart_collision  = settings.m_on_kart_collision;
     m_on_item_collision  = settings.m_on_item_collision;
+    if (m_on_kart_collision.size() > 0)
+        m_on_kart_collision_function.setDeclaration(
+                       "void " + m_on_kart_collision + "(int, const string)");
+    if (m_on_item_collision.size() > 0)
+        m_on_item_collision_function.setDeclaration(
+                  "void " + m_on_item_collision + "(int, int, const string)");
 
     m_init_pos.setIdentity();
     Vec3 radHpr(m_init_hpr);
@@ -154,7 +160,8 @@ PhysicalObject::PhysicalObject(bool is_dynamic,
     Vec3 init_xyz(m_init_xyz);
     m_init_pos.setOrigin(init_xyz);
 
-    m_is_dynamic = is_dynamic;
+    m_is_dynamic   = is_dynamic;
+    m_needs_update = true;
 
     init();
 }   // PhysicalObject
@@ -195,6 +202,7 @@ void PhysicalObject::move(const Vec3& xyz, const core::vector3df& hpr)
 
     btTransform trans(q, xyz-quatRotate(q,m_graphical_offset));
     m_motion_state->setWorldTransform(trans);
+    m_needs_update = true;
 }   // move
 
 // ----------------------------------------------------------------------------
@@ -492,6 +500,10 @@ void PhysicalObject::update(float dt)
 {
     if (!m_is_dynamic) return;
 
+    // A sleeping body does not move, so after this update the graphical
+    // position is correct until the body is activated again.
+    m_needs_update = m_body->isActive();
+
     btTransform t;
     m_motion_state->getWorldTransform(t);
 
@@ -552,6 +564,7 @@ void PhysicalObject::reset()
     m_body->setAngularVelocity(btVector3(0,0,0));
     m_body->setLinearVelocity(btVector3(0,0,0));
     m_body->activate();
+    m_needs_update = true;
 }   // reset
 
 // ----------------------------------------------------------------------------
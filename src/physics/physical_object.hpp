@@ -24,6 +24,7 @@
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
+#include "scriptengine/script_engine.hpp"
 #include "utils/vec3.hpp"
 #include "utils/leak_check.hpp"
 
@@ -156,11 +157,20 @@ private:
     * when a (flyable) item collides with this object
     */
     std::string           m_on_item_collision;
+    /** Handles of the two scripting functions above, so that they are
+     *  only looked up once. */
+    Scripting::ScriptFunction m_on_kart_collision_function;
+    Scripting::ScriptFunction m_on_item_collision_function;
     /** If this body is a bullet dynamic body, i.e. affected by physics
      *  or not (static (not moving) or kinematic (animated outside
      *  of physics). */
     bool                  m_is_dynamic;
 
+    /** True if the graphical position must be updated even if the body is
+     *  not active, i.e. the body went to sleep or was moved since the last
+     *  update. */
+    bool                  m_needs_update;
+
     /** Non-null only if the shape is exact */
     TriangleMesh         *m_triangle_mesh;
 
@@ -192,6 +202,17 @@ public:
     /** Returns the rigid body of this physical object. */
     btRigidBody *getBody        ()          { return m_body; }
     // ------------------------------------------------------------------------
+    /** Returns true if this object is moved by the physics. */
+    bool isDynamic() const { return m_is_dynamic; }
+    // ------------------------------------------------------------------------
+    /** Returns true if update() can change the graphical position, i.e. if
+     *  the object is dynamic and its body is not sleeping (or was not
+     *  sleeping at the last update). */
+    bool needsUpdate() const
+    {
+        return m_is_dynamic && (m_needs_update || m_body->isActive());
+    }   // needsUpdate
+    // ------------------------------------------------------------------------
     /** Returns true if this object should trigger a rescue in a kart that
      *  hits it. */
     bool isCrashReset() const { return m_crash_reset; }
@@ -213,6 +234,20 @@ public:
     // ------------------------------------------------------------------------
     const std::string& getOnItemCollisionFunction() const { return m_on_item_collision; }
     // ------------------------------------------------------------------------
+    /** Returns the handle of the script function to call when a kart
+     *  collides with this object (empty if none is set). */
+    Scripting::ScriptFunction* getOnKartCollisionScript()
+    {
+        return &m_on_kart_collision_function;
+    }   // getOnKartCollisionScript
+    // ------------------------------------------------------------------------
+    /** Returns the handle of the script function to call when an item
+     *  collides with this object (empty if none is set). */
+    Scripting::ScriptFunction* getOnItemCollisionScript()
+    {
+        return &m_on_item_collision_function;
+    }   // getOnItemCollisionScript
+    // ------------------------------------------------------------------------
     // Methods usable by scripts
 
     /**
@@ -22,6 +22,7 @@
 #include "animations/three_d_animation.hpp"
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stars.hpp"
@@ -46,7 +47,9 @@
 /** Initialise physics.
  *  Create the bullet dynamics world.
  */
-Physics::Physics() : btSequentialImpulseConstraintSolver()
+Physics::Physics() : btSequentialImpulseConstraintSolver(),
+                     m_kart_kart_collision_function(
+                                         "void onKartKartCollision(int, int)")
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
@@ -149,9 +152,19 @@ void Physics::update(float dt)
     // of objects.
     m_all_collisions.clear();
 
-    // Maximum of three substeps. This will work for framerate down to
-    // 20 FPS (bullet default frequency is 60 HZ).
-    m_dynamics_world->stepSimulation(dt, 3);
+    if(UserConfigParams::m_fixed_timestep>0)
+    {
+        // With a fixed time step do exactly one step of dt. Bullet's
+        // internal time accumulator stays at 0, so no interpolated motion
+        // states are used, which keeps the simulation deterministic.
+        m_dynamics_world->stepSimulation(dt, 1, dt);
+    }
+    else
+    {
+        // Maximum of three substeps. This will work for framerate down to
+        // 20 FPS (bullet default frequency is 60 HZ).
+        m_dynamics_world->stepSimulation(dt, 3);
+    }
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -171,7 +184,7 @@ void Physics::update(float dt)
             Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
             int kartid1 = p->getUserPointer(0)->getPointerKart()->getWorldKartId();
             int kartid2 = p->getUserPointer(1)->getPointerKart()->getWorldKartId();
-            script_engine->runFunction("void onKartKartCollision(int, int)",
+            script_engine->runFunction(&m_kart_kart_collision_function,
                 [=](asIScriptContext* ctx) {
                     ctx->SetArgDWord(0, kartid1);
                     ctx->SetArgDWord(1, kartid2);
@@ -187,11 +200,10 @@ void Physics::update(float dt)
             AbstractKart *kart = p->getUserPointer(1)->getPointerKart();
             int kartId = kart->getWorldKartId();
             PhysicalObject* obj = p->getUserPointer(0)->getPointerPhysicalObject();
-            std::string obj_id = obj->getID();
-            std::string scripting_function = obj->getOnKartCollisionFunction();
-            if (scripting_function.size() > 0)
+            if (!obj->getOnKartCollisionScript()->isEmpty())
             {
-                script_engine->runFunction("void " + scripting_function + "(int, const string)",
+                std::string obj_id = obj->getID();
+                script_engine->runFunction(obj->getOnKartCollisionScript(),
                     [&](asIScriptContext* ctx) {
                         ctx->SetArgDWord(0, kartId);
                         ctx->SetArgObject(1, &obj_id);
@@ -259,11 +271,10 @@ void Physics::update(float dt)
             Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
             Flyable* flyable = p->getUserPointer(0)->getPointerFlyable();
             PhysicalObject* obj = p->getUserPointer(1)->getPointerPhysicalObject();
-            std::string obj_id = obj->getID();
-            std::string scripting_function = obj->getOnItemCollisionFunction();
-            if (scripting_function.size() > 0)
+            if (!obj->getOnItemCollisionScript()->isEmpty())
             {
-                script_engine->runFunction("void " + scripting_function + "(int, int, const string)",
+                std::string obj_id = obj->getID();
+                script_engine->runFunction(obj->getOnItemCollisionScript(),
                         [&](asIScriptContext* ctx) {
                         ctx->SetArgDWord(0, (int)flyable->getType());
                         ctx->SetArgDWord(1, flyable->getOwnerId());
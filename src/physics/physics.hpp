@@ -32,6 +32,7 @@
 #include "physics/irr_debug_drawer.hpp"
 #include "physics/stk_dynamics_world.hpp"
 #include "physics/user_pointer.hpp"
+#include "scriptengine/script_engine.hpp"
 
 class AbstractKart;
 class STKDynamicsWorld;
@@ -145,6 +146,9 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** The script function called when two karts collide. */
+    Scripting::ScriptFunction        m_kart_kart_collision_function;
+
 public:
           Physics          ();
          ~Physics          ();
@@ -0,0 +1,234 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "physics/stk_dynamics_world.hpp"
+
+#include "physics/btKart.hpp"
+#include "physics/btKartRaycast.hpp"
+#include "utils/log.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/time.hpp"
+
+#include <math.h>
+#include <string.h>
+
+/** Minimum number of karts for which the wheel rays are cast in parallel.
+ *  With fewer karts the overhead of waking up the threads is larger than
+ *  the time saved. */
+static const unsigned int MIN_PARALLEL_KARTS = 4;
+
+// ----------------------------------------------------------------------------
+/** Casts the wheel rays of all karts before any kart is updated. This is
+ *  called from the first action of the world, i.e. after the new transforms
+ *  of all bodies have been integrated. The rays of a kart only depend on
+ *  these transforms, and updating a kart only changes its velocities, so
+ *  the results are identical to casting the rays in each kart's update.
+ *  The only exception is a kart that is rotated by its update (see
+ *  btKart::changesChassisTransform), in which case each kart casts its
+ *  rays in its own update as before.
+ */
+void STKDynamicsWorld::castWheelRays()
+{
+    m_karts.clear();
+    for (int i = 0; i < m_actions.size(); i++)
+    {
+        btKart *kart = dynamic_cast<btKart*>(m_actions[i]);
+        if (!kart)
+            continue;
+        if (kart->changesChassisTransform())
+            return;
+        m_karts.push_back(kart);
+    }
+
+    if (thread_pool && m_karts.size() >= MIN_PARALLEL_KARTS)
+    {
+        thread_pool->run((unsigned int)m_karts.size(), &castWheelRaysTask,
+                         &m_karts);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_karts.size(); i++)
+            m_karts[i]->castWheelRays();
+    }
+}   // castWheelRays
+
+// ----------------------------------------------------------------------------
+/** Thread pool task which casts the wheel rays of one kart.
+ *  \param index Index of the kart.
+ *  \param data Pointer to the vector of karts.
+ */
+void STKDynamicsWorld::castWheelRaysTask(unsigned int index, void *data)
+{
+    std::vector<btKart*> *karts = (std::vector<btKart*>*)data;
+    (*karts)[index]->castWheelRays();
+}   // castWheelRaysTask
+
+// ============================================================================
+namespace BenchmarkRays
+{
+    /** Number of rays per kart, the same as a kart with four wheels casts
+     *  (wheel and visual rays) plus two terrain rays. */
+    const unsigned int RAYS_PER_KART = 6;
+
+    /** The data shared by all benchmark tasks. */
+    struct Data
+    {
+        btKartRaycaster                            *m_raycaster;
+        std::vector<btRigidBody*>                   m_bodies;
+        std::vector<btVehicleRaycaster::btVehicleRaycasterResult> m_results;
+        std::vector<void*>                          m_objects;
+    };   // Data
+
+    // ------------------------------------------------------------------------
+    /** Casts the rays of one kart. */
+    void castRays(unsigned int index, void *d)
+    {
+        Data *data = (Data*)d;
+        const btTransform &t = data->m_bodies[index]->getWorldTransform();
+        for (unsigned int j = 0; j < RAYS_PER_KART; j++)
+        {
+            btVector3 offset(j%2 ? 0.6f : -0.6f, 0, (j/2)*0.8f - 0.8f);
+            btVector3 from = t(offset);
+            btVector3 to   = from - btVector3(0, 5.0f, 0);
+            unsigned int n = index*RAYS_PER_KART + j;
+            data->m_objects[n] =
+                data->m_raycaster->castRay(from, to, data->m_results[n],
+                                           data->m_bodies[index]);
+        }
+    }   // castRays
+}   // namespace BenchmarkRays
+
+// ----------------------------------------------------------------------------
+/** Measures the time to cast the wheel rays of 4 to 64 karts on a bumpy
+ *  triangle mesh, serially and with the thread pool, and checks that both
+ *  give identical results.
+ */
+void STKDynamicsWorld::benchmark()
+{
+    using namespace BenchmarkRays;
+
+    btDefaultCollisionConfiguration config;
+    btCollisionDispatcher dispatcher(&config);
+    btAxisSweep3 broadphase(btVector3(-200, -50, -200),
+                            btVector3( 200,  50,  200));
+    btSequentialImpulseConstraintSolver solver;
+    STKDynamicsWorld world(&dispatcher, &broadphase, &solver, &config);
+
+    // A 200x200 m ground with 1 m triangles and some bumps
+    btTriangleMesh *mesh = new btTriangleMesh();
+    const int size = 200;
+    for (int x = 0; x < size; x++)
+    {
+        for (int z = 0; z < size; z++)
+        {
+            btVector3 p[4];
+            for (int k = 0; k < 4; k++)
+            {
+                float px = float(x + k%2) - size/2;
+                float pz = float(z + k/2) - size/2;
+                p[k] = btVector3(px, 0.3f*sinf(px*0.7f)*cosf(pz*0.5f), pz);
+            }
+            mesh->addTriangle(p[0], p[1], p[2]);
+            mesh->addTriangle(p[1], p[3], p[2]);
+        }
+    }
+    btBvhTriangleMeshShape *ground_shape = new btBvhTriangleMeshShape(mesh,
+                                                                      true);
+    btRigidBody *ground = new btRigidBody(0, NULL, ground_shape);
+    world.addRigidBody(ground);
+
+    btBoxShape kart_shape(btVector3(0.7f, 0.4f, 1.1f));
+    btKartRaycaster raycaster(&world);
+    const unsigned int num_karts[] = { 4, 8, 16, 32, 64 };
+    const unsigned int iterations  = 200;
+    for (unsigned int n = 0; n < sizeof(num_karts)/sizeof(num_karts[0]); n++)
+    {
+        Data data[2];
+        for (unsigned int i = 0; i < num_karts[n]; i++)
+        {
+            btTransform t(btQuaternion(btVector3(0, 1, 0), i*0.3f),
+                          btVector3((i%8)*12.0f - 48.0f, 1.0f,
+                                    (i/8)*12.0f - 48.0f));
+            btRigidBody *body = new btRigidBody(0, NULL, &kart_shape);
+            body->setWorldTransform(t);
+            world.addRigidBody(body);
+            data[0].m_bodies.push_back(body);
+        }
+        data[1].m_bodies = data[0].m_bodies;
+        for (unsigned int k = 0; k < 2; k++)
+        {
+            data[k].m_raycaster = &raycaster;
+            data[k].m_results.resize(num_karts[n]*RAYS_PER_KART);
+            data[k].m_objects.resize(num_karts[n]*RAYS_PER_KART);
+        }
+
+        double start = StkTime::getRealTime();
+        for (unsigned int it = 0; it < iterations; it++)
+        {
+            for (unsigned int i = 0; i < num_karts[n]; i++)
+                castRays(i, &data[0]);
+        }
+        double serial_time = StkTime::getRealTime() - start;
+
+        start = StkTime::getRealTime();
+        for (unsigned int it = 0; it < iterations; it++)
+        {
+            if (thread_pool)
+                thread_pool->run(num_karts[n], &castRays, &data[1]);
+            else
+            {
+                for (unsigned int i = 0; i < num_karts[n]; i++)
+                    castRays(i, &data[1]);
+            }
+        }
+        double parallel_time = StkTime::getRealTime() - start;
+
+        bool identical = data[0].m_objects == data[1].m_objects;
+        for (unsigned int i = 0; i < data[0].m_results.size(); i++)
+        {
+            const btVehicleRaycaster::btVehicleRaycasterResult &r0 =
+                data[0].m_results[i];
+            const btVehicleRaycaster::btVehicleRaycasterResult &r1 =
+                data[1].m_results[i];
+            if (memcmp(&r0.m_hitPointInWorld, &r1.m_hitPointInWorld,
+                       sizeof(btVector3)) != 0                          ||
+                memcmp(&r0.m_hitNormalInWorld, &r1.m_hitNormalInWorld,
+                       sizeof(btVector3)) != 0                          ||
+                r0.m_distFraction != r1.m_distFraction)
+                identical = false;
+        }
+
+        Log::info("STKDynamicsWorld", "%2d karts: serial %.3f ms, %d threads "
+                  "%.3f ms per step, results %s.", num_karts[n],
+                  serial_time*1000.0/iterations,
+                  thread_pool ? thread_pool->getNumberOfThreads() : 1,
+                  parallel_time*1000.0/iterations,
+                  identical ? "identical" : "DIFFERENT");
+
+        for (unsigned int i = 0; i < data[0].m_bodies.size(); i++)
+        {
+            world.removeRigidBody(data[0].m_bodies[i]);
+            delete data[0].m_bodies[i];
+        }
+    }   // for n
+
+    world.removeRigidBody(ground);
+    delete ground;
+    delete ground_shape;
+    delete mesh;
+}   // benchmark
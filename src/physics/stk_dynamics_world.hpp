@@ -21,8 +21,37 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include <vector>
+
+class btKart;
+
+/** The dynamics world used by STK. Before the karts are updated in each
+ *  physics step, the wheel rays of all karts are cast in parallel.
+ */
 class STKDynamicsWorld : public btDiscreteDynamicsWorld
 {
+private:
+    /** An action that is always the first action of the world, so that it
+     *  is updated before all karts. It casts the wheel rays of all karts. */
+    class WheelRaycastStage : public btActionInterface
+    {
+    public:
+        STKDynamicsWorld *m_world;
+        virtual void updateAction(btCollisionWorld *world, btScalar step)
+        {
+            m_world->castWheelRays();
+        }   // updateAction
+        virtual void debugDraw(btIDebugDraw *debug_drawer) {}
+    };   // WheelRaycastStage
+
+    WheelRaycastStage    m_wheel_raycast_stage;
+
+    /** The karts whose wheel rays are cast in the current step. */
+    std::vector<btKart*> m_karts;
+
+    void        castWheelRays();
+    static void castWheelRaysTask(unsigned int index, void *data);
+
 public:
     /** The standard constructor which just created a btDiscreteDynamicsWorld. */
     STKDynamicsWorld(btDispatcher*             dispatcher,
@@ -34,12 +63,16 @@ public:
                                              constraintSolver,
                                              collisionConfiguration)
     {
+        m_wheel_raycast_stage.m_world = this;
+        addAction(&m_wheel_raycast_stage);
     }
 
     /** Resets m_localTime to 0. This allows more precise replay of
      *  physics, which is important for replaying histories. */
     virtual void resetLocalTime() { m_localTime = 0; }
 
+    static void benchmark();
+
 };   // STKDynamicsWorld
 #endif
 /* EOF */
@@ -19,6 +19,7 @@
 #ifndef HEADER_HISTORY_HPP
 #define HEADER_HISTORY_HPP
 
+#include <stdio.h>
 #include <vector>
 #include <string>
 
@@ -28,9 +29,15 @@
 #include "utils/aligned_array.hpp"
 #include "utils/vec3.hpp"
 
-class Kart;
+class AbstractKart;
 
 /**
+  * \brief Records the controls and positions of all karts, and replays them.
+  *  A history can be stored in two formats: a binary format (which is used
+  *  by default) with a fixed header followed by one array for each recorded
+  *  value of each kart, which is memory mapped and copied without any
+  *  parsing; and the old text format, which can still be read, and which
+  *  can be created using convert().
   * \ingroup race
   */
 class History
@@ -76,9 +83,44 @@ private:
     /** The identities of the karts to use. */
     std::vector<std::string>  m_kart_ident;
 
-    void  allocateMemory(int number_of_frames);
+    /** Number of local players of the recorded race. */
+    int                       m_num_players;
+
+    /** Difficulty of the recorded race. */
+    int                       m_difficulty;
+
+    /** Identifier of the track of the recorded race. */
+    std::string               m_track_name;
+
+    /** The seed of all random generators of the recorded race. */
+    unsigned int              m_random_seed;
+
+    /** True if a physics replay is compared with the recorded positions. */
+    bool                      m_verify;
+
+    /** The first tick at which a kart diverged during verification, or -1. */
+    int                       m_divergent_tick;
+
+    void  allocateMemory(int number_of_frames, unsigned int num_karts);
     void  updateSaving(float dt);
     void  updateReplay(float dt);
+    void  verifyKart(const AbstractKart *kart, unsigned int k);
+    void  linearise();
+    bool  saveText(FILE *fd) const;
+    bool  saveBinary(FILE *fd) const;
+    bool  loadText(FILE *fd);
+    bool  loadBinary(const std::string &filename);
+    void  createTestData(unsigned int num_karts, int num_frames);
+
+    // ------------------------------------------------------------------------
+    /** Returns the index of the data of a kart at a certain frame. The data
+     *  is stored one kart after another, so that the data of each kart is
+     *  a contiguous array. */
+    unsigned int getIndex(int frame, unsigned int kart) const
+    {
+        return kart*(unsigned int)m_all_deltas.size() + frame;
+    }   // getIndex
+
 public:
           History        ();
     void  startReplay    ();
@@ -86,6 +128,11 @@ public:
     void  update         (float dt);
     void  Save           ();
     void  Load           ();
+    bool  save           (const std::string &filename, bool binary);
+    bool  load           (const std::string &filename);
+    static bool convert  (const std::string &in, const std::string &out);
+    static void benchmark();
+    static void unitTesting();
 
     // -------------------I-----------------------------------------------------
     /** Returns the identifier of the n-th kart. */
@@ -104,6 +151,23 @@ public:
     /** Enable replaying a history, enabled from the command line. */
     void  doReplayHistory(HistoryReplayMode m) {m_replay_mode = m;           }
     // ------------------------------------------------------------------------
+    /** Replays the history with physics and checks in each tick that the
+     *  karts are at the recorded positions. */
+    void  doVerifyHistory()
+    {
+        m_replay_mode = HISTORY_PHYSICS;
+        m_verify      = true;
+    }   // doVerifyHistory
+    // ------------------------------------------------------------------------
+    /** Returns true if the replay is verified. */
+    bool  isVerifying    () const { return m_verify;                         }
+    // ------------------------------------------------------------------------
+    /** Returns true if a kart diverged from the recorded positions. */
+    bool  verificationFailed() const { return m_divergent_tick >= 0;         }
+    // ------------------------------------------------------------------------
+    /** Returns the seed of the random generators of the recorded race. */
+    unsigned int getRandomSeed() const { return m_random_seed;               }
+    // ------------------------------------------------------------------------
     /** Returns true if the physics should not be simulated in replay mode.
      *  I.e. either no replay mode, or physics replay mode. */
     bool dontDoPhysics   () const { return m_replay_mode == HISTORY_POSITION;}
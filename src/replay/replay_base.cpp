@@ -18,7 +18,64 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
 #include "race/race_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/types.hpp"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    /** Version of the binary replay format. */
+    const uint32_t REPLAY_BINARY_VERSION = 1;
+
+    /** Used to detect files written on a machine with a different byte
+     *  order. */
+    const uint32_t REPLAY_BYTE_ORDER     = 0x01020304;
+
+    /** Length of the (zero padded) track and kart names. */
+    const unsigned int IDENT_LENGTH      = 64;
+
+    const char REPLAY_MAGIC[4] = {'S', 'T', 'K', 'R'};
+
+    /** Header of a binary replay file. */
+    struct BinaryReplayHeader
+    {
+        char     m_magic[4];
+        uint32_t m_format_version;
+        uint32_t m_byte_order;
+        uint32_t m_replay_version;
+        uint32_t m_difficulty;
+        uint32_t m_num_laps;
+        uint32_t m_num_karts;
+        uint32_t m_reserved;
+        char     m_track[IDENT_LENGTH];
+    };   // BinaryReplayHeader
+
+    /** Header of the data of one kart in a binary replay file. It is
+     *  followed by the arrays of the times, positions (3 floats) and
+     *  rotations (4 floats) of all transforms, and the arrays of the times
+     *  and types of all events. Each array is padded with
+     *  MappedFile::writePadded. */
+    struct BinaryKartHeader
+    {
+        char     m_ident[IDENT_LENGTH];
+        uint32_t m_num_transforms;
+        uint32_t m_num_events;
+        uint32_t m_reserved[2];
+    };   // BinaryKartHeader
+
+    // ------------------------------------------------------------------------
+    /** Copies a string into a zero padded, fixed size buffer. */
+    void copyIdent(char *dest, const std::string &src)
+    {
+        memset(dest, 0, IDENT_LENGTH);
+        strncpy(dest, src.c_str(), IDENT_LENGTH-1);
+    }   // copyIdent
+}   // namespace
 
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
@@ -35,12 +92,512 @@ FILE* ReplayBase::openReplayFile(bool writeable)
 {
     m_filename = file_manager->getUserConfigFile(
                                        race_manager->getTrackName()+".replay");
-    FILE *fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+    FILE *fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     if(!fd)
     {
         m_filename = race_manager->getTrackName()+".replay";
-        fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+        fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     }
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+/** Reads a replay file, which can be either in the binary or in the text
+ *  format.
+ *  \param filename Name of the file.
+ *  \param data On return the content of the file.
+ *  \return True if the file could be read.
+ */
+bool ReplayBase::readReplay(const std::string &filename, ReplayData *data)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if(!fd)
+    {
+        Log::error("Replay", "Can't open '%s'.", filename.c_str());
+        return false;
+    }
+    char magic[sizeof(REPLAY_MAGIC)];
+    if(fread(magic, sizeof(magic), 1, fd)==1 &&
+       memcmp(magic, REPLAY_MAGIC, sizeof(magic))==0)
+    {
+        fclose(fd);
+        return readReplayBinary(filename, data);
+    }
+    rewind(fd);
+    bool ok = readReplayText(fd, data);
+    fclose(fd);
+    return ok;
+}   // readReplay
+
+// -----------------------------------------------------------------------------
+/** Reads a replay in the text format.
+ *  \param fd The file to read from.
+ *  \param data On return the content of the file.
+ */
+bool ReplayBase::readReplayText(FILE *fd, ReplayData *data)
+{
+    char s[1024], s1[1024];
+    data->m_karts.clear();
+
+    if (fgets(s, 1023, fd) == NULL)
+    {
+        Log::error("Replay", "Could not read replay file.");
+        return false;
+    }
+
+    if (sscanf(s,"Version: %u", &data->m_version) != 1)
+    {
+        Log::error("Replay", "No Version information found in replay file (bogus replay file).");
+        return false;
+    }
+
+    if (fgets(s, 1023, fd) == NULL ||
+        sscanf(s, "difficulty: %d", &data->m_difficulty) != 1)
+    {
+        Log::error("Replay", " No difficulty found in replay file.");
+        return false;
+    }
+
+    s1[0] = 0;
+    if (fgets(s, 1023, fd) == NULL || sscanf(s, "track: %1023s", s1) != 1)
+        Log::warn("Replay", "Track not found in replay file.");
+    data->m_track = s1;
+
+    if (fgets(s, 1023, fd) == NULL ||
+        sscanf(s, "Laps: %u", &data->m_num_laps) != 1)
+    {
+        Log::error("Replay", "No number of laps found in replay file.");
+        return false;
+    }
+
+    while(fgets(s, 1023, fd)!=NULL)
+    {
+        if(sscanf(s, "model: %1023s", s1)!=1)
+        {
+            Log::error("Replay", "No model information for kart %d found.",
+                       data->m_karts.size());
+            return false;
+        }
+        data->m_karts.push_back(KartReplayData());
+        KartReplayData &kart = data->m_karts.back();
+        kart.m_ident = s1;
+
+        unsigned int size;
+        if(fgets(s, 1023, fd)==NULL || sscanf(s,"size: %u",&size)!=1)
+        {
+            Log::error("Replay", "Number of records not found in replay file "
+                       "for kart %d.", data->m_karts.size()-1);
+            return false;
+        }
+
+        for(unsigned int i=0; i<size; i++)
+        {
+            if(fgets(s, 1023, fd)==NULL)
+                break;
+            float x, y, z, rx, ry, rz, rw, time;
+
+            // Check for EV_TRANSFORM event:
+            // -----------------------------
+            if(sscanf(s, "%f  %f %f %f  %f %f %f %f\n",
+                &time,
+                &x, &y, &z,
+                &rx, &ry, &rz, &rw
+                )==8)
+            {
+                TransformEvent te;
+                te.m_time = time;
+                te.m_transform = btTransform(btQuaternion(rx, ry, rz, rw),
+                                             btVector3(x, y, z));
+                kart.m_transforms.push_back(te);
+            }
+            else
+            {
+                // Invalid record found
+                // ---------------------
+                Log::warn("Replay", "Can't read replay data line %d:", i);
+                Log::warn("Replay", "%s", s);
+                Log::warn("Replay", "Ignored.");
+            }
+        }   // for i
+
+        unsigned int num_events = 0;
+        if(fgets(s, 1023, fd)==NULL ||
+           sscanf(s,"events: %u",&num_events)!=1)
+            Log::warn("Replay", "Number of events not found in replay file "
+                      "for kart %d.", data->m_karts.size()-1);
+
+        for(unsigned int i=0; i<num_events; i++)
+        {
+            if(fgets(s, 1023, fd)==NULL)
+                break;
+            KartReplayEvent kre;
+            int type;
+            if(sscanf(s, "%f %d\n", &kre.m_time, &type)==2)
+            {
+                kre.m_type = (KartReplayEvent::KartReplayEventType)type;
+                kart.m_events.push_back(kre);
+            }
+            else
+            {
+                // Invalid record found
+                // ---------------------
+                Log::warn("Replay", "Can't read replay event line %d:", i);
+                Log::warn("Replay", "%s", s);
+                Log::warn("Replay", "Ignored.");
+            }
+        }   // for i < events
+    }   // while fgets
+
+    return true;
+}   // readReplayText
+
+// -----------------------------------------------------------------------------
+/** Reads a replay in the binary format. The file is memory mapped, and the
+ *  arrays are copied without any parsing.
+ *  \param filename Name of the file.
+ *  \param data On return the content of the file.
+ */
+bool ReplayBase::readReplayBinary(const std::string &filename,
+                                  ReplayData *data)
+{
+    MappedFile file;
+    if(!file.open(filename))
+    {
+        Log::error("Replay", "Can't map '%s'.", filename.c_str());
+        return false;
+    }
+
+    BinaryReplayHeader header;
+    if(file.getSize()<sizeof(header))
+    {
+        Log::error("Replay", "Replay file '%s' is truncated.",
+                   filename.c_str());
+        return false;
+    }
+    memcpy(&header, file.getData(), sizeof(header));
+    if(header.m_byte_order!=REPLAY_BYTE_ORDER)
+    {
+        Log::error("Replay", "Replay file '%s' was written on a machine "
+                   "with a different byte order, convert it to the text "
+                   "format there.", filename.c_str());
+        return false;
+    }
+    if(header.m_format_version!=REPLAY_BINARY_VERSION)
+    {
+        Log::error("Replay", "Replay file '%s' has format version %d, only "
+                   "version %d is supported.", filename.c_str(),
+                   header.m_format_version, REPLAY_BINARY_VERSION);
+        return false;
+    }
+
+    data->m_version    = header.m_replay_version;
+    data->m_difficulty = header.m_difficulty;
+    data->m_num_laps   = header.m_num_laps;
+    data->m_track      = std::string(header.m_track, IDENT_LENGTH).c_str();
+    data->m_karts.clear();
+    data->m_karts.resize(header.m_num_karts);
+
+    size_t offset = sizeof(header);
+    for(unsigned int k=0; k<header.m_num_karts; k++)
+    {
+        BinaryKartHeader kart_header;
+        if(file.getSize()<offset+sizeof(kart_header))
+        {
+            Log::error("Replay", "Replay file '%s' is truncated.",
+                       filename.c_str());
+            return false;
+        }
+        memcpy(&kart_header, file.getData()+offset, sizeof(kart_header));
+        offset += sizeof(kart_header);
+
+        const size_t n = kart_header.m_num_transforms;
+        const size_t e = kart_header.m_num_events;
+        const size_t time_size     = MappedFile::paddedSize(n*sizeof(float));
+        const size_t xyz_size      = MappedFile::paddedSize(3*n*sizeof(float));
+        const size_t rotation_size = MappedFile::paddedSize(4*n*sizeof(float));
+        const size_t event_size    = MappedFile::paddedSize(e*sizeof(float));
+        const size_t type_size     = MappedFile::paddedSize(e*sizeof(uint32_t));
+        if(file.getSize() < offset + time_size + xyz_size + rotation_size
+                                   + event_size + type_size)
+        {
+            Log::error("Replay", "Replay file '%s' is truncated.",
+                       filename.c_str());
+            return false;
+        }
+
+        // All arrays start at a multiple of MappedFile::ALIGNMENT, and the
+        // mapping is page aligned, so the data can be accessed directly.
+        const char *p = file.getData() + offset;
+        const float    *times       = (const float*)p;
+        const float    *xyz         = (const float*)(p += time_size);
+        const float    *rotation    = (const float*)(p += xyz_size);
+        const float    *event_times = (const float*)(p += rotation_size);
+        const uint32_t *event_types = (const uint32_t*)(p += event_size);
+        offset += time_size + xyz_size + rotation_size + event_size
+                + type_size;
+
+        KartReplayData &kart = data->m_karts[k];
+        kart.m_ident = std::string(kart_header.m_ident, IDENT_LENGTH).c_str();
+        kart.m_transforms.resize(n);
+        for(unsigned int i=0; i<n; i++)
+        {
+            TransformEvent &te = kart.m_transforms[i];
+            te.m_time = times[i];
+            te.m_transform.setOrigin(btVector3(xyz[3*i], xyz[3*i+1],
+                                               xyz[3*i+2]));
+            te.m_transform.setRotation(btQuaternion(rotation[4*i  ],
+                                                    rotation[4*i+1],
+                                                    rotation[4*i+2],
+                                                    rotation[4*i+3]));
+        }
+        kart.m_events.resize(e);
+        for(unsigned int i=0; i<e; i++)
+        {
+            kart.m_events[i].m_time = event_times[i];
+            kart.m_events[i].m_type =
+                (KartReplayEvent::KartReplayEventType)event_types[i];
+        }
+    }   // for k
+    return true;
+}   // readReplayBinary
+
+// -----------------------------------------------------------------------------
+/** Writes a replay in the text format.
+ *  \param fd The file to write to.
+ *  \param data The replay data to write.
+ *  \return True if the data was written successfully.
+ */
+bool ReplayBase::writeReplayText(FILE *fd, const ReplayData &data)
+{
+    fprintf(fd, "Version:  %d\n",   data.m_version);
+    fprintf(fd, "difficulty: %d\n", data.m_difficulty);
+    fprintf(fd, "track: %s\n",      data.m_track.c_str());
+    fprintf(fd, "Laps: %d\n",       data.m_num_laps);
+
+    for(unsigned int k=0; k<data.m_karts.size(); k++)
+    {
+        const KartReplayData &kart = data.m_karts[k];
+        fprintf(fd, "model: %s\n", kart.m_ident.c_str());
+        fprintf(fd, "size:     %d\n", (int)kart.m_transforms.size());
+
+        for(unsigned int i=0; i<kart.m_transforms.size(); i++)
+        {
+            const TransformEvent *p=&(kart.m_transforms[i]);
+            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
+                    p->m_time,
+                    p->m_transform.getOrigin().getX(),
+                    p->m_transform.getOrigin().getY(),
+                    p->m_transform.getOrigin().getZ(),
+                    p->m_transform.getRotation().getX(),
+                    p->m_transform.getRotation().getY(),
+                    p->m_transform.getRotation().getZ(),
+                    p->m_transform.getRotation().getW()
+                );
+        }   // for i
+        fprintf(fd, "events: %d\n", (int)kart.m_events.size());
+        for(unsigned int i=0; i<kart.m_events.size(); i++)
+        {
+            const KartReplayEvent *p=&(kart.m_events[i]);
+            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
+        }
+    }   // for k
+    return !ferror(fd);
+}   // writeReplayText
+
+// -----------------------------------------------------------------------------
+/** Writes a replay in the binary format.
+ *  \param fd The file to write to.
+ *  \param data The replay data to write.
+ *  \return True if the data was written successfully.
+ */
+bool ReplayBase::writeReplayBinary(FILE *fd, const ReplayData &data)
+{
+    BinaryReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    header.m_format_version = REPLAY_BINARY_VERSION;
+    header.m_byte_order     = REPLAY_BYTE_ORDER;
+    header.m_replay_version = data.m_version;
+    header.m_difficulty     = data.m_difficulty;
+    header.m_num_laps       = data.m_num_laps;
+    header.m_num_karts      = (uint32_t)data.m_karts.size();
+    copyIdent(header.m_track, data.m_track);
+    if(fwrite(&header, sizeof(header), 1, fd)!=1)
+        return false;
+
+    std::vector<float>    times, xyz, rotation, event_times;
+    std::vector<uint32_t> event_types;
+    for(unsigned int k=0; k<data.m_karts.size(); k++)
+    {
+        const KartReplayData &kart = data.m_karts[k];
+        BinaryKartHeader kart_header;
+        memset(&kart_header, 0, sizeof(kart_header));
+        copyIdent(kart_header.m_ident, kart.m_ident);
+        kart_header.m_num_transforms = (uint32_t)kart.m_transforms.size();
+        kart_header.m_num_events     = (uint32_t)kart.m_events.size();
+        if(fwrite(&kart_header, sizeof(kart_header), 1, fd)!=1)
+            return false;
+
+        const size_t n = kart.m_transforms.size();
+        times.resize(n);
+        xyz.resize(3*n);
+        rotation.resize(4*n);
+        for(unsigned int i=0; i<n; i++)
+        {
+            const btTransform &t = kart.m_transforms[i].m_transform;
+            times[i] = kart.m_transforms[i].m_time;
+            for(unsigned int j=0; j<3; j++)
+                xyz[3*i+j] = t.getOrigin()[j];
+            const btQuaternion q = t.getRotation();
+            for(unsigned int j=0; j<4; j++)
+                rotation[4*i+j] = q[j];
+        }
+        const size_t e = kart.m_events.size();
+        event_times.resize(e);
+        event_types.resize(e);
+        for(unsigned int i=0; i<e; i++)
+        {
+            event_times[i] = kart.m_events[i].m_time;
+            event_types[i] = kart.m_events[i].m_type;
+        }
+        if(!MappedFile::writePadded(fd, n ? &times[0]    : NULL,
+                                    n*sizeof(float))           ||
+           !MappedFile::writePadded(fd, n ? &xyz[0]      : NULL,
+                                    3*n*sizeof(float))         ||
+           !MappedFile::writePadded(fd, n ? &rotation[0] : NULL,
+                                    4*n*sizeof(float))         ||
+           !MappedFile::writePadded(fd, e ? &event_times[0] : NULL,
+                                    e*sizeof(float))           ||
+           !MappedFile::writePadded(fd, e ? &event_types[0] : NULL,
+                                    e*sizeof(uint32_t))          )
+            return false;
+    }   // for k
+    return true;
+}   // writeReplayBinary
+
+// -----------------------------------------------------------------------------
+/** Converts a replay file: a binary file is converted into the text format,
+ *  a text file into the binary format.
+ *  \param in Name of the file to convert.
+ *  \param out Name of the file to write.
+ *  \return True if the conversion was successful.
+ */
+bool ReplayBase::convert(const std::string &in, const std::string &out)
+{
+    FILE *fd = fopen(in.c_str(), "rb");
+    if(!fd)
+    {
+        Log::error("Replay", "Can't open '%s'.", in.c_str());
+        return false;
+    }
+    char magic[sizeof(REPLAY_MAGIC)];
+    bool is_binary = fread(magic, sizeof(magic), 1, fd)==1 &&
+                     memcmp(magic, REPLAY_MAGIC, sizeof(magic))==0;
+    fclose(fd);
+
+    ReplayData data;
+    if(!readReplay(in, &data))
+        return false;
+
+    fd = fopen(out.c_str(), "wb");
+    bool ok = fd!=NULL;
+    if(fd)
+    {
+        ok = is_binary ? writeReplayText(fd, data)
+                       : writeReplayBinary(fd, data);
+        if(fclose(fd)!=0)
+            ok = false;
+    }
+    if(!ok)
+    {
+        Log::error("Replay", "Can't write '%s'.", out.c_str());
+        return false;
+    }
+    Log::info("Replay", "Converted '%s' into %s file '%s'.", in.c_str(),
+              is_binary ? "text" : "binary", out.c_str());
+    return true;
+}   // convert
+
+// -----------------------------------------------------------------------------
+/** Tests writing and reading replays in both formats.
+ */
+void ReplayBase::unitTesting()
+{
+    ReplayData data;
+    data.m_version    = getReplayVersion();
+    data.m_difficulty = 1;
+    data.m_track      = "test-track";
+    data.m_num_laps   = 3;
+    data.m_karts.resize(2);
+    for(unsigned int k=0; k<data.m_karts.size(); k++)
+    {
+        KartReplayData &kart = data.m_karts[k];
+        kart.m_ident = k==0 ? "tux" : "nolok";
+        for(unsigned int i=0; i<50+k*13; i++)
+        {
+            TransformEvent te;
+            te.m_time = i*0.05f;
+            te.m_transform = btTransform(btQuaternion(btVector3(0, 1, 0),
+                                                      i*0.1f),
+                                         btVector3(i*1.5f, k*0.5f, -i*0.2f));
+            kart.m_transforms.push_back(te);
+        }
+        for(unsigned int i=0; i<k*3; i++)
+        {
+            KartReplayEvent kre;
+            kre.m_time = i*1.25f;
+            kre.m_type = KartReplayEvent::KRE_SKID_LEFT;
+            kart.m_events.push_back(kre);
+        }
+    }
+
+    const std::string name =
+        file_manager->getUserConfigFile("replay-test.replay");
+    for(unsigned int binary=0; binary<2; binary++)
+    {
+        FILE *fd = fopen(name.c_str(), "wb");
+        assert(fd);
+        bool ok = binary ? writeReplayBinary(fd, data)
+                         : writeReplayText(fd, data);
+        fclose(fd);
+        ReplayData loaded;
+        ok = ok && readReplay(name, &loaded);
+        assert(ok);
+        assert(loaded.m_version    == data.m_version);
+        assert(loaded.m_difficulty == data.m_difficulty);
+        assert(loaded.m_track      == data.m_track);
+        assert(loaded.m_num_laps   == data.m_num_laps);
+        assert(loaded.m_karts.size() == data.m_karts.size());
+        // The text format only stores 6 decimals. In the binary format
+        // the rotation is converted into a matrix and back, which causes
+        // small rounding errors.
+        const float eps = binary ? 0.000001f : 0.00001f;
+        for(unsigned int k=0; k<data.m_karts.size(); k++)
+        {
+            const KartReplayData &k1 = data.m_karts[k];
+            const KartReplayData &k2 = loaded.m_karts[k];
+            assert(k1.m_ident == k2.m_ident);
+            assert(k1.m_transforms.size() == k2.m_transforms.size());
+            assert(k1.m_events.size()     == k2.m_events.size());
+            for(unsigned int i=0; i<k1.m_transforms.size(); i++)
+            {
+                const TransformEvent &t1 = k1.m_transforms[i];
+                const TransformEvent &t2 = k2.m_transforms[i];
+                assert(fabsf(t1.m_time-t2.m_time) <= eps);
+                assert((t1.m_transform.getOrigin() -
+                        t2.m_transform.getOrigin()).length() <= 100*eps);
+                assert((t1.m_transform.getRotation() -
+                        t2.m_transform.getRotation()).length() <= 2*eps);
+            }
+            for(unsigned int i=0; i<k1.m_events.size(); i++)
+            {
+                assert(fabsf(k1.m_events[i].m_time -
+                             k2.m_events[i].m_time) <= eps);
+                assert(k1.m_events[i].m_type == k2.m_events[i].m_type);
+            }
+        }
+        (void)ok;
+    }   // for binary
+    remove(name.c_str());
+}   // unitTesting
@@ -24,8 +24,15 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 /**
+  * \brief Base class for recording and replaying ghost karts.
+  *  Replay files are written in a binary format: a fixed size header, and
+  *  for each kart a small header followed by the arrays of the times,
+  *  positions and rotations of all transform events and of all kart
+  *  events. The old text format can still be read, and convert() converts
+  *  between both formats.
   * \ingroup race
   */
 class ReplayBase : public NoCopy
@@ -61,6 +68,34 @@ protected:
         float       m_time;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** All recorded data of one kart. */
+    struct KartReplayData
+    {
+        /** Identifier of the kart. */
+        std::string                  m_ident;
+        /** All transform events of the kart. */
+        std::vector<TransformEvent>  m_transforms;
+        /** All other events of the kart. */
+        std::vector<KartReplayEvent> m_events;
+    };   // KartReplayData
+
+    // ------------------------------------------------------------------------
+    /** The content of a replay file. */
+    struct ReplayData
+    {
+        /** Version of the replay data. */
+        unsigned int                m_version;
+        /** Difficulty of the recorded race. */
+        int                         m_difficulty;
+        /** Identifier of the track. */
+        std::string                 m_track;
+        /** Number of laps of the recorded race. */
+        unsigned int                m_num_laps;
+        /** The data of all karts. */
+        std::vector<KartReplayData> m_karts;
+    };   // ReplayData
+
     // ------------------------------------------------------------------------
           ReplayBase();
     FILE *openReplayFile(bool writeable);
@@ -71,7 +106,17 @@ protected:
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
      *  executable. */
-    unsigned int getReplayVersion() const { return 1; }
+    static unsigned int getReplayVersion() { return 1; }
+
+    static bool readReplay(const std::string &filename, ReplayData *data);
+    static bool readReplayText(FILE *fd, ReplayData *data);
+    static bool readReplayBinary(const std::string &filename,
+                                 ReplayData *data);
+    static bool writeReplayText(FILE *fd, const ReplayData &data);
+    static bool writeReplayBinary(FILE *fd, const ReplayData &data);
+public:
+    static bool convert(const std::string &in, const std::string &out);
+    static void unitTesting();
 };   // ReplayBase
 
 #endif
@@ -78,12 +78,12 @@ void ReplayPlay::update(float dt)
 }   // update
 
 //-----------------------------------------------------------------------------
-/** Loads a replay data from  file called 'trackname'.replay.
+/** Loads a replay data from  file called 'trackname'.replay. The file can
+ *  be in the binary or in the text format.
  */
 void ReplayPlay::Load()
 {
     m_ghost_karts.clearAndDeleteAll();
-    char s[1024], s1[1024];
 
     FILE *fd = openReplayFile(/*writeable*/false);
     if(!fd)
@@ -93,134 +93,40 @@ void ReplayPlay::Load()
         destroy();
         return;
     }
+    fclose(fd);
 
     Log::info("Replay", "Reading replay file '%s'.", getReplayFilename().c_str());
 
-    if (fgets(s, 1023, fd) == NULL)
+    ReplayData data;
+    if(!readReplay(getReplayFilename(), &data))
         Log::fatal("Replay", "Could not read '%s'.", getReplayFilename().c_str());
 
-    unsigned int version;
-    if (sscanf(s,"Version: %u", &version) != 1)
-        Log::fatal("Replay", "No Version information found in replay file (bogus replay file).");
-
-    if (version != getReplayVersion())
+    if (data.m_version != getReplayVersion())
     {
-        Log::warn("Replay", "Replay is version '%d'",version);
+        Log::warn("Replay", "Replay is version '%d'", data.m_version);
         Log::warn("Replay", "STK version is '%d'",getReplayVersion());
         Log::warn("Replay", "We try to proceed, but it may fail.");
     }
 
-    if (fgets(s, 1023, fd) == NULL)
-        Log::fatal("Replay", "Could not read '%s'.", getReplayFilename().c_str());
-
-    int  n;
-    if(sscanf(s, "difficulty: %d", &n) != 1)
-        Log::fatal("Replay", " No difficulty found in replay file.");
-
-    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)n)
+    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)data.m_difficulty)
         Log::warn("Replay", "Difficulty of replay is '%d', "
                   "while '%d' is selected.",
-                  race_manager->getDifficulty(), n);
-
-    fgets(s, 1023, fd);
-    if(sscanf(s, "track: %s", s1) != 1)
-        Log::warn("Replay", "Track not found in replay file.");
-    assert(std::string(s1)==race_manager->getTrackName());
-    race_manager->setTrack(s1);
+                  race_manager->getDifficulty(), data.m_difficulty);
 
-    unsigned int num_laps;
-    fgets(s, 1023, fd);
-    if(sscanf(s, "Laps: %u", &num_laps) != 1)
-        Log::fatal("Replay", "No number of laps found in replay file.");
+    assert(data.m_track==race_manager->getTrackName());
+    race_manager->setTrack(data.m_track);
+    race_manager->setNumLaps(data.m_num_laps);
 
-    race_manager->setNumLaps(num_laps);
-
-    // eof actually doesn't trigger here, since it requires first to try
-    // reading behind eof, but still it's clearer this way.
-    while(!feof(fd))
+    for(unsigned int k=0; k<data.m_karts.size(); k++)
     {
-        if(fgets(s, 1023, fd)==NULL)  // eof reached
-            break;
-        readKartData(fd, s);
-    }   // for k<num_ghost_karts
-
-    fprintf(fd, "Replay file end.\n");
-    fclose(fd);
+        const KartReplayData &kart_data = data.m_karts[k];
+        GhostKart *kart = new GhostKart(kart_data.m_ident);
+        m_ghost_karts.push_back(kart);
+        kart->init(RaceManager::KT_GHOST);
+        for(unsigned int i=0; i<kart_data.m_transforms.size(); i++)
+            kart->addTransform(kart_data.m_transforms[i].m_time,
+                               kart_data.m_transforms[i].m_transform);
+        for(unsigned int i=0; i<kart_data.m_events.size(); i++)
+            kart->addReplayEvent(kart_data.m_events[i]);
+    }   // for k
 }   // Load
-
-//-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
- *  \param fd The file descriptor from which to read.
- */
-void ReplayPlay::readKartData(FILE *fd, char *next_line)
-{
-    char s[1024];
-    if(sscanf(next_line, "model: %s", s)!=1)
-        Log::fatal("Replay", "No model information for kart %d found.",
-            m_ghost_karts.size());
-
-    m_ghost_karts.push_back(new GhostKart(std::string(s)));
-    m_ghost_karts[m_ghost_karts.size()-1].init(RaceManager::KT_GHOST);
-
-    fgets(s, 1023, fd);
-    unsigned int size;
-    if(sscanf(s,"size: %u",&size)!=1)
-        Log::fatal("Replay", "Number of records not found in replay file "
-            "for kart %d.",
-            m_ghost_karts.size()-1);
-
-    for(unsigned int i=0; i<size; i++)
-    {
-        fgets(s, 1023, fd);
-        float x, y, z, rx, ry, rz, rw, time;
-
-        // Check for EV_TRANSFORM event:
-        // -----------------------------
-        if(sscanf(s, "%f  %f %f %f  %f %f %f %f\n",
-            &time,
-            &x, &y, &z,
-            &rx, &ry, &rz, &rw
-            )==8)
-        {
-            btQuaternion q(rx, ry, rz, rw);
-            btVector3 xyz(x, y, z);
-            m_ghost_karts[m_ghost_karts.size()-1].addTransform(time,
-                                                          btTransform(q, xyz));
-        }
-        else
-        {
-            // Invalid record found
-            // ---------------------
-            Log::warn("Replay", "Can't read replay data line %d:", i);
-            Log::warn("Replay", "%s", s);
-            Log::warn("Replay", "Ignored.");
-        }
-    }   // for i
-    fgets(s, 1023, fd);
-    unsigned int num_events;
-    if(sscanf(s,"events: %u",&num_events)!=1)
-        Log::warn("Replay", "Number of events not found in replay file "
-                "for kart %d.", m_ghost_karts.size()-1);
-
-    for(unsigned int i=0; i<num_events; i++)
-    {
-        fgets(s, 1023, fd);
-        KartReplayEvent kre;
-        int type;
-        if(sscanf(s, "%f %d\n", &kre.m_time, &type)==2)
-        {
-            kre.m_type = (KartReplayEvent::KartReplayEventType)type;
-            m_ghost_karts[m_ghost_karts.size()-1].addReplayEvent(kre);
-        }
-        else
-        {
-            // Invalid record found
-            // ---------------------
-            Log::warn("Replay", "Can't read replay event line %d:", i);
-            Log::warn("Replay", "%s", s);
-            Log::warn("Replay", "Ignored.");
-        }
-
-    }   // for i < events
-
-}   // readKartData
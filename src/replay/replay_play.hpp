@@ -43,7 +43,6 @@ private:
 
           ReplayPlay();
          ~ReplayPlay();
-    void  readKartData(FILE *fd, char *next_line);
 public:
     void  init();
     void  update(float dt);
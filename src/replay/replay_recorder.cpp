@@ -168,41 +168,27 @@ void ReplayRecorder::Save()
 
     World *world   = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %d\n",   getReplayVersion());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-    fprintf(fd, "Laps: %d\n",       race_manager->getNumLaps());
+    ReplayData data;
+    data.m_version    = getReplayVersion();
+    data.m_difficulty = race_manager->getDifficulty();
+    data.m_track      = world->getTrack()->getIdent();
+    data.m_num_laps   = race_manager->getNumLaps();
+    data.m_karts.resize(num_karts);
 
     unsigned int max_frames = (unsigned int)(  stk_config->m_replay_max_time 
                                              / stk_config->m_replay_dt      );
     for(unsigned int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model: %s\n", world->getKart(k)->getIdent().c_str());
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
-
+        KartReplayData &kart = data.m_karts[k];
+        kart.m_ident = world->getKart(k)->getIdent();
         unsigned int num_transforms = std::min(max_frames,
                                                m_count_transforms[k]);
-        for(unsigned int i=0; i<num_transforms; i++)
-        {
-            const TransformEvent *p=&(m_transform_events[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW()
-                );
-        }   // for i
-        fprintf(fd, "events: %d\n", (int)m_kart_replay_event[k].size());
-        for(unsigned int i=0; i<m_kart_replay_event[k].size(); i++)
-        {
-            const KartReplayEvent *p=&(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
-        }
+        kart.m_transforms.assign(m_transform_events[k].begin(),
+                                 m_transform_events[k].begin()+num_transforms);
+        kart.m_events = m_kart_replay_event[k];
     }
+    if(!writeReplayBinary(fd, data))
+        Log::error("ReplayRecorder", "Error writing '%s'.",
+                   getReplayFilename().c_str());
     fclose(fd);
 }   // Save
-
@@ -31,10 +31,13 @@
 #include "scriptengine/scriptstdstring.hpp"
 #include "scriptengine/scriptvec3.hpp"
 #include <string.h>
+#include "io/mapped_file.hpp"
 #include "states_screens/dialogs/tutorial_message_dialog.hpp"
 #include "tracks/track_object_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
 
 
 using namespace Scripting;
@@ -54,6 +57,83 @@ namespace Scripting
         Log::warn("Scripting", "%s (%d, %d) : %s : %s\n", msg->section, msg->row, msg->col, type, msg->message);
     }
 
+    /** Generation of the next function cache, see
+     *  ScriptEngine::getCacheGeneration(). This is shared by all engines,
+     *  so that a ScriptFunction never uses a function from another engine. */
+    static unsigned int g_next_cache_generation = 1;
+
+    /** Magic number at the start of a bytecode file. */
+    static const char BYTECODE_MAGIC[4] = { 'S', 'T', 'K', 'B' };
+
+    /** Header of a bytecode file. The bytecode is only used if the script
+     *  engine version and the hash of the script source (and STK version,
+     *  since the registered interface can change) match. */
+    struct ByteCodeHeader
+    {
+        char     m_magic[4];
+        uint32_t m_angelscript_version;
+        uint32_t m_source_hash;
+    };   // ByteCodeHeader
+
+    // ------------------------------------------------------------------------
+    /** Computes a FNV-1a hash of the script and the STK version. */
+    static uint32_t getSourceHash(const std::string &script)
+    {
+        uint32_t hash = 2166136261u;
+        const std::string data = script + STK_VERSION;
+        for (unsigned int i = 0; i < data.size(); i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }   // getSourceHash
+
+    // ------------------------------------------------------------------------
+    /** Reads bytecode from a memory buffer. */
+    class ByteCodeReader : public asIBinaryStream
+    {
+    private:
+        const char *m_data;
+        size_t      m_size;
+        size_t      m_offset;
+        bool        m_error;
+    public:
+        ByteCodeReader(const char *data, size_t size)
+            : m_data(data), m_size(size), m_offset(0), m_error(false) {}
+        virtual void Read(void *ptr, asUINT size)
+        {
+            if (m_offset + size > m_size)
+            {
+                memset(ptr, 0, size);
+                m_error = true;
+                return;
+            }
+            memcpy(ptr, m_data + m_offset, size);
+            m_offset += size;
+        }   // Read
+        virtual void Write(const void *ptr, asUINT size) { assert(false); }
+        bool hasError() const { return m_error; }
+    };   // ByteCodeReader
+
+    // ------------------------------------------------------------------------
+    /** Writes bytecode to a file. */
+    class ByteCodeWriter : public asIBinaryStream
+    {
+    private:
+        FILE *m_fd;
+        bool  m_error;
+    public:
+        ByteCodeWriter(FILE *fd) : m_fd(fd), m_error(false) {}
+        virtual void Read(void *ptr, asUINT size) { assert(false); }
+        virtual void Write(const void *ptr, asUINT size)
+        {
+            if (size > 0 && fwrite(ptr, size, 1, m_fd) != 1)
+                m_error = true;
+        }   // Write
+        bool hasError() const { return m_error; }
+    };   // ByteCodeWriter
+
 
     //Constructor, creates a new Scripting Engine using AngelScript
     ScriptEngine::ScriptEngine()
@@ -71,26 +151,37 @@ namespace Scripting
         // Configure the script engine with all the functions, 
         // and variables that the script should be able to use.
         configureEngine(m_engine);
+        m_cache_generation = g_next_cache_generation++;
     }
 
     ScriptEngine::~ScriptEngine()
     {
+        cleanupCache();
         // Release the engine
         m_engine->Release();
     }
 
 
 
+    /** Returns the full path of a script of the current track.
+    *  \param fileName Name of the script.
+    */
+    std::string getScriptPath(const std::string &fileName)
+    {
+        std::string script_dir = file_manager->getAsset(FileManager::SCRIPT, "");
+        script_dir += World::getWorld()->getTrack()->getIdent() + "/";
+
+        return script_dir + fileName;
+    }
+
+    //-----------------------------------------------------------------------------
     /** Get Script By it's file name
     *  \param string scriptname = name of script to get
     *  \return      The corresponding script
     */
     std::string getScript(std::string fileName)
     {
-        std::string script_dir = file_manager->getAsset(FileManager::SCRIPT, "");
-        script_dir += World::getWorld()->getTrack()->getIdent() + "/";
-
-        script_dir += fileName;
+        std::string script_dir = getScriptPath(fileName);
         FILE *f = fopen(script_dir.c_str(), "rb");
         if (f == NULL)
         {
@@ -132,19 +223,11 @@ namespace Scripting
             return;
         }
 
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = getContext(func);
         if (ctx == NULL)
-        {
-            Log::error("Scripting", "evalScript: Failed to create the context.");
-            //m_engine->Release();
-            return;
-        }
-
-        r = ctx->Prepare(func);
-        if (r < 0)
         {
             Log::error("Scripting", "evalScript: Failed to prepare the context.");
-            ctx->Release();
+            func->Release();
             return;
         }
 
@@ -167,118 +250,110 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        // The function is only used once, so don't keep it prepared
+        ctx->Unprepare();
+        returnContext(ctx, NULL);
         func->Release();
     }
 
     //-----------------------------------------------------------------------------
 
-    /** runs the specified script
-    *  \param string scriptName = name of script to run
-    */
-    void ScriptEngine::runFunction(std::string function_name)
-    {
-        std::function<void(asIScriptContext*)> callback;
-        std::function<void(asIScriptContext*)> get_return_value;
-        runFunction(function_name, callback, get_return_value);
-    }
-
-    //-----------------------------------------------------------------------------
-
-    void ScriptEngine::runFunction(std::string function_name,
-        std::function<void(asIScriptContext*)> callback)
-    {
-        std::function<void(asIScriptContext*)> get_return_value;
-        runFunction(function_name, callback, get_return_value);
-    }
-
-    //-----------------------------------------------------------------------------
-
-    /** runs the specified script
-    *  \param string scriptName = name of script to run
+    /** Returns the function for the given declaration, or NULL if it does
+    *  not exist. The script file of the track is compiled when this is
+    *  called the first time. The result is cached till cleanupCache() is
+    *  called, so this lookup should only be done once for functions which
+    *  are called often (see ScriptFunction).
+    *  \param function_name Declaration of the function, e.g. "void onStart()".
     */
-    void ScriptEngine::runFunction(std::string function_name,
-        std::function<void(asIScriptContext*)> callback,
-        std::function<void(asIScriptContext*)> get_return_value)
+    asIScriptFunction *ScriptEngine::getFunction(const std::string &function_name)
     {
-        int r; //int for error checking
-
-        asIScriptFunction *func;
+        auto cached_function = m_functions_cache.find(function_name);
+        if (cached_function != m_functions_cache.end())
+            return cached_function->second;
 
         // TODO: allow splitting in multiple files
         std::string script_filename = "scripting.as";
         auto cached_script = m_loaded_files.find(script_filename);
-        auto cached_function = m_functions_cache.find(function_name);
-
         if (cached_script == m_loaded_files.end())
         {
             // Compile the script code
             Log::info("Scripting", "Checking for script file '%s'", script_filename.c_str());
-            r = compileScript(m_engine, script_filename);
+            int r = compileScript(m_engine, script_filename);
             if (r < 0)
-            {
                 Log::info("Scripting", "Script '%s' is not available", script_filename.c_str());
-                m_loaded_files[script_filename] = false;
-                m_functions_cache[function_name] = NULL; // remember that this script is unavailable
-                return;
-            }
-
-            m_loaded_files[script_filename] = true;
-        }
-        else if (cached_script->second == false)
-        {
-            return; // script file unavailable
+            cached_script = m_loaded_files.insert(
+                std::make_pair(script_filename, r >= 0)).first;
         }
 
-        if (cached_function == m_functions_cache.end())
+        asIScriptFunction *func = NULL;
+        if (cached_script->second)
         {
             // Find the function for the function we want to execute.
             //      This is how you call a normal function with arguments
             //      asIScriptFunction *func = engine->GetModule(0)->GetFunctionByDecl("void func(arg1Type, arg2Type)");
             func = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE)
                         ->GetFunctionByDecl(function_name.c_str());
-        
             if (func == NULL)
-            {
                 Log::debug("Scripting", "Scripting function was not found : %s", function_name.c_str());
-                m_loaded_files[function_name] = NULL; // remember that this script is unavailable
-                return;
-            }
-
-            m_functions_cache[function_name] = func;
-            func->AddRef();
-        }
-        else
-        {
-            // Script present in cache
-            func = cached_function->second;
+            else
+                func->AddRef();
         }
 
+        // A NULL entry remembers that this function is unavailable
+        m_functions_cache[function_name] = func;
+        return func;
+    }   // getFunction
+
+    //-----------------------------------------------------------------------------
+
+    /** runs the specified script
+    *  \param string scriptName = name of script to run
+    */
+    void ScriptEngine::runFunction(const std::string &function_name)
+    {
+        runFunction(function_name, ContextCallback(), ContextCallback());
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void ScriptEngine::runFunction(const std::string &function_name,
+                                   const ContextCallback &callback)
+    {
+        runFunction(function_name, callback, ContextCallback());
+    }
+
+    //-----------------------------------------------------------------------------
+
+    /** runs the specified script
+    *  \param string scriptName = name of script to run
+    */
+    void ScriptEngine::runFunction(const std::string &function_name,
+                                   const ContextCallback &callback,
+                                   const ContextCallback &get_return_value)
+    {
+        asIScriptFunction *func = getFunction(function_name);
         if (func == NULL)
-        {
             return; // function unavailable
-        }
+        runFunction(func, callback, get_return_value);
+    }
 
-        // Create a context that will execute the script.
-        asIScriptContext *ctx = m_engine->CreateContext();
-        if (ctx == NULL)
-        {
-            Log::error("Scripting", "Failed to create the context.");
-            //m_engine->Release();
-            return;
-        }
+    //-----------------------------------------------------------------------------
 
-        // Prepare the script context with the function we wish to execute. Prepare()
-        // must be called on the context before each new script function that will be
-        // executed. Note, that if because we intend to execute the same function 
-        // several times, we will store the function returned by 
-        // GetFunctionByDecl(), so that this relatively slow call can be skipped.
-        r = ctx->Prepare(func);
-        if (r < 0)
+    /** Runs a function which was looked up with getFunction().
+    *  \param func The function to run.
+    *  \param callback Called before the function is executed, e.g. to set
+    *         the arguments.
+    *  \param get_return_value Called after the function was executed
+    *         successfully, e.g. to get the return value.
+    */
+    void ScriptEngine::runFunction(asIScriptFunction *func,
+                                   const ContextCallback &callback,
+                                   const ContextCallback &get_return_value)
+    {
+        asIScriptContext *ctx = getContext(func);
+        if (ctx == NULL)
         {
             Log::error("Scripting", "Failed to prepare the context.");
-            ctx->Release();
-            //m_engine->Release();
             return;
         }
 
@@ -290,7 +365,7 @@ namespace Scripting
             callback(ctx);
 
         // Execute the function
-        r = ctx->Execute();
+        int r = ctx->Execute();
         if (r != asEXECUTION_FINISHED)
         {
             // The execution didn't finish as we had planned. Determine why.
@@ -300,15 +375,8 @@ namespace Scripting
             }
             else if (r == asEXECUTION_EXCEPTION)
             {
-                Log::error("Scripting", "The script ended with an exception.");
-
-                // Write some information about the script exception
-                asIScriptFunction *func = ctx->GetExceptionFunction();
-                //std::cout << "func: " << func->GetDeclaration() << std::endl;
-                //std::cout << "modl: " << func->GetModuleName() << std::endl;
-                //std::cout << "sect: " << func->GetScriptSectionName() << std::endl;
-                //std::cout << "line: " << ctx->GetExceptionLineNumber() << std::endl;
-                //std::cout << "desc: " << ctx->GetExceptionString() << std::endl;
+                Log::error("Scripting", "The script ended with an exception (%s).",
+                           ctx->GetExceptionString());
             }
             else
             {
@@ -325,14 +393,74 @@ namespace Scripting
                 get_return_value(ctx);
         }
 
-        // We must release the contexts when no longer using them
-        ctx->Release();
+        returnContext(ctx, func);
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns a context prepared for the given function. Contexts are
+    *  reused: a context that was last used for the same function is
+    *  preferred, since Prepare() is then very cheap. Otherwise a new context
+    *  is created, so the pool contains at most one context per function and
+    *  nesting level (a script can call other script functions).
+    *  \param func The function to prepare the context for.
+    *  \return The context, or NULL in case of an error.
+    */
+    asIScriptContext *ScriptEngine::getContext(asIScriptFunction *func)
+    {
+        asIScriptContext *ctx = NULL;
+        auto prepared = m_context_pool.find(func);
+        if (prepared == m_context_pool.end() || prepared->second.empty())
+            prepared = m_context_pool.find(NULL);
+        if (prepared != m_context_pool.end() && !prepared->second.empty())
+        {
+            ctx = prepared->second.back();
+            prepared->second.pop_back();
+        }
+        else
+        {
+            ctx = m_engine->CreateContext();
+            if (ctx == NULL)
+                return NULL;
+        }
+
+        if (ctx->Prepare(func) < 0)
+        {
+            ctx->Release();
+            return NULL;
+        }
+        return ctx;
+    }   // getContext
+
+    //-----------------------------------------------------------------------------
+    /** Returns a context to the pool after a function was executed.
+    *  \param ctx The context.
+    *  \param func The function the context is prepared for, or NULL if it
+    *         was unprepared.
+    */
+    void ScriptEngine::returnContext(asIScriptContext *ctx,
+                                     asIScriptFunction *func)
+    {
+        m_context_pool[func].push_back(ctx);
+    }   // returnContext
+
+    //-----------------------------------------------------------------------------
+    /** Releases all pooled contexts. */
+    void ScriptEngine::releaseContexts()
+    {
+        for (auto &pool : m_context_pool)
+        {
+            for (unsigned int i = 0; i < pool.second.size(); i++)
+                pool.second[i]->Release();
+        }
+        m_context_pool.clear();
+    }   // releaseContexts
+
     //-----------------------------------------------------------------------------
 
     void ScriptEngine::cleanupCache()
     {
+        // The contexts keep references to the functions they are prepared for
+        releaseContexts();
         for (auto curr : m_functions_cache)
         {
             if (curr.second != NULL)
@@ -340,8 +468,25 @@ namespace Scripting
         }
         m_functions_cache.clear();
         m_loaded_files.clear();
+        m_cache_generation = g_next_cache_generation++;
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns the function, looking it up first if the cache of the
+    *  engine was cleaned up since the last call.
+    *  \param engine The script engine to use.
+    */
+    asIScriptFunction *ScriptFunction::get(ScriptEngine *engine)
+    {
+        if (m_generation != engine->getCacheGeneration())
+        {
+            m_function   = m_declaration.empty()
+                         ? NULL : engine->getFunction(m_declaration);
+            m_generation = engine->getCacheGeneration();
+        }
+        return m_function;
+    }   // get
+
     //-----------------------------------------------------------------------------
     /** Configures the script engine by binding functions, enums
     *  \param asIScriptEngine engine = engine to configure
@@ -371,10 +516,17 @@ namespace Scripting
 
     //-----------------------------------------------------------------------------
 
+    /** Compiles a script of the current track into the main module. If
+    *  up-to-date bytecode of the script is found next to it, it is loaded
+    *  instead of compiling the script. Otherwise the bytecode is saved after
+    *  compiling, so the next time the track is loaded it is not compiled
+    *  again.
+    *  \param engine The engine to use.
+    *  \param scriptName File name of the script.
+    *  \return 0 on success, -1 otherwise.
+    */
     int ScriptEngine::compileScript(asIScriptEngine *engine, std::string scriptName)
     {
-        int r;
-
         std::string script = getScript(scriptName);
         if (script.size() == 0)
         {
@@ -382,13 +534,32 @@ namespace Scripting
             return -1;
         }
 
+        const std::string bytecode_file = getScriptPath(scriptName) + "b";
+        if (loadByteCode(bytecode_file, script))
+            return 0;
+
+        if (buildModule(script) < 0)
+            return -1;
+        saveByteCode(bytecode_file, script);
+        return 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    /** Compiles the given script source into the main module.
+    *  \param script The source of the script.
+    *  \return 0 on success, -1 otherwise.
+    */
+    int ScriptEngine::buildModule(const std::string &script)
+    {
+        int r;
+
         // Add the script sections that will be compiled into executable code.
         // If we want to combine more than one file into the same script, then 
         // we can call AddScriptSection() several times for the same module and
         // the script engine will treat them all as if they were one. The script
         // section name, will allow us to localize any errors in the script code.
-        asIScriptModule *mod = engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
-        r = mod->AddScriptSection("script", &script[0], script.size());
+        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+        r = mod->AddScriptSection("script", script.c_str(), script.size());
         if (r < 0)
         {
             Log::error("Scripting", "AddScriptSection() failed");
@@ -418,4 +589,155 @@ namespace Scripting
 
         return 0;
     }
+    //-----------------------------------------------------------------------------
+    /** Loads the main module from a bytecode file, if the file was created
+    *  from the given script source.
+    *  \param filename Name of the bytecode file.
+    *  \param script The source of the script.
+    *  \return True if the module was loaded.
+    */
+    bool ScriptEngine::loadByteCode(const std::string &filename,
+                                    const std::string &script)
+    {
+        MappedFile file;
+        if (!file.open(filename))
+            return false;
+        ByteCodeHeader header;
+        if (file.getSize() < sizeof(header))
+            return false;
+        memcpy(&header, file.getData(), sizeof(header));
+        if (memcmp(header.m_magic, BYTECODE_MAGIC, 4) != 0 ||
+            header.m_angelscript_version != ANGELSCRIPT_VERSION ||
+            header.m_source_hash != getSourceHash(script))
+        {
+            Log::info("Scripting", "Bytecode '%s' is outdated.",
+                      filename.c_str());
+            return false;
+        }
+
+        ByteCodeReader reader(file.getData() + sizeof(header),
+                              file.getSize() - sizeof(header));
+        asIScriptModule *mod =
+            m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+        if (mod->LoadByteCode(&reader) < 0 || reader.hasError())
+        {
+            Log::warn("Scripting", "Could not load bytecode '%s'.",
+                      filename.c_str());
+            m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
+            return false;
+        }
+        return true;
+    }   // loadByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Saves the main module as bytecode. Failing to save is not an error,
+    *  since the data directory might not be writable.
+    *  \param filename Name of the bytecode file.
+    *  \param script The source the module was compiled from.
+    */
+    void ScriptEngine::saveByteCode(const std::string &filename,
+                                    const std::string &script)
+    {
+        FILE *fd = fopen(filename.c_str(), "wb");
+        if (!fd)
+        {
+            Log::debug("Scripting", "Can't write bytecode '%s'.",
+                       filename.c_str());
+            return;
+        }
+        ByteCodeHeader header;
+        memcpy(header.m_magic, BYTECODE_MAGIC, 4);
+        header.m_angelscript_version = ANGELSCRIPT_VERSION;
+        header.m_source_hash         = getSourceHash(script);
+        ByteCodeWriter writer(fd);
+        writer.Write(&header, sizeof(header));
+        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE);
+        bool ok = mod->SaveByteCode(&writer) >= 0 && !writer.hasError();
+        ok = fclose(fd) == 0 && ok;
+        if (!ok)
+        {
+            Log::warn("Scripting", "Could not write bytecode '%s'.",
+                      filename.c_str());
+            remove(filename.c_str());
+        }
+    }   // saveByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Measures calling a collision callback 10000 times, both the way it
+    *  was done before (looking up the function by name and creating a new
+    *  context for each call) and with a function handle and the context
+    *  pool. Also compares compiling the script with loading its bytecode.
+    */
+    void ScriptEngine::benchmark()
+    {
+        const std::string script =
+            "int total = 0;\n"
+            "void onKartKartCollision(int kart1, int kart2)\n"
+            "{\n"
+            "    total += kart1 + kart2;\n"
+            "}\n";
+        const std::string declaration = "void onKartKartCollision(int, int)";
+        const int num_calls = 10000;
+
+        ScriptEngine engine;
+        double start = StkTime::getRealTime();
+        if (engine.buildModule(script) < 0)
+            return;
+        double compile_time = StkTime::getRealTime() - start;
+
+        const std::string bytecode_file =
+            file_manager->getUserConfigFile("script-benchmark.asb");
+        engine.saveByteCode(bytecode_file, script);
+        start = StkTime::getRealTime();
+        bool loaded = engine.loadByteCode(bytecode_file, script);
+        double load_time = StkTime::getRealTime() - start;
+        remove(bytecode_file.c_str());
+        Log::info("Scripting", "Compiling: %.3f ms, loading bytecode: "
+                  "%.3f ms%s.", compile_time*1000, load_time*1000,
+                  loaded ? "" : " (loading failed)");
+
+        // There is no track, so mark the script as loaded
+        engine.m_loaded_files["scripting.as"] = true;
+        asIScriptFunction *func = engine.getFunction(declaration);
+        if (func == NULL)
+        {
+            Log::error("Scripting", "Benchmark function not found.");
+            return;
+        }
+
+        // Old way: lookup by name and a new context for each call
+        start = StkTime::getRealTime();
+        for (int i = 0; i < num_calls; i++)
+        {
+            asIScriptFunction *f =
+                engine.m_functions_cache.find("void " +
+                    std::string("onKartKartCollision") + "(int, int)")->second;
+            asIScriptContext *ctx = engine.m_engine->CreateContext();
+            ctx->Prepare(f);
+            ctx->SetArgDWord(0, i % 20);
+            ctx->SetArgDWord(1, (i + 1) % 20);
+            ctx->Execute();
+            ctx->Release();
+        }
+        double old_time = StkTime::getRealTime() - start;
+
+        ScriptFunction handle(declaration);
+        start = StkTime::getRealTime();
+        for (int i = 0; i < num_calls; i++)
+        {
+            engine.runFunction(&handle,
+                [=](asIScriptContext* ctx) {
+                    ctx->SetArgDWord(0, i % 20);
+                    ctx->SetArgDWord(1, (i + 1) % 20);
+                });
+        }
+        double new_time = StkTime::getRealTime() - start;
+
+        Log::info("Scripting", "%d callbacks by name with new contexts: "
+                  "%.3f ms (%.0f calls/s).", num_calls, old_time*1000,
+                  num_calls/old_time);
+        Log::info("Scripting", "%d callbacks by handle with pooled "
+                  "contexts: %.3f ms (%.0f calls/s).", num_calls,
+                  new_time*1000, num_calls/new_time);
+    }   // benchmark
 }
@@ -19,37 +19,119 @@
 #ifndef HEADER_SCRIPT_ENGINE_HPP
 #define HEADER_SCRIPT_ENGINE_HPP
 
-#include <string>
 #include <angelscript.h>
 #include <functional>
+#include <map>
+#include <string>
+#include <vector>
 
 class TrackObjectPresentation;
 
 namespace Scripting
 {
+    class ScriptEngine;
+
+    /** A handle for a script function which is looked up by its declaration
+     *  only the first time it is called, so that frequently called functions
+     *  (e.g. collision callbacks) do not need to build and look up a string
+     *  each time. The lookup is repeated if the cache of the script engine
+     *  was cleaned up in the meantime (e.g. a new track was loaded).
+     */
+    class ScriptFunction
+    {
+    private:
+        /** Declaration of the function, e.g. "void onStart()". */
+        std::string        m_declaration;
+
+        /** The function, or NULL if it does not exist. */
+        asIScriptFunction *m_function;
+
+        /** Cache generation of the engine m_function was looked up in,
+         *  0 if it was not looked up yet. */
+        unsigned int       m_generation;
+
+    public:
+        ScriptFunction(const std::string &declaration = "")
+            : m_declaration(declaration), m_function(NULL), m_generation(0)
+        {
+        }   // ScriptFunction
+        // --------------------------------------------------------------------
+        /** Sets the declaration of the function to call. */
+        void setDeclaration(const std::string &declaration)
+        {
+            m_declaration = declaration;
+            m_generation  = 0;
+        }   // setDeclaration
+        // --------------------------------------------------------------------
+        /** Returns true if no function is set. */
+        bool isEmpty() const { return m_declaration.empty(); }
+        // --------------------------------------------------------------------
+        asIScriptFunction *get(ScriptEngine *engine);
+    };   // class ScriptFunction
+
+    // ========================================================================
     class ScriptEngine
     {
     public:
+        typedef std::function<void(asIScriptContext*)> ContextCallback;
 
         ScriptEngine();
         ~ScriptEngine();
 
-        void runFunction(std::string function_name);
-        void runFunction(std::string function_name,
-            std::function<void(asIScriptContext*)> callback);
-        void runFunction(std::string function_name,
-            std::function<void(asIScriptContext*)> callback,
-            std::function<void(asIScriptContext*)> get_return_value);
+        void runFunction(const std::string &function_name);
+        void runFunction(const std::string &function_name,
+                         const ContextCallback &callback);
+        void runFunction(const std::string &function_name,
+                         const ContextCallback &callback,
+                         const ContextCallback &get_return_value);
+        void runFunction(asIScriptFunction *func,
+                         const ContextCallback &callback,
+                         const ContextCallback &get_return_value);
+        asIScriptFunction *getFunction(const std::string &function_name);
         void evalScript(std::string script_fragment);
         void cleanupCache();
+        static void benchmark();
+
+        // --------------------------------------------------------------------
+        /** Runs the function of the given handle. */
+        void runFunction(ScriptFunction *func,
+                         const ContextCallback &callback = ContextCallback(),
+                         const ContextCallback &get_return_value
+                                                          = ContextCallback())
+        {
+            asIScriptFunction *f = func->get(this);
+            if (f)
+                runFunction(f, callback, get_return_value);
+        }   // runFunction
+        // --------------------------------------------------------------------
+        /** Returns the generation of the function cache, which is changed
+         *  each time the cache is cleaned up. */
+        unsigned int getCacheGeneration() const { return m_cache_generation; }
 
     private:
         asIScriptEngine *m_engine;
         std::map<std::string, bool> m_loaded_files;
         std::map<std::string, asIScriptFunction*> m_functions_cache;
 
+        /** Contexts which are not in use, stored by the function they were
+         *  last prepared for. Preparing a context again for the same
+         *  function is much cheaper than creating a new context. */
+        std::map<asIScriptFunction*,
+                 std::vector<asIScriptContext*> > m_context_pool;
+
+        /** See getCacheGeneration(). */
+        unsigned int m_cache_generation;
+
         void configureEngine(asIScriptEngine *engine);
         int  compileScript(asIScriptEngine *engine,std::string scriptName);
+        int  buildModule(const std::string &script);
+        bool loadByteCode(const std::string &filename,
+                          const std::string &script);
+        void saveByteCode(const std::string &filename,
+                          const std::string &script);
+        asIScriptContext *getContext(asIScriptFunction *func);
+        void returnContext(asIScriptContext *ctx, asIScriptFunction *func);
+        void releaseContexts();
     };   // class ScriptEngine
 
 }
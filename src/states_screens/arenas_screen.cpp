@@ -160,7 +160,7 @@ void ArenasScreen::eventCallback(Widget* widget, const std::string& name, const
                         tabs->getSelectionIDString(PLAYER_ID_GAME_MASTER), soccer_mode );
             }
 
-            RandomGenerator random;
+            RandomGenerator random(RandomGenerator::ST_LOCAL);
             const int randomID = random.get((int)curr_group.size());
 
             Track* clicked_track = track_manager->getTrack( curr_group[randomID] );
@@ -976,7 +976,7 @@ void KartSelectionScreen::eventCallback(Widget* widget,
 
         UserConfigParams::m_last_used_kart_group = selected_kart_group;
 
-        RandomGenerator random;
+        RandomGenerator random(RandomGenerator::ST_LOCAL);
 
         const int num_players = m_kart_widgets.size();
         for (int n=0; n<num_players; n++)
@@ -1128,7 +1128,7 @@ void KartSelectionScreen::allPlayersDone()
     race_manager->setNumLocalPlayers( players.size() );
 
     // ---- Manage 'random kart' selection(s)
-    RandomGenerator random;
+    RandomGenerator random(RandomGenerator::ST_LOCAL);
 
     //m_kart_widgets.clearAndDeleteAll();
     //race_manager->setLocalKartInfo(0, w->getSelectionIDString());
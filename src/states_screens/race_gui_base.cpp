@@ -1004,7 +1004,7 @@ void RaceGUIBase::drawPlungerInFace(const Camera *camera, float dt)
             {
                 // First time we reach faste state: select random target point
                 // at top of screen and set speed accordingly
-                RandomGenerator random;
+                RandomGenerator random(RandomGenerator::ST_LOCAL);
                 float movement_fraction = 0.3f;
                 int plunger_x_target  = screen_width/2
                     + random.get((int)(screen_width*movement_fraction))
@@ -1017,7 +1017,7 @@ void RaceGUIBase::drawPlungerInFace(const Camera *camera, float dt)
             }
             else
             {
-                RandomGenerator random;
+                RandomGenerator random(RandomGenerator::ST_LOCAL);
                 m_plunger_move_time = 0.1f+random.get(50)/200.0f;
                 // Plunger is either moving or not moving
                 if(m_plunger_state==PLUNGER_STATE_SLOW_1)
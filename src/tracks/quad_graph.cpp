@@ -37,7 +37,9 @@
 #include "tracks/check_manager.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
 #include "graphics/glwrap.hpp"
+#include "utils/time.hpp"
 
 const int QuadGraph::UNKNOWN_SECTOR  = -1;
 QuadGraph *QuadGraph::m_quad_graph = NULL;
@@ -61,6 +63,7 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     m_quad_filename        = quad_file_name;
     m_quad_graph           = this;
     load(graph_file_name);
+    buildSectorGrids();
 }   // QuadGraph
 
 // -----------------------------------------------------------------------------
@@ -821,8 +824,8 @@ void QuadGraph::spatialToTrack(Vec3 *dst, const Vec3& xyz,
  *         selected way in case of a branch, and also to make sure that it
  *         doesn't skip e.g. a loop (see explanation below for details).
  */
-void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
-                                std::vector<int> *all_sectors) const
+void QuadGraph::findRoadSectorLinear(const Vec3& xyz, int *sector,
+                                     const std::vector<int> *all_sectors) const
 {
     // Most likely the kart will still be on the sector it was before,
     // so this simple case is tested first.
@@ -867,7 +870,7 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     }   // for i<m_all_nodes.size()
 
     return;
-}   // findRoadSector
+}   // findRoadSectorLinear
 
 //-----------------------------------------------------------------------------
 /** findOutOfRoadSector finds the sector where XYZ is, but as it name
@@ -897,9 +900,9 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     until the next higher overlapping line segment, and find the closest
     one to XYZ.
  */
-int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
-                                   const int curr_sector,
-                                   std::vector<int> *all_sectors) const
+int QuadGraph::findOutOfRoadSectorLinear(const Vec3& xyz,
+                                         const int curr_sector,
+                                         const std::vector<int> *all_sectors) const
 {
     int count = (all_sectors!=NULL) ? (int) all_sectors->size() : getNumNodes();
     int current_sector = 0;
@@ -916,7 +919,8 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
         // shortcuts are tested). If this should become a performance
         // bottleneck, we need to set up a graph of 'next' quads for each
         // quad (similar to what the AI does), and only test the quads
-        // in this graph.
+        // in this graph. Note that findOutOfRoadSector uses m_line_grid
+        // instead, which gives the same result as this function.
         const int LIMIT = getNumNodes();
         count           = LIMIT;
         // Start 10 quads before the current quad, so the quads closest
@@ -968,6 +972,274 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
             return min_sector;
     }   // phase
 
+    if(min_sector==UNKNOWN_SECTOR )
+    {
+        Log::info("Quad Grap", "unknown sector found.");
+    }
+    return min_sector;
+}   // findOutOfRoadSectorLinear
+
+//-----------------------------------------------------------------------------
+/** Returns true if the triangle a, b, c is (nearly) degenerated, i.e. its
+ *  smallest height is very small. The side-of-line tests in pointInQuad
+ *  are not reliable for such triangles.
+ */
+static bool isSliver(const Vec3 &a, const Vec3 &b, const Vec3 &c)
+{
+    const float area_2 = fabsf(c.sideOfLine2D(a, b));
+    const Vec3 ab = b-a, bc = c-b, ca = a-c;
+    const float max_len_2 =
+        std::max(std::max(ab.getX()*ab.getX() + ab.getZ()*ab.getZ(),
+                          bc.getX()*bc.getX() + bc.getZ()*bc.getZ()),
+                          ca.getX()*ca.getX() + ca.getZ()*ca.getZ() );
+    // The smallest height of the triangle is area_2/sqrt(max_len_2)
+    return area_2*area_2 < 0.01f*max_len_2;
+}   // isSliver
+
+//-----------------------------------------------------------------------------
+/** Builds the grids used to speed up findRoadSector and findOutOfRoadSector.
+ *  The bounding boxes are slightly increased so that floating point errors
+ *  in the tests can never put a point outside of the box of a node it is
+ *  considered to be on (or close to).
+ */
+void QuadGraph::buildSectorGrids()
+{
+    const float margin = 0.05f;
+    std::vector<SectorGrid::Box> quad_boxes, line_boxes;
+    m_degenerated_quads.clear();
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        SectorGrid::Box box;
+        if(isSliver(q[0], q[1], q[2]) || isSliver(q[0], q[2], q[3]))
+        {
+            m_degenerated_quads.push_back(i);
+            // Use an empty box, so the node is not stored in the grid
+            box.m_min_x = box.m_min_z =  1.0f;
+            box.m_max_x = box.m_max_z = -1.0f;
+            quad_boxes.push_back(box);
+        }
+        else
+        {
+            box.m_min_x = std::min(std::min(q[0].getX(), q[1].getX()),
+                                   std::min(q[2].getX(), q[3].getX())) - margin;
+            box.m_max_x = std::max(std::max(q[0].getX(), q[1].getX()),
+                                   std::max(q[2].getX(), q[3].getX())) + margin;
+            box.m_min_z = std::min(std::min(q[0].getZ(), q[1].getZ()),
+                                   std::min(q[2].getZ(), q[3].getZ())) - margin;
+            box.m_max_z = std::max(std::max(q[0].getZ(), q[1].getZ()),
+                                   std::max(q[2].getZ(), q[3].getZ())) + margin;
+            quad_boxes.push_back(box);
+        }
+
+        const Vec3 &lower = m_all_nodes[i]->getLowerCenter();
+        const Vec3 &upper = m_all_nodes[i]->getUpperCenter();
+        box.m_min_x = std::min(lower.getX(), upper.getX()) - margin;
+        box.m_max_x = std::max(lower.getX(), upper.getX()) + margin;
+        box.m_min_z = std::min(lower.getZ(), upper.getZ()) - margin;
+        box.m_max_z = std::max(lower.getZ(), upper.getZ()) + margin;
+        line_boxes.push_back(box);
+    }   // for i < m_all_nodes.size()
+
+    m_quad_grid.build(quad_boxes, /*min cell size*/ 10.0f, /*max cells*/256);
+    m_line_grid.build(line_boxes, /*min cell size*/ 10.0f, /*max cells*/256);
+}   // buildSectorGrids
+
+//-----------------------------------------------------------------------------
+/** findRoadSector returns in which sector on the road the position
+ *  xyz is. If xyz is not on top of the road, it sets UNKNOWN_SECTOR as sector.
+ *  Unless a list of sectors to test is given, only the nodes in the grid
+ *  cell of xyz are tested. The result is identical to testing all nodes
+ *  (see findRoadSectorLinear): of all quads the point is on the one with
+ *  the smallest height difference is used, and if there is more than one,
+ *  the first one in the order findRoadSectorLinear tests them.
+ *
+ *  \param xyz Position for which the segment should be determined.
+ *  \param sector Contains the previous sector (as a shortcut, since usually
+ *         the sector is the same as the last one), and on return the result
+ *  \param all_sectors If this is not NULL, it is a list of all sectors to
+ *         test. This is used by the AI to make sure that it ends up on the
+ *         selected way in case of a branch, and also to make sure that it
+ *         doesn't skip e.g. a loop.
+ */
+void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
+                               const std::vector<int> *all_sectors) const
+{
+    if(all_sectors || m_quad_grid.isEmpty())
+    {
+        findRoadSectorLinear(xyz, sector, all_sectors);
+        return;
+    }
+
+    // Most likely the kart will still be on the sector it was before,
+    // so this simple case is tested first.
+    if(*sector!=UNKNOWN_SECTOR && getQuadOfNode(*sector).pointInQuad(xyz) )
+    {
+        return;
+    }   // if still on same quad
+
+    // The linear search starts with the node after the current one.
+    const int num_nodes  = (int)m_all_nodes.size();
+    const int first_node = *sector<num_nodes-1 ? *sector+1 : 0;
+
+    unsigned int count;
+    const int *nodes = m_quad_grid.getNodes(m_quad_grid.getCellX(xyz.getX()),
+                                            m_quad_grid.getCellZ(xyz.getZ()),
+                                            &count);
+    *sector        = UNKNOWN_SECTOR;
+    float min_dist = 999999.9f;
+    int   min_rank = num_nodes;
+    // First test the nodes in the cell of xyz, then all degenerated quads
+    // (which are not stored in the grid).
+    for(int list=0; list<2; list++)
+    {
+        if(list==1)
+        {
+            count = (unsigned int)m_degenerated_quads.size();
+            nodes = count>0 ? &m_degenerated_quads[0] : NULL;
+        }
+        for(unsigned int i=0; i<count; i++)
+        {
+            const int indx = nodes[i];
+            const Quad &q  = getQuadOfNode(indx);
+            float dist     = xyz.getY() - q.getMinHeight();
+            // Position of this node in the order of the linear search
+            const int rank = (indx - first_node + num_nodes) % num_nodes;
+            if(dist>min_dist || (dist==min_dist && rank>min_rank))
+                continue;
+            if(dist==min_dist && *sector==UNKNOWN_SECTOR)
+                continue;
+            // While negative distances are unlikely, we allow some small
+            // negative numbers in case that the kart is partly in the track.
+            if(dist>-1.0f && q.pointInQuad(xyz))
+            {
+                min_dist = dist;
+                min_rank = rank;
+                *sector  = indx;
+            }
+        }   // for i<count
+    }   // for list<2
+}   // findRoadSector
+
+//-----------------------------------------------------------------------------
+/** Finds the graph node whose center line is closest (in 2d) to the given
+ *  point, by searching the line grid in rings of growing size around the
+ *  cell of the point. If several nodes have the same distance, the one that
+ *  findOutOfRoadSectorLinear would test first is returned.
+ *  \param xyz The point.
+ *  \param first_node The first node that findOutOfRoadSectorLinear tests.
+ *  \param test_height If true, only nodes that are not too far below or
+ *         above the point are considered.
+ */
+int QuadGraph::findClosestNode(const Vec3& xyz, int first_node,
+                               bool test_height) const
+{
+    const int num_nodes = (int)m_all_nodes.size();
+    const int cell_x    = m_line_grid.getCellX(xyz.getX());
+    const int cell_z    = m_line_grid.getCellZ(xyz.getZ());
+    const int max_ring  = m_line_grid.getMaxRing(cell_x, cell_z);
+
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_rank   = num_nodes;
+    float min_dist_2 = 999999.0f*999999.0f;
+    // Rings closer to the point than the grid don't contain any cells.
+    int ring = std::max(std::max(-cell_x, cell_x-(m_line_grid.getNumX()-1)),
+                        std::max(-cell_z, cell_z-(m_line_grid.getNumZ()-1)));
+    for(ring=std::max(ring, 0); ring<=max_ring; ring++)
+    {
+        // Only test the cells of this ring that are inside of the grid.
+        const int min_x = std::max(cell_x-ring, 0);
+        const int max_x = std::min(cell_x+ring, m_line_grid.getNumX()-1);
+        const int min_z = std::max(cell_z-ring, 0);
+        const int max_z = std::min(cell_z+ring, m_line_grid.getNumZ()-1);
+        for(int x=min_x; x<=max_x; x++)
+        {
+            // Only the border of the ring needs to be tested, the inside
+            // was done with the previous rings.
+            const bool full_column = x==cell_x-ring || x==cell_x+ring;
+            for(int z=min_z; z<=max_z; z++)
+            {
+                if(!full_column && z!=cell_z-ring && z!=cell_z+ring)
+                {
+                    // Skip to the bottom border of the ring
+                    if(z<cell_z+ring) z = cell_z+ring-1;
+                    continue;
+                }
+                unsigned int count;
+                const int *nodes = m_line_grid.getNodes(x, z, &count);
+                for(unsigned int i=0; i<count; i++)
+                {
+                    const int indx = nodes[i];
+                    float dist_2 =
+                        m_all_nodes[indx]->getDistance2FromPoint(xyz);
+                    const int rank = (indx-first_node+num_nodes) % num_nodes;
+                    if(dist_2>min_dist_2 ||
+                       (dist_2==min_dist_2 &&
+                        (min_sector==UNKNOWN_SECTOR || rank>=min_rank)))
+                        continue;
+                    if(test_height)
+                    {
+                        const Quad &q = getQuadOfNode(indx);
+                        float dist    = xyz.getY() - q.getMinHeight();
+                        if(dist >= 5.0f || dist <= -1.0f)
+                            continue;
+                    }
+                    min_dist_2 = dist_2;
+                    min_rank   = rank;
+                    min_sector = indx;
+                }   // for i < count
+            }   // for z
+        }   // for x
+
+        // All nodes not tested so far are in cells which are at least
+        // ring cells away from the point. Use a small safety margin so
+        // that rounding errors can't skip a node with the same distance.
+        if(min_sector!=UNKNOWN_SECTOR)
+        {
+            const float d = ring*m_line_grid.getCellSize();
+            if(min_dist_2 < d*d*0.999f)
+                break;
+        }
+    }   // for ring <= max_ring
+    return min_sector;
+}   // findClosestNode
+
+//-----------------------------------------------------------------------------
+/** findOutOfRoadSector finds the sector where XYZ is, but as it name
+ *  implies, it is more accurate for the outside of the track than the
+ *  inside. See findOutOfRoadSectorLinear for details. Unless a list of
+ *  sectors to test is specified, this uses m_line_grid to only test nodes
+ *  close to xyz, but returns exactly the same result as
+ *  findOutOfRoadSectorLinear.
+ *  \param xyz The point for which to find the sector.
+ *  \param curr_sector The sector the point was on before, or UNKNOWN_SECTOR.
+ *  \param all_sectors If not NULL, only these sectors are tested.
+ */
+int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
+                                   const int curr_sector,
+                                   const std::vector<int> *all_sectors) const
+{
+    if(all_sectors || m_line_grid.isEmpty())
+        return findOutOfRoadSectorLinear(xyz, curr_sector, all_sectors);
+
+    // Determine the first node the linear search would test, which is
+    // needed to handle nodes with identical distances the same way.
+    const int num_nodes = getNumNodes();
+    int current_sector  = 0;
+    if(curr_sector != UNKNOWN_SECTOR)
+    {
+        current_sector = curr_sector - 10;
+        if(current_sector<0) current_sector += num_nodes;
+    }
+    const int first_node = current_sector+1 == num_nodes ? 0
+                                                         : current_sector+1;
+
+    // First test with height condition, then again without - just to make
+    // sure it always comes back with some kind of quad.
+    int min_sector = findClosestNode(xyz, first_node, /*test_height*/true);
+    if(min_sector==UNKNOWN_SECTOR)
+        min_sector = findClosestNode(xyz, first_node, /*test_height*/false);
+
     if(min_sector==UNKNOWN_SECTOR )
     {
         Log::info("Quad Grap", "unknown sector found.");
@@ -975,6 +1247,114 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
     return min_sector;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Randomised test that the grid based findRoadSector and findOutOfRoadSector
+ *  return exactly the same results as testing all graph nodes. This is done
+ *  for the drivelines of all tracks, and it prints the time per lookup for
+ *  both approaches.
+ */
+void QuadGraph::unitTesting()
+{
+    assert(m_quad_graph==NULL);
+    const int num_points = 2000;
+    for(unsigned int t=0; t<track_manager->getNumberOfTracks(); t++)
+    {
+        const Track *track = track_manager->getTrack(t);
+        if(track->isArena() || track->isSoccer())
+            continue;
+        const std::string quads = track->getTrackFile("quads.xml");
+        if(!file_manager->fileExists(quads))
+            continue;
+        for(int reverse=0; reverse<2; reverse++)
+        {
+            if(reverse && !track->reverseAvailable())
+                continue;
+            create(quads, track->getTrackFile("graph.xml"), reverse==1);
+            QuadGraph *qg = get();
+            const int num_nodes = qg->getNumNodes();
+            if(num_nodes==0)
+            {
+                destroy();
+                continue;
+            }
+            Vec3 min, max;
+            QuadSet::get()->getBoundingBox(&min, &max);
+
+            std::vector<Vec3> points;
+            std::vector<int>  sectors;
+            for(int i=0; i<num_points; i++)
+            {
+                Vec3 xyz;
+                if(i%2==0)
+                {
+                    // A point on (or close to) a random quad
+                    const Quad &q = qg->getQuadOfNode(rand()%num_nodes);
+                    float f[4], sum = 0;
+                    for(int j=0; j<4; j++)
+                    {
+                        f[j] = (float)(rand()%100);
+                        sum += f[j];
+                    }
+                    sum = std::max(sum, 1.0f);
+                    xyz = (q[0]*f[0] + q[1]*f[1] + q[2]*f[2] + q[3]*f[3])
+                        / sum;
+                    xyz.setY(q.getMinHeight() + (rand()%80-20)*0.1f);
+                }
+                else
+                {
+                    // A random point in (or a bit outside of) the track
+                    xyz = Vec3(min.getX() - 20.0f + (rand()%1000)*0.001f
+                                          * (max.getX()-min.getX()+40.0f),
+                               min.getY() -  5.0f + (rand()%1000)*0.001f
+                                          * (max.getY()-min.getY()+10.0f),
+                               min.getZ() - 20.0f + (rand()%1000)*0.001f
+                                          * (max.getZ()-min.getZ()+40.0f));
+                }
+                points.push_back(xyz);
+                sectors.push_back(rand()%4==0 ? UNKNOWN_SECTOR
+                                              : rand()%num_nodes);
+            }   // for i < num_points
+
+            for(int i=0; i<num_points; i++)
+            {
+                int s_linear = sectors[i], s_grid = sectors[i];
+                qg->findRoadSectorLinear(points[i], &s_linear, NULL);
+                qg->findRoadSector(points[i], &s_grid);
+                assert(s_linear==s_grid);
+                assert(qg->findOutOfRoadSectorLinear(points[i], sectors[i],
+                                                     NULL)
+                       == qg->findOutOfRoadSector(points[i], sectors[i]) );
+            }
+
+            double start = StkTime::getRealTime();
+            int sum = 0;
+            for(int i=0; i<num_points; i++)
+            {
+                int s = sectors[i];
+                qg->findRoadSectorLinear(points[i], &s, NULL);
+                sum += s + qg->findOutOfRoadSectorLinear(points[i],
+                                                         sectors[i], NULL);
+            }
+            double linear_time = StkTime::getRealTime() - start;
+            start = StkTime::getRealTime();
+            for(int i=0; i<num_points; i++)
+            {
+                int s = sectors[i];
+                qg->findRoadSector(points[i], &s);
+                sum -= s + qg->findOutOfRoadSector(points[i], sectors[i]);
+            }
+            double grid_time = StkTime::getRealTime() - start;
+            assert(sum==0);
+            Log::info("QuadGraph", "%s%s (%d nodes): linear %f us, "
+                      "grid %f us per lookup.", track->getIdent().c_str(),
+                      reverse ? " (reverse)" : "", num_nodes,
+                      linear_time/num_points*1.0e6,
+                      grid_time/num_points*1.0e6);
+            destroy();
+        }   // for reverse
+    }   // for t < getNumberOfTracks
+}   // unitTesting
+
 //-----------------------------------------------------------------------------
 /** Takes a snapshot of the driveline quads so they can be used as minimap.
  */
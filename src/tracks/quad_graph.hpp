@@ -25,6 +25,7 @@
 
 #include "tracks/graph_node.hpp"
 #include "tracks/quad_set.hpp"
+#include "tracks/sector_grid.hpp"
 #include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
 
@@ -82,6 +83,19 @@ private:
     /** Wether the graph should be reverted or not */
     bool                     m_reverse;
 
+    /** A grid over the 2d bounding boxes of the quads of all graph nodes,
+     *  used to find the quad a point is on. */
+    SectorGrid               m_quad_grid;
+
+    /** Nodes with (nearly) degenerated quads. Due to rounding errors
+     *  pointInQuad can be true for points far outside of such a quad, so
+     *  they are not stored in m_quad_grid, but always tested. */
+    std::vector<int>         m_degenerated_quads;
+
+    /** A grid over the 2d bounding boxes of the center lines of all graph
+     *  nodes, used to find the closest node for a point off the road. */
+    SectorGrid               m_line_grid;
+
     void setDefaultSuccessors();
     void computeChecklineRequirements(GraphNode* node, int latest_checkline);
     void computeDirectionData();
@@ -96,6 +110,13 @@ private:
                     const video::SColor *track_color=NULL,
                     const video::SColor *lap_color=NULL);
     unsigned int getStartNode() const;
+    void buildSectorGrids();
+    void findRoadSectorLinear(const Vec3& xyz, int *sector,
+                              const std::vector<int> *all_sectors) const;
+    int  findOutOfRoadSectorLinear(const Vec3& xyz, const int curr_sector,
+                                   const std::vector<int> *all_sectors) const;
+    int  findClosestNode(const Vec3& xyz, int first_node,
+                         bool test_height) const;
          QuadGraph     (const std::string &quad_file_name,
                         const std::string &graph_file_name,
                         const bool reverse);
@@ -111,10 +132,10 @@ public:
     void         spatialToTrack(Vec3 *dst, const Vec3& xyz,
                                 const int sector)               const;
     void         findRoadSector(const Vec3& XYZ, int *sector,
-                            std::vector<int> *all_sectors=NULL) const;
+                            const std::vector<int> *all_sectors=NULL) const;
     int          findOutOfRoadSector(const Vec3& xyz,
                                      const int curr_sector=UNKNOWN_SECTOR,
-                                     std::vector<int> *all_sectors=NULL
+                                     const std::vector<int> *all_sectors=NULL
                                      ) const;
     void         setDefaultStartPositions(AlignedArray<btTransform>
                                                        *start_transforms,
@@ -133,6 +154,7 @@ public:
                                                  unsigned int count);
     void         setupPaths();
     void         computeChecklineRequirements();
+    static void  unitTesting();
 // ----------------------------------------------------------------------======
     /** Returns the one instance of this object. It is possible that there
      *  is no instance created (e.g. in battle mode, since it doesn't have
@@ -0,0 +1,139 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "tracks/sector_grid.hpp"
+
+#include <algorithm>
+#include <stdlib.h>
+
+SectorGrid::SectorGrid()
+{
+    m_min_x = m_min_z = 0.0f;
+    m_cell_size = m_inv_cell_size = 1.0f;
+    m_num_x = m_num_z = 0;
+}   // SectorGrid
+
+// ----------------------------------------------------------------------------
+/** Builds the grid. The node index of each box is its index in the vector.
+ *  Empty boxes (minimum bigger than maximum) are not added to any cell.
+ *  \param boxes The bounding boxes of all nodes.
+ *  \param min_cell_size Minimum size of a cell.
+ *  \param max_cells Maximum number of cells in each direction. If the
+ *         bounding box of all nodes is too big, the cell size is increased.
+ */
+void SectorGrid::build(const std::vector<Box> &boxes, float min_cell_size,
+                       int max_cells)
+{
+    m_cell_start.clear();
+    m_cell_nodes.clear();
+    m_num_x = m_num_z = 0;
+    bool found = false;
+    float max_x = 0.0f, max_z = 0.0f;
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        if(boxes[i].m_min_x > boxes[i].m_max_x ||
+           boxes[i].m_min_z > boxes[i].m_max_z    )
+            continue;
+        if(!found)
+        {
+            m_min_x = boxes[i].m_min_x;  max_x = boxes[i].m_max_x;
+            m_min_z = boxes[i].m_min_z;  max_z = boxes[i].m_max_z;
+            found   = true;
+            continue;
+        }
+        m_min_x = std::min(m_min_x, boxes[i].m_min_x);
+        m_min_z = std::min(m_min_z, boxes[i].m_min_z);
+        max_x   = std::max(max_x,   boxes[i].m_max_x);
+        max_z   = std::max(max_z,   boxes[i].m_max_z);
+    }
+    if(!found)
+        return;
+    m_cell_size = std::max(min_cell_size,
+                           std::max(max_x-m_min_x, max_z-m_min_z)/max_cells);
+    m_inv_cell_size = 1.0f/m_cell_size;
+    // Note that the maximum coordinate can be exactly on the border of the
+    // last cell, so there can be max_cells+1 cells.
+    m_num_x = getCellX(max_x)+1;
+    m_num_z = getCellZ(max_z)+1;
+
+    // First count the number of nodes in each cell, then convert the
+    // counts into start indices, and then fill in the nodes.
+    m_cell_start.resize(m_num_x*m_num_z+1, 0);
+    for(int pass=0; pass<2; pass++)
+    {
+        std::vector<unsigned int> next;
+        if(pass==1)
+        {
+            unsigned int sum = 0;
+            for(unsigned int i=0; i<m_cell_start.size(); i++)
+            {
+                unsigned int count = m_cell_start[i];
+                m_cell_start[i] = sum;
+                sum += count;
+            }
+            m_cell_nodes.resize(sum);
+            next = m_cell_start;
+        }
+        for(unsigned int i=0; i<boxes.size(); i++)
+        {
+            int x0 = std::max(0, getCellX(boxes[i].m_min_x));
+            int x1 = std::min(m_num_x-1, getCellX(boxes[i].m_max_x));
+            int z0 = std::max(0, getCellZ(boxes[i].m_min_z));
+            int z1 = std::min(m_num_z-1, getCellZ(boxes[i].m_max_z));
+            for(int z=z0; z<=z1; z++)
+            {
+                for(int x=x0; x<=x1; x++)
+                {
+                    if(pass==0)
+                        m_cell_start[z*m_num_x+x]++;
+                    else
+                        m_cell_nodes[next[z*m_num_x+x]++] = i;
+                }   // for x
+            }   // for z
+        }   // for i<boxes.size()
+    }   // for pass
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Returns the nodes stored in a cell, sorted by node index.
+ *  \param x, z Index of the cell, can be outside of the grid.
+ *  \param count On return the number of nodes.
+ */
+const int* SectorGrid::getNodes(int x, int z, unsigned int *count) const
+{
+    if(x<0 || x>=m_num_x || z<0 || z>=m_num_z)
+    {
+        *count = 0;
+        return NULL;
+    }
+    const unsigned int start = m_cell_start[z*m_num_x+x];
+    *count = m_cell_start[z*m_num_x+x+1] - start;
+    return *count>0 ? &m_cell_nodes[start] : NULL;
+}   // getNodes
+
+// ----------------------------------------------------------------------------
+/** Returns the largest distance (in cells, using the maximum norm) from
+ *  the given cell to any cell of the grid. All cells of the grid are
+ *  covered by the rings 0 to this value around the given cell.
+ *  \param x, z Index of the cell, can be outside of the grid.
+ */
+int SectorGrid::getMaxRing(int x, int z) const
+{
+    return std::max(std::max(abs(x), abs(x-(m_num_x-1))),
+                    std::max(abs(z), abs(z-(m_num_z-1))) );
+}   // getMaxRing
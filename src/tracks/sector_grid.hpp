@@ -0,0 +1,99 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SECTOR_GRID_HPP
+#define HEADER_SECTOR_GRID_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <math.h>
+#include <vector>
+
+/**
+ *  \brief A static uniform grid in the XZ plane over the graph nodes of the
+ *  quad graph.
+ *  Each node is stored in all cells overlapped by its 2d bounding box,
+ *  the nodes of each cell are sorted by node index. The grid is built once
+ *  when the quad graph is loaded and never changed afterwards, so it can
+ *  be queried from several threads at the same time. The cells are stored
+ *  in one flat array (with an index of the first node of each cell) to
+ *  keep lookups cache friendly.
+ * \ingroup tracks
+ */
+class SectorGrid : public NoCopy
+{
+public:
+    /** A 2d bounding box in the XZ plane. */
+    struct Box
+    {
+        float m_min_x, m_min_z, m_max_x, m_max_z;
+    };   // Box
+
+private:
+    /** Minimum coordinates of the grid. */
+    float m_min_x, m_min_z;
+
+    /** Size of a cell, and its inverse. */
+    float m_cell_size, m_inv_cell_size;
+
+    /** Number of cells in X and Z direction. */
+    int   m_num_x, m_num_z;
+
+    /** Index into m_cell_nodes of the first node of each cell. Cell (x,z)
+     *  contains the nodes from m_cell_start[z*m_num_x+x] to
+     *  m_cell_start[z*m_num_x+x+1]-1. */
+    std::vector<unsigned int> m_cell_start;
+
+    /** The node indices of all cells. */
+    std::vector<int> m_cell_nodes;
+
+public:
+         SectorGrid();
+    void build(const std::vector<Box> &boxes, float min_cell_size,
+               int max_cells);
+    const int* getNodes(int x, int z, unsigned int *count) const;
+    int  getMaxRing(int x, int z) const;
+    // ------------------------------------------------------------------------
+    /** Returns true if the grid does not contain any node. */
+    bool isEmpty() const { return m_cell_nodes.empty(); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of cells in X direction. */
+    int getNumX() const { return m_num_x; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of cells in Z direction. */
+    int getNumZ() const { return m_num_z; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of a cell. */
+    float getCellSize() const { return m_cell_size; }
+    // ------------------------------------------------------------------------
+    /** Returns the x index of the cell containing the given X coordinate.
+     *  The result can be outside of the grid. */
+    int getCellX(float x) const
+    {
+        return (int)floorf((x-m_min_x)*m_inv_cell_size);
+    }   // getCellX
+    // ------------------------------------------------------------------------
+    /** Returns the z index of the cell containing the given Z coordinate.
+     *  The result can be outside of the grid. */
+    int getCellZ(float z) const
+    {
+        return (int)floorf((z-m_min_z)*m_inv_cell_size);
+    }   // getCellZ
+};   // SectorGrid
+
+#endif
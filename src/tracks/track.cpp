@@ -41,13 +41,16 @@
 #include "graphics/stk_text_billboard.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "io/xml_node.hpp"
 #include "items/item.hpp"
 #include "items/item_manager.hpp"
 #include "karts/abstract_kart.hpp"
+#include "karts/controller/ai_path.hpp"
 #include "karts/kart_properties.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/easter_egg_hunt.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/world.hpp"
 #include "physics/physical_object.hpp"
 #include "physics/physics.hpp"
@@ -62,6 +65,7 @@
 #include "tracks/track_object_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
@@ -119,6 +123,7 @@ Track::Track(const std::string &filename)
     m_camera_far            = 1000.0f;
     m_old_rtt_mini_map      = NULL;
     m_new_rtt_mini_map      = NULL;
+    m_sun                   = NULL;
     m_bloom                 = true;
     m_bloom_threshold       = 0.75f;
     m_color_inlevel         = core::vector3df(0.0,1.0, 255.0);
@@ -272,6 +277,7 @@ void Track::reset()
  */
 void Track::cleanup()
 {
+    AIPath::destroyAll();
     QuadGraph::destroy();
     ItemManager::destroy();
     VAOManager::kill();
@@ -308,7 +314,11 @@ void Track::cleanup()
     }
     m_object_physics_only_nodes.clear();
 
-    irr_driver->removeNode(m_sun);
+    if (m_sun)
+    {
+        irr_driver->removeNode(m_sun);
+        m_sun = NULL;
+    }
 
     delete m_track_mesh;
     m_track_mesh = NULL;
@@ -475,10 +485,9 @@ void Track::loadTrackInfo()
     m_sun_specular_color    = video::SColor(255, 255, 255, 255);
     m_sun_diffuse_color     = video::SColor(255, 255, 255, 255);
     m_sun_position          = core::vector3df(0, 10, 10);
-    irr_driver->setSSAORadius(1.);
-    irr_driver->setSSAOK(1.5);
-    irr_driver->setSSAOSigma(1.);
-    XMLNode *root           = file_manager->createXMLTree(m_filename);
+    XMLNode *root           = metadata_index
+                            ? metadata_index->createXMLTree(m_filename)
+                            : file_manager->createXMLTree(m_filename);
 
     if(!root || root->getName()!="track")
     {
@@ -493,9 +502,7 @@ void Track::loadTrackInfo()
     m_designer = StringUtils::xmlDecode(designer);
 
     root->get("version",               &m_version);
-    std::vector<std::string> filenames;
-    root->get("music",                 &filenames);
-    getMusicInformation(filenames, m_music);
+    root->get("music",                 &m_music_filenames);
     root->get("screenshot",            &m_screenshot);
     root->get("gravity",               &m_gravity);
     root->get("soccer",                &m_is_soccer);
@@ -559,7 +566,9 @@ void Track::loadTrackInfo()
     std::string dir = StringUtils::getPath(m_filename);
     std::string easter_name = dir + "/easter_eggs.xml";
 
-    XMLNode *easter = file_manager->createXMLTree(easter_name);
+    XMLNode *easter = metadata_index
+                    ? metadata_index->createXMLTree(easter_name)
+                    : file_manager->createXMLTree(easter_name);
 
     if(easter)
     {
@@ -576,6 +585,20 @@ void Track::loadTrackInfo()
     }
 }   // loadTrackInfo
 
+//-----------------------------------------------------------------------------
+/** Finds the music information for the music files of this track and sets
+ *  the default SSAO parameters. The constructor only reads the xml files, so
+ *  it can be called from a worker thread, but this function uses the music
+ *  manager and the irrlicht driver and must be called from the main thread.
+ */
+void Track::loadMusicInformation()
+{
+    irr_driver->setSSAORadius(1.);
+    irr_driver->setSSAOK(1.5);
+    irr_driver->setSSAOSigma(1.);
+    getMusicInformation(m_music_filenames, m_music);
+}   // loadMusicInformation
+
 //-----------------------------------------------------------------------------
 /** Loads all curves from the XML node.
  */
@@ -666,6 +689,12 @@ void Track::loadQuadGraph(unsigned int mode_id, const bool reverse)
                 "kart mode, but not with AIs\n");
         }
     }
+    else if (ProfileWorld::isNoGraphics())
+    {
+        // Without graphics there is no race gui to show a mini map
+        m_minimap_x_scale = 0;
+        m_minimap_y_scale = 0;
+    }
     else
     {
         //Check whether the hardware can do nonsquare or
@@ -1491,7 +1520,9 @@ void Track::update(float dt)
         script_engine->runFunction("void onStart()");
         m_startup_run = true;
     }
+    PROFILER_PUSH_CPU_MARKER("Track objects", 0x40, 0x40, 0x7F);
     m_track_object_manager->update(dt);
+    PROFILER_POP_CPU_MARKER();
 
     for(unsigned int i=0; i<m_animated_textures.size(); i++)
     {
@@ -1505,20 +1536,6 @@ void Track::update(float dt)
     //script_engine->runScript("void onUpdate()");
 }   // update
 
-// ----------------------------------------------------------------------------
-/** Handles an explosion, i.e. it makes sure that all physical objects are
- *  affected accordingly.
- *  \param pos  Position of the explosion.
- *  \param obj  If the hit was a physical object, this object will be affected
- *              more. Otherwise this is NULL.
- *  \param secondary_hits True if items that are not directly hit should
- *         also be affected. */
-void Track::handleExplosion(const Vec3 &pos, const PhysicalObject *obj,
-                            bool secondary_hits) const
-{
-    m_track_object_manager->handleExplosion(pos, obj, secondary_hits);
-}   // handleExplosion
-
 // ----------------------------------------------------------------------------
 /** Creates a water node. OBSOLETE, kept for backwards compat only
  *  \param node The XML node containing the specifications for the water node.
@@ -1799,7 +1816,11 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     // It's important to execute this BEFORE the code that creates the skycube,
     // otherwise the skycube node could be modified to have fog enabled, which
     // we don't want
-    if (m_use_fog && !UserConfigParams::m_camera_debug && !CVS->isGLSL())
+    // Without graphics only the collision geometry, the quad graph, items
+    // and checklines are needed, so fog, sky and sun are not created.
+    const bool no_graphics = ProfileWorld::isNoGraphics();
+    if (m_use_fog && !UserConfigParams::m_camera_debug && !CVS->isGLSL() &&
+        !no_graphics)
     {
         /* NOTE: if LINEAR type, density does not matter, if EXP or EXP2, start
            and end do not matter */
@@ -1820,7 +1841,11 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     // Sky dome and boxes support
     // --------------------------
     irr_driver->suppressSkyBox();
-    if(m_sky_type==SKY_DOME && m_sky_textures.size() > 0)
+    if(no_graphics)
+    {
+        // No sky needed
+    }
+    else if(m_sky_type==SKY_DOME && m_sky_textures.size() > 0)
     {
         scene::ISceneNode *node = irr_driver->addSkyDome(m_sky_textures[0],
                                                          m_sky_hori_segments,
@@ -1872,28 +1897,31 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         m_sun_position = core::vector3df(500, 250, 250);
     }
 
-    const video::SColorf tmpf(m_sun_diffuse_color);
-    m_sun = irr_driver->addLight(m_sun_position, 0., 0., tmpf.r, tmpf.g, tmpf.b, true);
-
-    if (!CVS->isGLSL())
+    if (!no_graphics)
     {
-        scene::ILightSceneNode *sun = (scene::ILightSceneNode *) m_sun;
+        const video::SColorf tmpf(m_sun_diffuse_color);
+        m_sun = irr_driver->addLight(m_sun_position, 0., 0., tmpf.r, tmpf.g, tmpf.b, true);
 
-        sun->setLightType(video::ELT_DIRECTIONAL);
+        if (!CVS->isGLSL())
+        {
+            scene::ILightSceneNode *sun = (scene::ILightSceneNode *) m_sun;
 
-        // The angle of the light is rather important - let the sun
-        // point towards (0,0,0).
-        if (m_sun_position.getLengthSQ() < 0.03f)
-            // Backward compatibility: if no sun is specified, use the
-            // old hardcoded default angle
-            m_sun->setRotation(core::vector3df(180, 45, 45));
-        else
-            m_sun->setRotation((-m_sun_position).getHorizontalAngle());
+            sun->setLightType(video::ELT_DIRECTIONAL);
+
+            // The angle of the light is rather important - let the sun
+            // point towards (0,0,0).
+            if (m_sun_position.getLengthSQ() < 0.03f)
+                // Backward compatibility: if no sun is specified, use the
+                // old hardcoded default angle
+                m_sun->setRotation(core::vector3df(180, 45, 45));
+            else
+                m_sun->setRotation((-m_sun_position).getHorizontalAngle());
 
-        sun->getLightData().SpecularColor = m_sun_specular_color;
+            sun->getLightData().SpecularColor = m_sun_specular_color;
+        }
+        else
+            irr_driver->createSunInterposer();
     }
-    else
-        irr_driver->createSunInterposer();
 
 
     createPhysicsModel(main_track_count);
@@ -2014,14 +2042,17 @@ void Track::loadObjects(const XMLNode* root, const std::string& path, ModelDefin
         }
         else if (name == "particle-emitter")
         {
-            if (UserConfigParams::m_graphical_effects)
+            if (UserConfigParams::m_graphical_effects &&
+                !ProfileWorld::isNoGraphics())
             {
                 m_track_object_manager->add(*node, parent, model_def_loader);
             }
         }
         else if (name == "sky-dome" || name == "sky-box" || name == "sky-color")
         {
-            handleSky(*node, path);
+            // Don't load the sky textures if they are never shown
+            if (!ProfileWorld::isNoGraphics())
+                handleSky(*node, path);
         }
         else if (name == "end-cameras")
         {
@@ -2388,6 +2419,7 @@ std::vector< std::vector<float> > Track::buildHeightMap()
 /** Returns the rotation of the sun. */
 const core::vector3df& Track::getSunRotation()
 {
+    assert(m_sun);
     return m_sun->getRotation();
 }
 //-----------------------------------------------------------------------------
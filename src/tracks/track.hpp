@@ -55,7 +55,6 @@ class MovingTexture;
 class MusicInformation;
 class ParticleEmitter;
 class ParticleKind;
-class PhysicalObject;
 class TrackObjectManager;
 class TriangleMesh;
 class World;
@@ -154,6 +153,9 @@ private:
     std::string              m_ident;
     std::string              m_screenshot;
     std::vector<MusicInformation*> m_music;
+    /** The music files listed in track.xml. They are converted into music
+     *  information in loadMusicInformation(). */
+    std::vector<std::string> m_music_filenames;
 
     /** Will only be used on overworld */
     std::vector<OverworldChallenge> m_challenges;
@@ -436,6 +438,7 @@ public:
                       ~Track             ();
     void               cleanup           ();
     void               removeCachedData  ();
+    void               loadMusicInformation();
     void               startMusic        () const;
 
     bool               setTerrainHeight(Vec3 *pos) const;
@@ -453,9 +456,6 @@ public:
     /** Sets the current ambient color for a kart with index k. */
     void               setAmbientColor(const video::SColor &color,
                                        unsigned int k);
-    void               handleExplosion(const Vec3 &pos,
-                                       const PhysicalObject *mp,
-                                       bool secondary_hits=true) const;
     void               loadTrackModel  (bool reverse_track = false,
                                         unsigned int mode_id=0);
     bool findGround(AbstractKart *kart);
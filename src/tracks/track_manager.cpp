@@ -21,7 +21,11 @@
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/time.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -132,7 +136,23 @@ std::vector<std::string> TrackManager::getAllTrackIdentifiers()
 }   // getAllTrackNames
 
 //-----------------------------------------------------------------------------
-/** Loads all tracks from the track directory (data/track).
+/** Data for the tasks that parse the track.xml files in parallel. */
+struct ParseTracksData
+{
+    /** The directories of all tracks. */
+    const std::vector<std::string> *m_dirs;
+    /** On return the parsed tracks (NULL if an error occurred). */
+    std::vector<Track*>             m_tracks;
+};   // ParseTracksData
+
+//-----------------------------------------------------------------------------
+/** \brief Searches all track directories for tracks and loads their info.
+ *  The directories are scanned first (listing a directory changes the
+ *  current directory of the file system, so this can not be done in
+ *  parallel). Then all track.xml files are parsed in parallel by the thread
+ *  pool, and the tracks are added in the order of the directories, so that
+ *  the track indices and groups do not depend on the order in which the
+ *  tasks finished.
  */
 void TrackManager::loadTrackList()
 {
@@ -146,25 +166,61 @@ void TrackManager::loadTrackList()
     m_track_avail.clear();
     m_tracks.clear();
 
+    const double start_time = StkTime::getPreciseTime();
+    std::vector<std::string> track_dirs;
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
 
         // First test if the directory itself contains a track:
         // ----------------------------------------------------
-        if(loadTrack(dir)) continue;  // track found, no more tests
+        if(file_manager->fileExists(dir+"track.xml"))
+        {
+            track_dirs.push_back(dir);
+            continue;  // track found, no more tests
+        }
 
         // Then see if a subdir of this dir contains tracks
         // ------------------------------------------------
         std::set<std::string> dirs;
-        file_manager->listFiles(dirs, dir);
+        if(metadata_index)
+            metadata_index->listFiles(dirs, dir);
+        else
+            file_manager->listFiles(dirs, dir);
         for(std::set<std::string>::iterator subdir = dirs.begin();
             subdir != dirs.end(); subdir++)
         {
             if(*subdir=="." || *subdir=="..") continue;
-            loadTrack(dir+*subdir+"/");
+            if(file_manager->fileExists(dir+*subdir+"/track.xml"))
+                track_dirs.push_back(dir+*subdir+"/");
         }   // for dir in dirs
     }   // for i <m_track_search_path.size()
+    const double scan_time = StkTime::getPreciseTime();
+
+    ParseTracksData data;
+    data.m_dirs = &track_dirs;
+    data.m_tracks.resize(track_dirs.size(), NULL);
+    if(thread_pool)
+        thread_pool->run((unsigned int)track_dirs.size(), &parseTrackTask,
+                         &data);
+    else
+    {
+        for(unsigned int i=0; i<track_dirs.size(); i++)
+            parseTrackTask(i, &data);
+    }
+    const double parse_time = StkTime::getPreciseTime();
+
+    for(unsigned int i=0; i<track_dirs.size(); i++)
+    {
+        if(data.m_tracks[i])
+            addTrack(track_dirs[i], data.m_tracks[i]);
+    }
+    const double end_time = StkTime::getPreciseTime();
+
+    Log::info("TrackManager", "Loaded %d tracks in %.1f ms (scan %.1f ms, "
+              "parsing %.1f ms, adding %.1f ms).", m_tracks.size(),
+              (end_time-start_time)*1000, (scan_time-start_time)*1000,
+              (parse_time-scan_time)*1000, (end_time-parse_time)*1000);
 }  // loadTrackList
 
 // ----------------------------------------------------------------------------
@@ -173,10 +229,24 @@ void TrackManager::loadTrackList()
  *  \param dirname Name of the directory to load the track from.
  */
 bool TrackManager::loadTrack(const std::string& dirname)
+{
+    Track *track = parseTrack(dirname);
+    if(!track)
+        return false;
+    return addTrack(dirname, track);
+}   // loadTrack
+
+// ----------------------------------------------------------------------------
+/** Reads the track.xml file of a track. This does not use any graphics or
+ *  global managers, so it can be executed by a worker thread.
+ *  \param dirname Name of the directory to load the track from.
+ *  \return The track, or NULL if the track can not be loaded.
+ */
+Track* TrackManager::parseTrack(const std::string& dirname)
 {
     std::string config_file = dirname+"track.xml";
     if(!file_manager->fileExists(config_file))
-        return false;
+        return NULL;
 
     Track *track;
 
@@ -188,9 +258,32 @@ bool TrackManager::loadTrack(const std::string& dirname)
     {
         Log::error("TrackManager", "Cannot load track <%s> : %s\n",
                 dirname.c_str(), e.what());
-        return false;
+        return NULL;
     }
+    return track;
+}   // parseTrack
+
+// ----------------------------------------------------------------------------
+/** The task executed by the thread pool for each track.xml file.
+ *  \param index Index of the track directory.
+ *  \param data Pointer to the ParseTracksData.
+ */
+void TrackManager::parseTrackTask(unsigned int index, void *data)
+{
+    ParseTracksData *tracks = (ParseTracksData*)data;
+    tracks->m_tracks[index] = parseTrack((*tracks->m_dirs)[index]);
+}   // parseTrackTask
 
+// ----------------------------------------------------------------------------
+/** Checks the version of a parsed track and adds it to the list of tracks
+ *  and to its groups. Must be called from the main thread. The screenshot
+ *  of the track is not loaded here, it is loaded when it is first shown.
+ *  \param dirname Name of the directory of the track.
+ *  \param track The parsed track. It is deleted if it can not be added.
+ *  \return True if the track was added.
+ */
+bool TrackManager::addTrack(const std::string& dirname, Track *track)
+{
     if (track->getVersion()<stk_config->m_min_track_version ||
         track->getVersion()>stk_config->m_max_track_version)
     {
@@ -203,18 +296,14 @@ bool TrackManager::loadTrack(const std::string& dirname)
         delete track;
         return false;
     }
+    track->loadMusicInformation();
     m_all_track_dirs.push_back(dirname);
     m_tracks.push_back(track);
     m_track_avail.push_back(true);
     updateGroups(track);
 
-    // Populate the texture cache with track screenshots
-    // (internal tracks like end cutscene don't have screenshots)
-    if (!track->isInternal())
-        irr_driver->getTexture(track->getScreenshotFile());
-
     return true;
-}   // loadTrack
+}   // addTrack
 
 // ----------------------------------------------------------------------------
 /** Removes a track.
@@ -68,6 +68,9 @@ private:
     std::vector<bool>                        m_track_avail;
 
     void          updateGroups(const Track* track);
+    static Track* parseTrack(const std::string &dirname);
+    static void   parseTrackTask(unsigned int index, void *data);
+    bool          addTrack(const std::string &dirname, Track *track);
 
 public:
                 TrackManager();
@@ -122,10 +122,6 @@ public:
     /** To finish object constructions. Called after the track model
      *  is ready. */
     virtual void init() {};
-    // ------------------------------------------------------------------------
-    /** Called when an explosion happens. As a default does nothing, will
-     *  e.g. be overwritten by physical objects etc. */
-    virtual void handleExplosion(const Vec3& pos, bool directHit) {};
     void         setID(std::string obj_id) { m_id = obj_id; }
 
     // ------------------------------------------------------------------------
@@ -133,9 +129,9 @@ public:
     // ------------------------------------------------------------------------
     const std::string& getType() const { return m_type; }
     // ------------------------------------------------------------------------
-	const std::string getName() const { return m_name; }
+    const std::string& getName() const { return m_name; }
     // ------------------------------------------------------------------------
-    const std::string getID() const { return m_id; }
+    const std::string& getID() const { return m_id; }
     // ------------------------------------------------------------------------
     const std::string getInteraction() const { return m_interaction; }
     // ------------------------------------------------------------------------
@@ -208,6 +204,14 @@ public:
     // ------------------------------------------------------------------------
     /** Returns if a kart can drive on this object. */
     bool isDriveable() const { return m_is_driveable; }
+    // ------------------------------------------------------------------------
+    /** Returns true if this object must be updated every frame, i.e. if it
+     *  has an animation or a presentation that changes over time. */
+    bool isAnimated() const
+    {
+        return m_animator ||
+               (m_presentation && m_presentation->needsUpdate());
+    }   // isAnimated
 
     LEAK_CHECK()
 };   // TrackObject
@@ -30,6 +30,8 @@
 #include <IMeshSceneNode.h>
 #include <ISceneManager.h>
 
+#include <algorithm>
+
 TrackObjectManager::TrackObjectManager()
 {
 }   // TrackObjectManager
@@ -50,6 +52,7 @@ void TrackObjectManager::add(const XMLNode &xml_node, scene::ISceneNode* parent,
     {
         TrackObject *obj = new TrackObject(xml_node, parent, model_def_loader);
         m_all_objects.push_back(obj);
+        addToNameIndex(obj);
         if(obj->isDriveable())
             m_driveable_objects.push_back(obj);
     }
@@ -70,8 +73,26 @@ void TrackObjectManager::init()
     for_in (curr, m_all_objects)
     {
         curr->init();
+        addToUpdateLists(curr);
     }
-}   // reset
+    Log::debug("TrackObjectManager", "%d objects: %d animated, %d dynamic.",
+               m_all_objects.size(), m_animated_objects.size(),
+               m_dynamic_objects.size());
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Adds an object to the list of animated or dynamic objects, depending on
+ *  what needs to be done in its update.
+ *  \param object The object to add.
+ */
+void TrackObjectManager::addToUpdateLists(TrackObject *object)
+{
+    if (object->isAnimated())
+        m_animated_objects.push_back(object);
+    else if (object->getPhysicalObject() &&
+             object->getPhysicalObject()->isDynamic())
+        m_dynamic_objects.push_back(object);
+}   // addToUpdateLists
 // ----------------------------------------------------------------------------
 /** Initialises all track objects.
  */
@@ -93,115 +114,150 @@ void TrackObjectManager::reset()
     }
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Adds the name and the ID of an object to the name index.
+ *  \param object The object to add.
+ */
+void TrackObjectManager::addToNameIndex(TrackObject *object)
+{
+    m_objects_by_name[object->getName()].push_back(object);
+    if (object->getID() != object->getName())
+        m_objects_by_name[object->getID()].push_back(object);
+}   // addToNameIndex
+
+// ----------------------------------------------------------------------------
+/** Removes an object from the name index.
+ *  \param object The object to remove.
+ */
+void TrackObjectManager::removeFromNameIndex(TrackObject *object)
+{
+    const std::string *keys[2] = { &object->getName(), &object->getID() };
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        auto it = m_objects_by_name.find(*keys[i]);
+        if (it == m_objects_by_name.end())
+            continue;
+        std::vector<TrackObject*> &objects = it->second;
+        objects.erase(std::remove(objects.begin(), objects.end(), object),
+                      objects.end());
+        if (objects.empty())
+            m_objects_by_name.erase(it);
+    }
+}   // removeFromNameIndex
+
+// ----------------------------------------------------------------------------
+/** Returns all objects with the given name or ID, or NULL if there is no
+ *  such object.
+ *  \param name Name or ID of the objects.
+ */
+const std::vector<TrackObject*>*
+              TrackObjectManager::findObjects(const std::string &name) const
+{
+    auto it = m_objects_by_name.find(name);
+    return it == m_objects_by_name.end() ? NULL : &it->second;
+}   // findObjects
+
+// ----------------------------------------------------------------------------
+/** Disables a track object, and removes its physical body from the world.
+ *  \param object The object to disable.
+ */
+void TrackObjectManager::disable(TrackObject *object)
+{
+    object->setEnable(false);
+    if (object->getType() == "mesh")
+    {
+        if (object->getPhysicalObject() != NULL)
+            object->getPhysicalObject()->removeBody();
+    }
+}   // disable
+
+// ----------------------------------------------------------------------------
+/** Enables a track object (and resets it), and adds its physical body back
+ *  to the world.
+ *  \param object The object to enable.
+ */
+void TrackObjectManager::enable(TrackObject *object)
+{
+    object->reset();
+    object->setEnable(true);
+    if (object->getType() == "mesh")
+    {
+        if (object->getPhysicalObject() != NULL)
+            object->getPhysicalObject()->addBody();
+    }
+}   // enable
+
 // ----------------------------------------------------------------------------
 /** disables all track objects with a particular ID
  *  \param name Name or ID for disabling
  */
-void TrackObjectManager::disable(std::string name)
+void TrackObjectManager::disable(const std::string &name)
 {
-     for (TrackObject* curr : m_all_objects)
-     {
-        if (curr->getName() == (name) || curr->getID() == (name))
-        {
+    const std::vector<TrackObject*> *objects = findObjects(name);
+    if (!objects)
+        return;
+    for (unsigned int i = 0; i < objects->size(); i++)
+        disable((*objects)[i]);
+}   // disable
 
-			curr->setEnable(false);
-            if (curr->getType() == "mesh")
-            {
-                if (curr->getPhysicalObject()!=NULL)
-                    curr->getPhysicalObject()->removeBody();
-            }
-        }
-     }
-}
 // ----------------------------------------------------------------------------
 /** enables all track objects with a particular ID
  *  \param name Name or ID for enabling
  */
-void TrackObjectManager::enable(std::string name)
+void TrackObjectManager::enable(const std::string &name)
 {
-    for (TrackObject* curr : m_all_objects)
-    {
-        if (curr->getName() == (name) || curr->getID() == (name))
-        {
-            curr->reset();
-            curr->setEnable(true);
-            if (curr->getType() == "mesh")
-            {
-                if (curr->getPhysicalObject() != NULL)
-                curr->getPhysicalObject()->addBody();
-            }
-        }
-    }
-}
+    const std::vector<TrackObject*> *objects = findObjects(name);
+    if (!objects)
+        return;
+    for (unsigned int i = 0; i < objects->size(); i++)
+        enable((*objects)[i]);
+}   // enable
 
 // ----------------------------------------------------------------------------
 /**  returns activation status for all track objects
  *   with a particular ID
  *   \param name Name or ID of track object
  */
-bool TrackObjectManager::getStatus(std::string name)
+bool TrackObjectManager::getStatus(const std::string &name) const
 {
-     for (TrackObject* curr : m_all_objects){
-            if (curr->getName() == (name)||curr->getID()==(name))
-            {
+    const std::vector<TrackObject*> *objects = findObjects(name);
+    //object not found
+    if (!objects)
+        return false;
+    return (*objects)[0]->isEnabled();
+}   // getStatus
 
-				return curr->isEnabled();
-            
-            }
-     }
-     //object not found
-     return false;
-}
 // ----------------------------------------------------------------------------
 /** returns a reference to the track object
  *  with a particular ID
  *  \param name Name or ID of track object
  */
-TrackObject* TrackObjectManager::getTrackObject(std::string name)
+TrackObject* TrackObjectManager::getTrackObject(const std::string &name)
 {
-    for (TrackObject* curr : m_all_objects)
-    {
-        if (curr->getName() == (name) || curr->getID() == (name))
-        {
-
-            return curr;
-
-        }
-    }
+    const std::vector<TrackObject*> *objects = findObjects(name);
     //object not found
-    return NULL;
-}
-/** Handles an explosion, i.e. it makes sure that all physical objects are
- *  affected accordingly.
- *  \param pos  Position of the explosion.
- *  \param obj  If the hit was a physical object, this object will be affected
- *              more. Otherwise this is NULL.
- *  \param secondary_hits True if items that are not directly hit should
- *         also be affected.
- */
-
-void TrackObjectManager::handleExplosion(const Vec3 &pos, const PhysicalObject *mp,
-                                         bool secondary_hits)
-{
-    TrackObject* curr;
-    for_in (curr, m_all_objects)
-    {
-        if(secondary_hits || mp == curr->getPhysicalObject())
-            curr->handleExplosion(pos, mp == curr->getPhysicalObject());
-    }
-}   // handleExplosion
+    if (!objects)
+        return NULL;
+    return (*objects)[0];
+}   // getTrackObject
 
 // ----------------------------------------------------------------------------
-/** Updates all track objects.
+/** Updates all track objects. Static objects are not updated at all, and
+ *  dynamic objects only while their rigid body is not sleeping (bullet
+ *  wakes a body up if it is hit or pushed).
  *  \param dt Time step size.
  */
 void TrackObjectManager::update(float dt)
 {
-    TrackObject* curr;
-    for_in (curr, m_all_objects)
+    for (TrackObject* curr : m_animated_objects)
     {
         curr->update(dt);
     }
+    for (TrackObject* curr : m_dynamic_objects)
+    {
+        if (curr->getPhysicalObject()->needsUpdate())
+            curr->update(dt);
+    }
 }   // update
 
 // ----------------------------------------------------------------------------
@@ -329,6 +385,8 @@ void TrackObjectManager::enableFog(bool enable)
 void TrackObjectManager::insertObject(TrackObject* object)
 {
     m_all_objects.push_back(object);
+    addToNameIndex(object);
+    addToUpdateLists(object);
 }
 
 // ----------------------------------------------------------------------------
@@ -339,6 +397,10 @@ void TrackObjectManager::insertObject(TrackObject* object)
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
     m_all_objects.remove(obj);
+    removeFromNameIndex(obj);
+    m_driveable_objects.remove(obj);
+    m_animated_objects.remove(obj);
+    m_dynamic_objects.remove(obj);
     delete obj;
 }   // removeObject
 
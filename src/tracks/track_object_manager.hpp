@@ -24,11 +24,11 @@
 #include "utils/ptr_vector.hpp"
 
 class Track;
-class Vec3;
 class XMLNode;
 class LODNode;
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
@@ -51,6 +51,26 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** All objects that must be updated every frame (animations, sounds,
+     *  particles, billboards). */
+    PtrVector<TrackObject, REF> m_animated_objects;
+
+    /** All other objects with a dynamic physical object. These are only
+     *  updated while their rigid body is awake. All remaining objects are
+     *  static, their update does nothing and is not called. */
+    PtrVector<TrackObject, REF> m_dynamic_objects;
+
+    /** Maps the name and the ID of each object to all objects with this
+     *  name or ID (in the order of m_all_objects), so that the lookups by
+     *  scripts do not need to search all objects. */
+    std::unordered_map<std::string, std::vector<TrackObject*> >
+                                m_objects_by_name;
+
+    void addToUpdateLists(TrackObject *object);
+    void addToNameIndex(TrackObject *object);
+    void removeFromNameIndex(TrackObject *object);
+    const std::vector<TrackObject*>* findObjects(const std::string &name) const;
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
@@ -59,11 +79,11 @@ public:
     void add(const XMLNode &xml_node, scene::ISceneNode* parent,
              ModelDefinitionLoader& model_def_loader);
     void update(float dt);
-    void handleExplosion(const Vec3 &pos, const PhysicalObject *mp,
-                         bool secondary_hits=true);
-	void disable(std::string name);
-	void enable (std::string name);
-	bool getStatus(std::string name);
+    void disable(const std::string &name);
+    void enable (const std::string &name);
+    void disable(TrackObject *object);
+    void enable (TrackObject *object);
+    bool getStatus(const std::string &name) const;
     void castRay(const btVector3 &from,
                  const btVector3 &to, btVector3 *hit_point,
                  const Material **material, btVector3 *normal = NULL,
@@ -76,7 +96,7 @@ public:
 
     void removeObject(TrackObject* who);
 
-    TrackObject* getTrackObject(std::string name);
+    TrackObject* getTrackObject(const std::string &name);
 
           PtrVector<TrackObject>& getObjects()       { return m_all_objects; }
     const PtrVector<TrackObject>& getObjects() const { return m_all_objects; }
@@ -83,6 +83,10 @@ public:
     virtual void update(float dt) {}
     virtual void move(const core::vector3df& xyz, const core::vector3df& hpr,
         const core::vector3df& scale, bool isAbsoluteCoord) {}
+    // ------------------------------------------------------------------------
+    /** Returns true if update() must be called every frame. Most
+     *  presentations do nothing in update(). */
+    virtual bool needsUpdate() const { return false; }
 
     // ------------------------------------------------------------------------
     /** Returns the position of this TrackObjectPresentation. */
@@ -263,6 +267,7 @@ public:
     virtual ~TrackObjectPresentationSound();
     virtual void onTriggerItemApproached(Item* who) OVERRIDE;
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE { return true; }
     virtual void move(const core::vector3df& xyz, const core::vector3df& hpr,
         const core::vector3df& scale, bool isAbsoluteCoord) OVERRIDE;
     void triggerSound(bool loop);
@@ -291,6 +296,7 @@ public:
                                      scene::ISceneNode* parent);
     virtual ~TrackObjectPresentationBillboard();
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE { return true; }
 };   // TrackObjectPresentationBillboard
 
 
@@ -311,6 +317,7 @@ public:
     virtual ~TrackObjectPresentationParticles();
 
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE { return true; }
     void triggerParticles();
     void stop();
     void setRate(float rate);
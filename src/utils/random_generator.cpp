@@ -18,51 +18,197 @@
 
 #include "utils/random_generator.hpp"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <ctime>
 
 std::vector<RandomGenerator*> RandomGenerator::m_all_random_generators;
+pthread_mutex_t RandomGenerator::m_generators_mutex = PTHREAD_MUTEX_INITIALIZER;
+unsigned int RandomGenerator::m_race_seed      = 0;
+unsigned int RandomGenerator::m_num_race_seeds = 0;
+bool         RandomGenerator::m_race_active    = false;
 
-RandomGenerator::RandomGenerator()
+/** Creates a generator.
+ *  \param type ST_RACE if the generator is seeded from the race seed,
+ *         ST_LOCAL if it is seeded using rand() (for generators that are
+ *         not part of the race simulation).
+ */
+RandomGenerator::RandomGenerator(SeedType type)
 {
     m_a = 1103515245;
     m_c = 12345;
+    m_is_race_generator = type == ST_RACE;
+    if(!m_is_race_generator)
+    {
+        m_random_value = (unsigned int)rand();
+        return;
+    }
+    pthread_mutex_lock(&m_generators_mutex);
     m_all_random_generators.push_back(this);
-    m_random_value = 3141591;
+    m_random_value = nextSeed();
+    pthread_mutex_unlock(&m_generators_mutex);
 }   // RandomGenerator
 
+// ----------------------------------------------------------------------------
+/** Copies a generator (including its state), and registers the copy if the
+ *  original is a race generator. */
+RandomGenerator::RandomGenerator(const RandomGenerator &other)
+{
+    m_a                 = other.m_a;
+    m_c                 = other.m_c;
+    m_random_value      = other.m_random_value;
+    m_is_race_generator = other.m_is_race_generator;
+    if(!m_is_race_generator)
+        return;
+    pthread_mutex_lock(&m_generators_mutex);
+    m_all_random_generators.push_back(this);
+    pthread_mutex_unlock(&m_generators_mutex);
+}   // RandomGenerator(const RandomGenerator&)
+
+// ----------------------------------------------------------------------------
+RandomGenerator::~RandomGenerator()
+{
+    if(!m_is_race_generator)
+        return;
+    pthread_mutex_lock(&m_generators_mutex);
+    std::vector<RandomGenerator*>::iterator i =
+        std::find(m_all_random_generators.begin(),
+                  m_all_random_generators.end(), this);
+    assert(i!=m_all_random_generators.end());
+    m_all_random_generators.erase(i);
+    pthread_mutex_unlock(&m_generators_mutex);
+}   // ~RandomGenerator
+
+// ----------------------------------------------------------------------------
+/** Returns the seed for the next generator: during a race this depends only
+ *  on the race seed and the number of generators seeded so far, otherwise
+ *  rand() is used. Must be called with m_generators_mutex locked.
+ */
+unsigned int RandomGenerator::nextSeed()
+{
+    if(!m_race_active)
+        return (unsigned int)rand();
+
+    // Mix the race seed and the counter, so that consecutive seeds result
+    // in unrelated sequences (the finalizer of MurmurHash3).
+    unsigned int h = m_race_seed + 0x9E3779B9u * (++m_num_race_seeds);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}   // nextSeed
+
+// ----------------------------------------------------------------------------
+/** Seeds all existing random generators for a new race, and makes sure that
+ *  all generators created during the race are seeded from the same seed.
+ *  \param seed The race seed.
+ */
+void RandomGenerator::seedRace(unsigned int seed)
+{
+    pthread_mutex_lock(&m_generators_mutex);
+    m_race_seed      = seed;
+    m_num_race_seeds = 0;
+    m_race_active    = true;
+    for(unsigned int i=0; i<m_all_random_generators.size(); i++)
+        m_all_random_generators[i]->seed(nextSeed());
+    pthread_mutex_unlock(&m_generators_mutex);
+}   // seedRace
+
+// ----------------------------------------------------------------------------
+/** Called at the end of a race: generators created afterwards are seeded
+ *  using rand() again.
+ */
+void RandomGenerator::endRace()
+{
+    pthread_mutex_lock(&m_generators_mutex);
+    m_race_active = false;
+    pthread_mutex_unlock(&m_generators_mutex);
+}   // endRace
+
 // ----------------------------------------------------------------------------
 std::vector<int> RandomGenerator::generateAllSeeds()
 {
     std::vector<int> all_seeds;
+    pthread_mutex_lock(&m_generators_mutex);
     for(unsigned int i=0; i<m_all_random_generators.size(); i++)
     {
         int seed = rand();
         all_seeds.push_back(seed);
         m_all_random_generators[i]->seed(seed);
     }
+    pthread_mutex_unlock(&m_generators_mutex);
     return all_seeds;
 }   // generateAllSeeds
 
-#if 0
-
 // ----------------------------------------------------------------------------
-int RandomGenerator::get(int n)
+/** Tests that seeding a race results in reproducible values, and that the
+ *  values are in the requested range.
+ */
+void RandomGenerator::unitTesting()
 {
-    // This generator is (currently) not good enough, i.e. it often gives
-    // long sequences of same numbers. And the seeding is not done (the
-    // mid term goal is to synchronise all random number generators on
-    // client and server to make less communication necessary).
-    // For now: just use standard random numbers:
-    return rand() % n;
-#ifdef NOT_USED_ATM
-    m_random_value = m_random_value*m_a+m_c;
-    // Note: the lower bits can have a very short cycle, e.g. for n = 4 the
-    // cycle length is 4, meaning that the same sequence 1,2,3,4 is repeated
-    // over and over again. The higher bits are more random, so the lower
-    // 8 bits are discarded.
-    return (m_random_value >> 8) % n;
-#endif
-}   // get
-
-#endif // if 0
+    const bool         saved_active = m_race_active;
+    const unsigned int saved_seed   = m_race_seed;
+    const unsigned int saved_count  = m_num_race_seeds;
+
+    std::vector<int> first;
+    for(unsigned int run=0; run<2; run++)
+    {
+        seedRace(1234);
+        RandomGenerator a, b;
+        std::vector<int> values;
+        for(unsigned int i=0; i<100; i++)
+        {
+            values.push_back(a.get(1000));
+            values.push_back(b.get(7));
+            float f = a.getFloat();
+            assert(f>=0.0f && f<1.0f);
+            (void)f;
+        }
+        if(run==0)
+            first = values;
+        else
+            assert(first==values);
+    }
+
+    // Local generators must not change the seeds of race generators.
+    {
+        seedRace(1234);
+        RandomGenerator a;
+        RandomGenerator local(ST_LOCAL);
+        RandomGenerator b;
+        RandomGenerator local_copy(local);
+        std::vector<int> values;
+        for(unsigned int i=0; i<100; i++)
+        {
+            values.push_back(a.get(1000));
+            values.push_back(b.get(7));
+            a.getFloat();
+            local.get(10);
+        }
+        assert(first==values);
+    }
+
+    // The generator must not get stuck on a few values, and the
+    // two generators must produce different sequences.
+    seedRace(42);
+    RandomGenerator a, b;
+    int count[10] = {0};
+    int equal     = 0;
+    for(unsigned int i=0; i<10000; i++)
+    {
+        int r = a.get(10);
+        assert(r>=0 && r<10);
+        count[r]++;
+        if(r==b.get(10)) equal++;
+    }
+    for(unsigned int i=0; i<10; i++)
+        assert(count[i]>800 && count[i]<1200);
+    assert(equal<1500);
+    (void)equal;
+
+    m_race_active    = saved_active;
+    m_race_seed      = saved_seed;
+    m_num_race_seeds = saved_count;
+}   // unitTesting
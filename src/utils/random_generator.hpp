@@ -20,6 +20,7 @@
 #define HEADER_RANDOM_GENERATOR_HPP
 
 #include <algorithm>
+#include <pthread.h>
 #include <vector>
 #include <stdlib.h>
 
@@ -28,22 +29,85 @@
     by the server. This guarantees that in a network game all 'random' values
     are actually identical among all machines.
     The formula used is x(n+1)=(a*x(n)+c) % m, but m is assumed to be 2^32,
-    so the modulo operation can be skipped (for 4 byte integers).
+    so the modulo operation can be skipped (for 4 byte integers). Since the
+    lower bits of such a generator have very short cycles, only the upper
+    bits are used.
+    At the start of each race all generators are seeded from one race seed
+    (see seedRace), and generators created during a race are seeded from
+    the race seed and the order in which they are created. So a race (or a
+    replayed history) that uses the same race seed and the same time steps
+    makes the same random decisions. Outside of a race new generators are
+    seeded using rand().
+    Generators that are not used for the simulation of the race (e.g. in the
+    GUI, the graphics or the network code) must be created with ST_LOCAL:
+    they are seeded using rand() and are not affected by the race seed, so
+    they do not change the seeds of the race generators created later. Only
+    these local generators may be created on threads other than the main
+    thread.
  */
 class RandomGenerator
 {
+public:
+    /** How a generator is seeded: ST_RACE generators are seeded from the
+     *  race seed, ST_LOCAL generators using rand(). */
+    enum SeedType { ST_RACE, ST_LOCAL };
+
 private:
     unsigned int m_random_value;
     unsigned int m_a, m_c;
+
+    /** True if this generator is seeded from the race seed, i.e. if it is
+     *  in m_all_random_generators. */
+    bool         m_is_race_generator;
+
     static std::vector<RandomGenerator*> m_all_random_generators;
 
+    /** Protects the list of generators and the race seed data. */
+    static pthread_mutex_t m_generators_mutex;
+
+    /** The seed of the current race. */
+    static unsigned int m_race_seed;
+
+    /** Number of generators seeded since the race was seeded. */
+    static unsigned int m_num_race_seeds;
+
+    /** True between seedRace() and endRace(). */
+    static bool m_race_active;
+
+    static unsigned int nextSeed();
+    // ------------------------------------------------------------------------
+    /** Advances the generator and returns the upper 31 bits. */
+    unsigned int next()
+    {
+        m_random_value = m_random_value*m_a+m_c;
+        return m_random_value >> 1;
+    }   // next
+
 public:
-    RandomGenerator();
+    RandomGenerator(SeedType type = ST_RACE);
+    RandomGenerator(const RandomGenerator &other);
+   ~RandomGenerator();
 
     std::vector<int> generateAllSeeds();
-    /** Returns a pseudo random number between 0 and n-1 inclusive */
-    int  get(int n)  {return rand() % n; }
+    static void seedRace(unsigned int seed);
+    static void endRace();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns a pseudo random number between 0 and n-1 inclusive. */
+    int  get(int n)
+    {
+        // Scale the upper bits instead of using modulo, which would
+        // mostly use the lower bits.
+        return (int)(((unsigned long long)next() * (unsigned int)n) >> 31);
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Returns a pseudo random number in [0, 1). */
+    float getFloat() { return (next() >> 7) * (1.0f/16777216.0f); }
+    // ------------------------------------------------------------------------
     void seed(int s) {m_random_value = s;}
+    // ------------------------------------------------------------------------
+    /** Returns the seed of the current (or last) race. */
+    static unsigned int getRaceSeed() { return m_race_seed; }
 };  // RandomGenerator
 
 #endif // HEADER_RANDOM_GENERATOR_HPP
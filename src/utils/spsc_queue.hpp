@@ -0,0 +1,127 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SPSC_QUEUE_HPP
+#define HEADER_SPSC_QUEUE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+
+/** A lock free queue with a fixed capacity for exactly one producer and one
+ *  consumer thread. The elements are stored by value in a ring buffer, so
+ *  no memory is allocated when adding elements. The read and write index
+ *  are kept in separate cache lines, so that producer and consumer do not
+ *  invalidate each other's cache line on every access.
+ *  \param T Type of the elements, must be default constructible and
+ *         assignable.
+ *  \param N Capacity of the queue, must be a power of two.
+ */
+template<typename T, unsigned int N>
+class SPSCQueue : public NoCopy
+{
+private:
+    static_assert((N & (N - 1)) == 0, "Capacity must be a power of two.");
+
+    static const unsigned int CACHE_LINE_SIZE = 64;
+
+    /** Index of the next element to read (not wrapped). Only written by
+     *  the consumer. */
+    std::atomic<unsigned int> m_read;
+
+    /** The consumer's copy of m_write, so that m_write only needs to be
+     *  read again if the queue seems to be empty. */
+    unsigned int              m_cached_write;
+
+    char m_padding_read[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned int>)
+                                        - sizeof(unsigned int)];
+
+    /** Index of the next element to write (not wrapped). Only written by
+     *  the producer. */
+    std::atomic<unsigned int> m_write;
+
+    /** The producer's copy of m_read, so that m_read only needs to be read
+     *  again if the queue seems to be full. */
+    unsigned int              m_cached_read;
+
+    char m_padding_write[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned int>)
+                                         - sizeof(unsigned int)];
+
+    /** The elements. */
+    T m_data[N];
+
+public:
+    SPSCQueue() : m_read(0), m_cached_write(0), m_write(0), m_cached_read(0)
+    {
+    }   // SPSCQueue
+
+    // ------------------------------------------------------------------------
+    /** Adds an element at the end of the queue. Must only be called by the
+     *  producer thread.
+     *  \param t The element to add.
+     *  \return False if the queue is full (the element is not added).
+     */
+    bool push(const T &t)
+    {
+        const unsigned int w = m_write.load(std::memory_order_relaxed);
+        if (w - m_cached_read >= N)
+        {
+            m_cached_read = m_read.load(std::memory_order_acquire);
+            if (w - m_cached_read >= N)
+                return false;
+        }
+        m_data[w & (N - 1)] = t;
+        m_write.store(w + 1, std::memory_order_release);
+        return true;
+    }   // push
+
+    // ------------------------------------------------------------------------
+    /** Removes the first element of the queue. Must only be called by the
+     *  consumer thread.
+     *  \param t On return the removed element.
+     *  \return False if the queue is empty.
+     */
+    bool pop(T *t)
+    {
+        const unsigned int r = m_read.load(std::memory_order_relaxed);
+        if (r == m_cached_write)
+        {
+            m_cached_write = m_write.load(std::memory_order_acquire);
+            if (r == m_cached_write)
+                return false;
+        }
+        *t = m_data[r & (N - 1)];
+        m_read.store(r + 1, std::memory_order_release);
+        return true;
+    }   // pop
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of elements in the queue. This can be called from
+     *  any thread, but the value can be outdated by the time it is used. */
+    unsigned int size() const
+    {
+        return m_write.load(std::memory_order_acquire)
+             - m_read.load(std::memory_order_acquire);
+    }   // size
+
+    // ------------------------------------------------------------------------
+    /** Returns the capacity of the queue. */
+    static unsigned int capacity() { return N; }
+};   // SPSCQueue
+
+#endif
@@ -0,0 +1,207 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/thread_pool.hpp"
+
+#include "config/hardware_stats.hpp"
+#include "utils/log.hpp"
+
+#include <assert.h>
+
+ThreadPool *thread_pool = NULL;
+
+/** Maximum number of worker threads. */
+static const int MAX_WORKER_THREADS = 15;
+
+/** Creates the pool and starts the worker threads.
+ *  \param num_threads Number of threads that work on the tasks (including
+ *         the thread calling run()). If it is negative, one thread for
+ *         each processor is used.
+ */
+ThreadPool::ThreadPool(int num_threads)
+{
+    if (num_threads < 0)
+        num_threads = HardwareStats::getNumProcessors();
+    int num_workers = num_threads - 1;
+    if (num_workers < 0)                  num_workers = 0;
+    if (num_workers > MAX_WORKER_THREADS) num_workers = MAX_WORKER_THREADS;
+
+    m_function     = NULL;
+    m_data         = NULL;
+    m_num_tasks    = 0;
+    m_next_task    = 0;
+    m_batch        = 0;
+    m_busy_workers = 0;
+    m_exit         = false;
+    pthread_mutex_init(&m_mutex,      NULL);
+    pthread_mutex_init(&m_run_mutex,  NULL);
+    pthread_cond_init (&m_start_cond, NULL);
+    pthread_cond_init (&m_done_cond,  NULL);
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &ThreadPool::mainLoop, this) != 0)
+        {
+            Log::warn("ThreadPool", "Could not create worker thread.");
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+    Log::info("ThreadPool", "Using %d threads.", getNumberOfThreads());
+}   // ThreadPool
+
+//-----------------------------------------------------------------------------
+/** Stops all worker threads. */
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_exit = true;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+    for (unsigned int i = 0; i < m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+
+    pthread_cond_destroy (&m_done_cond);
+    pthread_cond_destroy (&m_start_cond);
+    pthread_mutex_destroy(&m_run_mutex);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~ThreadPool
+
+//-----------------------------------------------------------------------------
+/** The main loop of a worker thread: waits till a batch of tasks is started
+ *  and then works on it.
+ *  \param obj Pointer to the thread pool.
+ */
+void *ThreadPool::mainLoop(void *obj)
+{
+    ThreadPool *me = (ThreadPool*)obj;
+    unsigned int batch = 0;
+
+    pthread_mutex_lock(&me->m_mutex);
+    while (true)
+    {
+        // The loop is necessary because of spurious wakeups
+        while (!me->m_exit && me->m_batch == batch)
+            pthread_cond_wait(&me->m_start_cond, &me->m_mutex);
+        if (me->m_exit)
+            break;
+        batch = me->m_batch;
+        pthread_mutex_unlock(&me->m_mutex);
+
+        me->executeTasks();
+
+        pthread_mutex_lock(&me->m_mutex);
+        me->m_busy_workers--;
+        if (me->m_busy_workers == 0)
+            pthread_cond_signal(&me->m_done_cond);
+    }
+    pthread_mutex_unlock(&me->m_mutex);
+    return NULL;
+}   // mainLoop
+
+//-----------------------------------------------------------------------------
+/** Executes tasks of the current batch until all tasks are taken. */
+void ThreadPool::executeTasks()
+{
+    while (true)
+    {
+        unsigned int index = m_next_task.fetch_add(1);
+        if (index >= m_num_tasks)
+            return;
+        m_function(index, m_data);
+    }
+}   // executeTasks
+
+//-----------------------------------------------------------------------------
+/** Executes a function for each task index from 0 to num_tasks-1 and waits
+ *  till all tasks are done. The order in which the tasks are executed is
+ *  undefined.
+ *  \param num_tasks Number of tasks.
+ *  \param function The function to execute for each task.
+ *  \param data A pointer that is given to each call of the function.
+ */
+void ThreadPool::run(unsigned int num_tasks, TaskFunction function,
+                     void *data)
+{
+    if (m_threads.empty() || num_tasks < 2)
+    {
+        for (unsigned int i = 0; i < num_tasks; i++)
+            function(i, data);
+        return;
+    }
+
+    pthread_mutex_lock(&m_run_mutex);
+
+    pthread_mutex_lock(&m_mutex);
+    m_function     = function;
+    m_data         = data;
+    m_num_tasks    = num_tasks;
+    m_next_task    = 0;
+    m_busy_workers = (unsigned int)m_threads.size();
+    m_batch++;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    executeTasks();
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_busy_workers > 0)
+        pthread_cond_wait(&m_done_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_mutex_unlock(&m_run_mutex);
+}   // run
+
+//-----------------------------------------------------------------------------
+/** Data for the unit test. */
+struct ThreadPoolTestData
+{
+    std::vector<unsigned int> m_results;
+    std::atomic<unsigned int> m_count;
+};   // ThreadPoolTestData
+
+// ----------------------------------------------------------------------------
+static void threadPoolTestTask(unsigned int index, void *data)
+{
+    ThreadPoolTestData *test = (ThreadPoolTestData*)data;
+    test->m_results[index] = index*index;
+    test->m_count.fetch_add(1);
+}   // threadPoolTestTask
+
+// ----------------------------------------------------------------------------
+/** Checks that each task is executed exactly once, for several batches and
+ *  for pools with and without worker threads.
+ */
+void ThreadPool::unitTesting()
+{
+    for (int threads = 1; threads <= 4; threads += 3)
+    {
+        ThreadPool pool(threads);
+        for (unsigned int n = 0; n < 1000; n += 37)
+        {
+            ThreadPoolTestData test;
+            test.m_results.resize(n, 0);
+            test.m_count = 0;
+            pool.run(n, &threadPoolTestTask, &test);
+            assert(test.m_count == n);
+            for (unsigned int i = 0; i < n; i++)
+                assert(test.m_results[i] == i*i);
+        }
+    }
+}   // unitTesting
@@ -0,0 +1,102 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_THREAD_POOL_HPP
+#define HEADER_THREAD_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <pthread.h>
+#include <vector>
+
+/** A pool of worker threads to execute many independent tasks in parallel.
+ *  run() executes a function for each index of a range of tasks. The
+ *  calling thread works on the tasks, too, and run() only returns once all
+ *  tasks are done. So the tasks can use data from the caller's stack, and
+ *  the caller can process the results in a deterministic order afterwards.
+ *  The tasks must not call run() themselves.
+ */
+class ThreadPool : public NoCopy
+{
+public:
+    /** The function that is executed for each task.
+     *  \param index Index of the task.
+     *  \param data The data pointer given to run(). */
+    typedef void (*TaskFunction)(unsigned int index, void *data);
+
+private:
+    /** The worker threads. */
+    std::vector<pthread_t> m_threads;
+
+    /** Protects the batch data and the counters below. */
+    pthread_mutex_t m_mutex;
+
+    /** Signalled when a new batch of tasks is started, or the pool is
+     *  shut down. */
+    pthread_cond_t  m_start_cond;
+
+    /** Signalled when the last worker has finished its part of a batch. */
+    pthread_cond_t  m_done_cond;
+
+    /** Makes sure that only one thread at a time uses the pool. */
+    pthread_mutex_t m_run_mutex;
+
+    /** The function to execute for the current batch. */
+    TaskFunction    m_function;
+
+    /** The data for the current batch. */
+    void           *m_data;
+
+    /** Number of tasks in the current batch. */
+    unsigned int    m_num_tasks;
+
+    /** Index of the next task to execute. */
+    std::atomic<unsigned int> m_next_task;
+
+    /** Incremented for each batch, so that a worker can detect a new batch. */
+    unsigned int    m_batch;
+
+    /** Number of workers that still work on the current batch. */
+    unsigned int    m_busy_workers;
+
+    /** Set when the pool is deleted. */
+    bool            m_exit;
+
+    static void *mainLoop(void *obj);
+    void executeTasks();
+
+public:
+                 ThreadPool(int num_threads=-1);
+                ~ThreadPool();
+    void         run(unsigned int num_tasks, TaskFunction function,
+                     void *data);
+    static void  unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads that work on the tasks, including the
+     *  thread calling run(). */
+    unsigned int getNumberOfThreads() const
+    {
+        return (unsigned int)m_threads.size() + 1;
+    }   // getNumberOfThreads
+};   // ThreadPool
+
+extern ThreadPool *thread_pool;
+
+#endif
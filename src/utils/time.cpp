@@ -21,6 +21,10 @@
 #include "graphics/irr_driver.hpp"
 
 #include <ctime>
+#include <pthread.h>
+#ifdef WIN32
+#  include <sys/timeb.h>
+#endif
 
 irr::ITimer *StkTime::m_timer = NULL;
 
@@ -49,6 +53,54 @@ double StkTime::getRealTime(long startAt)
     return m_timer->getRealTime()/1000.0;
 }   // getTimeSinceEpoch
 
+// ----------------------------------------------------------------------------
+/** Returns a time in seconds with (at least) microsecond resolution, based
+ *  on an arbitrary epoch. Unlike getRealTime() this does not use the
+ *  irrlicht timer (which only has millisecond resolution), so it can be
+ *  used to measure short delays, e.g. between threads.
+ */
+double StkTime::getPreciseTime()
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return double(counter.QuadPart) / double(frequency.QuadPart);
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*0.000001;
+#endif
+}   // getPreciseTime
+
+// ----------------------------------------------------------------------------
+/** Computes the absolute time for pthread_cond_timedwait to wait for
+ *  the given number of milliseconds.
+ *  \param msec Number of milliseconds from now.
+ *  \param timeout On return the absolute time.
+ */
+void StkTime::getAbsoluteTimeout(int msec, struct timespec *timeout)
+{
+#ifdef WIN32
+    struct _timeb now;
+    _ftime(&now);
+    timeout->tv_sec  = (long)now.time;
+    timeout->tv_nsec = now.millitm * 1000000;
+#else
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    timeout->tv_sec  = now.tv_sec;
+    timeout->tv_nsec = now.tv_usec * 1000;
+#endif
+    timeout->tv_sec  += msec / 1000;
+    timeout->tv_nsec += (msec % 1000) * 1000000;
+    if (timeout->tv_nsec >= 1000000000)
+    {
+        timeout->tv_sec++;
+        timeout->tv_nsec -= 1000000000;
+    }
+}   // getAbsoluteTimeout
+
 // ----------------------------------------------------------------------------
 /** Returns the current date.
  *  \param day Day (1 - 31).
@@ -31,12 +31,15 @@
 #else
 #  include <stdint.h>
 #  include <sys/time.h>
+#  include <time.h>
 #  include <unistd.h>
 #endif
 
 #include <string>
 #include <stdio.h>
 
+struct timespec;
+
 class StkTime
 {
 private:
@@ -97,6 +100,8 @@ public:
      *  The value is a double precision floating point value in seconds.
      */
     static double getRealTime(long startAt=0);
+    static double getPreciseTime();
+    static void   getAbsoluteTimeout(int msec, struct timespec *timeout);
 
     // ------------------------------------------------------------------------
     /**
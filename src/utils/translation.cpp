@@ -355,8 +355,141 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
 #ifdef TEST_BIDI
     m_rtl = true;
 #endif
+
+    // Convert all translations once, so that w_gettext does not need to
+    // convert strings anymore.
+    pthread_mutex_init(&m_catalog_mutex, NULL);
+    m_catalog.resize(1024);
+    m_catalog_size = 0;
+    CatalogCompiler compiler;
+    compiler.m_translations = this;
+    m_dictionary.foreach(compiler);
+    m_dictionary.foreach_ctxt(compiler);
 }   // Translations
 
+// ----------------------------------------------------------------------------
+Translations::~Translations()
+{
+    pthread_mutex_destroy(&m_catalog_mutex);
+}   // ~Translations
+
+// ----------------------------------------------------------------------------
+/** Adds a message without context to the catalog. */
+void Translations::CatalogCompiler::operator()(const std::string &original,
+                                       const std::vector<std::string> &msgstrs)
+{
+    if (original.empty()) return;
+    const char *s = original.c_str();
+    const std::string &translation =
+        m_translations->m_dictionary.translate(original);
+    m_translations->addCatalogEntry(getCatalogHash(s, NULL), s, NULL,
+                                    translation);
+}   // CatalogCompiler::operator()
+
+// ----------------------------------------------------------------------------
+/** Adds a message with context to the catalog. */
+void Translations::CatalogCompiler::operator()(const std::string &context,
+                                       const std::string &original,
+                                       const std::vector<std::string> &msgstrs)
+{
+    if (original.empty()) return;
+    const char *s = original.c_str();
+    const char *c = context.c_str();
+    const std::string &translation =
+        m_translations->m_dictionary.translate_ctxt(context, original);
+    m_translations->addCatalogEntry(getCatalogHash(s, c), s, c, translation);
+}   // CatalogCompiler::operator()
+
+// ----------------------------------------------------------------------------
+/** Computes the FNV-1a hash of a message and its (optional) context. */
+uint32_t Translations::getCatalogHash(const char *original,
+                                      const char *context)
+{
+    uint32_t hash = 2166136261u;
+    if (context)
+    {
+        for (const char *p = context; *p; p++)
+        {
+            hash ^= (unsigned char)*p;
+            hash *= 16777619u;
+        }
+        // Separator between context and message, as used in .mo files
+        hash ^= 4;
+        hash *= 16777619u;
+    }
+    for (const char *p = original; *p; p++)
+    {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}   // getCatalogHash
+
+// ----------------------------------------------------------------------------
+/** Returns the index of the catalog slot of a message, or of the unused
+ *  slot where it would be inserted. m_catalog_mutex must be locked.
+ */
+unsigned int Translations::findCatalogSlot(uint32_t hash,
+                                           const char *original,
+                                           const char *context) const
+{
+    const unsigned int mask = (unsigned int)m_catalog.size() - 1;
+    for (unsigned int i = hash & mask; ; i = (i + 1) & mask)
+    {
+        const CatalogEntry &entry = m_catalog[i];
+        if (!entry.m_translation)
+            return i;
+        if (entry.m_hash == hash && entry.m_has_context == (context!=NULL) &&
+            entry.m_original == original &&
+            (!context || entry.m_context == context))
+            return i;
+    }
+}   // findCatalogSlot
+
+// ----------------------------------------------------------------------------
+/** Adds a translation to the catalog (the table is doubled in size if it
+ *  is more than half full). m_catalog_mutex must be locked, except when
+ *  the catalog is compiled in the constructor.
+ *  \return The converted translation.
+ */
+const wchar_t* Translations::addCatalogEntry(uint32_t hash,
+                                             const char *original,
+                                             const char *context,
+                                             const std::string &translation)
+{
+    if (2 * (m_catalog_size + 1) > m_catalog.size())
+    {
+        std::vector<CatalogEntry> old_catalog(m_catalog.size() * 2);
+        old_catalog.swap(m_catalog);
+        for (unsigned int i = 0; i < old_catalog.size(); i++)
+        {
+            const CatalogEntry &entry = old_catalog[i];
+            if (!entry.m_translation) continue;
+            const unsigned int mask = (unsigned int)m_catalog.size() - 1;
+            unsigned int j = entry.m_hash & mask;
+            while (m_catalog[j].m_translation)
+                j = (j + 1) & mask;
+            m_catalog[j] = entry;
+        }
+    }
+
+    CatalogEntry &entry = m_catalog[findCatalogSlot(hash, original, context)];
+    if (entry.m_translation)
+        return entry.m_translation;
+
+    m_catalog_strings.push_back(StringUtils::utf8_to_wide(translation.c_str()));
+    const wchar_t *out_ptr = m_catalog_strings.back().c_str();
+    if (REMOVE_BOM) out_ptr++;
+
+    entry.m_hash        = hash;
+    entry.m_has_context = context != NULL;
+    entry.m_context     = context ? context : "";
+    entry.m_original    = original;
+    entry.m_translation = out_ptr;
+    m_catalog_size++;
+    return out_ptr;
+}   // addCatalogEntry
+
 // ----------------------------------------------------------------------------
 
 const wchar_t* Translations::fribidize(const wchar_t* in_ptr)
@@ -442,28 +575,21 @@ const wchar_t* Translations::w_gettext(const char* original, const char* context
     Log::info("Translations", "Translating %s", original);
 #endif
 
-    const std::string& original_t = (context == NULL ?
-                                     m_dictionary.translate(original) :
-                                     m_dictionary.translate_ctxt(context, original));
-
-    if (original_t == original)
+    // Most messages are found in the catalog. Messages without a
+    // translation are converted once and added to the catalog.
+    const uint32_t hash = getCatalogHash(original, context);
+    pthread_mutex_lock(&m_catalog_mutex);
+    const CatalogEntry &entry =
+        m_catalog[findCatalogSlot(hash, original, context)];
+    const wchar_t *out_ptr = entry.m_translation;
+    if (!out_ptr)
     {
-        m_converted_string = StringUtils::utf8_to_wide(original);
-
-#if TRANSLATE_VERBOSE
-        std::wcout << L"  translation : " << m_converted_string << std::endl;
-#endif
-        return m_converted_string.c_str();
+        const std::string& original_t = (context == NULL ?
+                                         m_dictionary.translate(original) :
+                                         m_dictionary.translate_ctxt(context, original));
+        out_ptr = addCatalogEntry(hash, original, context, original_t);
     }
-
-    // print
-    //for (int n=0;; n+=4)
-
-    static core::stringw original_tw;
-    original_tw = StringUtils::utf8_to_wide(original_t.c_str());
-
-    const wchar_t* out_ptr = original_tw.c_str();
-    if (REMOVE_BOM) out_ptr++;
+    pthread_mutex_unlock(&m_catalog_mutex);
 
 #if TRANSLATE_VERBOSE
     std::wcout << L"  translation : " << out_ptr << std::endl;
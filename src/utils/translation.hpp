@@ -20,9 +20,12 @@
 #define TRANSLATION_HPP
 
 #include <irrString.h>
+#include <deque>
+#include <pthread.h>
 #include <vector>
 #include <string>
 #include "utils/string_utils.hpp"
+#include "utils/types.hpp"
 
 #  include "tinygettext/tinygettext.hpp"
 
@@ -51,8 +54,59 @@ private:
 
     std::string m_current_language_name;
 
+    /** An entry of the catalog of converted translations. */
+    struct CatalogEntry
+    {
+        /** Hash of context and message, see getCatalogHash(). */
+        uint32_t       m_hash;
+        /** True if the message has a context. */
+        bool           m_has_context;
+        std::string    m_context;
+        std::string    m_original;
+        /** The translation, or NULL if this slot is unused. */
+        const wchar_t *m_translation;
+        CatalogEntry() : m_translation(NULL) {}
+    };   // CatalogEntry
+
+    /** Adds all messages of a dictionary to the catalog. */
+    struct CatalogCompiler
+    {
+        Translations *m_translations;
+        void operator()(const std::string &original,
+                        const std::vector<std::string> &msgstrs);
+        void operator()(const std::string &context,
+                        const std::string &original,
+                        const std::vector<std::string> &msgstrs);
+    };   // CatalogCompiler
+
+    /** Hash table (open addressing with linear probing) of all translations
+     *  as wide strings, so w_gettext only needs a hash lookup. The table
+     *  is filled when the language is loaded, messages without a
+     *  translation are added when they are requested the first time. */
+    std::vector<CatalogEntry>      m_catalog;
+
+    /** Number of used entries in m_catalog. */
+    unsigned int                   m_catalog_size;
+
+    /** The converted strings. A deque is used so that the pointers
+     *  returned by w_gettext stay valid when more strings are added. */
+    std::deque<irr::core::stringw> m_catalog_strings;
+
+    /** Protects the catalog, since messages can be translated by
+     *  different threads. */
+    pthread_mutex_t                m_catalog_mutex;
+
+    static uint32_t    getCatalogHash(const char *original,
+                                      const char *context);
+    unsigned int       findCatalogSlot(uint32_t hash, const char *original,
+                                       const char *context) const;
+    const wchar_t     *addCatalogEntry(uint32_t hash, const char *original,
+                                       const char *context,
+                                       const std::string &translation);
+
 public:
                        Translations();
+                      ~Translations();
 
     const wchar_t     *w_gettext(const wchar_t* original, const char* context=NULL);
     const wchar_t     *w_gettext(const char* original, const char* context=NULL);
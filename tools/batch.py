@@ -1,77 +1,43 @@
 from matplotlib import pyplot
-from os import listdir
+import csv
 
 
-def is_numeric(x):
-    try:
-        float(x)
-    except ValueError:
-        return False
-    return True
-    
-    
+# Reads the results file written by test.sh, i.e. supertuxkart started with
+# --profile-races=n --profile-results=../../batch/faceoff.csv. ProfileWorld
+# writes one line per kart and race, the lap times of a kart are separated
+# by ';'.
+results_file = '../../batch/faceoff.csv'
+kart_names = ["gnu", "sara", "tux", "elephpant"]
+
 avg_lap_time = {}
 avg_pos = {}
 avg_speed = {}
 avg_top = {}
 total_rescued = {}
-        
-tests = len(listdir('../../batch'))-1    
-for file in listdir('../../batch'):
-    if (file == '.DS_Store'):
-        continue
-    f = open('../../batch/'+file,'r')
-    
-    
-    '''
-    name_index = file.find('.')
-    kart_name = str(file[:name_index])
-    first = file.find('.',name_index+1)
-    track_name = file[name_index+1:first]
-    second = file.find('.',first+1)
-    run = int(file[first+1:second])
-    '''
-    track_name = "snowmountain"
-    kart_names = ["gnu", "sara", "tux", "elephpant"]
-    
-    if track_name == "snowmountain":
-        contents = f.readlines()
-        '''
-        contents = contents[2:contents.index("[debug  ] profile: \n")-1]
-        content = [s for s in contents if kart_name in s]
-        data = [float(x) for x in content[0].split() if is_numeric(x)]
-        if kart_name not in avg_lap_time:
-            avg_lap_time[kart_name] = []
-            avg_pos[kart_name] = []
-            avg_speed[kart_name] = []
-            avg_top[kart_name] = []
-            total_rescued[kart_name] = []
+for kart in kart_names:
+    avg_lap_time[kart] = []
+    avg_pos[kart] = []
+    avg_speed[kart] = []
+    avg_top[kart] = []
+    total_rescued[kart] = []
 
-            avg_lap_time[kart_name].append(data[2]/4)
-            avg_pos[kart_name].append(data[1])
-            avg_speed[kart_name].append(data[3])
-            avg_top[kart_name].append(data[4])
-            total_rescued[kart_name].append(data[7])
-        '''
-        
-        contents = contents[2:6] #TODO check if all is in here
-        for kart in kart_names:
-            content = [s for s in contents if kart in s]
-            data = [float(x) for x in content[0].split() if is_numeric(x)]
-            if kart not in avg_lap_time:
-                avg_lap_time[kart] = []
-                avg_pos[kart] = []
-                avg_speed[kart] = []
-                avg_top[kart] = []
-                total_rescued[kart] = []
-    
-            avg_lap_time[kart].append(data[2]/4)
-            avg_pos[kart].append(data[1])
-            avg_speed[kart].append(data[3])
-            avg_top[kart].append(data[4])
-            total_rescued[kart].append(data[7])
+f = open(results_file, 'r')
+for row in csv.DictReader(f):
+    kart = row['kart']
+    if kart not in avg_lap_time:
+        continue
+    lap_times = [float(x) for x in row['lap_times'].split(';') if x != '']
+    if len(lap_times) > 0:
+        avg_lap_time[kart].append(sum(lap_times)/len(lap_times))
+    else:
+        avg_lap_time[kart].append(float(row['finish_time']))
+    avg_pos[kart].append(float(row['end_position']))
+    avg_speed[kart].append(float(row['average_speed']))
+    avg_top[kart].append(float(row['top_speed']))
+    total_rescued[kart].append(float(row['rescue_count']))
+f.close()
 
-tests = len(avg_lap_time["gnu"])        
+tests = len(avg_lap_time["gnu"])
 print total_rescued
 
 
@@ -81,7 +47,7 @@ for kart in kart_names:
     print "avg_pos for " , kart , ": " , sum(avg_pos[kart])/tests
     print "avg_speed for " , kart , ": " , sum(avg_speed[kart])/tests
     print "avg_top for " , kart , ": " , sum(avg_top[kart])/tests
-    
+
 
 pyplot.subplot(2,2,1)
 pyplot.plot(list(xrange(tests)),avg_pos["gnu"], "b-")